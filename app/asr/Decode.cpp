@@ -25,6 +25,7 @@
 #include "flashlight/app/asr/runtime/runtime.h"
 
 #include "flashlight/lib/common/ProducerConsumerQueue.h"
+#include "flashlight/lib/text/decoder/BatchDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeSeq2SeqDecoder.h"
@@ -174,7 +175,8 @@ int main(int argc, char** argv) {
       FLAGS_silscore,
       FLAGS_eosscore,
       FLAGS_logadd,
-      criterionType);
+      criterionType,
+      FLAGS_hashmerge ? MergeMode::HASH : MergeMode::SORT);
 
   // Prepare log writer
   std::mutex hypMutex, refMutex, logMutex;
@@ -240,7 +242,7 @@ int main(int argc, char** argv) {
           FLAGS_lm_vocab,
           usrDict,
           FLAGS_lm_memory,
-          FLAGS_beamsize);
+          FLAGS_beamsize * FLAGS_decoder_batchsize);
     } else {
       LOG(FATAL) << "[LM constructing] Invalid LM Type: " << FLAGS_lmtype;
     }
@@ -254,9 +256,19 @@ int main(int argc, char** argv) {
   if (FLAGS_wordseparator != "") {
     tokenDict.getIndex(FLAGS_wordseparator);
   }
-  std::shared_ptr<Trie> trie = nullptr;
-  if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
-    trie = std::make_shared<Trie>(tokenDict.indexSize(), silIdx);
+  // Shared by all decoder threads
+  std::shared_ptr<FlatTrie> flatTrie = nullptr;
+  if ((FLAGS_decodertype == "wrd" || FLAGS_uselexicon) &&
+      !FLAGS_flat_trie_path.empty() && fileExists(FLAGS_flat_trie_path)) {
+    flatTrie = FlatTrie::load(FLAGS_flat_trie_path);
+    if (flatTrie->getMaxChildren() != tokenDict.indexSize()) {
+      LOG(FATAL) << "[Decoder] Trie " << FLAGS_flat_trie_path << " has "
+                 << flatTrie->getMaxChildren() << " tokens, expected "
+                 << tokenDict.indexSize();
+    }
+    LOG(INFO) << "[Decoder] Trie loaded from " << FLAGS_flat_trie_path;
+  } else if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
+    auto trie = std::make_shared<Trie>(tokenDict.indexSize(), silIdx);
     auto startState = lm->start(false);
 
     for (auto& it : lexicon) {
@@ -285,6 +297,11 @@ int main(int argc, char** argv) {
     }
     trie->smear(smear_mode);
     LOG(INFO) << "[Decoder] Trie smeared.\n";
+    flatTrie = std::make_shared<FlatTrie>(*trie);
+    if (!FLAGS_flat_trie_path.empty()) {
+      flatTrie->save(FLAGS_flat_trie_path);
+      LOG(INFO) << "[Decoder] Trie saved to " << FLAGS_flat_trie_path;
+    }
   }
 
   /* ===================== AM Forwarding ===================== */
@@ -319,6 +336,7 @@ int main(int argc, char** argv) {
                        &emissionQueue](int tid) {
     // Initialize AM
     af::setDevice(tid);
+    fl::NoGradGuard noGrad;
     std::shared_ptr<fl::Module> localNetwork = network;
     std::shared_ptr<SequenceCriterion> localCriterion = criterion;
     if (tid != 0) {
@@ -391,7 +409,7 @@ int main(int argc, char** argv) {
   /* ===================== Decode ===================== */
   auto runDecoder = [&criterion,
                      &lm,
-                     &trie,
+                     &flatTrie,
                      &silIdx,
                      &blankIdx,
                      &unkWordIdx,
@@ -412,6 +430,9 @@ int main(int argc, char** argv) {
                      &sliceNumSamples,
                      &sliceTime](int tid) {
     try {
+      // The LM and the S2S criterion only run inference
+      fl::NoGradGuard noGrad;
+
       /* 1. Prepare GPU-dependent resources */
       // Note: These 2 GPU-dependent models should be placed on different
       // cards
@@ -442,7 +463,7 @@ int main(int argc, char** argv) {
               FLAGS_lm_vocab,
               usrDict,
               FLAGS_lm_memory,
-              FLAGS_beamsize);
+              FLAGS_beamsize * FLAGS_decoder_batchsize);
         }
 
         if (criterionType == CriterionType::S2S) {
@@ -454,112 +475,103 @@ int main(int argc, char** argv) {
       }
 
       /* 2. Build Decoder */
-      std::unique_ptr<Decoder> decoder;
-      if (criterionType == CriterionType::S2S) {
-        auto amUpdateFunc = FLAGS_criterion == kSeq2SeqCriterion
-            ? buildAmUpdateFunction(localCriterion)
-            : buildTransformerAmUpdateFunction(localCriterion);
-        int eosIdx = tokenDict.getIndex(fl::app::asr::kEosToken);
-
-        if (FLAGS_decodertype == "wrd") {
-          decoder.reset(new LexiconSeq2SeqDecoder(
-              decoderOpt,
-              trie,
-              localLm,
-              eosIdx,
-              amUpdateFunc,
-              FLAGS_maxdecoderoutputlen,
-              false));
-          LOG(INFO)
-              << "[Decoder] LexiconSeq2Seq decoder with word-LM loaded in thread: "
-              << tid;
-        } else if (FLAGS_decodertype == "tkn") {
-          if (FLAGS_uselexicon) {
+      auto createDecoder = [&]() {
+        std::unique_ptr<Decoder> decoder;
+        if (criterionType == CriterionType::S2S) {
+          auto amUpdateFunc = FLAGS_criterion == kSeq2SeqCriterion
+              ? buildAmUpdateFunction(localCriterion)
+              : buildTransformerAmUpdateFunction(localCriterion);
+          int eosIdx = tokenDict.getIndex(fl::app::asr::kEosToken);
+
+          if (FLAGS_decodertype == "wrd") {
             decoder.reset(new LexiconSeq2SeqDecoder(
                 decoderOpt,
-                trie,
+                flatTrie,
                 localLm,
                 eosIdx,
                 amUpdateFunc,
                 FLAGS_maxdecoderoutputlen,
-                true));
+                false));
             LOG(INFO)
-                << "[Decoder] LexiconSeq2Seq decoder with token-LM loaded in thread: "
+                << "[Decoder] LexiconSeq2Seq decoder with word-LM loaded in thread: "
                 << tid;
+          } else if (FLAGS_decodertype == "tkn") {
+            if (FLAGS_uselexicon) {
+              decoder.reset(new LexiconSeq2SeqDecoder(
+                  decoderOpt,
+                  flatTrie,
+                  localLm,
+                  eosIdx,
+                  amUpdateFunc,
+                  FLAGS_maxdecoderoutputlen,
+                  true));
+              LOG(INFO)
+                  << "[Decoder] LexiconSeq2Seq decoder with token-LM loaded in thread: "
+                  << tid;
+            } else {
+              decoder.reset(new LexiconFreeSeq2SeqDecoder(
+                  decoderOpt,
+                  localLm,
+                  eosIdx,
+                  amUpdateFunc,
+                  FLAGS_maxdecoderoutputlen));
+              LOG(INFO)
+                  << "[Decoder] LexiconFreeSeq2Seq decoder with token-LM loaded in thread: "
+                  << tid;
+            }
           } else {
-            decoder.reset(new LexiconFreeSeq2SeqDecoder(
-                decoderOpt,
-                localLm,
-                eosIdx,
-                amUpdateFunc,
-                FLAGS_maxdecoderoutputlen));
-            LOG(INFO)
-                << "[Decoder] LexiconFreeSeq2Seq decoder with token-LM loaded in thread: "
-                << tid;
+            LOG(FATAL) << "Unsupported decoder type: " << FLAGS_decodertype;
           }
         } else {
-          LOG(FATAL) << "Unsupported decoder type: " << FLAGS_decodertype;
-        }
-      } else {
-        if (FLAGS_decodertype == "wrd") {
-          decoder.reset(new LexiconDecoder(
-              decoderOpt,
-              trie,
-              localLm,
-              silIdx,
-              blankIdx,
-              unkWordIdx,
-              transition,
-              false));
-          LOG(INFO)
-              << "[Decoder] Lexicon decoder with word-LM loaded in thread: "
-              << tid;
-        } else if (FLAGS_decodertype == "tkn") {
-          if (FLAGS_uselexicon) {
+          if (FLAGS_decodertype == "wrd") {
             decoder.reset(new LexiconDecoder(
                 decoderOpt,
-                trie,
+                flatTrie,
                 localLm,
                 silIdx,
                 blankIdx,
                 unkWordIdx,
                 transition,
-                true));
+                false));
             LOG(INFO)
-                << "[Decoder] Lexicon decoder with token-LM loaded in thread: "
+                << "[Decoder] Lexicon decoder with word-LM loaded in thread: "
                 << tid;
+          } else if (FLAGS_decodertype == "tkn") {
+            if (FLAGS_uselexicon) {
+              decoder.reset(new LexiconDecoder(
+                  decoderOpt,
+                  flatTrie,
+                  localLm,
+                  silIdx,
+                  blankIdx,
+                  unkWordIdx,
+                  transition,
+                  true));
+              LOG(INFO)
+                  << "[Decoder] Lexicon decoder with token-LM loaded in thread: "
+                  << tid;
+            } else {
+              decoder.reset(new LexiconFreeDecoder(
+                  decoderOpt, localLm, silIdx, blankIdx, transition));
+              LOG(INFO)
+                  << "[Decoder] Lexicon-free decoder with token-LM loaded in thread: "
+                  << tid;
+            }
           } else {
-            decoder.reset(new LexiconFreeDecoder(
-                decoderOpt, localLm, silIdx, blankIdx, transition));
-            LOG(INFO)
-                << "[Decoder] Lexicon-free decoder with token-LM loaded in thread: "
-                << tid;
+            LOG(FATAL) << "Unsupported decoder type: " << FLAGS_decodertype;
           }
-        } else {
-          LOG(FATAL) << "Unsupported decoder type: " << FLAGS_decodertype;
         }
-      }
+        return decoder;
+      };
 
       /* 3. Get data and run decoder */
       TestMeters meters;
-      EmissionTargetPair emissionTargetPair;
-      while (emissionQueue.get(emissionTargetPair)) {
-        const auto& emissionUnit = emissionTargetPair.first;
-        const auto& targetUnit = emissionTargetPair.second;
-
-        const auto& nFrames = emissionUnit.nFrames;
-        const auto& nTokens = emissionUnit.nTokens;
-        const auto& emission = emissionUnit.emission;
-        const auto& sampleId = emissionUnit.sampleId;
-        const auto& wordTarget = targetUnit.wordTargetStr;
-        const auto& tokenTarget = targetUnit.tokenTarget;
-
-        // DecodeResult
-        meters.timer.reset();
-        meters.timer.resume();
-        const auto& results =
-            decoder->decode(emission.data(), nFrames, nTokens);
-        meters.timer.stop();
+      auto processResults = [&](const EmissionTargetPair& emissionTargetPair,
+                                const std::vector<DecodeResult>& results,
+                                double decodeTime) {
+        const auto& sampleId = emissionTargetPair.first.sampleId;
+        const auto& wordTarget = emissionTargetPair.second.wordTargetStr;
+        const auto& tokenTarget = emissionTargetPair.second.tokenTarget;
 
         int nTopHyps = FLAGS_isbeamdump ? results.size() : 1;
         for (int i = 0; i < nTopHyps; i++) {
@@ -622,7 +634,7 @@ int main(int argc, char** argv) {
             // Update conters
             sliceNumWords[tid] += wordTarget.size();
             sliceNumTokens[tid] += letterTarget.size();
-            sliceTime[tid] += meters.timer.value();
+            sliceTime[tid] += decodeTime;
             sliceNumSamples[tid] += 1;
           }
           // Beam Dump
@@ -644,6 +656,69 @@ int main(int argc, char** argv) {
             writeHyp(outString);
           }
         }
+      };
+
+      if (FLAGS_decoder_batchsize <= 1) {
+        auto decoder = createDecoder();
+        EmissionTargetPair emissionTargetPair;
+        while (emissionQueue.get(emissionTargetPair)) {
+          const auto& emissionUnit = emissionTargetPair.first;
+
+          // DecodeResult
+          meters.timer.reset();
+          meters.timer.resume();
+          const auto& results = decoder->decode(
+              emissionUnit.emission.data(),
+              emissionUnit.nFrames,
+              emissionUnit.nTokens);
+          meters.timer.stop();
+          processResults(emissionTargetPair, results, meters.timer.value());
+        }
+      } else {
+        // Decode FLAGS_decoder_batchsize utterances in lockstep, so that the
+        // LM scores all their queries for a frame at once
+        if (criterionType == CriterionType::S2S) {
+          LOG(FATAL) << "Batched decoding is not supported for seq2seq models";
+        }
+        std::vector<std::shared_ptr<Decoder>> decoders;
+        for (int i = 0; i < FLAGS_decoder_batchsize; i++) {
+          decoders.push_back(createDecoder());
+        }
+        BatchDecoder batchDecoder(localLm, decoders);
+
+        // Take several batches from the queue at once, so that the decoders
+        // don't wait for each other at the end of every batch
+        const int maxBatchSize = 4 * FLAGS_decoder_batchsize;
+        std::vector<EmissionTargetPair> batch;
+        std::vector<const float*> emissions;
+        std::vector<int> nFrames;
+        while (true) {
+          batch.clear();
+          EmissionTargetPair emissionTargetPair;
+          while (batch.size() < maxBatchSize &&
+                 emissionQueue.get(emissionTargetPair)) {
+            batch.push_back(std::move(emissionTargetPair));
+          }
+          if (batch.empty()) {
+            break;
+          }
+
+          emissions.clear();
+          nFrames.clear();
+          for (const auto& pair : batch) {
+            emissions.push_back(pair.first.emission.data());
+            nFrames.push_back(pair.first.nFrames);
+          }
+          meters.timer.reset();
+          meters.timer.resume();
+          auto results = batchDecoder.decode(
+              emissions, nFrames, batch.front().first.nTokens);
+          meters.timer.stop();
+          double decodeTime = meters.timer.value() / batch.size();
+          for (int i = 0; i < batch.size(); i++) {
+            processResults(batch[i], results[i], decodeTime);
+          }
+        }
       }
       sliceWer[tid] = meters.werSlice.value()[0];
       sliceLer[tid] = meters.lerSlice.value()[0];
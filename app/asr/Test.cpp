@@ -198,6 +198,7 @@ int main(int argc, char** argv) {
               &sliceTime](int tid) {
     // Initialize AM
     af::setDevice(tid);
+    fl::NoGradGuard noGrad;
     std::shared_ptr<fl::Module> localNetwork = network;
     std::shared_ptr<SequenceCriterion> localCriterion = criterion;
     if (tid != 0) {
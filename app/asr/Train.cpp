@@ -501,6 +501,7 @@ int main(int argc, char** argv) {
                   std::shared_ptr<SequenceCriterion> crit,
                   std::shared_ptr<fl::Dataset> validds,
                   DatasetMeters& mtrs) {
+    fl::NoGradGuard noGrad;
     ntwrk->eval();
     crit->eval();
     mtrs.tknEdit.reset();
@@ -539,7 +540,15 @@ int main(int argc, char** argv) {
                    double initcritlr,
                    bool clampCrit,
                    int64_t nbatches) {
-    if (reducer) {
+    auto phaseReducer = reducer;
+    if (reducer && FLAGS_reducer_bucket_mb > 0) {
+      // Buckets are assigned per training phase since the criterion changes
+      auto bucketed = std::make_shared<fl::BucketedReducer>(
+          1.0 / fl::getWorldSize(), true, FLAGS_reducer_bucket_mb << 20);
+      bucketed->registerParams(ntwrk->params());
+      bucketed->registerParams(crit->params());
+      phaseReducer = bucketed;
+    } else if (reducer) {
       fl::distributeModuleGrads(ntwrk, reducer);
       fl::distributeModuleGrads(crit, reducer);
     }
@@ -688,8 +697,8 @@ int main(int argc, char** argv) {
         netopt->zeroGrad();
         critopt->zeroGrad();
         loss.backward();
-        if (reducer) {
-          reducer->finalize();
+        if (phaseReducer) {
+          phaseReducer->finalize();
         }
         af::sync();
         meters.bwdtimer.stopAndIncUnit();
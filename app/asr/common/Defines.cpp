@@ -194,12 +194,22 @@ DEFINE_double(
 DEFINE_bool(show, false, "show predictions");
 DEFINE_bool(showletters, false, "show letter predictions");
 DEFINE_bool(logadd, false, "use logadd when merging decoder nodes");
+DEFINE_bool(
+    hashmerge,
+    false,
+    "find decoder nodes to merge with a hash table instead of sorting");
 DEFINE_bool(uselexicon, true, "use lexicon in decoding");
 DEFINE_bool(isbeamdump, false, "dump the decoding beam");
 
 DEFINE_string(smearing, "none", "none, max or logadd");
 DEFINE_string(lmtype, "kenlm", "kenlm, convlm");
 DEFINE_string(lexicon, "", "path/to/lexicon.txt");
+DEFINE_string(
+    flat_trie_path,
+    "",
+    "path/to/flat_trie.bin: loaded instead of building the lexicon trie if "
+    "it exists, written after building it otherwise. Delete it when the "
+    "lexicon, tokens, LM or smearing change");
 DEFINE_string(lm_vocab, "", "path/to/lm_vocab.txt");
 DEFINE_string(emission_dir, "", "path/to/emission_dir/");
 DEFINE_string(lm, "", "path/to/language_model");
@@ -223,6 +233,14 @@ DEFINE_int32(beamsize, 2500, "max overall beam size");
 DEFINE_int32(beamsizetoken, 250000, "max beam for token selection");
 DEFINE_int32(nthread_decoder_am_forward, 1, "number of threads for AM forward");
 DEFINE_int32(nthread_decoder, 1, "number of threads for decoding");
+DEFINE_int32(
+    decoder_batchsize,
+    1,
+    "number of utterances each decoding thread decodes in lockstep, scoring "
+    "their LM queries together (lexicon and lexicon-free decoders only). "
+    "With a ConvLM, each thread caches the scores of the whole LM vocabulary "
+    "for beamsize * decoder_batchsize states, i.e. 4 * vocabulary size * "
+    "beamsize * decoder_batchsize bytes");
 DEFINE_int32(
     lm_memory,
     5000,
@@ -334,6 +352,11 @@ DEFINE_string(
     "",
     "Shared file path used for setting up rendezvous."
     "If empty, uses MPI to initialize.");
+DEFINE_int64(
+    reducer_bucket_mb,
+    0,
+    "If > 0, synchronize gradients during backward in buckets of this size "
+    "(in MB) instead of after backward");
 
 // FB SPECIFIC
 DEFINE_string(target, "tkn", "target feature");
@@ -231,12 +231,14 @@ DECLARE_double(am_decoder_tr_layerdrop);
 DECLARE_bool(show);
 DECLARE_bool(showletters);
 DECLARE_bool(logadd);
+DECLARE_bool(hashmerge);
 DECLARE_bool(uselexicon);
 DECLARE_bool(isbeamdump);
 
 DECLARE_string(smearing);
 DECLARE_string(lmtype);
 DECLARE_string(lexicon);
+DECLARE_string(flat_trie_path);
 DECLARE_string(lm_vocab);
 DECLARE_string(emission_dir);
 DECLARE_string(lm);
@@ -257,6 +259,7 @@ DECLARE_int32(beamsize);
 DECLARE_int32(beamsizetoken);
 DECLARE_int32(nthread_decoder_am_forward);
 DECLARE_int32(nthread_decoder);
+DECLARE_int32(decoder_batchsize);
 DECLARE_int32(lm_memory);
 
 DECLARE_int32(emission_queue_size);
@@ -307,6 +310,7 @@ DECLARE_int64(world_rank);
 DECLARE_int64(world_size);
 DECLARE_int64(max_devices_per_node);
 DECLARE_string(rndv_filepath);
+DECLARE_int64(reducer_bucket_mb);
 
 /* ========== FB SPECIFIC ========== */
 DECLARE_string(target);
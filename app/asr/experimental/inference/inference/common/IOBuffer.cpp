@@ -11,12 +11,17 @@
 #include <cstring>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 namespace w2l {
 namespace streaming {
 
 IOBuffer::IOBuffer(int initialSize, const std::string& name)
-    : buf_(initialSize), offsetInBytes_(0), sizeInBytes_(0), name_(name) {}
+    : buf_(initialSize),
+      offsetInBytes_(0),
+      sizeInBytes_(0),
+      name_(name),
+      managedCapacityInBytes_(0) {}
 
 IOBuffer::IOBuffer(const void* buffer, int sizeInBytes, const std::string& name)
     : buf_(
@@ -24,7 +29,8 @@ IOBuffer::IOBuffer(const void* buffer, int sizeInBytes, const std::string& name)
           static_cast<const char*>(buffer) + sizeInBytes),
       offsetInBytes_(0),
       sizeInBytes_(sizeInBytes),
-      name_(name) {
+      name_(name),
+      managedCapacityInBytes_(0) {
   if (sizeInBytes < 0) {
     std::stringstream ss;
     ss << "Invalid index at IOBuffer::IOBuffer(buffer=" << buffer
@@ -33,6 +39,48 @@ IOBuffer::IOBuffer(const void* buffer, int sizeInBytes, const std::string& name)
   }
 }
 
+IOBuffer::IOBuffer(
+    std::shared_ptr<MemoryManager> memoryManager,
+    int capacityInBytes,
+    const std::string& name)
+    : offsetInBytes_(0),
+      sizeInBytes_(0),
+      name_(name),
+      memoryManager_(memoryManager),
+      managedCapacityInBytes_(0) {
+  if (!memoryManager || capacityInBytes < 0) {
+    std::stringstream ss;
+    ss << "Invalid argument at IOBuffer::IOBuffer(memoryManager="
+       << (memoryManager ? memoryManager->debugString() : "nullptr")
+       << " capacityInBytes=" << capacityInBytes << " name=" << name << ")";
+    throw std::invalid_argument(ss.str());
+  }
+  grow(capacityInBytes);
+}
+
+IOBuffer::IOBuffer(const IOBuffer& other)
+    : buf_(other.buf_),
+      offsetInBytes_(other.offsetInBytes_),
+      sizeInBytes_(other.sizeInBytes_),
+      name_(other.name_),
+      memoryManager_(other.memoryManager_),
+      managedCapacityInBytes_(0) {
+  if (other.memoryManager_) {
+    offsetInBytes_ = 0;
+    sizeInBytes_ = 0;
+    grow(other.capacity());
+    write<char>(other.data<char>(), other.size<char>());
+  }
+}
+
+IOBuffer& IOBuffer::operator=(const IOBuffer& other) {
+  if (this != &other) {
+    IOBuffer copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
 int IOBuffer::headRoom() const {
   if (offsetInBytes_ < 0) {
     throw std::runtime_error(
@@ -43,14 +91,53 @@ int IOBuffer::headRoom() const {
 }
 
 int IOBuffer::tailRoom() const {
-  return buf_.size() - headRoom() - sizeInBytes_;
+  return capacity() - headRoom() - sizeInBytes_;
+}
+
+int IOBuffer::capacity() const {
+  return memoryManager_ ? managedCapacityInBytes_ : buf_.size();
+}
+
+char* IOBuffer::storage() {
+  return memoryManager_ ? managedBuf_.get() : buf_.data();
+}
+
+const char* IOBuffer::storage() const {
+  return memoryManager_ ? managedBuf_.get() : buf_.data();
 }
 
 void IOBuffer::reset() {
-  if (buf_.data()) {
-    std::memmove(buf_.data(), data<void>(), sizeInBytes_);
+  if (storage()) {
+    std::memmove(storage(), data<void>(), sizeInBytes_);
+  }
+  offsetInBytes_ = 0;
+}
+
+void IOBuffer::grow(int sizeInBytes) {
+  int finalSize = 0;
+  if (sizeInBytes > 0) {
+    finalSize = pow(2, ceil(log(sizeInBytes) / log(2)));
+  }
+  if (!memoryManager_) {
+    buf_.resize(finalSize);
+    return;
+  }
+  if (finalSize <= managedCapacityInBytes_) {
+    return;
+  }
+  std::shared_ptr<char> newBuf = memoryManager_->makeShared<char>(finalSize);
+  if (!newBuf) {
+    std::stringstream ss;
+    ss << "Failed to allocate " << finalSize
+       << " bytes at IOBuffer::grow() for " << debugString();
+    throw std::runtime_error(ss.str());
+  }
+  if (sizeInBytes_ > 0) {
+    std::memcpy(newBuf.get(), data<char>(), sizeInBytes_);
   }
   offsetInBytes_ = 0;
+  managedBuf_ = newBuf;
+  managedCapacityInBytes_ = finalSize;
 }
 
 std::string IOBuffer::debugString() const {
@@ -62,7 +149,7 @@ std::string IOBuffer::debugStringHelper(const std::string& content) const {
   ss << "IOBuffer:{"
         "name_="
      << name_ << " offsetInBytes_=" << offsetInBytes_
-     << " buf_.size()=" << buf_.size() << " sizeInBytes_=" << sizeInBytes_;
+     << " capacity()=" << capacity() << " sizeInBytes_=" << sizeInBytes_;
   if (!content.empty()) {
     ss << " content:" << content;
   }
@@ -73,6 +160,7 @@ std::string IOBuffer::debugStringHelper(const std::string& content) const {
 void IOBuffer::clear() {
   offsetInBytes_ = 0;
   sizeInBytes_ = 0;
+  // Storage allocated from the memory manager is kept for reuse.
   buf_.clear();
 }
 
@@ -11,21 +11,67 @@
 #include <cereal/archives/xml.hpp>
 #include <cereal/types/vector.hpp>
 #include <algorithm>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "inference/common/MemoryManager.h"
+
 namespace w2l {
 namespace streaming {
 
+// Span-style view of the content of an IOBuffer. It is valid until the next
+// call that writes to the buffer.
+template <typename T>
+struct IOBufferView {
+  T* data;
+  int size;
+
+  T* begin() const {
+    return data;
+  }
+
+  T* end() const {
+    return data + size;
+  }
+
+  T& operator[](int idx) const {
+    return data[idx];
+  }
+
+  bool empty() const {
+    return size == 0;
+  }
+};
+
 // Inspired by folly::IOBuffer
 // Currently memory is unalinged, will make it aligned if it improves
 // performance.
+//
+// consume() only moves the read head. When the write head reaches the end of
+// the storage, the unconsumed content is moved back to the front. The content
+// is always contiguous, and the storage grows to the next power of two only
+// when the unconsumed content and the new write do not fit. A stream in steady
+// state therefore does not allocate.
 class IOBuffer {
  public:
   explicit IOBuffer(int initialSize = 0, const std::string& name = "");
 
   IOBuffer(const void* buffer, int sizeInBytes, const std::string& name = "");
 
+  // Storage is allocated from memoryManager instead of a std::vector, with a
+  // power of two capacity of at least capacityInBytes.
+  IOBuffer(
+      std::shared_ptr<MemoryManager> memoryManager,
+      int capacityInBytes,
+      const std::string& name = "");
+
+  IOBuffer(const IOBuffer& other);
+  IOBuffer(IOBuffer&& other) = default;
+  IOBuffer& operator=(const IOBuffer& other);
+  IOBuffer& operator=(IOBuffer&& other) = default;
+
   template <typename T>
   T* data();
 
@@ -52,6 +98,11 @@ class IOBuffer {
   template <typename T>
   void writeZero(int size);
 
+  // Inserts size zeros in front of the buffer content. Uses the head room when
+  // large enough, otherwise shifts the content in place.
+  template <typename T>
+  void prependZero(int size);
+
   template <typename T>
   void move(int size);
 
@@ -61,28 +112,50 @@ class IOBuffer {
   template <typename T>
   int size() const;
 
+  template <typename T>
+  IOBufferView<T> view();
+
+  template <typename T>
+  IOBufferView<const T> view() const;
+
+  // Capacity of the storage in bytes.
+  int capacity() const;
+
   std::string debugString() const;
 
   template <typename T>
   std::string debugStringWithContent() const;
 
+  // Storage of buffers that are not allocated from a MemoryManager.
   std::vector<char>& buffer();
 
  private:
   int headRoom() const;
   int tailRoom() const;
   void reset();
+  // Grows the storage to the power of two capacity that fits sizeInBytes.
+  void grow(int sizeInBytes);
+  char* storage();
+  const char* storage() const;
   std::string debugStringHelper(const std::string& content = "") const;
 
   std::vector<char> buf_;
   uint32_t offsetInBytes_; // value in bytes
   uint32_t sizeInBytes_; // value in bytes. This is the write head location.
   std::string name_;
+  // Used instead of buf_ when not null.
+  std::shared_ptr<MemoryManager> memoryManager_;
+  std::shared_ptr<char> managedBuf_;
+  uint32_t managedCapacityInBytes_;
 
   friend class cereal::access;
 
   template <class Archive>
   void serialize(Archive& ar) {
+    if (memoryManager_) {
+      throw std::runtime_error(
+          "IOBuffer allocated from a MemoryManager cannot be serialized");
+    }
     ar(buf_, offsetInBytes_, sizeInBytes_, name_);
   }
 };
@@ -117,22 +190,22 @@ T IOBufferAddress(const char* buf, int offsetInBytes, int indexInBytes = 0) {
 
 template <typename T>
 T* IOBuffer::data() {
-  return IOBufferAddress<T*>(buf_.data(), offsetInBytes_);
+  return IOBufferAddress<T*>(storage(), offsetInBytes_);
 }
 
 template <typename T>
 const T* IOBuffer::data() const {
-  return IOBufferAddress<const T*>(buf_.data(), offsetInBytes_);
+  return IOBufferAddress<const T*>(storage(), offsetInBytes_);
 }
 
 template <typename T>
 T* IOBuffer::tail() {
-  return IOBufferAddress<T*>(buf_.data(), offsetInBytes_, sizeInBytes_);
+  return IOBufferAddress<T*>(storage(), offsetInBytes_, sizeInBytes_);
 }
 
 template <typename T>
 const T* IOBuffer::tail() const {
-  return IOBufferAddress<const T*>(buf_.data(), offsetInBytes_, sizeInBytes_);
+  return IOBufferAddress<const T*>(storage(), offsetInBytes_, sizeInBytes_);
 }
 
 template <typename T>
@@ -172,9 +245,7 @@ void IOBuffer::ensure(int size) {
   } else {
     reset();
     // increment similar to std::vector
-    int finalSize = bytes + buf_.size();
-    finalSize = pow(2, ceil(log(finalSize) / log(2)));
-    buf_.resize(finalSize);
+    grow(bytes + capacity());
   }
 }
 
@@ -185,10 +256,12 @@ void IOBuffer::move(int size) {
     ss << "Invalid size at IOBuffer::move[](size=" << size << ")=";
     throw std::invalid_argument(ss.str());
   }
-  if (sizeInBytes_ + size * sizeof(T) > buf_.size()) {
+  if (offsetInBytes_ + sizeInBytes_ + size * sizeof(T) >
+      static_cast<size_t>(capacity())) {
     std::stringstream ss;
     ss << "Cannot move beyond end of buffer IOBuffer::move[](size=" << size
-       << "): sizeInBytes_=" << sizeInBytes_ << " buf_.size()=" << buf_.size();
+       << "): offsetInBytes_=" << offsetInBytes_
+       << " sizeInBytes_=" << sizeInBytes_ << " capacity()=" << capacity();
     throw std::invalid_argument(ss.str());
   }
   sizeInBytes_ += (size * sizeof(T));
@@ -213,12 +286,40 @@ void IOBuffer::writeZero(int size) {
   move<T>(size);
 }
 
+template <typename T>
+void IOBuffer::prependZero(int size) {
+  if (size < 0) {
+    std::stringstream ss;
+    ss << "Invalid size at IOBuffer::prependZero[](size=" << size << ")";
+    throw std::invalid_argument(ss.str());
+  }
+  const int bytes = size * sizeof(T);
+  if (headRoom() < bytes) {
+    ensure<char>(bytes);
+    std::memmove(data<char>() + bytes, data<char>(), sizeInBytes_);
+    offsetInBytes_ += bytes;
+  }
+  offsetInBytes_ -= bytes;
+  sizeInBytes_ += bytes;
+  std::fill_n(data<T>(), size, 0);
+}
+
 template <typename T>
 int IOBuffer::size() const {
   assert(sizeInBytes_ >= 0);
   return sizeInBytes_ / sizeof(T);
 }
 
+template <typename T>
+IOBufferView<T> IOBuffer::view() {
+  return {data<T>(), size<T>()};
+}
+
+template <typename T>
+IOBufferView<const T> IOBuffer::view() const {
+  return {data<T>(), size<T>()};
+}
+
 template <typename T>
 std::string IOBuffer::debugStringWithContent() const {
   std::stringstream ss;
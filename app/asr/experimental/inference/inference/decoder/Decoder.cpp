@@ -13,6 +13,7 @@
 
 #include "flashlight/app/asr/common/Defines.h"
 #include "flashlight/app/asr/decoder/TranscriptionUtils.h"
+#include "flashlight/lib/common/System.h"
 #include "flashlight/lib/text/decoder/LexiconDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeDecoder.h"
 #include "flashlight/lib/text/decoder/lm/KenLM.h"
@@ -30,7 +31,8 @@ DecoderFactory::DecoderFactory(
     const std::vector<float>& transitions,
     fl::lib::text::SmearingMode smearing,
     const std::string& silenceToken,
-    const int repetitionLabel)
+    const int repetitionLabel,
+    const std::string& flatTrieFile)
     : letterMap_(Dictionary(letterDictFile)),
       alphabetSize_(letterMap_.indexSize()),
       repetitionLabel_(repetitionLabel),
@@ -71,9 +73,17 @@ DecoderFactory::DecoderFactory(
   }
 
   /* 4. Plant trie */
-  if (!wordDictFile.empty()) {
+  if (!wordDictFile.empty() && !flatTrieFile.empty() &&
+      fl::lib::fileExists(flatTrieFile)) {
+    trie_ = fl::lib::text::FlatTrie::load(flatTrieFile);
+    if (trie_->getMaxChildren() != static_cast<int>(alphabetSize_)) {
+      throw std::invalid_argument(
+          "Trie file " + flatTrieFile + " doesn't match the letters.");
+    }
+    std::cerr << "[Trie] " << trie_->nNodes() << " nodes loaded.\n";
+  } else if (!wordDictFile.empty()) {
     // Init Trie.
-    trie_ = std::make_shared<fl::lib::text::Trie>(alphabetSize_, silence_);
+    auto trie = std::make_shared<fl::lib::text::Trie>(alphabetSize_, silence_);
     auto startState = lm_->start(false);
     for (const auto& it : lexicon) {
       const std::string& word = it.first;
@@ -85,12 +95,16 @@ DecoderFactory::DecoderFactory(
       for (const auto& tokens : it.second) {
         auto tokensTensor =
             fl::app::asr::tkn2Idx(tokens, letterMap_, repetitionLabel_);
-        trie_->insert(tokensTensor, usrIdx, score);
+        trie->insert(tokensTensor, usrIdx, score);
       }
     }
 
     // Smearing.
-    trie_->smear(smearing);
+    trie->smear(smearing);
+    trie_ = std::make_shared<fl::lib::text::FlatTrie>(*trie);
+    if (!flatTrieFile.empty()) {
+      trie_->save(flatTrieFile);
+    }
   }
 }
 
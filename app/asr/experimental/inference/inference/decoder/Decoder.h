@@ -9,7 +9,7 @@
 #pragma once
 
 #include "flashlight/lib/text/decoder/Decoder.h"
-#include "flashlight/lib/text/decoder/Trie.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 #include "flashlight/lib/text/dictionary/Dictionary.h"
 
@@ -36,7 +36,10 @@ class Decoder;
 // to decode streams.
 class DecoderFactory {
  public:
-  // Loads all the parameters and initializes decoder model.
+  // Loads all the parameters and initializes decoder model. If
+  // `flatTrieFile` exists, the lexicon trie is loaded from it instead of being
+  // planted and smeared, otherwise the built trie is saved to it. The file
+  // must be deleted whenever the other parameters change.
   DecoderFactory(
       const std::string& letterDictFile,
       const std::string& wordDictFile,
@@ -44,7 +47,8 @@ class DecoderFactory {
       const std::vector<float>& transitions,
       fl::lib::text::SmearingMode smearing,
       const std::string& silenceToken,
-      const int repetitionLabel);
+      const int repetitionLabel,
+      const std::string& flatTrieFile = "");
 
   // Creates provided Decoder instance with specified options and allocator.
   // The Decoder instance uses provided allocator to manage its memory.
@@ -66,7 +70,7 @@ class DecoderFactory {
   int unk_;
   int repetitionLabel_;
   fl::lib::text::LMPtr lm_;
-  fl::lib::text::TriePtr trie_;
+  fl::lib::text::FlatTriePtr trie_;
   std::vector<float> transitions_;
 
   // Helper functions to unpack RepLabels from the transcription
@@ -50,7 +50,10 @@ void audioStreamToWordsStream(
   inputAudioStream.ignore(kWavHeaderNumBytes);
 
   const int minChunkSize = kChunkSizeMsec * kAudioWavSamplingFrequency / 1000;
-  auto input = std::make_shared<streaming::ModuleProcessingState>(1);
+  // Stream buffers are allocated once from the module's memory manager and
+  // reused for every chunk.
+  auto input = std::make_shared<streaming::ModuleProcessingState>(
+      1, dnnModule->getMemoryManager(), 2 * minChunkSize * sizeof(float));
   auto inputBuffer = input->buffer(0);
   int audioSampleCount = 0;
 
@@ -40,6 +40,7 @@
  */
 
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <istream>
 #include <ostream>
@@ -63,6 +64,24 @@ using namespace w2l;
 using namespace w2l::streaming;
 
 DEFINE_int32(max_num_threads, 1, "maximum number of threads to use for ASR.");
+DEFINE_int32(
+    max_batch_streams,
+    1,
+    "maximum number of streams whose chunks are batched together through the"
+    " acoustic model. 1 disables batching.");
+DEFINE_int32(
+    max_batch_wait_usec,
+    2000,
+    "maximum time in microseconds a chunk waits for chunks of other streams"
+    " to batch with.");
+DEFINE_int32(
+    batch_workers,
+    1,
+    "number of threads running batches through the acoustic model, when"
+    " max_batch_streams > 1. One worker uses a single core, which caps"
+    " throughput once the streams produce chunks faster than it can run"
+    " them. More workers use more cores, but split the chunks into more,"
+    " smaller batches, which makes each GEMM less efficient.");
 DEFINE_string(
     input_files_base_path,
     ".",
@@ -86,6 +105,12 @@ DEFINE_string(
     "binary file containing ASG criterion transition parameters.");
 DEFINE_string(tokens_file, "tokens.txt", "text file containing tokens.");
 DEFINE_string(lexicon_file, "lexicon.txt", "text file containing lexicon.");
+DEFINE_string(
+    flat_trie_file,
+    "",
+    "binary file the lexicon trie is loaded from if it exists, or saved to "
+    "after it is built otherwise. Saves planting and smearing the trie at "
+    "startup, but must be deleted when the lexicon, tokens or LM change.");
 DEFINE_string(
     input_audio_files,
     "",
@@ -181,7 +206,16 @@ int main(int argc, char* argv[]) {
   // String both modeles togthers to a single DNN.
   auto dnnModule = std::make_shared<streaming::Sequential>();
   dnnModule->add(featureModule);
-  dnnModule->add(acousticModule);
+  if (FLAGS_max_batch_streams > 1) {
+    // The streams run their chunks through the acoustic model together.
+    dnnModule->add(std::make_shared<streaming::BatchScheduler>(
+        acousticModule,
+        FLAGS_max_batch_streams,
+        std::chrono::microseconds(FLAGS_max_batch_wait_usec),
+        FLAGS_batch_workers));
+  } else {
+    dnnModule->add(acousticModule);
+  }
 
   std::vector<std::string> tokens;
   {
@@ -250,7 +284,10 @@ int main(int argc, char* argv[]) {
         transitions,
         fl::lib::text::SmearingMode::MAX,
         FLAGS_silence_token,
-        0);
+        0,
+        FLAGS_flat_trie_file.empty()
+            ? ""
+            : GetInputFileFullPath(FLAGS_flat_trie_file));
   }
 
   {
@@ -102,6 +102,12 @@ DEFINE_string(
     "binary file containing ASG criterion transition parameters.");
 DEFINE_string(tokens_file, "tokens.txt", "text file containing tokens.");
 DEFINE_string(lexicon_file, "lexicon.txt", "text file containing lexicon.");
+DEFINE_string(
+    flat_trie_file,
+    "",
+    "binary file the lexicon trie is loaded from if it exists, or saved to "
+    "after it is built otherwise. Saves planting and smearing the trie at "
+    "startup, but must be deleted when the lexicon, tokens or LM change.");
 DEFINE_string(
     input_audio_file,
     "",
@@ -229,7 +235,10 @@ int main(int argc, char* argv[]) {
         transitions,
         fl::lib::text::SmearingMode::MAX,
         FLAGS_silence_token,
-        0);
+        0,
+        FLAGS_flat_trie_file.empty()
+            ? ""
+            : GetInputFileFullPath(FLAGS_flat_trie_file));
   }
 
   if (FLAGS_input_audio_file.empty()) {
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+/**
+ * User guide
+ * ----------
+ *
+ * Compares the speed and the accuracy of the int8 quantized acoustic model
+ * modules (LinearFbGemmInt8, Conv1dFbGemmInt8) against the default fp16 ones
+ * (LinearFbGemm, Conv1dFbGemm) on a stack of TDS blocks with random weights.
+ * Both models stream the same random input, chunk by chunk.
+ *
+ * tds_int8_benchmark --num_tds_blocks 10 --channels 15 --feature_size 80
+ *                    --chunk_frames 50 --num_chunks 100
+ *
+ * It prints the time per chunk of both models, the speedup of the int8 one,
+ * and the max and mean absolute differences between their outputs.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "inference/module/module.h"
+#include "inference/module/nn/nn.h"
+
+using namespace w2l;
+using namespace w2l::streaming;
+
+DEFINE_int32(num_tds_blocks, 10, "number of TDS blocks in the model.");
+DEFINE_int32(channels, 15, "number of channels of the TDS blocks.");
+DEFINE_int32(feature_size, 80, "feature size of the TDS blocks.");
+DEFINE_int32(kernel_size, 9, "kernel size of the TDS convolutions.");
+DEFINE_int32(chunk_frames, 50, "number of frames per streamed chunk.");
+DEFINE_int32(num_chunks, 100, "number of streamed chunks.");
+
+namespace {
+
+std::mt19937 generator(0);
+
+std::shared_ptr<ModuleParameter> randParam(int size, int fanIn) {
+  std::normal_distribution<float> distribution(0, 1 / std::sqrt(fanIn));
+  std::vector<float> values(size);
+  for (auto& value : values) {
+    value = distribution(generator);
+  }
+  return std::make_shared<ModuleParameter>(
+      DataType::FLOAT, values.data(), values.size());
+}
+
+// Returns the same model with fp16 and with int8 weights.
+std::pair<std::shared_ptr<Sequential>, std::shared_ptr<Sequential>>
+createModels() {
+  const int dim = FLAGS_channels * FLAGS_feature_size;
+  const int convFanIn = FLAGS_kernel_size * FLAGS_channels;
+  const int leftPadding = FLAGS_kernel_size - 1;
+  auto fp16Model = std::make_shared<Sequential>();
+  auto int8Model = std::make_shared<Sequential>();
+  for (int i = 0; i < FLAGS_num_tds_blocks; ++i) {
+    auto convWeights = randParam(
+        FLAGS_kernel_size * FLAGS_channels * FLAGS_channels, convFanIn);
+    auto convBias = randParam(FLAGS_channels, convFanIn);
+    auto lin1Weights = randParam(dim * dim, dim);
+    auto lin1Bias = randParam(dim, dim);
+    auto lin2Weights = randParam(dim * dim, dim);
+    auto lin2Bias = randParam(dim, dim);
+
+    fp16Model->add(std::make_shared<TDSBlock>(
+        createConv1d(
+            dim,
+            dim,
+            FLAGS_kernel_size,
+            1,
+            {leftPadding, 0},
+            FLAGS_feature_size,
+            convWeights,
+            convBias),
+        std::make_shared<LayerNorm>(dim, 1.0, 0.0),
+        createLinear(dim, dim, lin1Weights, lin1Bias),
+        createLinear(dim, dim, lin2Weights, lin2Bias),
+        std::make_shared<LayerNorm>(dim, 1.0, 0.0),
+        DataType::FLOAT,
+        DataType::FLOAT));
+    int8Model->add(std::make_shared<TDSBlock>(
+        std::make_shared<Conv1dFbGemmInt8>(
+            dim,
+            dim,
+            FLAGS_kernel_size,
+            1,
+            0,
+            leftPadding,
+            FLAGS_feature_size,
+            convWeights,
+            convBias),
+        std::make_shared<LayerNorm>(dim, 1.0, 0.0),
+        std::make_shared<LinearFbGemmInt8>(dim, dim, lin1Weights, lin1Bias),
+        std::make_shared<LinearFbGemmInt8>(dim, dim, lin2Weights, lin2Bias),
+        std::make_shared<LayerNorm>(dim, 1.0, 0.0),
+        DataType::FLOAT,
+        DataType::FLOAT));
+  }
+  return {fp16Model, int8Model};
+}
+
+// Streams the chunks through the model. Returns the output and adds the
+// processing time to elapsedMsec.
+std::vector<float> runModel(
+    std::shared_ptr<Sequential> model,
+    const std::vector<std::vector<float>>& chunks,
+    double& elapsedMsec) {
+  auto input = std::make_shared<ModuleProcessingState>(1);
+  auto output = model->start(input);
+  std::vector<float> result;
+  for (const auto& chunk : chunks) {
+    input->buffer(0)->write<float>(chunk.data(), chunk.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    model->run(input);
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsedMsec +=
+        std::chrono::duration<double, std::milli>(end - start).count();
+
+    auto outputBuf = output->buffer(0);
+    result.insert(
+        result.end(),
+        outputBuf->data<float>(),
+        outputBuf->data<float>() + outputBuf->size<float>());
+    outputBuf->consume<float>(outputBuf->size<float>());
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  auto models = createModels();
+
+  const int dim = FLAGS_channels * FLAGS_feature_size;
+  std::normal_distribution<float> distribution(0, 1);
+  std::vector<std::vector<float>> chunks(FLAGS_num_chunks);
+  for (auto& chunk : chunks) {
+    chunk.resize(FLAGS_chunk_frames * dim);
+    for (auto& value : chunk) {
+      value = distribution(generator);
+    }
+  }
+
+  // Warm up
+  double fp16Msec = 0;
+  double int8Msec = 0;
+  runModel(models.first, {chunks.front()}, fp16Msec);
+  runModel(models.second, {chunks.front()}, int8Msec);
+
+  fp16Msec = 0;
+  int8Msec = 0;
+  auto fp16Output = runModel(models.first, chunks, fp16Msec);
+  auto int8Output = runModel(models.second, chunks, int8Msec);
+
+  double maxError = 0;
+  double sumError = 0;
+  for (int i = 0; i < fp16Output.size(); ++i) {
+    double error = std::fabs(fp16Output[i] - int8Output[i]);
+    maxError = std::max(maxError, error);
+    sumError += error;
+  }
+
+  std::cout << "fp16: " << fp16Msec / FLAGS_num_chunks << " msec per chunk"
+            << std::endl;
+  std::cout << "int8: " << int8Msec / FLAGS_num_chunks
+            << " msec per chunk (speedup x" << fp16Msec / int8Msec << ")"
+            << std::endl;
+  std::cout << "int8 vs fp16 output: max abs error=" << maxError
+            << " mean abs error="
+            << sumError / std::max<size_t>(fp16Output.size(), 1) << std::endl;
+  return 0;
+}
@@ -15,6 +15,16 @@ namespace streaming {
 InferenceModule::InferenceModule()
     : memoryManager_(std::make_shared<DefaultMemoryManager>()) {}
 
+std::vector<std::shared_ptr<ModuleProcessingState>> InferenceModule::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  for (auto& input : inputs) {
+    outputs.push_back(run(input));
+  }
+  return outputs;
+}
+
 void InferenceModule::setMemoryManager(
     std::shared_ptr<MemoryManager> memoryManager) {
   memoryManager_ = memoryManager;
@@ -48,10 +48,22 @@ class InferenceModule {
     return run(input);
   }
 
+  // Same as calling run() on each input, where each input is the state of a
+  // different stream. Modules that can process the streams together, such as
+  // GEMM based layers that stack the frames of all the streams into a single
+  // matrix multiplication, override it. Returns the output state of each
+  // input, in order.
+  virtual std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs);
+
   virtual void clear() {}
 
   virtual void setMemoryManager(std::shared_ptr<MemoryManager> memoryManager);
 
+  std::shared_ptr<MemoryManager> getMemoryManager() const {
+    return memoryManager_;
+  }
+
   virtual std::string debugString() const = 0;
 
  protected:
@@ -14,7 +14,15 @@
 namespace w2l {
 namespace streaming {
 
-ModuleProcessingState::ModuleProcessingState(int numOfBuffers) {
+ModuleProcessingState::ModuleProcessingState(int numOfBuffers)
+    : ModuleProcessingState(numOfBuffers, nullptr, 0) {}
+
+ModuleProcessingState::ModuleProcessingState(
+    int numOfBuffers,
+    std::shared_ptr<MemoryManager> memoryManager,
+    int bufferCapacityInBytes)
+    : memoryManager_(memoryManager),
+      bufferCapacityInBytes_(bufferCapacityInBytes) {
   // Typically a module has a single input and a single output. While a module
   // may have more, it is unlikely to have more than a few.
   if (numOfBuffers <= 0 || numOfBuffers > 100) {
@@ -24,8 +32,15 @@ ModuleProcessingState::ModuleProcessingState(int numOfBuffers) {
     throw std::invalid_argument(ss.str());
   }
   while (buffers_.size() < numOfBuffers) {
-    buffers_.push_back(std::make_shared<IOBuffer>());
+    buffers_.push_back(createBuffer());
+  }
+}
+
+std::shared_ptr<IOBuffer> ModuleProcessingState::createBuffer() const {
+  if (memoryManager_) {
+    return std::make_shared<IOBuffer>(memoryManager_, bufferCapacityInBytes_);
   }
+  return std::make_shared<IOBuffer>();
 }
 
 std::vector<std::shared_ptr<IOBuffer>>& ModuleProcessingState::buffers() {
@@ -46,7 +61,8 @@ std::shared_ptr<ModuleProcessingState> ModuleProcessingState::next(
     bool createIfNotExists,
     int numOfBuffers) {
   if (!next_ && createIfNotExists) {
-    next_ = std::make_shared<ModuleProcessingState>(numOfBuffers);
+    next_ = std::make_shared<ModuleProcessingState>(
+        numOfBuffers, memoryManager_, bufferCapacityInBytes_);
   }
   return next_;
 }
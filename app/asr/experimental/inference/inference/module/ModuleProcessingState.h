@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "inference/common/IOBuffer.h"
+#include "inference/common/MemoryManager.h"
 
 namespace w2l {
 namespace streaming {
@@ -23,10 +24,23 @@ class ModuleProcessingState {
  public:
   explicit ModuleProcessingState(int numOfBuffers);
 
+  // The buffers of this state, and of all the states that follow it, are
+  // allocated from memoryManager with an initial capacity of
+  // bufferCapacityInBytes. Sizing the capacity for the largest chunk of the
+  // stream avoids any allocation after the first chunk.
+  ModuleProcessingState(
+      int numOfBuffers,
+      std::shared_ptr<MemoryManager> memoryManager,
+      int bufferCapacityInBytes);
+
   std::vector<std::shared_ptr<IOBuffer>>& buffers();
 
   std::shared_ptr<IOBuffer> buffer(int idx);
 
+  // Returns a new buffer with the same allocation policy as the buffers of
+  // this state.
+  std::shared_ptr<IOBuffer> createBuffer() const;
+
   // A modules knows the number of output buffers it processes. Before first
   // inference pass the list of ModuleProcessingState has only the input
   // element. When first calling Module::start() on the first module in the
@@ -40,6 +54,8 @@ class ModuleProcessingState {
  private:
   std::vector<std::shared_ptr<IOBuffer>> buffers_;
   std::shared_ptr<ModuleProcessingState> next_;
+  std::shared_ptr<MemoryManager> memoryManager_;
+  int bufferCapacityInBytes_;
 };
 
 } // namespace streaming
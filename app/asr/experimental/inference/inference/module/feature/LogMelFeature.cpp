@@ -55,11 +55,14 @@ std::shared_ptr<ModuleProcessingState> LogMelFeature::run(
   if (numFrames == 0) {
     return output;
   }
-  std::vector<float> inputVec(inputBuf->data<float>(), inputBuf->tail<float>());
-  auto outputVec = mfscFeaturizer_->apply(inputVec);
-
-  assert(outputVec.size() == numFrames * numFilters_);
-  outputBuf->write<float>(outputVec.data(), outputVec.size());
+  // Frames are featurized in place from the input buffer and written directly
+  // to the output buffer. The overlap of the last frame with the next one stays
+  // in the input buffer for the next call.
+  const int outputSize = numFrames * featParams_.mfscFeatSz();
+  outputBuf->ensure<float>(outputSize);
+  mfscFeaturizer_->applyFrames(
+      inputBuf->data<float>(), numFrames, outputBuf->tail<float>());
+  outputBuf->move<float>(outputSize);
   inputBuf->consume<float>(numFrames * featParams_.numFrameStrideSamples());
   return output;
 }
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "inference/module/nn/BatchScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+
+namespace w2l {
+namespace streaming {
+
+BatchScheduler::BatchScheduler(
+    std::shared_ptr<InferenceModule> module,
+    int maxBatchSize,
+    std::chrono::microseconds maxWait,
+    int numWorkers)
+    : module_(module),
+      maxBatchSize_(maxBatchSize),
+      maxWait_(maxWait),
+      gathering_(false),
+      stop_(false) {
+  if (!module || maxBatchSize <= 0 || maxWait.count() < 0 ||
+      numWorkers <= 0) {
+    std::stringstream ss;
+    ss << "Invalid argument at BatchScheduler::BatchScheduler(module="
+       << (module ? module->debugString() : "nullptr")
+       << " maxBatchSize=" << maxBatchSize
+       << " maxWait(usec)=" << maxWait.count()
+       << " numWorkers=" << numWorkers << ")";
+    throw std::invalid_argument(ss.str());
+  }
+  for (int i = 0; i < numWorkers; ++i) {
+    workers_.emplace_back(&BatchScheduler::processBatches, this);
+  }
+}
+
+BatchScheduler::~BatchScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::shared_ptr<ModuleProcessingState> BatchScheduler::start(
+    std::shared_ptr<ModuleProcessingState> input) {
+  return module_->start(input);
+}
+
+std::shared_ptr<ModuleProcessingState> BatchScheduler::run(
+    std::shared_ptr<ModuleProcessingState> input) {
+  return runBatch({input})[0];
+}
+
+std::shared_ptr<ModuleProcessingState> BatchScheduler::finish(
+    std::shared_ptr<ModuleProcessingState> input) {
+  return module_->finish(input);
+}
+
+std::vector<std::shared_ptr<ModuleProcessingState>> BatchScheduler::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  std::vector<Request> requests(inputs.size());
+  std::vector<std::future<std::shared_ptr<ModuleProcessingState>>> futures;
+  futures.reserve(inputs.size());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      throw std::runtime_error(
+          "BatchScheduler::runBatch() is called while stopping.");
+    }
+    const auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < inputs.size(); ++i) {
+      assert(inputs[i]);
+      requests[i].input = inputs[i];
+      requests[i].enqueueTime = now;
+      futures.push_back(requests[i].output.get_future());
+      pending_.push_back(&requests[i]);
+    }
+  }
+  cv_.notify_all();
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  for (auto& future : futures) {
+    outputs.push_back(future.get());
+  }
+  return outputs;
+}
+
+void BatchScheduler::processBatches() {
+  std::vector<Request*> batch;
+  std::vector<std::shared_ptr<ModuleProcessingState>> inputs;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // One worker at a time gathers a batch, the others wait for their turn
+      cv_.wait(lock, [this] {
+        return stop_ || (!gathering_ && !pending_.empty());
+      });
+      if (pending_.empty()) {
+        return;
+      }
+      // Give the other streams until maxWait_ after the oldest request to
+      // join the batch.
+      gathering_ = true;
+      cv_.wait_until(lock, pending_.front()->enqueueTime + maxWait_, [this] {
+        return stop_ || pending_.size() >= maxBatchSize_;
+      });
+      gathering_ = false;
+      // Other workers may have emptied pending_ while stopping
+      const int batchSize =
+          std::min(static_cast<int>(pending_.size()), maxBatchSize_);
+      batch.assign(pending_.begin(), pending_.begin() + batchSize);
+      pending_.erase(pending_.begin(), pending_.begin() + batchSize);
+    }
+    // Let the next worker gather a batch while this one runs
+    cv_.notify_all();
+    if (batch.empty()) {
+      continue;
+    }
+
+    inputs.clear();
+    for (Request* request : batch) {
+      inputs.push_back(request->input);
+    }
+    std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+    try {
+      outputs = module_->runBatch(inputs);
+    } catch (...) {
+      for (Request* request : batch) {
+        request->output.set_exception(std::current_exception());
+      }
+      continue;
+    }
+    assert(outputs.size() == batch.size());
+    for (int i = 0; i < batch.size(); ++i) {
+      batch[i]->output.set_value(outputs[i]);
+    }
+  }
+}
+
+void BatchScheduler::setMemoryManager(
+    std::shared_ptr<MemoryManager> memoryManager) {
+  InferenceModule::setMemoryManager(memoryManager);
+  module_->setMemoryManager(memoryManager);
+}
+
+std::string BatchScheduler::debugString() const {
+  std::stringstream ss;
+  ss << "BatchScheduler:{maxBatchSize_=" << maxBatchSize_
+     << " maxWait_(usec)=" << maxWait_.count()
+     << " workers_.size()=" << workers_.size()
+     << " module_=" << module_->debugString() << "}";
+  return ss.str();
+}
+
+} // namespace streaming
+} // namespace w2l
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inference/module/InferenceModule.h"
+#include "inference/module/ModuleProcessingState.h"
+
+namespace w2l {
+namespace streaming {
+
+// Micro-batches the run() calls of concurrent streams. Each stream runs on its
+// own thread and calls run() with its processing state. The calls are queued,
+// and a worker thread gathers the chunks that are ready, up to maxBatchSize of
+// them, and processes them with a single runBatch() call on the wrapped
+// module. Layers such as LinearFbGemm and Conv1dFbGemm then run one GEMM with
+// the frames of all the streams instead of one small GEMM per stream.
+//
+// The first queued chunk waits at most maxWait for other streams to join its
+// batch. start() and finish() are not batched and run on the caller's thread.
+//
+// With numWorkers > 1, one worker at a time gathers a batch, and the next one
+// starts gathering as soon as it is handed off, so several batches run
+// concurrently on as many cores. The wrapped module must then support
+// concurrent runBatch() calls. More workers raise throughput when a single
+// worker can't keep up with the streams, at the cost of smaller batches, and
+// thus smaller GEMMs, when it can.
+//
+// Example:
+//   auto dnnModule = std::make_shared<Sequential>();
+//   dnnModule->add(featureModule);
+//   dnnModule->add(std::make_shared<BatchScheduler>(
+//       acousticModule, 16, std::chrono::microseconds(2000), 2));
+//   // Streams then share dnnModule as usual, from different threads.
+class BatchScheduler : public InferenceModule {
+ public:
+  BatchScheduler(
+      std::shared_ptr<InferenceModule> module,
+      int maxBatchSize,
+      std::chrono::microseconds maxWait,
+      int numWorkers = 1);
+
+  virtual ~BatchScheduler() override;
+
+  std::shared_ptr<ModuleProcessingState> start(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  // Blocks until the input is processed together with the inputs of other
+  // streams.
+  std::shared_ptr<ModuleProcessingState> run(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  std::shared_ptr<ModuleProcessingState> finish(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
+  void setMemoryManager(std::shared_ptr<MemoryManager> memoryManager) override;
+
+  std::string debugString() const override;
+
+ private:
+  struct Request {
+    std::shared_ptr<ModuleProcessingState> input;
+    std::promise<std::shared_ptr<ModuleProcessingState>> output;
+    std::chrono::steady_clock::time_point enqueueTime;
+  };
+
+  // Worker threads loop
+  void processBatches();
+
+  std::shared_ptr<InferenceModule> module_;
+  const int maxBatchSize_;
+  const std::chrono::microseconds maxWait_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // Requests are owned by the threads waiting for them in runBatch()
+  std::deque<Request*> pending_;
+  // Whether a worker is waiting for pending_ to fill up a batch
+  bool gathering_;
+  bool stop_;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace streaming
+} // namespace w2l
@@ -32,7 +32,7 @@ Residual::Residual()
 std::shared_ptr<ModuleProcessingState> Residual::start(
     std::shared_ptr<ModuleProcessingState> input) {
   // add one more buffer to store a copy of input
-  input->buffers().push_back(std::make_shared<IOBuffer>());
+  input->buffers().push_back(input->createBuffer());
   input->buffers().back()->write<char>(
       input->buffer(0)->data<char>(), input->buffer(0)->size<char>());
 
@@ -76,6 +76,33 @@ std::shared_ptr<ModuleProcessingState> Residual::finish(
   return identity_->finish(residualSum);
 }
 
+std::vector<std::shared_ptr<ModuleProcessingState>> Residual::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  for (auto& input : inputs) {
+    input->buffers().back()->write<char>(
+        input->buffer(0)->data<char>(), input->buffer(0)->size<char>());
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> inputCopies =
+      identity_->runBatch(inputs);
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs =
+      module_->runBatch(inputCopies);
+  assert(outputs.size() == inputs.size());
+  std::vector<std::shared_ptr<ModuleProcessingState>> residualSums;
+  residualSums.reserve(inputs.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    assert(outputs[i]);
+    std::shared_ptr<ModuleProcessingState> residualSum = outputs[i]->next();
+    assert(residualSum);
+    sum(inputs[i]->buffers().back(),
+        outputs[i]->buffer(0),
+        residualSum->buffer(0));
+    residualSums.push_back(residualSum);
+  }
+  return identity_->runBatch(residualSums);
+}
+
 void Residual::setMemoryManager(std::shared_ptr<MemoryManager> memoryManager) {
   InferenceModule::setMemoryManager(memoryManager);
   module_->setMemoryManager(memoryManager);
@@ -53,6 +53,17 @@ std::shared_ptr<ModuleProcessingState> Sequential::finish(
   return intermediateInput;
 }
 
+std::vector<std::shared_ptr<ModuleProcessingState>> Sequential::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  std::vector<std::shared_ptr<ModuleProcessingState>> intermediateInputs =
+      inputs;
+  for (auto& module : modules_) {
+    assert(module);
+    intermediateInputs = module->runBatch(intermediateInputs);
+  }
+  return intermediateInputs;
+}
+
 void Sequential::setMemoryManager(
     std::shared_ptr<MemoryManager> memoryManager) {
   InferenceModule::setMemoryManager(memoryManager);
@@ -38,6 +38,10 @@ class Sequential : public InferenceModule {
   std::shared_ptr<ModuleProcessingState> finish(
       std::shared_ptr<ModuleProcessingState> input) override;
 
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
   void setMemoryManager(std::shared_ptr<MemoryManager> memoryManager) override;
 
   virtual std::string debugString() const override;
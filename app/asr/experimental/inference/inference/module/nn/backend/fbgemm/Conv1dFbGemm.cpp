@@ -9,6 +9,7 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include "inference/common/IOBuffer.h"
 
@@ -61,6 +62,36 @@ void Conv1dFbGemm::init(std::shared_ptr<ModuleParameter> weights) {
       (outChannels_ / groups_), // n
       alpha,
       weights->buffer_.data<float>());
+  initKernelTaps();
+}
+
+void Conv1dFbGemm::initKernelTaps() {
+  packedKernelTaps_.clear();
+  if (stride_ != 1) {
+    return;
+  }
+  // The rows of packedWeights_ are ordered by kernel tap, then by input
+  // channel. Split them into one (inChannels_ / groups_) x
+  // (outChannels_ / groups_) matrix per tap.
+  const int k = packedWeights_->numRows();
+  const int n = packedWeights_->numCols();
+  const int tapSize = (k / kernelSize_) * n;
+  std::vector<fbgemm::float16> unpacked(k * n);
+  packedWeights_->unpack(unpacked.data(), fbgemm::matrix_op_t::NoTranspose);
+
+  constexpr float alpha = 1.0;
+  std::vector<float> tap(tapSize);
+  for (int ts = 0; ts < kernelSize_; ++ts) {
+    for (int i = 0; i < tapSize; ++i) {
+      tap[i] = fbgemm::cpu_half2float(unpacked[ts * tapSize + i]);
+    }
+    packedKernelTaps_.push_back(std::make_shared<fbgemm::PackedGemmMatrixFP16>(
+        fbgemm::matrix_op_t::NoTranspose,
+        k / kernelSize_,
+        n,
+        alpha,
+        tap.data()));
+  }
 }
 
 std::string Conv1dFbGemm::debugString() const {
@@ -80,10 +111,7 @@ std::shared_ptr<ModuleProcessingState> Conv1dFbGemm::start(
     std::shared_ptr<IOBuffer> inputBuf = input->buffer(0);
     assert(inputBuf);
 
-    IOBuffer tempBuf = *inputBuf;
-    inputBuf->clear();
-    inputBuf->writeZero<float>(leftPadding_ * inChannels_);
-    inputBuf->write<float>(tempBuf.data<float>(), tempBuf.size<float>());
+    inputBuf->prependZero<float>(leftPadding_ * inChannels_);
   }
   return input->next(true, 1);
 }
@@ -100,7 +128,6 @@ std::shared_ptr<ModuleProcessingState> Conv1dFbGemm::finish(
   return run(input);
 }
 
-namespace {
 void unfoldDepthwise(
     float* dst,
     const float* src,
@@ -120,7 +147,6 @@ void unfoldDepthwise(
     }
   }
 }
-} // namespace
 
 std::shared_ptr<ModuleProcessingState> Conv1dFbGemm::run(
     std::shared_ptr<ModuleProcessingState> input) {
@@ -154,34 +180,133 @@ std::shared_ptr<ModuleProcessingState> Conv1dFbGemm::run(
         outPtr + i * (outChannels_ / groups_));
   }
 
+  constexpr float beta = 1.0;
+  if (!packedKernelTaps_.empty()) {
+    // With a unit stride, the inputs met by kernel tap ts in all the output
+    // frames form a contiguous (nOutFrames * groups_) x (inChannels_ / groups_)
+    // matrix that starts ts frames into the input buffer. Accumulate one GEMM
+    // per tap into the output instead of unfolding the input.
+    const float* inPtr = inputBuf->data<float>();
+    for (int ts = 0; ts < kernelSize_; ++ts) {
+      cblas_gemm_compute(
+          fbgemm::matrix_op_t::NoTranspose,
+          nOutFrames * groups_,
+          inPtr + ts * inChannels_,
+          *packedKernelTaps_[ts],
+          beta,
+          outPtr);
+    }
+  } else {
+    if (!memoryManager_) {
+      throw std::invalid_argument("null memoryManager_ at Conv1dFbGemm::run()");
+    }
+    auto workspace = memoryManager_->makeShared<float>(
+        kernelSize_ * inChannels_ * nOutFrames);
+    assert(workspace);
+
+    unfoldDepthwise(
+        workspace.get() /* dst */,
+        inputBuf->data<float>() /* src */,
+        inChannels_ / groups_,
+        kernelSize_,
+        stride_,
+        nOutFrames,
+        groups_);
+
+    cblas_gemm_compute(
+        fbgemm::matrix_op_t::NoTranspose,
+        nOutFrames * groups_,
+        workspace.get(),
+        *packedWeights_,
+        beta,
+        outPtr);
+  }
+
+  outputBuf->move<float>(outSize);
+  inputBuf->consume<float>(consumedSize);
+  return output;
+}
+
+std::vector<std::shared_ptr<ModuleProcessingState>> Conv1dFbGemm::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  if (inputs.size() == 1) {
+    return {run(inputs[0])};
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  std::vector<int> nOutFrames(inputs.size());
+  int nTotalOutFrames = 0;
+  for (int i = 0; i < inputs.size(); ++i) {
+    assert(inputs[i]);
+    assert(!inputs[i]->buffers().empty());
+    outputs.push_back(inputs[i]->next());
+    assert(outputs.back());
+    const int nInFrames = inputs[i]->buffer(0)->size<float>() / inChannels_;
+    nOutFrames[i] =
+        nInFrames < kernelSize_ ? 0 : (nInFrames - kernelSize_) / stride_ + 1;
+    nTotalOutFrames += nOutFrames[i];
+  }
+  if (nTotalOutFrames == 0) {
+    return outputs;
+  }
+
   if (!memoryManager_) {
-    throw std::invalid_argument("null memoryManager_ at Conv1dFbGemm::run()");
+    throw std::invalid_argument(
+        "null memoryManager_ at Conv1dFbGemm::runBatch()");
   }
-  auto workspace = memoryManager_->makeShared<float>(
-      (kernelSize_ * inChannels_ * outChannels_ * nOutFrames) / groups_);
+  // Each output frame unfolds into groups_ rows of kernelSize_ x
+  // (inChannels_ / groups_) inputs
+  const int unfoldedFrameSize = kernelSize_ * inChannels_;
+  auto workspace =
+      memoryManager_->makeShared<float>(unfoldedFrameSize * nTotalOutFrames);
+  auto outWorkspace =
+      memoryManager_->makeShared<float>(outChannels_ * nTotalOutFrames);
   assert(workspace);
+  assert(outWorkspace);
 
-  unfoldDepthwise(
-      workspace.get() /* dst */,
-      inputBuf->data<float>() /* src */,
-      inChannels_ / groups_,
-      kernelSize_,
-      stride_,
-      nOutFrames,
-      groups_);
+  // Unfold the input frames of all the streams one after the other
+  float* unfoldedPtr = workspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    unfoldDepthwise(
+        unfoldedPtr /* dst */,
+        inputs[i]->buffer(0)->data<float>() /* src */,
+        inChannels_ / groups_,
+        kernelSize_,
+        stride_,
+        nOutFrames[i],
+        groups_);
+    unfoldedPtr += unfoldedFrameSize * nOutFrames[i];
+  }
+  for (int i = 0; i < nTotalOutFrames * groups_; ++i) {
+    std::copy_n(
+        bias_->buffer_.data<float>(),
+        outChannels_ / groups_,
+        outWorkspace.get() + i * (outChannels_ / groups_));
+  }
 
   constexpr float beta = 1.0;
   cblas_gemm_compute(
       fbgemm::matrix_op_t::NoTranspose,
-      nOutFrames * groups_,
+      nTotalOutFrames * groups_,
       workspace.get(),
       *packedWeights_,
       beta,
-      outPtr);
+      outWorkspace.get());
 
-  outputBuf->move<float>(outSize);
-  inputBuf->consume<float>(consumedSize);
-  return output;
+  // Scatter the output frames back to their streams
+  const float* outPtr = outWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (nOutFrames[i] == 0) {
+      continue;
+    }
+    assert(!outputs[i]->buffers().empty());
+    outputs[i]->buffer(0)->write<float>(outPtr, nOutFrames[i] * outChannels_);
+    outPtr += nOutFrames[i] * outChannels_;
+    inputs[i]->buffer(0)->consume<float>(
+        nOutFrames[i] * stride_ * inChannels_);
+  }
+  return outputs;
 }
 
 std::shared_ptr<Conv1d> createConv1d(
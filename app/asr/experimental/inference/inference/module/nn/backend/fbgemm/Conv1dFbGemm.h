@@ -14,6 +14,7 @@
 #include <fbgemm/FbgemmFP16.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "inference/module/ModuleParameter.h"
 #include "inference/module/ModuleProcessingState.h"
@@ -23,6 +24,18 @@
 namespace w2l {
 namespace streaming {
 
+// Unfolds outDim output frames of a grouped convolution into the rows of the
+// GEMM input matrix. Each output frame makes depth rows of kernelSize x
+// inChannels elements, where inChannels is the number of channels per group.
+void unfoldDepthwise(
+    float* dst,
+    const float* src,
+    const int inChannels,
+    const int kernelSize,
+    const int stride,
+    const int outDim,
+    const int depth);
+
 class Conv1dFbGemm : public Conv1d {
  public:
   // weights is freed after we read its content into internal float 16 packed
@@ -46,6 +59,11 @@ class Conv1dFbGemm : public Conv1d {
   std::shared_ptr<ModuleProcessingState> run(
       std::shared_ptr<ModuleProcessingState> input) override;
 
+  // Stacks the frames of all the streams into a single GEMM.
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
   std::shared_ptr<ModuleProcessingState> finish(
       std::shared_ptr<ModuleProcessingState> input) override;
 
@@ -54,8 +72,15 @@ class Conv1dFbGemm : public Conv1d {
  protected:
   void init(std::shared_ptr<ModuleParameter> weights);
 
+  // Splits packedWeights_ into packedKernelTaps_ when stride_ is 1.
+  void initKernelTaps();
+
   std::shared_ptr<ModuleParameter> bias_;
   std::shared_ptr<fbgemm::PackedGemmMatrixFP16> packedWeights_;
+  // One packed matrix per kernel tap, used by run() to convolve directly from
+  // the input buffer. Empty for strided convolutions, which unfold the input
+  // into a workspace.
+  std::vector<std::shared_ptr<fbgemm::PackedGemmMatrixFP16>> packedKernelTaps_;
 
  private:
   friend class cereal::access;
@@ -63,8 +88,14 @@ class Conv1dFbGemm : public Conv1d {
   Conv1dFbGemm(); // Used by Cereal for serialization.
 
   template <class Archive>
-  void serialize(Archive& ar) {
+  void save(Archive& ar) const {
+    ar(cereal::base_class<Conv1d>(this), bias_, packedWeights_);
+  }
+
+  template <class Archive>
+  void load(Archive& ar) {
     ar(cereal::base_class<Conv1d>(this), bias_, packedWeights_);
+    initKernelTaps();
   }
 };
 
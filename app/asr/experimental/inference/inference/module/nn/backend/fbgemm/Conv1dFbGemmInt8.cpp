@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "inference/module/nn/backend/fbgemm/Conv1dFbGemmInt8.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "inference/common/IOBuffer.h"
+#include "inference/module/nn/backend/fbgemm/Conv1dFbGemm.h"
+
+namespace w2l {
+namespace streaming {
+
+Conv1dFbGemmInt8::Conv1dFbGemmInt8(
+    int inChannels,
+    int outChannels,
+    int kernelSize,
+    int stride,
+    int rightPadding,
+    int leftPadding,
+    int groups,
+    std::shared_ptr<ModuleParameter> weights,
+    std::shared_ptr<ModuleParameter> bias)
+    : Conv1d(
+          inChannels,
+          outChannels,
+          kernelSize,
+          stride,
+          rightPadding,
+          leftPadding,
+          groups),
+      bias_(bias) {
+  if (!weights || !bias || weights->type_ != DataType::FLOAT ||
+      bias->type_ != DataType::FLOAT) {
+    std::stringstream ss;
+    ss << "Invalid argument at"
+       << " Conv1dFbGemmInt8::Conv1dFbGemmInt8(groups=" << groups
+       << " inChannels=" << inChannels << " outChannels=" << outChannels
+       << " kernelSize=" << kernelSize << " stride=" << stride
+       << " rightPadding=" << rightPadding << " leftPadding=" << leftPadding
+       << " weights=" << (weights ? weights->debugString() : "nullptr")
+       << " bias=" << (bias ? bias->debugString() : "nullptr") << ")";
+    throw std::invalid_argument(ss.str());
+  }
+  packedWeights_ = std::make_shared<PackedGemmMatrixInt8>(
+      fbgemm::matrix_op_t::Transpose,
+      (inChannels_ / groups_) * kernelSize_, // k
+      (outChannels_ / groups_), // n
+      weights->buffer_.data<float>());
+}
+
+// Used for serialization loading only. Initialize using temporary valid bogus
+// values.
+Conv1dFbGemmInt8::Conv1dFbGemmInt8() : Conv1d(1, 1, 1, 1, 1, 1, 1) {}
+
+std::string Conv1dFbGemmInt8::debugString() const {
+  std::stringstream ss;
+  ss << "Conv1dFbGemmInt8:{base=" << Conv1d::debugString()
+     << " packedWeights_="
+     << (packedWeights_ ? packedWeights_->debugString() : "nullptr")
+     << "} bias_=" << (bias_ ? bias_->debugString() : "nullptr") << "}";
+  return ss.str();
+}
+
+std::shared_ptr<ModuleProcessingState> Conv1dFbGemmInt8::start(
+    std::shared_ptr<ModuleProcessingState> input) {
+  if (leftPadding_ > 0) {
+    assert(input);
+    assert(!input->buffers().empty());
+    std::shared_ptr<IOBuffer> inputBuf = input->buffer(0);
+    assert(inputBuf);
+
+    inputBuf->prependZero<float>(leftPadding_ * inChannels_);
+  }
+  return input->next(true, 1);
+}
+
+std::shared_ptr<ModuleProcessingState> Conv1dFbGemmInt8::finish(
+    std::shared_ptr<ModuleProcessingState> input) {
+  if (rightPadding_ > 0) {
+    assert(input);
+    assert(!input->buffers().empty());
+    std::shared_ptr<IOBuffer> inputBuf = input->buffer(0);
+    assert(inputBuf);
+    inputBuf->writeZero<float>(rightPadding_ * inChannels_);
+  }
+  return run(input);
+}
+
+std::shared_ptr<ModuleProcessingState> Conv1dFbGemmInt8::run(
+    std::shared_ptr<ModuleProcessingState> input) {
+  assert(input);
+  assert(!input->buffers().empty());
+  std::shared_ptr<IOBuffer> inputBuf = input->buffer(0);
+  assert(inputBuf);
+
+  std::shared_ptr<ModuleProcessingState> output = input->next();
+  assert(output);
+  assert(!output->buffers().empty());
+
+  const int nInFrames = inputBuf->size<float>() / inChannels_;
+  if (nInFrames < kernelSize_) {
+    return output;
+  }
+
+  std::shared_ptr<IOBuffer> outputBuf = output->buffer(0);
+  assert(outputBuf);
+
+  int nOutFrames = (nInFrames - kernelSize_) / stride_ + 1;
+  int outSize = nOutFrames * outChannels_;
+  int consumedSize = nOutFrames * stride_ * inChannels_;
+
+  if (!memoryManager_) {
+    throw std::invalid_argument(
+        "null memoryManager_ at Conv1dFbGemmInt8::run()");
+  }
+  auto workspace =
+      memoryManager_->makeShared<float>(kernelSize_ * inChannels_ * nOutFrames);
+  assert(workspace);
+
+  unfoldDepthwise(
+      workspace.get() /* dst */,
+      inputBuf->data<float>() /* src */,
+      inChannels_ / groups_,
+      kernelSize_,
+      stride_,
+      nOutFrames,
+      groups_);
+
+  outputBuf->ensure<float>(outSize);
+  packedWeights_->compute(
+      nOutFrames * groups_,
+      workspace.get(),
+      bias_->buffer_.data<float>(),
+      outputBuf->tail<float>());
+
+  outputBuf->move<float>(outSize);
+  inputBuf->consume<float>(consumedSize);
+  return output;
+}
+
+std::vector<std::shared_ptr<ModuleProcessingState>> Conv1dFbGemmInt8::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  if (inputs.size() == 1) {
+    return {run(inputs[0])};
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  std::vector<int> nOutFrames(inputs.size());
+  int nTotalOutFrames = 0;
+  for (int i = 0; i < inputs.size(); ++i) {
+    assert(inputs[i]);
+    assert(!inputs[i]->buffers().empty());
+    outputs.push_back(inputs[i]->next());
+    assert(outputs.back());
+    const int nInFrames = inputs[i]->buffer(0)->size<float>() / inChannels_;
+    nOutFrames[i] =
+        nInFrames < kernelSize_ ? 0 : (nInFrames - kernelSize_) / stride_ + 1;
+    nTotalOutFrames += nOutFrames[i];
+  }
+  if (nTotalOutFrames == 0) {
+    return outputs;
+  }
+
+  if (!memoryManager_) {
+    throw std::invalid_argument(
+        "null memoryManager_ at Conv1dFbGemmInt8::runBatch()");
+  }
+  const int unfoldedFrameSize = kernelSize_ * inChannels_;
+  auto workspace =
+      memoryManager_->makeShared<float>(unfoldedFrameSize * nTotalOutFrames);
+  auto outWorkspace =
+      memoryManager_->makeShared<float>(outChannels_ * nTotalOutFrames);
+  assert(workspace);
+  assert(outWorkspace);
+
+  // Unfold the input frames of all the streams one after the other
+  float* unfoldedPtr = workspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    unfoldDepthwise(
+        unfoldedPtr /* dst */,
+        inputs[i]->buffer(0)->data<float>() /* src */,
+        inChannels_ / groups_,
+        kernelSize_,
+        stride_,
+        nOutFrames[i],
+        groups_);
+    unfoldedPtr += unfoldedFrameSize * nOutFrames[i];
+  }
+
+  packedWeights_->compute(
+      nTotalOutFrames * groups_,
+      workspace.get(),
+      bias_->buffer_.data<float>(),
+      outWorkspace.get());
+
+  // Scatter the output frames back to their streams
+  const float* outPtr = outWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (nOutFrames[i] == 0) {
+      continue;
+    }
+    assert(!outputs[i]->buffers().empty());
+    outputs[i]->buffer(0)->write<float>(outPtr, nOutFrames[i] * outChannels_);
+    outPtr += nOutFrames[i] * outChannels_;
+    inputs[i]->buffer(0)->consume<float>(
+        nOutFrames[i] * stride_ * inChannels_);
+  }
+  return outputs;
+}
+
+} // namespace streaming
+} // namespace w2l
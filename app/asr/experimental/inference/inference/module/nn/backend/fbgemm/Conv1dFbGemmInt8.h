@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cereal/access.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/xml.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/memory.hpp>
+#include <cereal/types/polymorphic.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "inference/module/ModuleParameter.h"
+#include "inference/module/ModuleProcessingState.h"
+#include "inference/module/nn/Conv1d.h"
+#include "inference/module/nn/backend/fbgemm/PackedGemmMatrixInt8.h"
+
+namespace w2l {
+namespace streaming {
+
+// Same as Conv1dFbGemm with weights quantized to int8 per output channel and
+// activations quantized to uint8 at run time.
+class Conv1dFbGemmInt8 : public Conv1d {
+ public:
+  // weights is quantized into an internal structure.
+  Conv1dFbGemmInt8(
+      int inChannels,
+      int outChannels,
+      int kernelSize,
+      int stride,
+      int rightPadding,
+      int leftPadding,
+      int groups,
+      std::shared_ptr<ModuleParameter> weights,
+      std::shared_ptr<ModuleParameter> bias);
+
+  virtual ~Conv1dFbGemmInt8() override = default;
+
+  std::shared_ptr<ModuleProcessingState> start(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  std::shared_ptr<ModuleProcessingState> run(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  // Stacks the frames of all the streams into a single GEMM.
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
+  std::shared_ptr<ModuleProcessingState> finish(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  std::string debugString() const override;
+
+ protected:
+  std::shared_ptr<ModuleParameter> bias_;
+  std::shared_ptr<PackedGemmMatrixInt8> packedWeights_;
+
+ private:
+  friend class cereal::access;
+
+  Conv1dFbGemmInt8(); // Used by Cereal for serialization.
+
+  template <class Archive>
+  void serialize(Archive& ar) {
+    ar(cereal::base_class<Conv1d>(this), bias_, packedWeights_);
+  }
+};
+
+} // namespace streaming
+} // namespace w2l
+
+CEREAL_REGISTER_TYPE(w2l::streaming::Conv1dFbGemmInt8);
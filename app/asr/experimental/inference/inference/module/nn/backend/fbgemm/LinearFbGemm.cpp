@@ -9,6 +9,7 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include "inference/common/IOBuffer.h"
 
@@ -102,6 +103,75 @@ std::shared_ptr<ModuleProcessingState> LinearFbGemm::run(
   return output;
 }
 
+std::vector<std::shared_ptr<ModuleProcessingState>> LinearFbGemm::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  if (inputs.size() == 1) {
+    return {run(inputs[0])};
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  std::vector<int> nFrames(inputs.size());
+  int nTotalFrames = 0;
+  for (int i = 0; i < inputs.size(); ++i) {
+    assert(inputs[i]);
+    assert(inputs[i]->buffers().size() == 1);
+    outputs.push_back(inputs[i]->next());
+    assert(outputs.back());
+    nFrames[i] = inputs[i]->buffer(0)->size<float>() / nInput_;
+    nTotalFrames += nFrames[i];
+  }
+  if (nTotalFrames == 0) {
+    return outputs;
+  }
+
+  if (!memoryManager_) {
+    throw std::invalid_argument(
+        "null memoryManager_ at LinearFbGemm::runBatch()");
+  }
+  auto inWorkspace = memoryManager_->makeShared<float>(nTotalFrames * nInput_);
+  auto outWorkspace =
+      memoryManager_->makeShared<float>(nTotalFrames * nOutput_);
+  assert(inWorkspace);
+  assert(outWorkspace);
+
+  // Stack the input frames of all the streams
+  float* inPtr = inWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    std::copy_n(
+        inputs[i]->buffer(0)->data<float>(), nFrames[i] * nInput_, inPtr);
+    inPtr += nFrames[i] * nInput_;
+  }
+  for (int i = 0; i < nTotalFrames; ++i) {
+    std::copy_n(
+        bias_->buffer_.data<float>(),
+        nOutput_,
+        outWorkspace.get() + i * nOutput_);
+  }
+
+  constexpr float beta = 1.0;
+  cblas_gemm_compute(
+      fbgemm::matrix_op_t::Transpose,
+      nTotalFrames,
+      inWorkspace.get(),
+      *packedWeights_,
+      beta,
+      outWorkspace.get());
+
+  // Scatter the output frames back to their streams
+  const float* outPtr = outWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (nFrames[i] == 0) {
+      continue;
+    }
+    assert(outputs[i]->buffers().size() == 1);
+    outputs[i]->buffer(0)->write<float>(outPtr, nFrames[i] * nOutput_);
+    outPtr += nFrames[i] * nOutput_;
+    inputs[i]->buffer(0)->consume<float>(nFrames[i] * nInput_);
+  }
+  return outputs;
+}
+
 std::shared_ptr<Linear> createLinear(
     int nInput,
     int nOutput,
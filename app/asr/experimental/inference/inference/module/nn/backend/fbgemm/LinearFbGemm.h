@@ -15,6 +15,7 @@
 #include <fbgemm/FbgemmFP16.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "inference/module/ModuleParameter.h"
 #include "inference/module/ModuleProcessingState.h"
@@ -38,6 +39,11 @@ class LinearFbGemm : public Linear {
   std::shared_ptr<ModuleProcessingState> run(
       std::shared_ptr<ModuleProcessingState> input) override;
 
+  // Stacks the frames of all the streams into a single GEMM.
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
   std::string debugString() const override;
   std::string debugStringWithContent() const override;
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "inference/module/nn/backend/fbgemm/LinearFbGemmInt8.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "inference/common/IOBuffer.h"
+
+namespace w2l {
+namespace streaming {
+
+LinearFbGemmInt8::LinearFbGemmInt8(
+    int nInput,
+    int nOutput,
+    std::shared_ptr<ModuleParameter> weights,
+    std::shared_ptr<ModuleParameter> bias)
+    : Linear(nInput, nOutput), bias_(bias) {
+  if (!weights || !bias || weights->type_ != DataType::FLOAT ||
+      bias->type_ != DataType::FLOAT) {
+    std::stringstream ss;
+    ss << "Invalid arg at LinearFbGemmInt8::LinearFbGemmInt8(nInput=" << nInput
+       << " nOutput=" << nOutput
+       << " weights=" << (weights ? weights->debugString() : "nullptr")
+       << " bias=" << (bias ? bias->debugString() : "nullptr") << ")";
+    throw std::invalid_argument(ss.str());
+  }
+
+  packedWeights_ = std::make_shared<PackedGemmMatrixInt8>(
+      fbgemm::matrix_op_t::NoTranspose,
+      nInput_, // k
+      nOutput_, // n
+      weights->buffer_.data<float>());
+}
+
+LinearFbGemmInt8::LinearFbGemmInt8() : Linear(0, 0) {}
+
+std::string LinearFbGemmInt8::debugString() const {
+  return debugStringImpl(false);
+}
+
+std::string LinearFbGemmInt8::debugStringWithContent() const {
+  return debugStringImpl(true);
+}
+
+std::string LinearFbGemmInt8::debugStringImpl(bool withContent) const {
+  std::stringstream ss;
+  ss << "LinearFbGemmInt8:{base=" << Linear::debugString() << " packedWeights_="
+     << (packedWeights_ ? packedWeights_->debugString(withContent) : "nullptr")
+     << "} bias_=" << (bias_ ? bias_->debugString() : "nullptr") << "}";
+  return ss.str();
+}
+
+std::shared_ptr<ModuleProcessingState> LinearFbGemmInt8::run(
+    std::shared_ptr<ModuleProcessingState> input) {
+  assert(input);
+  std::shared_ptr<ModuleProcessingState> output = input->next();
+  assert(output);
+  assert(input->buffers().size() == 1);
+  std::shared_ptr<IOBuffer> inputBuf = input->buffer(0);
+  assert(inputBuf);
+
+  int nFrames = inputBuf->size<float>() / nInput_;
+  if (nFrames == 0) {
+    return output;
+  }
+  assert(output->buffers().size() == 1);
+  std::shared_ptr<IOBuffer> outputBuf = output->buffer(0);
+  assert(outputBuf);
+
+  const int outSize = nFrames * nOutput_;
+  outputBuf->ensure<float>(outSize);
+  packedWeights_->compute(
+      nFrames,
+      inputBuf->data<float>(),
+      bias_->buffer_.data<float>(),
+      outputBuf->tail<float>());
+  outputBuf->move<float>(outSize);
+
+  inputBuf->consume<float>(nFrames * nInput_);
+  return output;
+}
+
+std::vector<std::shared_ptr<ModuleProcessingState>> LinearFbGemmInt8::runBatch(
+    const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs) {
+  if (inputs.size() == 1) {
+    return {run(inputs[0])};
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  outputs.reserve(inputs.size());
+  std::vector<int> nFrames(inputs.size());
+  int nTotalFrames = 0;
+  for (int i = 0; i < inputs.size(); ++i) {
+    assert(inputs[i]);
+    assert(inputs[i]->buffers().size() == 1);
+    outputs.push_back(inputs[i]->next());
+    assert(outputs.back());
+    nFrames[i] = inputs[i]->buffer(0)->size<float>() / nInput_;
+    nTotalFrames += nFrames[i];
+  }
+  if (nTotalFrames == 0) {
+    return outputs;
+  }
+
+  if (!memoryManager_) {
+    throw std::invalid_argument(
+        "null memoryManager_ at LinearFbGemmInt8::runBatch()");
+  }
+  auto inWorkspace = memoryManager_->makeShared<float>(nTotalFrames * nInput_);
+  auto outWorkspace =
+      memoryManager_->makeShared<float>(nTotalFrames * nOutput_);
+  assert(inWorkspace);
+  assert(outWorkspace);
+
+  // Stack the input frames of all the streams
+  float* inPtr = inWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    std::copy_n(
+        inputs[i]->buffer(0)->data<float>(), nFrames[i] * nInput_, inPtr);
+    inPtr += nFrames[i] * nInput_;
+  }
+
+  packedWeights_->compute(
+      nTotalFrames,
+      inWorkspace.get(),
+      bias_->buffer_.data<float>(),
+      outWorkspace.get());
+
+  // Scatter the output frames back to their streams
+  const float* outPtr = outWorkspace.get();
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (nFrames[i] == 0) {
+      continue;
+    }
+    assert(outputs[i]->buffers().size() == 1);
+    outputs[i]->buffer(0)->write<float>(outPtr, nFrames[i] * nOutput_);
+    outPtr += nFrames[i] * nOutput_;
+    inputs[i]->buffer(0)->consume<float>(nFrames[i] * nInput_);
+  }
+  return outputs;
+}
+
+} // namespace streaming
+} // namespace w2l
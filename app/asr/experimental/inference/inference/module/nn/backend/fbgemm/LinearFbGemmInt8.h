@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cereal/access.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/xml.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/memory.hpp>
+#include <cereal/types/polymorphic.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "inference/module/ModuleParameter.h"
+#include "inference/module/ModuleProcessingState.h"
+#include "inference/module/nn/Linear.h"
+#include "inference/module/nn/backend/fbgemm/PackedGemmMatrixInt8.h"
+
+namespace w2l {
+namespace streaming {
+
+// Same as LinearFbGemm with weights quantized to int8 per output channel and
+// activations quantized to uint8 at run time.
+class LinearFbGemmInt8 : public Linear {
+ public:
+  // weights is quantized into an internal structure.
+  LinearFbGemmInt8(
+      int nInput,
+      int nOutput,
+      std::shared_ptr<ModuleParameter> weights,
+      std::shared_ptr<ModuleParameter> bias);
+
+  virtual ~LinearFbGemmInt8() override = default;
+
+  std::shared_ptr<ModuleProcessingState> run(
+      std::shared_ptr<ModuleProcessingState> input) override;
+
+  // Stacks the frames of all the streams into a single GEMM.
+  std::vector<std::shared_ptr<ModuleProcessingState>> runBatch(
+      const std::vector<std::shared_ptr<ModuleProcessingState>>& inputs)
+      override;
+
+  std::string debugString() const override;
+  std::string debugStringWithContent() const override;
+
+ protected:
+  std::string debugStringImpl(bool withContent) const;
+
+  std::shared_ptr<ModuleParameter> bias_;
+  std::shared_ptr<PackedGemmMatrixInt8> packedWeights_;
+
+ private:
+  friend class cereal::access;
+
+  LinearFbGemmInt8(); // Used by Cereal for serialization.
+
+  template <class Archive>
+  void serialize(Archive& ar) {
+    ar(cereal::base_class<Linear>(this), bias_, packedWeights_);
+  }
+};
+
+} // namespace streaming
+} // namespace w2l
+
+CEREAL_REGISTER_TYPE(w2l::streaming::LinearFbGemmInt8);
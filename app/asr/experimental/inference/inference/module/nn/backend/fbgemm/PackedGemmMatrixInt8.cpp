@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "inference/module/nn/backend/fbgemm/PackedGemmMatrixInt8.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <fbgemm/QuantUtils.h>
+
+namespace w2l {
+namespace streaming {
+
+namespace {
+// Activations are quantized to 7 bits, like fbgemm's reduce_range in PyTorch.
+// The AVX2 kernel sums pairs of uint8 x int8 products in int16, and
+// 2 * 255 * 127 would saturate it, while 2 * 127 * 127 fits.
+constexpr int32_t kActivationQMax = 127;
+} // namespace
+
+PackedGemmMatrixInt8::PackedGemmMatrixInt8(
+    fbgemm::matrix_op_t trans,
+    int k,
+    int n,
+    const float* weights)
+    : k_(k),
+      n_(n),
+      quantizedWeights_(k * n),
+      scales_(n),
+      zeroPoints_(n),
+      colOffsets_(n) {
+  if (k <= 0 || n <= 0 || !weights) {
+    std::stringstream ss;
+    ss << "Invalid argument at PackedGemmMatrixInt8::PackedGemmMatrixInt8(k="
+       << k << " n=" << n << " weights=" << weights << ")";
+    throw std::invalid_argument(ss.str());
+  }
+
+  // Quantize each output channel with its own range
+  std::vector<float> channel(k);
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < k; ++i) {
+      channel[i] = trans == fbgemm::matrix_op_t::Transpose ? weights[j * k + i]
+                                                           : weights[i * n + j];
+    }
+    const auto minMax = std::minmax_element(channel.begin(), channel.end());
+    const fbgemm::TensorQuantizationParams qparams =
+        fbgemm::ChooseQuantizationParams(
+            *minMax.first, *minMax.second, -128, 127);
+    int8_t* quantizedChannel = quantizedWeights_.data() + j * k;
+    fbgemm::Quantize<int8_t>(channel.data(), quantizedChannel, k, qparams);
+
+    scales_[j] = qparams.scale;
+    zeroPoints_[j] = qparams.zero_point;
+    colOffsets_[j] = 0;
+    for (int i = 0; i < k; ++i) {
+      colOffsets_[j] += quantizedChannel[i] - qparams.zero_point;
+    }
+  }
+  pack();
+}
+
+PackedGemmMatrixInt8::PackedGemmMatrixInt8() : k_(0), n_(0) {}
+
+void PackedGemmMatrixInt8::pack() {
+  packedWeights_ = std::make_shared<fbgemm::PackBMatrix<int8_t>>(
+      fbgemm::matrix_op_t::Transpose,
+      k_, // rows of B
+      n_, // columns of B
+      quantizedWeights_.data(),
+      k_); // leading dimension of the n x k source
+}
+
+void PackedGemmMatrixInt8::compute(
+    int m,
+    const float* a,
+    const float* bias,
+    float* c) const {
+  // Dynamic quantization of the activations
+  const auto minMax = std::minmax_element(a, a + m * k_);
+  const fbgemm::TensorQuantizationParams qparams =
+      fbgemm::ChooseQuantizationParams(
+          *minMax.first, *minMax.second, 0, kActivationQMax);
+
+  fbgemm::PackAWithQuantRowOffset<uint8_t> packedA(
+      fbgemm::matrix_op_t::NoTranspose,
+      m,
+      k_,
+      a,
+      k_, // lda
+      nullptr, // let fbgemm allocate the packing buffer
+      qparams.scale,
+      qparams.zero_point);
+
+  fbgemm::DoNothing<float, float> doNothing;
+  fbgemm::ReQuantizeForFloat<
+      false /* fuse relu */,
+      fbgemm::QuantizationGranularity::OUT_CHANNEL>
+      requantize(
+          doNothing,
+          qparams.scale,
+          scales_.data(),
+          qparams.zero_point,
+          zeroPoints_.data(),
+          packedA.getRowOffsetBuffer(),
+          colOffsets_.data(),
+          bias,
+          n_);
+
+  // The int32 accumulation buffer is the output buffer itself.
+  fbgemm::fbgemmPacked(
+      packedA,
+      *packedWeights_,
+      c,
+      reinterpret_cast<int32_t*>(c),
+      n_, // ldc
+      requantize,
+      0, // thread id
+      1); // number of threads
+}
+
+std::string PackedGemmMatrixInt8::debugString(bool dumpContent) const {
+  std::stringstream ss;
+  ss << "PackedGemmMatrixInt8:{k_=" << k_ << " n_=" << n_;
+  if (dumpContent) {
+    ss << " content=\n";
+    for (int j = 0; j < n_; ++j) {
+      ss << "scale=" << scales_[j] << " zeroPoint=" << zeroPoints_[j] << ": ";
+      for (int i = 0; i < k_; ++i) {
+        ss << static_cast<int>(quantizedWeights_[j * k_ + i]) << ", ";
+      }
+      ss << std::endl;
+    }
+  }
+  ss << "}";
+  return ss.str();
+}
+
+} // namespace streaming
+} // namespace w2l
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cereal/access.hpp>
+#include <cereal/types/vector.hpp>
+#include <fbgemm/Fbgemm.h>
+
+namespace w2l {
+namespace streaming {
+
+// Weights matrix of a GEMM, quantized to int8 with a scale and a zero point per
+// output channel (column), and packed for fbgemm. Activations are quantized to
+// uint8 on the fly (dynamic quantization) with a scale and a zero point per
+// call, and the int32 results are requantized to float. Activations only use
+// [0, 127], so that the int16 intermediate sums of the AVX2 kernel can't
+// saturate.
+class PackedGemmMatrixInt8 {
+ public:
+  // Same arguments as fbgemm::PackedGemmMatrixFP16. weights is k x n when trans
+  // is NoTranspose and n x k when trans is Transpose.
+  PackedGemmMatrixInt8(
+      fbgemm::matrix_op_t trans,
+      int k,
+      int n,
+      const float* weights);
+
+  // c = a * weights + bias, where a is m x k and c is m x n. bias has n
+  // elements.
+  void compute(int m, const float* a, const float* bias, float* c) const;
+
+  int numRows() const {
+    return k_;
+  }
+
+  int numCols() const {
+    return n_;
+  }
+
+  std::string debugString(bool dumpContent = false) const;
+
+ private:
+  friend class cereal::access;
+
+  PackedGemmMatrixInt8(); // Used by Cereal for serialization.
+
+  void pack();
+
+  template <class Archive>
+  void save(Archive& ar) const {
+    ar(k_, n_, quantizedWeights_, scales_, zeroPoints_, colOffsets_);
+  }
+
+  template <class Archive>
+  void load(Archive& ar) {
+    ar(k_, n_, quantizedWeights_, scales_, zeroPoints_, colOffsets_);
+    pack();
+  }
+
+  int k_;
+  int n_;
+  // n x k quantized weights, that is one row per output channel
+  std::vector<int8_t> quantizedWeights_;
+  std::vector<float> scales_;
+  std::vector<int32_t> zeroPoints_;
+  // Sum over k of (quantizedWeights_ - zeroPoints_) for each output channel
+  std::vector<int32_t> colOffsets_;
+  std::shared_ptr<fbgemm::PackBMatrix<int8_t>> packedWeights_;
+};
+
+} // namespace streaming
+} // namespace w2l
@@ -8,4 +8,6 @@
 #pragma once
 
 #include "inference/module/nn/backend/fbgemm/Conv1dFbGemm.h"
+#include "inference/module/nn/backend/fbgemm/Conv1dFbGemmInt8.h"
 #include "inference/module/nn/backend/fbgemm/LinearFbGemm.h"
+#include "inference/module/nn/backend/fbgemm/LinearFbGemmInt8.h"
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "inference/module/nn/BatchScheduler.h"
 #include "inference/module/nn/Conv1d.h"
 #include "inference/module/nn/Identity.h"
 #include "inference/module/nn/LayerNorm.h"
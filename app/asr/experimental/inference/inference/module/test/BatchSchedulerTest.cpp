@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "inference/common/DataType.h"
+#include "inference/common/IOBuffer.h"
+#include "inference/module/ModuleParameter.h"
+#include "inference/module/ModuleProcessingState.h"
+#include "inference/module/nn/BatchScheduler.h"
+#include "inference/module/nn/TDSBlock.h"
+#include "inference/module/test/TestUtils.h"
+
+namespace w2l {
+namespace streaming {
+
+namespace {
+
+const int kChannels = 10;
+
+std::shared_ptr<ModuleParameter> randParam(int size) {
+  std::vector<float> values = randVec<float>(size);
+  return std::make_shared<ModuleParameter>(
+      DataType::FLOAT, values.data(), values.size());
+}
+
+std::shared_ptr<TDSBlock> createTds() {
+  const int groups = 5;
+  const int kernelSize = 3;
+  const int channelsPerGroup = kChannels / groups;
+  auto conv = createConv1d(
+      kChannels,
+      kChannels,
+      kernelSize,
+      1,
+      {1, 1},
+      groups,
+      randParam(kernelSize * channelsPerGroup * channelsPerGroup),
+      randParam(channelsPerGroup));
+  auto lnorm1 = std::make_shared<LayerNorm>(kChannels, 1.0, 0.0);
+  auto lnorm2 = std::make_shared<LayerNorm>(kChannels, 1.0, 0.0);
+  auto linear1 = createLinear(
+      kChannels,
+      kChannels,
+      randParam(kChannels * kChannels),
+      randParam(kChannels));
+  auto linear2 = createLinear(
+      kChannels,
+      kChannels,
+      randParam(kChannels * kChannels),
+      randParam(kChannels));
+  return std::make_shared<TDSBlock>(
+      conv, lnorm1, linear1, linear2, lnorm2, DataType::FLOAT, DataType::FLOAT);
+}
+
+// Streams the chunks of `input` through `module` one by one with run().
+std::vector<float> runStream(
+    std::shared_ptr<InferenceModule> module,
+    const std::vector<std::vector<float>>& chunks) {
+  auto input = std::make_shared<ModuleProcessingState>(1);
+  auto output = module->start(input);
+  std::vector<float> result;
+  for (int i = 0; i < chunks.size(); ++i) {
+    input->buffer(0)->write<float>(chunks[i].data(), chunks[i].size());
+    if (i + 1 < chunks.size()) {
+      module->run(input);
+    } else {
+      module->finish(input);
+    }
+    auto outputBuf = output->buffer(0);
+    result.insert(
+        result.end(),
+        outputBuf->data<float>(),
+        outputBuf->data<float>() + outputBuf->size<float>());
+    outputBuf->consume<float>(outputBuf->size<float>());
+  }
+  return result;
+}
+
+std::vector<std::vector<float>> randChunks(int nChunks) {
+  std::vector<std::vector<float>> chunks;
+  for (int i = 0; i < nChunks; ++i) {
+    // Chunks of 0 to 7 frames
+    chunks.push_back(randVec<float>((rand() % 8) * kChannels));
+  }
+  return chunks;
+}
+
+void checkNear(const std::vector<float>& a, const std::vector<float>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (int i = 0; i < a.size(); ++i) {
+    ASSERT_NEAR(a[i], b[i], 1E-4);
+  }
+}
+
+} // namespace
+
+TEST(BatchScheduler, RunBatchMatchesRun) {
+  auto tds = createTds();
+  const int nStreams = 4, nChunks = 6;
+  std::vector<std::vector<std::vector<float>>> streamChunks;
+  for (int s = 0; s < nStreams; ++s) {
+    streamChunks.push_back(randChunks(nChunks));
+  }
+
+  std::vector<std::shared_ptr<ModuleProcessingState>> inputs;
+  std::vector<std::shared_ptr<ModuleProcessingState>> outputs;
+  for (int s = 0; s < nStreams; ++s) {
+    inputs.push_back(std::make_shared<ModuleProcessingState>(1));
+    outputs.push_back(tds->start(inputs.back()));
+  }
+  for (int c = 0; c < nChunks - 1; ++c) {
+    for (int s = 0; s < nStreams; ++s) {
+      inputs[s]->buffer(0)->write<float>(
+          streamChunks[s][c].data(), streamChunks[s][c].size());
+    }
+    auto batchOutputs = tds->runBatch(inputs);
+    ASSERT_EQ(batchOutputs, outputs);
+  }
+
+  for (int s = 0; s < nStreams; ++s) {
+    const auto& lastChunk = streamChunks[s].back();
+    inputs[s]->buffer(0)->write<float>(lastChunk.data(), lastChunk.size());
+    tds->finish(inputs[s]);
+    auto outputBuf = outputs[s]->buffer(0);
+    std::vector<float> batched(
+        outputBuf->data<float>(),
+        outputBuf->data<float>() + outputBuf->size<float>());
+    checkNear(runStream(tds, streamChunks[s]), batched);
+  }
+}
+
+TEST(BatchScheduler, ConcurrentStreams) {
+  auto tds = createTds();
+  const int nStreams = 5, nChunks = 10;
+  std::vector<std::vector<std::vector<float>>> streamChunks;
+  std::vector<std::vector<float>> expected;
+  for (int s = 0; s < nStreams; ++s) {
+    streamChunks.push_back(randChunks(nChunks));
+    expected.push_back(runStream(tds, streamChunks.back()));
+  }
+
+  for (int numWorkers : {1, 3}) {
+    auto scheduler = std::make_shared<BatchScheduler>(
+        tds, 3, std::chrono::microseconds(1000), numWorkers);
+    std::vector<std::vector<float>> results(nStreams);
+    std::vector<std::thread> threads;
+    for (int s = 0; s < nStreams; ++s) {
+      threads.emplace_back([&, s]() {
+        results[s] = runStream(scheduler, streamChunks[s]);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (int s = 0; s < nStreams; ++s) {
+      checkNear(expected[s], results[s]);
+    }
+  }
+}
+
+} // namespace streaming
+} // namespace w2l
@@ -23,6 +23,7 @@
 #include "inference/module/ModuleProcessingState.h"
 #include "inference/module/nn/Conv1d.h"
 #include "inference/module/nn/Relu.h"
+#include "inference/module/test/TestUtils.h"
 
 namespace w2l {
 namespace streaming {
@@ -201,5 +202,103 @@ TEST(Conv1d, SingleLayerSerialization) {
     ASSERT_NEAR(out[i], targetValues[i], 1E-2);
   }
 }
+
+namespace {
+
+// Reference grouped convolution of the whole (already padded) input. All the
+// groups share the same weights.
+std::vector<float> referenceConv1d(
+    const std::vector<float>& input,
+    const std::vector<float>& weights,
+    const std::vector<float>& bias,
+    int channels,
+    int groups,
+    int kernelSize,
+    int stride) {
+  const int channelsPerGroup = channels / groups;
+  const int nInFrames = input.size() / channels;
+  const int nOutFrames = (nInFrames - kernelSize) / stride + 1;
+  std::vector<float> output;
+  for (int t = 0; t < nOutFrames; ++t) {
+    for (int d = 0; d < groups; ++d) {
+      for (int j = 0; j < channelsPerGroup; ++j) {
+        float sum = bias[j];
+        for (int ts = 0; ts < kernelSize; ++ts) {
+          const float* w =
+              weights.data() + (j * kernelSize + ts) * channelsPerGroup;
+          const float* x = input.data() + (t * stride + ts) * channels +
+              d * channelsPerGroup;
+          for (int c = 0; c < channelsPerGroup; ++c) {
+            sum += w[c] * x[c];
+          }
+        }
+        output.push_back(sum);
+      }
+    }
+  }
+  return output;
+}
+
+} // namespace
+
+TEST(Conv1d, StreamingMatchesReference) {
+  const int channels = 12, groups = 3, kernelSize = 4, T = 23;
+  const int channelsPerGroup = channels / groups;
+  const int leftPadding = 2, rightPadding = 1;
+  const std::vector<float> weightsValues =
+      randVec<float>(kernelSize * channelsPerGroup * channelsPerGroup);
+  const std::vector<float> biasValues = randVec<float>(channelsPerGroup);
+  const std::vector<float> inputValues = randVec<float>(T * channels);
+
+  std::vector<float> paddedInput(leftPadding * channels, 0);
+  paddedInput.insert(paddedInput.end(), inputValues.begin(), inputValues.end());
+  paddedInput.resize(paddedInput.size() + rightPadding * channels, 0);
+
+  // stride 1 convolves directly from the input buffer, stride 2 unfolds it.
+  for (int stride : {1, 2}) {
+    const std::vector<float> expected = referenceConv1d(
+        paddedInput,
+        weightsValues,
+        biasValues,
+        channels,
+        groups,
+        kernelSize,
+        stride);
+
+    std::shared_ptr<Conv1d> conv = createConv1d(
+        channels,
+        channels,
+        kernelSize,
+        stride,
+        std::make_pair(leftPadding, rightPadding),
+        groups,
+        std::make_shared<ModuleParameter>(
+            DataType::FLOAT, weightsValues.data(), weightsValues.size()),
+        std::make_shared<ModuleParameter>(
+            DataType::FLOAT, biasValues.data(), biasValues.size()));
+
+    // Stream the input in chunks of 1 to 5 frames, with some of it already
+    // written before start().
+    auto input = std::make_shared<ModuleProcessingState>(1);
+    std::shared_ptr<IOBuffer> inputBuffer = input->buffer(0);
+    inputBuffer->write<float>(inputValues.data(), 3 * channels);
+    auto output = conv->start(input);
+    for (int t = 3; t < T;) {
+      const int nFrames = std::min(1 + t % 5, T - t);
+      inputBuffer->write<float>(
+          inputValues.data() + t * channels, nFrames * channels);
+      conv->run(input);
+      t += nFrames;
+    }
+    conv->finish(input);
+
+    std::shared_ptr<IOBuffer> outputBuffer = output->buffer(0);
+    ASSERT_EQ(outputBuffer->size<float>(), expected.size());
+    const float* out = outputBuffer->data<float>();
+    for (int i = 0; i < expected.size(); i++) {
+      ASSERT_NEAR(out[i], expected[i], 1E-2);
+    }
+  }
+}
 }
 }
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "inference/common/DataType.h"
+#include "inference/common/IOBuffer.h"
+#include "inference/module/ModuleParameter.h"
+#include "inference/module/ModuleProcessingState.h"
+#include "inference/module/nn/Conv1d.h"
+#include "inference/module/nn/Linear.h"
+#include "inference/module/nn/backend/fbgemm/Conv1dFbGemmInt8.h"
+#include "inference/module/nn/backend/fbgemm/LinearFbGemmInt8.h"
+#include "inference/module/test/TestUtils.h"
+
+namespace w2l {
+namespace streaming {
+
+namespace {
+
+std::shared_ptr<ModuleParameter> toParam(const std::vector<float>& values) {
+  return std::make_shared<ModuleParameter>(
+      DataType::FLOAT, values.data(), values.size());
+}
+
+std::vector<float> runAll(
+    std::shared_ptr<InferenceModule> module,
+    const std::vector<float>& inputValues) {
+  auto input = std::make_shared<ModuleProcessingState>(1);
+  auto output = module->start(input);
+  input->buffer(0)->write<float>(inputValues.data(), inputValues.size());
+  module->finish(input);
+  auto outputBuf = output->buffer(0);
+  return std::vector<float>(
+      outputBuf->data<float>(),
+      outputBuf->data<float>() + outputBuf->size<float>());
+}
+
+// Quantization errors are relative to the range of the values
+void checkNear(const std::vector<float>& a, const std::vector<float>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  float maxAbs = 0;
+  for (float x : a) {
+    maxAbs = std::max(maxAbs, std::fabs(x));
+  }
+  for (int i = 0; i < a.size(); ++i) {
+    ASSERT_NEAR(a[i], b[i], 2E-2 * maxAbs);
+  }
+}
+
+} // namespace
+
+TEST(Int8, LinearMatchesFloat) {
+  const int nInput = 32, nOutput = 24, T = 9;
+  const std::vector<float> weights = randVec<float>(nInput * nOutput);
+  std::vector<float> bias = randVec<float>(nOutput);
+  std::vector<float> inputValues = randVec<float>(nInput * T);
+  for (auto& x : inputValues) {
+    x = x * 2 - 1;
+  }
+
+  auto lin = createLinear(nInput, nOutput, toParam(weights), toParam(bias));
+  auto linInt8 = std::make_shared<LinearFbGemmInt8>(
+      nInput, nOutput, toParam(weights), toParam(bias));
+  checkNear(runAll(lin, inputValues), runAll(linInt8, inputValues));
+}
+
+TEST(Int8, LinearExtremeValues) {
+  // Quantized inputs and weights at the top of their ranges: full range uint8
+  // activations would saturate the int16 pair sums of the AVX2 kernel
+  const int nInput = 64, nOutput = 8, T = 4;
+  std::vector<float> weights(nInput * nOutput, 1.0);
+  weights[0] = -1.0;
+  std::vector<float> bias(nOutput, 0.0);
+  std::vector<float> inputValues(nInput * T, 1.0);
+  inputValues[0] = -1.0;
+
+  auto lin = createLinear(nInput, nOutput, toParam(weights), toParam(bias));
+  auto linInt8 = std::make_shared<LinearFbGemmInt8>(
+      nInput, nOutput, toParam(weights), toParam(bias));
+  checkNear(runAll(lin, inputValues), runAll(linInt8, inputValues));
+}
+
+TEST(Int8, Conv1dMatchesFloat) {
+  const int channels = 12, groups = 3, kernelSize = 5, T = 20;
+  const int channelsPerGroup = channels / groups;
+  const std::vector<float> weights =
+      randVec<float>(kernelSize * channelsPerGroup * channelsPerGroup);
+  const std::vector<float> bias = randVec<float>(channelsPerGroup);
+  const std::vector<float> inputValues = randVec<float>(channels * T);
+
+  auto conv = createConv1d(
+      channels,
+      channels,
+      kernelSize,
+      2,
+      {3, 1},
+      groups,
+      toParam(weights),
+      toParam(bias));
+  auto convInt8 = std::make_shared<Conv1dFbGemmInt8>(
+      channels,
+      channels,
+      kernelSize,
+      2,
+      1,
+      3,
+      groups,
+      toParam(weights),
+      toParam(bias));
+  checkNear(runAll(conv, inputValues), runAll(convInt8, inputValues));
+}
+
+TEST(Int8, RunBatch) {
+  const int nInput = 16, nOutput = 8;
+  auto linInt8 = std::make_shared<LinearFbGemmInt8>(
+      nInput,
+      nOutput,
+      toParam(randVec<float>(nInput * nOutput)),
+      toParam(randVec<float>(nOutput)));
+
+  std::vector<std::vector<float>> inputValues;
+  std::vector<std::shared_ptr<ModuleProcessingState>> inputs;
+  for (int T : {3, 0, 7}) {
+    inputValues.push_back(randVec<float>(nInput * T));
+    inputs.push_back(std::make_shared<ModuleProcessingState>(1));
+    linInt8->start(inputs.back());
+    inputs.back()->buffer(0)->write<float>(
+        inputValues.back().data(), inputValues.back().size());
+  }
+  auto outputs = linInt8->runBatch(inputs);
+  ASSERT_EQ(outputs.size(), inputs.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    ASSERT_EQ(inputs[i]->buffer(0)->size<float>(), 0);
+    auto outputBuf = outputs[i]->buffer(0);
+    checkNear(
+        runAll(linInt8, inputValues[i]),
+        std::vector<float>(
+            outputBuf->data<float>(),
+            outputBuf->data<float>() + outputBuf->size<float>()));
+  }
+}
+
+} // namespace streaming
+} // namespace w2l
@@ -5,7 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -17,6 +20,21 @@
 namespace w2l {
 namespace streaming {
 
+namespace {
+
+class CountingMemoryManager : public DefaultMemoryManager {
+ public:
+  int nAllocations = 0;
+
+ protected:
+  void* allocate(size_t sizeInBytes) override {
+    ++nAllocations;
+    return DefaultMemoryManager::allocate(sizeInBytes);
+  }
+};
+
+} // namespace
+
 TEST(MemoryManager, Basic) {
   std::shared_ptr<MemoryManager> mm = std::make_shared<DefaultMemoryManager>();
   auto floatPtr = mm->makeShared<float>(100);
@@ -25,5 +43,55 @@ TEST(MemoryManager, Basic) {
   EXPECT_NE(floatPtr, nullptr);
   EXPECT_NE(floatPtr, nullptr);
 }
+
+TEST(MemoryManager, IOBufferSteadyStateDoesNotAllocate) {
+  auto mm = std::make_shared<CountingMemoryManager>();
+  IOBuffer buffer(mm, 100 * sizeof(float));
+  EXPECT_EQ(buffer.capacity(), 512);
+  EXPECT_EQ(mm->nAllocations, 1);
+
+  // Write chunks of 30 and consume 25 at a time, leaving a growing remainder
+  // that is moved back to the front when the end of the storage is reached.
+  std::vector<float> chunk(30);
+  int next = 0;
+  int expectedHead = 0;
+  for (int i = 0; i < 20; ++i) {
+    std::iota(chunk.begin(), chunk.end(), next);
+    next += chunk.size();
+    buffer.write<float>(chunk.data(), chunk.size());
+    auto view = buffer.view<float>();
+    for (int j = 0; j < view.size; ++j) {
+      ASSERT_EQ(view[j], expectedHead + j);
+    }
+    const int consumed = std::min(view.size, 25 + i % 3 * 5);
+    buffer.consume<float>(consumed);
+    expectedHead += consumed;
+  }
+  EXPECT_EQ(mm->nAllocations, 1);
+
+  // Content that does not fit doubles the storage and is preserved.
+  const int remaining = buffer.size<float>();
+  buffer.writeZero<float>(200);
+  EXPECT_EQ(buffer.capacity(), 2048);
+  EXPECT_EQ(mm->nAllocations, 2);
+  EXPECT_EQ(buffer.data<float>()[0], expectedHead);
+  EXPECT_EQ(buffer.size<float>(), remaining + 200);
+
+  IOBuffer copy = buffer;
+  EXPECT_EQ(mm->nAllocations, 3);
+  EXPECT_NE(copy.data<float>(), buffer.data<float>());
+  EXPECT_EQ(copy.size<float>(), buffer.size<float>());
+  EXPECT_EQ(copy.data<float>()[0], expectedHead);
+}
+
+TEST(MemoryManager, ModuleProcessingStateBuffers) {
+  auto mm = std::make_shared<CountingMemoryManager>();
+  auto state = std::make_shared<ModuleProcessingState>(2, mm, 64);
+  auto next = state->next(true, 3);
+  ASSERT_EQ(next->buffers().size(), 3);
+  EXPECT_EQ(next->buffer(2)->capacity(), 64);
+  EXPECT_EQ(state->createBuffer()->capacity(), 64);
+  EXPECT_EQ(mm->nAllocations, 6);
+}
 } // namespace streaming
 } // namespace w2l
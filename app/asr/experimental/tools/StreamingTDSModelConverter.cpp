@@ -6,6 +6,7 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iomanip>
@@ -28,6 +29,11 @@
 #include "inference/module/nn/nn.h"
 
 DEFINE_string(outdir, "", "");
+DEFINE_bool(
+    quantize_int8,
+    false,
+    "convert the linear and conv1d layers to int8 weights with dynamically"
+    " quantized activations");
 
 using namespace w2l;
 using namespace fl::app::asr;
@@ -76,6 +82,18 @@ std::shared_ptr<streaming::Conv1d> convertConv1d(
   } else if (padding.second == -1) {
     padding.second = kw - dw - padding.first;
   }
+  if (FLAGS_quantize_int8) {
+    return std::make_shared<streaming::Conv1dFbGemmInt8>(
+        cIn,
+        cOut,
+        kw,
+        dw,
+        padding.second,
+        padding.first,
+        groups,
+        variableToModuleParam(fl::reorder(wt, 2, 1, 0)),
+        variableToModuleParam(bs));
+  }
   return streaming::createConv1d(
       cIn,
       cOut,
@@ -95,6 +113,10 @@ std::shared_ptr<streaming::Linear> convertLinear(
   if (wt.elements() != (nIn * nOut) || bs.elements() != nOut) {
     LOG(FATAL) << "Invalid params for linear.";
   }
+  if (FLAGS_quantize_int8) {
+    return std::make_shared<streaming::LinearFbGemmInt8>(
+        nIn, nOut, variableToModuleParam(wt), variableToModuleParam(bs));
+  }
   return streaming::createLinear(
       nIn, nOut, variableToModuleParam(wt), variableToModuleParam(bs));
 }
@@ -360,14 +382,23 @@ int main(int argc, char** argv) {
 
   LOG_IF(FATAL, outputBuffer->size<float>() != outputVec.size())
       << "[Serialization Error] Incorrect output sizes";
+  // Int8 quantization is expected to be less accurate than fp16
+  const float tolerance = FLAGS_quantize_int8 ? 1e-1 : 1e-2;
+  float maxError = 0;
+  double sumError = 0;
   float* outPtr = outputBuffer->data<float>();
   for (int i = 0; i < outputBuffer->size<float>(); i++) {
     float streamingOut = outPtr[i];
     float w2lOut = outputVec[i];
-    LOG_IF(ERROR, fabs(streamingOut - w2lOut) > 1e-2)
+    float error = fabs(streamingOut - w2lOut);
+    maxError = std::max(maxError, error);
+    sumError += error;
+    LOG_IF(ERROR, error > tolerance)
         << "[Serialization Error] Mismatched output w2l:" << w2lOut
         << " vs streaming:" << streamingOut;
   }
+  LOG(INFO) << "Output error vs w2l: max=" << maxError
+            << " mean=" << sumError / outputVec.size();
   LOG(INFO) << "Done !";
   return 0;
 }
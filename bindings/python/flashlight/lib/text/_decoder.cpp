@@ -151,6 +151,12 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
       .def("search", &Trie::search, "indices"_a)
       .def("smear", &Trie::smear, "smear_mode"_a);
 
+  py::class_<FlatTrie, FlatTriePtr>(m, "FlatTrie")
+      .def(py::init<const Trie&>(), "trie"_a)
+      .def("save", &FlatTrie::save, "path"_a)
+      .def_static("load", &FlatTrie::load, "path"_a)
+      .def("n_nodes", &FlatTrie::nNodes);
+
   py::class_<LM, LMPtr, PyLM>(m, "LM")
       .def(py::init<>())
       .def("start", &LM::start, "start_with_nothing"_a)
@@ -175,6 +181,10 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
       .value("ASG", CriterionType::ASG)
       .value("CTC", CriterionType::CTC);
 
+  py::enum_<MergeMode>(m, "MergeMode")
+      .value("SORT", MergeMode::SORT)
+      .value("HASH", MergeMode::HASH);
+
   py::class_<DecoderOptions>(m, "DecoderOptions")
       .def(
           py::init<
@@ -187,7 +197,8 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
               const double,
               const double,
               const bool,
-              const CriterionType>(),
+              const CriterionType,
+              const MergeMode>(),
           "beam_size"_a,
           "beam_size_token"_a,
           "beam_threshold"_a,
@@ -197,7 +208,8 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
           "sil_score"_a,
           "eos_score"_a,
           "log_add"_a,
-          "criterion_type"_a)
+          "criterion_type"_a,
+          "merge_mode"_a = MergeMode::SORT)
       .def_readwrite("beam_size", &DecoderOptions::beamSize)
       .def_readwrite("beam_size_token", &DecoderOptions::beamSizeToken)
       .def_readwrite("beam_threshold", &DecoderOptions::beamThreshold)
@@ -207,7 +219,8 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
       .def_readwrite("sil_score", &DecoderOptions::silScore)
       .def_readwrite("eos_score", &DecoderOptions::silScore)
       .def_readwrite("log_add", &DecoderOptions::logAdd)
-      .def_readwrite("criterion_type", &DecoderOptions::criterionType);
+      .def_readwrite("criterion_type", &DecoderOptions::criterionType)
+      .def_readwrite("merge_mode", &DecoderOptions::mergeMode);
 
   py::class_<DecodeResult>(m, "DecodeResult")
       .def(py::init<int>(), "length"_a)
@@ -228,6 +241,15 @@ PYBIND11_MODULE(_lib_text_decoder, m) {
            const int,
            const std::vector<float>&,
            const bool>())
+      .def(py::init<
+           const DecoderOptions&,
+           const FlatTriePtr,
+           const LMPtr,
+           const int,
+           const int,
+           const int,
+           const std::vector<float>&,
+           const bool>())
       .def("decode_begin", &LexiconDecoder::decodeBegin)
       .def(
           "decode_step",
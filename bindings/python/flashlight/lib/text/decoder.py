@@ -11,10 +11,12 @@ from flashlight._lib_text_decoder import (
     CriterionType,
     DecodeResult,
     DecoderOptions,
+    FlatTrie,
     KenLM,
     LexiconDecoder,
     LexiconFreeDecoder,
     LMState,
+    MergeMode,
     SmearingMode,
     Trie,
     TrieNode,
@@ -18,25 +18,50 @@
 #include <af/internal.h>
 #include <algorithm>
 #include <cassert>
-#include <functional>
+#include <cstdint>
 #include <stdexcept>
-#include <unordered_set>
 #include <utility>
 
 #include "flashlight/flashlight/common/CppBackports.h"
 
 namespace fl {
 
-Variable::Variable(af::array data, bool calcGrad) {
+namespace {
+thread_local bool gradEnabled = true;
+} // namespace
+
+constexpr size_t Variable::kMaxPendingGrads;
+
+bool isGradEnabled() {
+  return gradEnabled;
+}
+
+NoGradGuard::NoGradGuard() : prevGradEnabled_(gradEnabled) {
+  gradEnabled = false;
+}
+
+NoGradGuard::~NoGradGuard() {
+  gradEnabled = prevGradEnabled_;
+}
+
+Variable::Variable(af::array data, bool calcGrad)
+    : sharedGrad_(calcGrad ? std::make_shared<SharedGrad>() : nullptr) {
   sharedData_->data = std::move(data);
-  sharedGrad_->calcGrad = calcGrad;
+  if (calcGrad) {
+    sharedGrad_->calcGrad = true;
+  }
 }
 
 Variable::Variable(
     af::array data,
     std::vector<Variable> inputs,
-    GradFunc gradFunc) {
+    GradFunc gradFunc)
+    : sharedGrad_(gradEnabled ? std::make_shared<SharedGrad>() : nullptr) {
   sharedData_->data = std::move(data);
+  if (!gradEnabled) {
+    // Gradient state is allocated on first use, see setCalcGrad()
+    return;
+  }
   if (std::any_of(inputs.begin(), inputs.end(), [](const Variable& input) {
         return input.isCalcGrad();
       })) {
@@ -72,7 +97,7 @@ af::array& Variable::array() const {
 }
 
 Variable& Variable::grad() const {
-  if (!sharedGrad_->calcGrad) {
+  if (!isCalcGrad()) {
     throw std::logic_error("gradient calculation disabled for this Variable");
   }
 
@@ -80,19 +105,29 @@ Variable& Variable::grad() const {
     throw std::logic_error("gradient not calculated yet for this Variable");
   }
 
+  accumulatePendingGrads();
   return *sharedGrad_->grad;
 }
 
 std::vector<Variable>& Variable::getInputs() const {
+  if (!sharedGrad_) {
+    thread_local std::vector<Variable> noInputs;
+    noInputs.clear();
+    return noInputs;
+  }
   return sharedGrad_->inputs;
 }
 
+std::weak_ptr<const void> Variable::getDataRef() const {
+  return sharedData_;
+}
+
 bool Variable::isCalcGrad() const {
-  return sharedGrad_->calcGrad;
+  return sharedGrad_ && sharedGrad_->calcGrad;
 }
 
 bool Variable::isGradAvailable() const {
-  if (!sharedGrad_->calcGrad) {
+  if (!isCalcGrad()) {
     return false;
   }
   return sharedGrad_->grad != nullptr;
@@ -144,29 +179,39 @@ void Variable::eval() const {
 }
 
 void Variable::zeroGrad() {
-  sharedGrad_->grad.reset();
+  if (sharedGrad_) {
+    sharedGrad_->grad.reset();
+    sharedGrad_->pendingGrads.clear();
+  }
 }
 
 void Variable::setCalcGrad(bool calcGrad) {
+  if (!sharedGrad_) {
+    if (!calcGrad) {
+      return;
+    }
+    sharedGrad_ = std::make_shared<SharedGrad>();
+  }
   sharedGrad_->calcGrad = calcGrad;
   if (!calcGrad) {
     sharedGrad_->gradFunc = nullptr;
     sharedGrad_->inputs.clear();
     sharedGrad_->grad.reset();
+    sharedGrad_->pendingGrads.clear();
   }
 }
 
 void Variable::addGrad(const Variable& childGrad) {
-  if (sharedGrad_->calcGrad) {
+  if (isCalcGrad()) {
     if (sharedGrad_->grad) {
-      // Prevent increment of array refcount to avoid a copy
-      // if getting a device pointer. See
-      // https://git.io/fp9oM for more
-      sharedGrad_->grad = cpp::make_unique<Variable>(
-          sharedGrad_->grad->array() + childGrad.array(), false);
-      // Eval the JIT as a temporary workaround for
-      // https://github.com/arrayfire/arrayfire/issues/2281
-      sharedGrad_->grad->eval();
+      // Summed when the gradient is read, so that the gradients of a Variable
+      // with many consumers are summed and evaluated once. Leaves are only
+      // read after the backward pass, so the queue is bounded to keep a few
+      // gradients of a weight used at many steps alive at a time.
+      sharedGrad_->pendingGrads.push_back(childGrad);
+      if (sharedGrad_->pendingGrads.size() >= kMaxPendingGrads) {
+        accumulatePendingGrads();
+      }
     } else {
       // Copy the childGrad Variable so as to share a reference
       // to the underlying childGrad.array() rather than copying
@@ -176,27 +221,61 @@ void Variable::addGrad(const Variable& childGrad) {
   }
 }
 
+size_t Variable::numPendingGrads() const {
+  return sharedGrad_ ? sharedGrad_->pendingGrads.size() : 0;
+}
+
+void Variable::accumulatePendingGrads() const {
+  auto& pendingGrads = sharedGrad_->pendingGrads;
+  if (pendingGrads.empty()) {
+    return;
+  }
+  af::array sum = sharedGrad_->grad->array() + pendingGrads.front().array();
+  for (auto iter = pendingGrads.begin() + 1; iter != pendingGrads.end();
+       ++iter) {
+    sum += iter->array();
+  }
+  pendingGrads.clear();
+  // Prevent increment of array refcount to avoid a copy
+  // if getting a device pointer. See
+  // https://git.io/fp9oM for more
+  sharedGrad_->grad = cpp::make_unique<Variable>(sum, false);
+  // Eval the JIT as a temporary workaround for
+  // https://github.com/arrayfire/arrayfire/issues/2281
+  sharedGrad_->grad->eval();
+}
+
 void Variable::registerGradHook(const GradHook& hook) {
+  if (!sharedGrad_) {
+    sharedGrad_ = std::make_shared<SharedGrad>();
+  }
   sharedGrad_->onGradAvailable = hook;
 }
 
 void Variable::clearGradHook() {
-  sharedGrad_->onGradAvailable = nullptr;
+  if (sharedGrad_) {
+    sharedGrad_->onGradAvailable = nullptr;
+  }
 }
 
 void Variable::applyGradHook() {
-  if (sharedGrad_->onGradAvailable) {
+  if (sharedGrad_ && sharedGrad_->onGradAvailable) {
     assert(sharedGrad_->grad);
+    accumulatePendingGrads();
     sharedGrad_->onGradAvailable(*sharedGrad_->grad);
   }
 }
 
 void Variable::calcGradInputs(bool retainGraph) {
+  if (!sharedGrad_) {
+    return;
+  }
   if (sharedGrad_->gradFunc) {
     if (!sharedGrad_->grad) {
       throw std::logic_error("gradient was not propagated to this Variable");
     }
 
+    accumulatePendingGrads();
     sharedGrad_->gradFunc(sharedGrad_->inputs, *sharedGrad_->grad);
   }
   if (!retainGraph) {
@@ -205,15 +284,9 @@ void Variable::calcGradInputs(bool retainGraph) {
 }
 
 void Variable::backward(const Variable& grad, bool retainGraph) {
-  addGrad(grad);
-  auto dag = build();
-  for (auto iter = dag.rbegin(); iter != dag.rend(); iter++) {
-    iter->calcGradInputs(retainGraph);
-    iter->applyGradHook();
-    if (!retainGraph) {
-      *iter = Variable();
-    }
-  }
+  BackwardTape tape;
+  tape.record(*this);
+  tape.backward(grad, retainGraph);
 }
 
 void Variable::backward(bool retainGraph) {
@@ -311,26 +384,139 @@ Variable Variable::withoutData() const {
   return other;
 }
 
-Variable::DAG Variable::build() const {
-  std::unordered_set<SharedGrad*> cache;
-  DAG dag;
-  std::function<void(const Variable&)> recurse;
+namespace {
 
-  // Topological sort
-  recurse = [&](const Variable& var) {
-    auto id = var.sharedGrad_.get();
-    if (cache.find(id) != cache.end()) {
-      return;
+// Set of the SharedGrads visited by a graph traversal. Each thread keeps its
+// own across traversals, as graphs may share Variables between threads. It is
+// a flat table with linear probing, whose slots are tagged with the traversal
+// which filled them, so clearing it costs nothing and inserting into it
+// doesn't allocate once it is large enough.
+class VisitedSet {
+ public:
+  void clear() {
+    ++epoch_;
+    size_ = 0;
+  }
+
+  // Returns whether ptr wasn't in the set yet
+  bool insert(const void* ptr) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      grow();
     }
-    for (const auto& input : var.getInputs()) {
-      recurse(input);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash(ptr) & mask;; i = (i + 1) & mask) {
+      if (slots_[i].epoch != epoch_) {
+        slots_[i] = {ptr, epoch_};
+        ++size_;
+        return true;
+      } else if (slots_[i].ptr == ptr) {
+        return false;
+      }
     }
-    cache.insert(id);
-    dag.push_back(var);
+  }
+
+ private:
+  struct Slot {
+    const void* ptr;
+    uint64_t epoch;
   };
 
-  recurse(*this);
-  return dag;
+  // Slots from a previous traversal, including the initial ones, are empty
+  uint64_t epoch_{1};
+  size_t size_{0};
+  std::vector<Slot> slots_;
+
+  static size_t hash(const void* ptr) {
+    uint64_t h = reinterpret_cast<uintptr_t>(ptr);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  void grow() {
+    std::vector<Slot> slots(
+        std::max<size_t>(2 * slots_.size(), 64), Slot{nullptr, 0});
+    slots_.swap(slots);
+    size_ = 0;
+    for (const auto& slot : slots) {
+      if (slot.epoch == epoch_) {
+        insert(slot.ptr);
+      }
+    }
+  }
+};
+
+} // namespace
+
+void Variable::build(DAG& dag) const {
+  thread_local VisitedSet visited;
+  // Variables being visited, with the index of their next input to visit
+  thread_local std::vector<std::pair<const Variable*, size_t>> stack;
+
+  // Topological sort
+  dag.clear();
+  if (!sharedGrad_) {
+    // Created without recording a graph
+    dag.push_back(*this);
+    return;
+  }
+  visited.clear();
+  stack.clear();
+  visited.insert(sharedGrad_.get());
+  stack.emplace_back(this, 0);
+  while (!stack.empty()) {
+    const Variable* var = stack.back().first;
+    size_t& nextInput = stack.back().second;
+    const auto& inputs = var->getInputs();
+    if (nextInput < inputs.size()) {
+      const Variable& input = inputs[nextInput++];
+      // Inputs created without recording a graph don't need a gradient
+      if (input.sharedGrad_ && visited.insert(input.sharedGrad_.get())) {
+        stack.emplace_back(&input, 0);
+      }
+    } else {
+      dag.push_back(*var);
+      stack.pop_back();
+    }
+  }
+}
+
+void BackwardTape::record(const Variable& output) {
+  output.build(dag_);
+}
+
+void BackwardTape::backward(const Variable& grad, bool retainGraph) {
+  if (dag_.empty()) {
+    throw std::logic_error("BackwardTape: no graph recorded");
+  }
+  dag_.back().addGrad(grad);
+  for (auto iter = dag_.rbegin(); iter != dag_.rend(); iter++) {
+    iter->calcGradInputs(retainGraph);
+    iter->applyGradHook();
+    if (!retainGraph) {
+      *iter = Variable();
+    }
+  }
+  if (!retainGraph) {
+    dag_.clear();
+  }
+}
+
+void BackwardTape::backward(bool retainGraph) {
+  if (dag_.empty()) {
+    throw std::logic_error("BackwardTape: no graph recorded");
+  }
+  auto ones = Variable(af::constant(1, dag_.back().dims()), false);
+  backward(ones, retainGraph);
+}
+
+size_t BackwardTape::size() const {
+  return dag_.size();
+}
+
+void BackwardTape::clear() {
+  dag_.clear();
 }
 
 } // namespace fl
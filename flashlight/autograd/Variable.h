@@ -16,8 +16,11 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <arrayfire.h>
@@ -25,6 +28,14 @@
 
 namespace fl {
 
+class BackwardTape;
+
+/**
+ * Returns whether operations on Variables record the computation graph on the
+ * current thread, see `NoGradGuard`.
+ */
+bool isGradEnabled();
+
 /**
  *  Variable wraps an Arrayfire array and facilitates easy backpropagation
  *
@@ -96,6 +107,22 @@ class Variable {
    */
   Variable(af::array data, std::vector<Variable> inputs, GradFunc gradFunc);
 
+  /**
+   * Same as above for any callable `gradFunc`, which is only converted to a
+   * `GradFunc` when the computation graph is recorded. Under a `NoGradGuard`,
+   * the closure is neither copied nor allocated.
+   */
+  template <
+      typename F,
+      typename = typename std::enable_if<
+          !std::is_same<typename std::decay<F>::type, GradFunc>::value>::type>
+  Variable(af::array data, std::vector<Variable> inputs, F&& gradFunc)
+      : Variable(
+            std::move(data),
+            std::move(inputs),
+            isGradEnabled() ? GradFunc(std::forward<F>(gradFunc))
+                            : GradFunc()) {}
+
   /**
    * Indexing operator on the Arrayfire Array wrapped by the Variable
    * @param[in] s0 sequence of indices along first dimension
@@ -224,9 +251,18 @@ class Variable {
   /**
    * Add the gradient `childGrad` to the Variable.
    * No-op if `this->isCalcGrad()` is false.
+   * The gradients added are summed when the gradient is read, or once
+   * `kMaxPendingGrads` of them are waiting, which bounds the memory they use.
    */
   void addGrad(const Variable& childGrad);
 
+  /**
+   * Number of gradients added with `addGrad()` and not summed yet
+   */
+  size_t numPendingGrads() const;
+
+  static constexpr size_t kMaxPendingGrads = 8;
+
   /**
    * Registers a lambda function `hook` to be applied on the gradient w.r.t
    * Variable after it is computed during backward pass
@@ -322,19 +358,35 @@ class Variable {
    */
   Variable withoutData() const;
 
- private:
-  using DAG = std::vector<Variable>;
-
   /**
-   * Get all the inputs to this Variable
+   * Get all the inputs to this Variable. Variables which don't record a graph,
+   * such as constants and results of operations run under `NoGradGuard`, have
+   * none.
    */
   std::vector<Variable>& getInputs() const;
 
+  /**
+   * Returns a weak reference to the data shared by this Variable and its
+   * copies. It identifies the data of the Variable, e.g. the parameter of a
+   * module, and expires once the Variable and all its copies are destroyed.
+   * Backends use it to key state derived from the data without extending its
+   * lifetime.
+   */
+  std::weak_ptr<const void> getDataRef() const;
+
+ private:
+  friend class BackwardTape;
+
+  using DAG = std::vector<Variable>;
+
   /**
    * Builds the computation graph which comprises of all the input Variables for
-   * which the gradient of `var` can be propagated using chain rule
+   * which the gradient of `var` can be propagated using chain rule. The graph
+   * is stored in `dag` in topological order, inputs first, reusing its memory.
+   * The traversal is iterative, so it is not limited by the depth of the
+   * graph.
    */
-  DAG build() const;
+  void build(DAG& dag) const;
 
   /**
    * Calculate the gradient of inputs.
@@ -348,6 +400,11 @@ class Variable {
    */
   void applyGradHook();
 
+  /**
+   * Sums the gradients added since the gradient was last read into it
+   */
+  void accumulatePendingGrads() const;
+
   struct SharedData {
     /// Array wrapped by this Variable
     af::array data;
@@ -362,6 +419,8 @@ class Variable {
     std::vector<Variable> inputs;
     /// Gradient with respect to this Variable
     std::unique_ptr<Variable> grad{nullptr};
+    /// Gradients added to grad, summed when it is read
+    std::vector<Variable> pendingGrads;
     /// Function for calculating the gradient of the input Variables
     GradFunc gradFunc{nullptr};
     /// Function applied to gradient after it's computed during bwd pass
@@ -372,7 +431,9 @@ class Variable {
   };
 
   std::shared_ptr<SharedData> sharedData_{std::make_shared<SharedData>()};
-  std::shared_ptr<SharedGrad> sharedGrad_{std::make_shared<SharedGrad>()};
+  // Only allocated for Variables which record a graph or need a gradient,
+  // see setCalcGrad() and registerGradHook()
+  std::shared_ptr<SharedGrad> sharedGrad_;
 
   // NB: array only; we don't try to serialize the autograd graph
   // Saving the sharedData ptr helps to avoid saving variables which share the
@@ -380,4 +441,96 @@ class Variable {
   FL_SAVE_LOAD(sharedData_, sharedGrad_)
 };
 
+/**
+ * NoGradGuard disables the recording of the computation graph on the current
+ * thread while it is in scope. Operations on Variables then only compute their
+ * result: they don't create a gradient function, keep references to their
+ * inputs or allocate gradient state, whether their inputs require a gradient
+ * or not. Use it for inference and validation to save memory and time.
+ *
+ * Guards can be nested. Variables created with `Variable(data, true)`
+ * still require a gradient. The gradient state of the other Variables is
+ * allocated on first use, e.g. by `setCalcGrad(true)`, and is not shared with
+ * the copies made before.
+ *
+ * \code{.cpp}
+ * {
+ *   fl::NoGradGuard noGrad;
+ *   auto output = model(input); // output.isCalcGrad() is false
+ * }
+ * \endcode
+ */
+class NoGradGuard {
+ public:
+  NoGradGuard();
+  ~NoGradGuard();
+  NoGradGuard(const NoGradGuard&) = delete;
+  NoGradGuard& operator=(const NoGradGuard&) = delete;
+
+ private:
+  bool prevGradEnabled_;
+};
+
+/**
+ * BackwardTape records the topologically sorted computation graph leading to
+ * a Variable, which backward passes then replay without traversing the graph.
+ *
+ * Variable::backward() records a new tape on each call. Keeping a BackwardTape
+ * across training steps instead reuses its memory: once the graph size is
+ * stable, recording and replaying it doesn't allocate. When the graph is
+ * retained, the same tape can also be replayed several times, e.g. with
+ * different output gradients.
+ *
+ * Example :
+ *
+ * \code{.cpp}
+ * fl::BackwardTape tape;
+ * for (auto& sample : dataset) {
+ *   auto loss = criterion(model(sample[0]), sample[1]);
+ *   tape.record(loss);
+ *   tape.backward();
+ *   optimizer.step();
+ * }
+ * \endcode
+ */
+class BackwardTape {
+ public:
+  /**
+   * Records the computation graph leading to `output`, replacing the previous
+   * recording.
+   */
+  void record(const Variable& output);
+
+  /**
+   * Runs the backward pass of the recorded graph. Same as
+   * `Variable::backward(grad, retainGraph)` on the recorded Variable.
+   * @param[in] grad gradient w.r.t to the recorded Variable
+   * @param[in] retainGraph If False, clears the input Variables stored by the
+   * Variables of the graph, and the tape itself
+   */
+  void backward(const Variable& grad, bool retainGraph = false);
+
+  /**
+   * Runs the backward pass of the recorded graph, with a gradient of 1.0 for
+   * all the elements of the recorded Variable.
+   * @param[in] retainGraph If False, clears the input Variables stored by the
+   * Variables of the graph, and the tape itself
+   */
+  void backward(bool retainGraph = false);
+
+  /**
+   * Returns the number of Variables in the recorded graph
+   */
+  size_t size() const;
+
+  /**
+   * Releases the recorded graph, keeping the memory of the tape
+   */
+  void clear();
+
+ private:
+  /// Variables of the graph in topological order, the recorded one last
+  Variable::DAG dag_;
+};
+
 } // namespace fl
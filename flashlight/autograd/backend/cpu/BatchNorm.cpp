@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <memory>
 #include <stdexcept>
 
 #include <arrayfire.h>
@@ -26,6 +27,13 @@ constexpr size_t kWIdx = 1;
 constexpr size_t kChannelSizeIdx = 2;
 constexpr size_t kBatchSizeIdx = 3;
 
+detail::MkldnnPrimitiveDescCache<
+    mkldnn::batch_normalization_forward::primitive_desc>
+    fwdPrimDescCache;
+detail::MkldnnPrimitiveDescCache<
+    mkldnn::batch_normalization_backward::primitive_desc>
+    bwdPrimDescCache;
+
 } // namespace
 
 Variable batchnorm(
@@ -114,11 +122,15 @@ Variable batchnorm(
   // FWD primitive descriptor construction
   auto kind = train ? mkldnn::prop_kind::forward_training
                     : mkldnn::prop_kind::forward_inference;
-  auto fwdDesc = mkldnn::batch_normalization_forward::desc(
-      kind, inputOutputMemDesc, epsilon, flag);
-  auto fwdPrimDesc =
-      std::make_shared<mkldnn::batch_normalization_forward::primitive_desc>(
-          fwdDesc, mkldnnEngine);
+  auto fwdPrimDesc = fwdPrimDescCache.get(
+      detail::mkldnnCacheKey(inputOutputDims, dType, epsilon, flag, kind),
+      [&]() {
+        auto fwdDesc = mkldnn::batch_normalization_forward::desc(
+            kind, inputOutputMemDesc, epsilon, flag);
+        return std::make_shared<
+            mkldnn::batch_normalization_forward::primitive_desc>(
+            fwdDesc, mkldnnEngine);
+      });
 
   /****************************************************************************/
   // Prepare memories
@@ -264,26 +276,28 @@ Variable batchnorm(
     auto gradWeightsMkldnnMemInit = mkldnn::memory(
         gradWeightsMkldnnMemPrimDesc, gradWeightsMkldnnRaw.get());
 
-    /********************************************************************/
-    // Setup backward descriptor:
-
-    auto bwdDesc = mkldnn::batch_normalization_backward::desc(
-        mkldnn::prop_kind::backward,
-        gradOutputMemDesc,
-        outputMemDesc,
-        epsilon,
-        mkldnn::use_scale_shift);
-
     /********************************************************************/
     // Setup backward prim descriptor:
-    auto bwdPrimDesc = mkldnn::batch_normalization_backward::primitive_desc(
-        bwdDesc, mkldnnEngineBwd, *fwdPrimDesc);
+    auto bwdPrimDesc = bwdPrimDescCache.get(
+        detail::mkldnnCacheKey(inputOutputDims, dType, epsilon),
+        [&]() {
+          // Setup backward descriptor:
+          auto bwdDesc = mkldnn::batch_normalization_backward::desc(
+              mkldnn::prop_kind::backward,
+              gradOutputMemDesc,
+              outputMemDesc,
+              epsilon,
+              mkldnn::use_scale_shift);
+          return std::make_shared<
+              mkldnn::batch_normalization_backward::primitive_desc>(
+              bwdDesc, mkldnnEngineBwd, *fwdPrimDesc);
+        });
 
     /********************************************************************/
     // Construct bwd op
 
     auto bwdPrim = std::make_shared<mkldnn::batch_normalization_backward>(
-        bwdPrimDesc,
+        *bwdPrimDesc,
         inputMemInit,
         meanMemInit,
         varMemInit,
@@ -6,9 +6,15 @@
  */
 
 #include <array>
+#include <iterator>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 
+#include <af/internal.h>
 #include <arrayfire.h>
 #include <mkldnn.hpp>
 
@@ -30,6 +36,122 @@ constexpr size_t kIOChannelSizeIdx = 2;
 constexpr size_t kIOBatchSizeIdx = 3;
 constexpr size_t kWeightOutputChannelSizeIdx = 3;
 
+detail::MkldnnPrimitiveDescCache<convolution_forward::primitive_desc>
+    fwdPrimDescCache;
+detail::MkldnnPrimitiveDescCache<convolution_backward_data::primitive_desc>
+    bwdDataPrimDescCache;
+detail::MkldnnPrimitiveDescCache<convolution_backward_weights::primitive_desc>
+    bwdWeightsPrimDescCache;
+
+/**
+ * Weights reordered into the layout requested by the forward convolution
+ * (usually a blocked layout), kept between inference calls so that the
+ * weights aren't reordered on every forward.
+ *
+ * Entries are keyed by the data of the weights Variable (see
+ * Variable::getDataRef()), which is the same across calls for the parameters
+ * of a module, and by the layout. An entry is dropped once that data is
+ * destroyed, so that weights computed on every call (e.g. by WeightNorm)
+ * don't pile up and a freed model doesn't keep its reordered weights.
+ *
+ * An entry holds a reference to the array it was reordered from, so that its
+ * buffer can't be reused by another array while cached: if the weights still
+ * point to that buffer, they haven't changed since they were reordered.
+ * Otherwise the entry is dropped when it is looked up.
+ *
+ * The reordered weights take at most kCapacityBytes; the least recently used
+ * entries are evicted beyond that.
+ */
+class ReorderedWeightsCache {
+ public:
+  std::shared_ptr<memory> find(
+      const Variable& weights,
+      const detail::MkldnnCacheKey& layout) {
+    if (!af::isOwner(weights.array())) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    eraseExpired();
+    auto it = index_.find({weights.getDataRef().lock().get(), layout});
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    auto entry = it->second;
+    if (af::getRawPtr(entry->source) != af::getRawPtr(weights.array())) {
+      erase(it);
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, entry);
+    return entry->reordered;
+  }
+
+  void insert(
+      const Variable& weights,
+      const detail::MkldnnCacheKey& layout,
+      std::shared_ptr<memory> reordered) {
+    size_t bytes = reordered->get_primitive_desc().get_size();
+    if (!af::isOwner(weights.array()) || bytes > kCapacityBytes) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    eraseExpired();
+    auto data = weights.getDataRef();
+    Key key(data.lock().get(), layout);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      erase(it);
+    }
+    while (bytes_ + bytes > kCapacityBytes) {
+      erase(index_.find(lru_.back().key));
+    }
+    lru_.push_front(
+        {key, std::move(data), weights.array(), std::move(reordered), bytes});
+    index_[key] = lru_.begin();
+    bytes_ += bytes;
+  }
+
+ private:
+  static constexpr size_t kCapacityBytes = size_t(256) << 20;
+
+  using Key = std::pair<const void*, detail::MkldnnCacheKey>;
+
+  struct Entry {
+    Key key;
+    std::weak_ptr<const void> data;
+    af::array source;
+    std::shared_ptr<memory> reordered;
+    size_t bytes;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  void erase(std::map<Key, EntryList::iterator>::iterator it) {
+    bytes_ -= it->second->bytes;
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+
+  // Drops the entries of weights which were destroyed. This also invalidates
+  // the entries whose key address was reused by other weights.
+  void eraseExpired() {
+    for (auto it = lru_.begin(); it != lru_.end();) {
+      auto next = std::next(it);
+      if (it->data.expired()) {
+        erase(index_.find(it->key));
+      }
+      it = next;
+    }
+  }
+
+  std::mutex mutex_;
+  // Most recently used first
+  EntryList lru_;
+  std::map<Key, EntryList::iterator> index_;
+  size_t bytes_{0};
+};
+
+ReorderedWeightsCache reorderedWeightsCache;
+
 } // namespace
 
 Variable conv2d(
@@ -125,10 +247,11 @@ Variable conv2d(
   // larger dilations accordingly. See https://git.io/fhAT2 for more.
   memory::dims mDilationDims = {dy - 1, dx - 1};
 
-  // Create memory descriptors. using format::any gives the best performance
+  // Create memory descriptors. using format::any gives the best performance.
+  // The weights are then usually reordered into a blocked layout
   auto inputMD = memory::desc({mInputDims}, dataType, formatAny);
   auto outputMD = memory::desc({mOutputDims}, dataType, formatAny);
-  auto weightMD = memory::desc({mWeightDims}, dataType, formatWeight);
+  auto weightMD = memory::desc({mWeightDims}, dataType, formatAny);
   auto biasMD = memory::desc({mBiasDims}, dataType, formatAny);
 
   // Choose a mode based on whether gradients are needed
@@ -137,39 +260,51 @@ Variable conv2d(
       ? prop_kind::forward_training
       : prop_kind::forward_inference;
 
-  // Convolution descriptor
-  std::shared_ptr<convolution_forward::desc> fwdDescriptor;
-  if (hasBias) {
-    fwdDescriptor = std::make_shared<convolution_forward::desc>(
-        forwardMode,
-        convolution_direct,
-        inputMD,
-        weightMD,
-        biasMD,
-        outputMD,
-        mStrideDims,
-        mDilationDims,
-        mPaddingDims,
-        mPaddingDims,
-        padding_kind::zero);
-  } else {
-    fwdDescriptor = std::make_shared<convolution_forward::desc>(
-        forwardMode,
-        convolution_direct,
-        inputMD,
-        weightMD,
-        outputMD,
-        mStrideDims,
-        mDilationDims,
-        mPaddingDims,
-        mPaddingDims,
-        padding_kind::zero);
-  }
-
-  // Primitive descriptor
+  // Primitive descriptor, for all the convolutions with the same parameters
   auto mkldnnEngine = detail::MkldnnEngine::getInstance().getEngine();
-  auto fwdPrimDesc = std::make_shared<convolution_forward::primitive_desc>(
-      *fwdDescriptor, mkldnnEngine);
+  auto fwdPrimDesc = fwdPrimDescCache.get(
+      detail::mkldnnCacheKey(
+          mInputDims,
+          mWeightDims,
+          mOutputDims,
+          mStrideDims,
+          mDilationDims,
+          mPaddingDims,
+          hasBias,
+          dataType,
+          forwardMode),
+      [&]() {
+        // Convolution descriptor
+        std::shared_ptr<convolution_forward::desc> fwdDescriptor;
+        if (hasBias) {
+          fwdDescriptor = std::make_shared<convolution_forward::desc>(
+              forwardMode,
+              convolution_direct,
+              inputMD,
+              weightMD,
+              biasMD,
+              outputMD,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              mPaddingDims,
+              padding_kind::zero);
+        } else {
+          fwdDescriptor = std::make_shared<convolution_forward::desc>(
+              forwardMode,
+              convolution_direct,
+              inputMD,
+              weightMD,
+              outputMD,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              mPaddingDims,
+              padding_kind::zero);
+        }
+        return std::make_shared<convolution_forward::primitive_desc>(
+            *fwdDescriptor, mkldnnEngine);
+      });
 
   // Create memory
   DevicePtr inputRaw(input.array());
@@ -178,10 +313,6 @@ Variable conv2d(
   DevicePtr outputRaw(output);
   auto outputMemoryInit = memory(
       {{{mOutputDims}, dataType, formatNCHW}, mkldnnEngine}, outputRaw.get());
-  DevicePtr weightsRaw(weights.array());
-  auto weightsMemoryInit = memory(
-      {{{mWeightDims}, dataType, formatWeight}, mkldnnEngine},
-      weightsRaw.get());
 
   // Network for execution
   std::vector<primitive> network;
@@ -195,8 +326,34 @@ Variable conv2d(
   // Input
   auto inputMemory =
       detail::mkldnnAlignOrdering(network, inputMemoryInit, inputPrimDesc);
-  auto weightsMemory =
-      detail::mkldnnAlignOrdering(network, weightsMemoryInit, weightsPrimDesc);
+  // Weights. For inference, the weights reordered by a previous call are used
+  // if they haven't changed since then. Getting a device pointer to the
+  // weights while they are cached would copy them.
+  auto weightsMemoryInitPrimDesc = memory::primitive_desc(
+      {{mWeightDims}, dataType, formatWeight}, mkldnnEngine);
+  bool cacheWeights = forwardMode == prop_kind::forward_inference &&
+      weightsMemoryInitPrimDesc != memory::primitive_desc(weightsPrimDesc);
+  auto weightsLayout =
+      detail::mkldnnCacheKey(memory::primitive_desc(weightsPrimDesc));
+  std::shared_ptr<memory> weightsMemory;
+  if (cacheWeights) {
+    weightsMemory = reorderedWeightsCache.find(weights, weightsLayout);
+  }
+  bool weightsCached = weightsMemory != nullptr;
+  DevicePtr weightsRaw;
+  // Weights in another layout than the one of the array, kept for the
+  // backward pass
+  std::shared_ptr<memory> reorderedWeightsMemory;
+  if (!weightsCached) {
+    weightsRaw = DevicePtr(weights.array());
+    auto weightsMemoryInit =
+        memory(weightsMemoryInitPrimDesc, weightsRaw.get());
+    weightsMemory = std::make_shared<memory>(detail::mkldnnAlignOrdering(
+        network, weightsMemoryInit, weightsPrimDesc));
+    if (*weightsMemory != weightsMemoryInit) {
+      reorderedWeightsMemory = weightsMemory;
+    }
+  }
   // Output - adds a reorder after the conv if needed
   auto outputMemory = outputMemoryInit;
   if (outputMemoryInit.get_primitive_desc() !=
@@ -212,20 +369,25 @@ Variable conv2d(
       {{{mBiasDims}, dataType, formatBias}, mkldnnEngine}, biasRaw.get());
   if (hasBias) {
     conv = std::make_shared<convolution_forward>(
-        *fwdPrimDesc, inputMemory, weightsMemory, biasMemory, outputMemory);
+        *fwdPrimDesc, inputMemory, *weightsMemory, biasMemory, outputMemory);
   } else {
     conv = std::make_shared<convolution_forward>(
-        *fwdPrimDesc, inputMemory, weightsMemory, outputMemory);
+        *fwdPrimDesc, inputMemory, *weightsMemory, outputMemory);
   }
   network.push_back(*conv);
 
   // Add output reordering if needed
   if (outputMemory != outputMemoryInit) {
-    network.push_back(mkldnn::reorder(outputMemory, outputMemoryInit));
+    network.push_back(detail::mkldnnReorder(outputMemory, outputMemoryInit));
   }
 
   detail::MkldnnStream::getInstance().getStream().submit(network);
 
+  // Cache the weights once reordered
+  if (cacheWeights && !weightsCached) {
+    reorderedWeightsCache.insert(weights, weightsLayout, weightsMemory);
+  }
+
   /***************************** Backward ******************************/
   auto gradFunc = [hasBias,
                    // Types
@@ -245,8 +407,11 @@ Variable conv2d(
                    outputMD,
                    weightMD,
                    biasMD,
-                   fwdPrimDesc // used for creating a bw desc
-  ](std::vector<Variable>& inputs, const Variable& grad_output) {
+                   fwdPrimDesc, // used for creating a bw desc
+                   // weights in the layout of the forward convolution
+                   reorderedWeightsMemory](
+                      std::vector<Variable>& inputs,
+                      const Variable& grad_output) {
     auto& inputRef = inputs[0];
     auto& weightRef = inputs[1];
 
@@ -258,21 +423,33 @@ Variable conv2d(
       auto gradInput =
           Variable(af::array(inputRef.dims(), inputRef.type()), false);
 
-      // Backward descriptor
-      auto bwdDataDesc = std::make_shared<convolution_backward_data::desc>(
-          convolution_direct,
-          inputMD,
-          weightMD,
-          outputMD,
-          mStrideDims,
-          mDilationDims,
-          mPaddingDims,
-          mPaddingDims,
-          padding_kind::zero);
       // Primitive descriptor
-      auto bwdDataPrimDesc =
-          std::make_shared<convolution_backward_data::primitive_desc>(
-              *bwdDataDesc, mkldnnEngineBwd, *fwdPrimDesc);
+      auto bwdDataPrimDesc = bwdDataPrimDescCache.get(
+          detail::mkldnnCacheKey(
+              mInputDims,
+              mWeightDims,
+              mOutputDims,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              hasBias,
+              dataType),
+          [&]() {
+            // Backward descriptor
+            auto bwdDataDesc = convolution_backward_data::desc(
+                convolution_direct,
+                inputMD,
+                weightMD,
+                outputMD,
+                mStrideDims,
+                mDilationDims,
+                mPaddingDims,
+                mPaddingDims,
+                padding_kind::zero);
+            return std::make_shared<
+                convolution_backward_data::primitive_desc>(
+                bwdDataDesc, mkldnnEngineBwd, *fwdPrimDesc);
+          });
 
       // Create memory
       DevicePtr gradOutputRaw(grad_output.array());
@@ -283,10 +460,6 @@ Variable conv2d(
       auto gradInputMemoryInit = memory(
           {{{mInputDims}, dataType, formatNCHW}, mkldnnEngineBwd},
           gradInputRaw.get());
-      DevicePtr weightRaw(weightRef.array());
-      auto weightsMemoryInitBackwards = memory(
-          {{{mWeightDims}, dataType, formatWeight}, mkldnnEngineBwd},
-          weightRaw.get());
 
       std::vector<primitive> networkBackwards;
       // Check for reorderings
@@ -295,8 +468,25 @@ Variable conv2d(
       auto gradInputPrimitiveDesc = bwdDataPrimDesc->diff_src_primitive_desc();
       auto gradOutputMemory = detail::mkldnnAlignOrdering(
           networkBackwards, gradOutputMemoryInit, gradOutputPrimitiveDesc);
-      auto weightsMemoryBackwards = detail::mkldnnAlignOrdering(
-          networkBackwards, weightsMemoryInitBackwards, weightsPrimitiveDesc);
+      // Use the weights reordered in the forward pass if the layout is the
+      // same
+      DevicePtr weightRaw;
+      std::shared_ptr<memory> weightsMemoryBackwards;
+      if (reorderedWeightsMemory &&
+          reorderedWeightsMemory->get_primitive_desc() ==
+              memory::primitive_desc(weightsPrimitiveDesc)) {
+        weightsMemoryBackwards = reorderedWeightsMemory;
+      } else {
+        weightRaw = DevicePtr(weightRef.array());
+        auto weightsMemoryInitBackwards = memory(
+            {{{mWeightDims}, dataType, formatWeight}, mkldnnEngineBwd},
+            weightRaw.get());
+        weightsMemoryBackwards =
+            std::make_shared<memory>(detail::mkldnnAlignOrdering(
+                networkBackwards,
+                weightsMemoryInitBackwards,
+                weightsPrimitiveDesc));
+      }
       auto gradInputMemory = gradInputMemoryInit;
       // Don't reorder the gradient until after the conv
       if (gradInputMemoryInit.get_primitive_desc() !=
@@ -308,18 +498,18 @@ Variable conv2d(
       auto convBwdData = std::make_shared<convolution_backward_data>(
           *bwdDataPrimDesc,
           gradOutputMemory,
-          weightsMemoryBackwards,
+          *weightsMemoryBackwards,
           gradInputMemory);
       networkBackwards.push_back(*convBwdData);
 
-      detail::MkldnnStream::getInstance().getStream().submit(networkBackwards);
-
       // Reorder the output (which is gradInput here) if necessary
       if (gradInputMemory != gradInputMemoryInit) {
         networkBackwards.push_back(
-            mkldnn::reorder(gradInputMemory, gradInputMemoryInit));
+            detail::mkldnnReorder(gradInputMemory, gradInputMemoryInit));
       }
 
+      detail::MkldnnStream::getInstance().getStream().submit(networkBackwards);
+
       inputRef.addGrad(gradInput);
     }
 
@@ -335,36 +525,50 @@ Variable conv2d(
         gradBias = Variable(af::array(biasRef.dims(), biasRef.type()), false);
       }
 
-      // Weight backward descriptor
-      std::shared_ptr<convolution_backward_weights::desc> bwdWeightDesc;
-      if (hasBias) {
-        bwdWeightDesc = std::make_shared<convolution_backward_weights::desc>(
-            convolution_direct,
-            inputMD,
-            weightMD,
-            biasMD,
-            outputMD,
-            mStrideDims,
-            mDilationDims,
-            mPaddingDims,
-            mPaddingDims,
-            padding_kind::zero);
-      } else {
-        bwdWeightDesc = std::make_shared<convolution_backward_weights::desc>(
-            convolution_direct,
-            inputMD,
-            weightMD,
-            outputMD,
-            mStrideDims,
-            mDilationDims,
-            mPaddingDims,
-            mPaddingDims,
-            padding_kind::zero);
-      }
       // Weight backward primitive descriptor
-      auto bwdWeightPrimDesc =
-          std::make_shared<convolution_backward_weights::primitive_desc>(
-              *bwdWeightDesc, mkldnnEngineBwd, *fwdPrimDesc);
+      auto bwdWeightPrimDesc = bwdWeightsPrimDescCache.get(
+          detail::mkldnnCacheKey(
+              mInputDims,
+              mWeightDims,
+              mOutputDims,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              hasBias,
+              dataType),
+          [&]() {
+            // Weight backward descriptor
+            std::shared_ptr<convolution_backward_weights::desc> bwdWeightDesc;
+            if (hasBias) {
+              bwdWeightDesc =
+                  std::make_shared<convolution_backward_weights::desc>(
+                      convolution_direct,
+                      inputMD,
+                      weightMD,
+                      biasMD,
+                      outputMD,
+                      mStrideDims,
+                      mDilationDims,
+                      mPaddingDims,
+                      mPaddingDims,
+                      padding_kind::zero);
+            } else {
+              bwdWeightDesc =
+                  std::make_shared<convolution_backward_weights::desc>(
+                      convolution_direct,
+                      inputMD,
+                      weightMD,
+                      outputMD,
+                      mStrideDims,
+                      mDilationDims,
+                      mPaddingDims,
+                      mPaddingDims,
+                      padding_kind::zero);
+            }
+            return std::make_shared<
+                convolution_backward_weights::primitive_desc>(
+                *bwdWeightDesc, mkldnnEngineBwd, *fwdPrimDesc);
+          });
 
       // Create memory
       DevicePtr inputRawBackwards(inputRef.array());
@@ -424,7 +628,7 @@ Variable conv2d(
       // Reorder weight gradients if necessary
       if (gradWeightsMemory != gradWeightsMemoryInit) {
         networkBackwards.push_back(
-            mkldnn::reorder(gradWeightsMemory, gradWeightsMemoryInit));
+            detail::mkldnnReorder(gradWeightsMemory, gradWeightsMemoryInit));
       }
 
       detail::MkldnnStream::getInstance().getStream().submit(networkBackwards);
@@ -30,6 +30,29 @@ MkldnnEngine& MkldnnEngine::getInstance() {
   return instance;
 }
 
+void appendToCacheKey(
+    MkldnnCacheKey& key,
+    const mkldnn::memory::primitive_desc& desc) {
+  const auto& data = desc.desc().data;
+  key.push_back(data.ndims);
+  key.insert(key.end(), data.dims, data.dims + data.ndims);
+  key.push_back(data.data_type);
+  key.push_back(data.format);
+}
+
+mkldnn::reorder mkldnnReorder(
+    const mkldnn::memory& input,
+    const mkldnn::memory& output) {
+  static MkldnnPrimitiveDescCache<mkldnn::reorder::primitive_desc> cache;
+  auto inputDesc = input.get_primitive_desc();
+  auto outputDesc = output.get_primitive_desc();
+  auto primDesc = cache.get(mkldnnCacheKey(inputDesc, outputDesc), [&]() {
+    return std::make_shared<mkldnn::reorder::primitive_desc>(
+        inputDesc, outputDesc);
+  });
+  return mkldnn::reorder(*primDesc, input, output);
+}
+
 mkldnn::memory::dims convertAfToMklDnnDims(const std::vector<dim_t>& afDims) {
   // MKL-DNN uses ints in dims
   std::vector<int> intVec(afDims.begin(), afDims.end());
@@ -44,7 +67,7 @@ mkldnn::memory mkldnnAlignOrdering(
   if (memory.get_primitive_desc() != mkldnn::memory::primitive_desc(desc)) {
     memoryOut =
         mkldnn::memory(desc); // use the ordering requested by the descriptor
-    net.push_back(mkldnn::reorder(memory, memoryOut));
+    net.push_back(mkldnnReorder(memory, memoryOut));
   }
   return memoryOut;
 }
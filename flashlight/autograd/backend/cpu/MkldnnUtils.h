@@ -8,6 +8,12 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <arrayfire.h>
 #include <mkldnn.hpp>
@@ -55,6 +61,104 @@ class MkldnnEngine {
   mkldnn::engine engine_;
 };
 
+/**
+ * A key which identifies a primitive descriptor by the shapes, strides,
+ * paddings, data types, formats and flags it is created with.
+ */
+using MkldnnCacheKey = std::vector<int64_t>;
+
+inline void appendToCacheKey(
+    MkldnnCacheKey& key,
+    const mkldnn::memory::dims& dims) {
+  key.push_back(dims.size());
+  key.insert(key.end(), dims.begin(), dims.end());
+}
+
+inline void appendToCacheKey(MkldnnCacheKey& key, double value) {
+  int64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  key.push_back(bits);
+}
+
+/**
+ * Appends the dims, data type and format of a memory primitive descriptor to
+ * a cache key.
+ */
+void appendToCacheKey(
+    MkldnnCacheKey& key,
+    const mkldnn::memory::primitive_desc& desc);
+
+/// Integers, booleans and MKL-DNN enums (formats, data types, prop kinds...)
+template <typename T>
+void appendToCacheKey(MkldnnCacheKey& key, T value) {
+  key.push_back(static_cast<int64_t>(value));
+}
+
+/**
+ * Builds a cache key from a list of integers, enums, doubles and
+ * ``mkldnn::memory::dims``, e.g.
+ * \code
+   auto key = mkldnnCacheKey(inputDims, outputDims, dataType, forwardMode);
+   \endcode
+ */
+template <typename... Args>
+MkldnnCacheKey mkldnnCacheKey(const Args&... args) {
+  MkldnnCacheKey key;
+  int unused[] = {0, (appendToCacheKey(key, args), 0)...};
+  (void)unused;
+  return key;
+}
+
+/**
+ * A thread-safe cache of MKL-DNN primitive descriptors. Creating a primitive
+ * descriptor selects and initializes an implementation, which takes a large
+ * part of the time of small convolutions. The descriptors don't depend on the
+ * data, so one created for a given key can be used to create the primitives
+ * of any call with the same key.
+ *
+ * Each operation owns a static cache for each kind of primitive descriptor it
+ * uses. If a cache grows past its capacity, e.g. with variable input sizes,
+ * it is emptied.
+ */
+template <typename T>
+class MkldnnPrimitiveDescCache {
+ public:
+  explicit MkldnnPrimitiveDescCache(size_t capacity = 1024)
+      : capacity_(capacity) {}
+
+  /**
+   * Returns the primitive descriptor cached for `key`, or caches and returns
+   * the one returned by `create()` if there is none.
+   */
+  template <typename F>
+  std::shared_ptr<T> get(const MkldnnCacheKey& key, F create) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      return it->second;
+    }
+    if (cache_.size() >= capacity_) {
+      cache_.clear();
+    }
+    std::shared_ptr<T> primDesc = create();
+    cache_.emplace(key, primDesc);
+    return primDesc;
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::map<MkldnnCacheKey, std::shared_ptr<T>> cache_;
+};
+
+/**
+ * Creates a ``mkldnn::reorder`` from a memory to another, with a primitive
+ * descriptor shared with all previous reorders between the same layouts.
+ */
+mkldnn::reorder mkldnnReorder(
+    const mkldnn::memory& input,
+    const mkldnn::memory& output);
+
 /**
  * Helper for converting an ArrayFire af::dim4 into an MKL-DNN-compatible input
  * for mkldnn::memory::dims.
@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <memory>
 #include <vector>
 
 #include <arrayfire.h>
@@ -25,6 +26,11 @@ constexpr size_t kHIdx = 1;
 constexpr size_t kChannelSizeIdx = 2;
 constexpr size_t kBatchSizeIdx = 3;
 
+fl::detail::MkldnnPrimitiveDescCache<pooling_forward::primitive_desc>
+    fwdPrimDescCache;
+fl::detail::MkldnnPrimitiveDescCache<pooling_backward::primitive_desc>
+    bwdPrimDescCache;
+
 } // namespace
 
 namespace fl {
@@ -83,17 +89,30 @@ Variable pool2d(
 
   // Descriptors
   auto poolingMode = detail::mkldnnMapToPoolingMode(mode);
-  auto desc = pooling_forward::desc(
-      forwardMode,
-      poolingMode,
-      inputMD,
-      outputMD,
-      strideDims,
-      windowDims,
-      paddingDims,
-      paddingDims,
-      padding_kind::zero);
-  auto primDesc = pooling_forward::primitive_desc(desc, mkldnnEngine);
+  auto primDesc = *fwdPrimDescCache.get(
+      detail::mkldnnCacheKey(
+          inputDims,
+          outputDims,
+          windowDims,
+          strideDims,
+          paddingDims,
+          poolingMode,
+          dataType,
+          forwardMode),
+      [&]() {
+        auto desc = pooling_forward::desc(
+            forwardMode,
+            poolingMode,
+            inputMD,
+            outputMD,
+            strideDims,
+            windowDims,
+            paddingDims,
+            paddingDims,
+            padding_kind::zero);
+        return std::make_shared<pooling_forward::primitive_desc>(
+            desc, mkldnnEngine);
+      });
 
   // Network
   std::vector<primitive> network;
@@ -123,7 +142,7 @@ Variable pool2d(
 
   // Add output reordering if needed
   if (outputMemory != outputMemoryInit) {
-    network.push_back(mkldnn::reorder(outputMemory, outputMemoryInit));
+    network.push_back(detail::mkldnnReorder(outputMemory, outputMemoryInit));
   }
 
   detail::MkldnnStream::getInstance().getStream().submit(network);
@@ -166,22 +185,35 @@ Variable pool2d(
             gradOutputRaw.get());
 
         // Descriptors
-        // Memory descriptors from initialized memory must be used since
-        // pooling_backward descriptors require an ordering
-        auto gradInputMD = gradInputMemoryInit.get_primitive_desc().desc();
-        auto gradOutputMD = gradOutputMemoryInit.get_primitive_desc().desc();
-        auto bwdDesc = pooling_backward::desc(
-            poolingMode,
-            gradInputMD,
-            gradOutputMD,
-            strideDims,
-            windowDims,
-            paddingDims,
-            paddingDims,
-            padding_kind::zero);
-        // Pass forward descriptor as a hint
-        auto bwdPrimDesc = pooling_backward::primitive_desc(
-            bwdDesc, mkldnnEngineBwd, primDesc);
+        auto bwdPrimDesc = *bwdPrimDescCache.get(
+            detail::mkldnnCacheKey(
+                inputDims,
+                outputDims,
+                windowDims,
+                strideDims,
+                paddingDims,
+                poolingMode,
+                dataType),
+            [&]() {
+              // Memory descriptors from initialized memory must be used
+              // since pooling_backward descriptors require an ordering
+              auto gradInputMD =
+                  gradInputMemoryInit.get_primitive_desc().desc();
+              auto gradOutputMD =
+                  gradOutputMemoryInit.get_primitive_desc().desc();
+              auto bwdDesc = pooling_backward::desc(
+                  poolingMode,
+                  gradInputMD,
+                  gradOutputMD,
+                  strideDims,
+                  windowDims,
+                  paddingDims,
+                  paddingDims,
+                  padding_kind::zero);
+              // Pass forward descriptor as a hint
+              return std::make_shared<pooling_backward::primitive_desc>(
+                  bwdDesc, mkldnnEngineBwd, primDesc);
+            });
 
         std::vector<primitive> networkBackward;
         // Reorder output memory if required
@@ -11,4 +11,6 @@ namespace fl {
 // ODR
 constexpr const char* DistributedConstants::kMaxDevicePerNode;
 constexpr const char* DistributedConstants::kFilePath;
+constexpr const char* DistributedConstants::kTcpHost;
+constexpr const char* DistributedConstants::kTcpPort;
 } // namespace fl
@@ -66,11 +66,15 @@ enum class DistributedBackend {
 enum class DistributedInit {
   MPI = 0,
   FILE_SYSTEM = 1,
+  /// Rendezvous through a key-value store served by rank 0 over TCP
+  TCP = 2,
 };
 
 struct DistributedConstants {
   static constexpr const char* kMaxDevicePerNode = "MAX_DEVICE_PER_NODE";
   static constexpr const char* kFilePath = "FILE_PATH";
+  static constexpr const char* kTcpHost = "TCP_HOST";
+  static constexpr const char* kTcpPort = "TCP_PORT";
   static constexpr const std::size_t kCoalesceCacheSize =
       ((size_t)(20) << 20); // 20 MB
 };
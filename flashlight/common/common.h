@@ -13,3 +13,4 @@
 #include "flashlight/flashlight/common/Serialization.h"
 #include "flashlight/flashlight/common/Utils.h"
 #include "flashlight/flashlight/common/threadpool/ThreadPool.h"
+#include "flashlight/flashlight/common/threadpool/WorkStealingThreadPool.h"
@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fl {
+
+namespace detail {
+
+/**
+ * A move-only `void()` callable. Callables of up to `kInlineSize` bytes are
+ * stored inline, so wrapping them does not allocate.
+ */
+class SmallTask {
+ public:
+  static constexpr size_t kInlineSize = 64;
+
+  SmallTask() noexcept : ops_(nullptr) {}
+
+  template <
+      class F,
+      class = typename std::enable_if<!std::is_same<
+          typename std::decay<F>::type,
+          SmallTask>::value>::type>
+  SmallTask(F&& f) : ops_(nullptr) {
+    using Fn = typename std::decay<F>::type;
+    init<Fn>(
+        std::forward<F>(f),
+        std::integral_constant<bool, fitsInline<Fn>()>());
+  }
+
+  SmallTask(SmallTask&& other) noexcept : ops_(nullptr) {
+    moveFrom(other);
+  }
+
+  SmallTask& operator=(SmallTask&& other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  SmallTask(const SmallTask&) = delete;
+  SmallTask& operator=(const SmallTask&) = delete;
+
+  ~SmallTask() {
+    reset();
+  }
+
+  void operator()() {
+    ops_->invoke(&storage_);
+  }
+
+  explicit operator bool() const noexcept {
+    return ops_ != nullptr;
+  }
+
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  using Storage = typename std::
+      aligned_storage<kInlineSize, alignof(std::max_align_t)>::type;
+
+  struct Ops {
+    void (*invoke)(void*);
+    void (*move)(void* from, void* to);
+    void (*destroy)(void*);
+  };
+
+  template <class Fn>
+  static constexpr bool fitsInline() {
+    return sizeof(Fn) <= kInlineSize &&
+        alignof(Fn) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<Fn>::value;
+  }
+
+  template <class Fn>
+  struct InlineOps {
+    static void invoke(void* s) {
+      (*static_cast<Fn*>(s))();
+    }
+    static void move(void* from, void* to) {
+      new (to) Fn(std::move(*static_cast<Fn*>(from)));
+      static_cast<Fn*>(from)->~Fn();
+    }
+    static void destroy(void* s) {
+      static_cast<Fn*>(s)->~Fn();
+    }
+    static constexpr Ops ops = {&invoke, &move, &destroy};
+  };
+
+  template <class Fn>
+  struct HeapOps {
+    static Fn*& ptr(void* s) {
+      return *static_cast<Fn**>(s);
+    }
+    static void invoke(void* s) {
+      (*ptr(s))();
+    }
+    static void move(void* from, void* to) {
+      new (to) Fn*(ptr(from));
+    }
+    static void destroy(void* s) {
+      delete ptr(s);
+    }
+    static constexpr Ops ops = {&invoke, &move, &destroy};
+  };
+
+  template <class Fn, class F>
+  void init(F&& f, std::true_type /* inline */) {
+    new (&storage_) Fn(std::forward<F>(f));
+    ops_ = &InlineOps<Fn>::ops;
+  }
+
+  template <class Fn, class F>
+  void init(F&& f, std::false_type /* inline */) {
+    new (&storage_) Fn*(new Fn(std::forward<F>(f)));
+    ops_ = &HeapOps<Fn>::ops;
+  }
+
+  void moveFrom(SmallTask& other) noexcept {
+    if (other.ops_) {
+      other.ops_->move(&other.storage_, &storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_;
+};
+
+template <class Fn>
+constexpr SmallTask::Ops SmallTask::InlineOps<Fn>::ops;
+
+template <class Fn>
+constexpr SmallTask::Ops SmallTask::HeapOps<Fn>::ops;
+
+/**
+ * A FIFO ring buffer of tasks, which only allocates when it grows. Not
+ * thread-safe.
+ */
+class TaskQueue {
+ public:
+  TaskQueue() : buffer_(kInitialCapacity), head_(0), size_(0) {}
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void push(SmallTask&& task) {
+    if (size_ == buffer_.size()) {
+      grow();
+    }
+    buffer_[(head_ + size_) & (buffer_.size() - 1)] = std::move(task);
+    ++size_;
+  }
+
+  SmallTask pop() {
+    SmallTask task = std::move(buffer_[head_]);
+    head_ = (head_ + 1) & (buffer_.size() - 1);
+    --size_;
+    return task;
+  }
+
+ private:
+  static constexpr size_t kInitialCapacity = 64; // must be a power of 2
+
+  void grow() {
+    std::vector<SmallTask> buffer(buffer_.size() * 2);
+    for (size_t i = 0; i < size_; ++i) {
+      buffer[i] = std::move(buffer_[(head_ + i) & (buffer_.size() - 1)]);
+    }
+    buffer_.swap(buffer);
+    head_ = 0;
+  }
+
+  std::vector<SmallTask> buffer_;
+  size_t head_;
+  size_t size_;
+};
+
+template <class R, class Fn>
+struct PromiseTask {
+  Fn fn;
+  std::promise<R> promise;
+
+  explicit PromiseTask(Fn&& f) : fn(std::move(f)) {}
+
+  void operator()() {
+    try {
+      promise.set_value(fn());
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+template <class Fn>
+struct PromiseTask<void, Fn> {
+  Fn fn;
+  std::promise<void> promise;
+
+  explicit PromiseTask(Fn&& f) : fn(std::move(f)) {}
+
+  void operator()() {
+    try {
+      fn();
+      promise.set_value();
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+struct ParallelForState {
+  std::atomic<int64_t> nextChunk{0};
+  std::atomic<int64_t> doneChunks{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable done;
+};
+
+} // namespace detail
+
+/**
+ * A work-stealing thread pool.
+ *
+ * Each worker owns a task queue with its own lock; tasks enqueued from a
+ * worker go to its own queue, others are spread over the queues round-robin.
+ * Idle workers steal from the other queues, and only go to sleep when no
+ * task is pending anywhere: there is no global lock on the task path.
+ *
+ * Tasks are stored in a small-buffer callable (no allocation for callables
+ * of up to 64 bytes). `enqueue` has the same interface as `fl::ThreadPool`;
+ * `execute` skips the future (and its shared state) entirely, and
+ * `parallelFor` runs a loop over the pool and the calling thread.
+ *
+ * Basic usage:
+  \code
+    WorkStealingThreadPool pool(4);
+
+    auto result = pool.enqueue([](int answer) { return answer; }, 42);
+    std::cout << result.get() << std::endl;
+
+    std::vector<float> v(1000);
+    pool.parallelFor(0, v.size(), [&v](int64_t i) { v[i] = i * i; });
+  \endcode
+ */
+class WorkStealingThreadPool {
+ public:
+  /**
+   * Launches the given amount of workers.
+   * \param [in] threads number of threads
+   * \param [in] initFn initialization code (if any) that will be run on all the
+   * threads
+   */
+  explicit WorkStealingThreadPool(
+      size_t threads,
+      const std::function<void(size_t)>& initFn = nullptr);
+
+  /**
+   * Add new work item to the pool.
+   * \param [in] f function to be executed in threadpool
+   * \param [in] args varadic arguments for the function
+   */
+  template <class F, class... Args>
+  auto enqueue(F&& f, Args&&... args)
+      -> std::future<typename std::result_of<F(Args...)>::type>;
+
+  /**
+   * Add new work item to the pool, without a future. An exception escaping
+   * `f` terminates the program.
+   * \param [in] f function to be executed in threadpool
+   */
+  template <class F>
+  void execute(F&& f);
+
+  /**
+   * Call `fn(i)` for all `i` in [begin, end), using the workers and the
+   * calling thread, and block until done. Iterations are distributed in
+   * chunks of `grainSize`. The first exception thrown by `fn` (if any) is
+   * rethrown; remaining chunks are then skipped.
+   */
+  template <class F>
+  void parallelFor(int64_t begin, int64_t end, F&& fn, int64_t grainSize = 1);
+
+  /// Number of workers
+  size_t size() const;
+
+  ///  destructor runs pending tasks and joins all threads.
+  ~WorkStealingThreadPool();
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    detail::TaskQueue tasks;
+  };
+
+  // (pool, worker id) the current thread belongs to, if any
+  static std::pair<const WorkStealingThreadPool*, size_t>& current();
+
+  void push(detail::SmallTask&& task);
+  bool tryPop(size_t id, detail::SmallTask& task);
+  void run(size_t id, const std::function<void(size_t)>& initFn);
+
+  std::vector<std::unique_ptr<Worker>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::atomic<int64_t> pending_;
+  std::atomic<size_t> nextQueue_;
+  std::atomic<int> sleepers_;
+  std::atomic<bool> stop_;
+  std::mutex sleepMutex_;
+  std::condition_variable wakeUp_;
+};
+
+inline WorkStealingThreadPool::WorkStealingThreadPool(
+    size_t threads,
+    const std::function<void(size_t)>& initFn /* = nullptr */)
+    : pending_(0), nextQueue_(0), sleepers_(0), stop_(false) {
+  if (threads == 0) {
+    throw std::invalid_argument("WorkStealingThreadPool needs a thread");
+  }
+  for (size_t id = 0; id < threads; ++id) {
+    queues_.emplace_back(new Worker());
+  }
+  for (size_t id = 0; id < threads; ++id) {
+    workers_.emplace_back([this, initFn, id] { run(id, initFn); });
+  }
+}
+
+template <class F, class... Args>
+auto WorkStealingThreadPool::enqueue(F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type> {
+  using return_type = typename std::result_of<F(Args...)>::type;
+  auto fn = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+  detail::PromiseTask<return_type, decltype(fn)> task(std::move(fn));
+  std::future<return_type> res = task.promise.get_future();
+  push(detail::SmallTask(std::move(task)));
+  return res;
+}
+
+template <class F>
+void WorkStealingThreadPool::execute(F&& f) {
+  push(detail::SmallTask(std::forward<F>(f)));
+}
+
+template <class F>
+void WorkStealingThreadPool::parallelFor(
+    int64_t begin,
+    int64_t end,
+    F&& fn,
+    int64_t grainSize /* = 1 */) {
+  if (end <= begin) {
+    return;
+  }
+  grainSize = std::max<int64_t>(grainSize, 1);
+  const int64_t nChunks = (end - begin + grainSize - 1) / grainSize;
+
+  // Helpers may start after the loop is done, so the state they share is
+  // not on the stack; `fn` is only called for claimed chunks, which all
+  // complete before returning.
+  auto state = std::make_shared<detail::ParallelForState>();
+  auto* f = &fn;
+  auto runChunks = [state, f, begin, end, grainSize, nChunks]() {
+    for (;;) {
+      int64_t chunk = state->nextChunk.fetch_add(1);
+      if (chunk >= nChunks) {
+        return;
+      }
+      if (!state->failed.load()) {
+        try {
+          int64_t chunkEnd = std::min(begin + (chunk + 1) * grainSize, end);
+          for (int64_t i = begin + chunk * grainSize; i < chunkEnd; ++i) {
+            (*f)(i);
+          }
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (!state->error) {
+            state->error = std::current_exception();
+          }
+          state->failed = true;
+        }
+      }
+      if (state->doneChunks.fetch_add(1) + 1 == nChunks) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->done.notify_all();
+      }
+    }
+  };
+
+  int64_t nHelpers = std::min<int64_t>(nChunks - 1, queues_.size());
+  for (int64_t i = 0; i < nHelpers; ++i) {
+    push(detail::SmallTask(runChunks));
+  }
+  runChunks();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(
+      lock, [&state, nChunks]() { return state->doneChunks == nChunks; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+inline size_t WorkStealingThreadPool::size() const {
+  return workers_.size();
+}
+
+inline std::pair<const WorkStealingThreadPool*, size_t>&
+WorkStealingThreadPool::current() {
+  static thread_local std::pair<const WorkStealingThreadPool*, size_t> cur(
+      nullptr, 0);
+  return cur;
+}
+
+inline void WorkStealingThreadPool::push(detail::SmallTask&& task) {
+  // don't allow enqueueing after stopping the pool
+  if (stop_) {
+    throw std::runtime_error("enqueue on stopped WorkStealingThreadPool");
+  }
+  const auto& cur = current();
+  size_t id = (cur.first == this) ? cur.second
+                                  : nextQueue_.fetch_add(1) % queues_.size();
+  // Counted before being queued, so that pending_ never underflows
+  pending_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(queues_[id]->mutex);
+    queues_[id]->tasks.push(std::move(task));
+  }
+  // Workers register as sleepers before checking pending_, so either they
+  // see the new task or we see them.
+  if (sleepers_.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    wakeUp_.notify_one();
+  }
+}
+
+inline bool WorkStealingThreadPool::tryPop(
+    size_t id,
+    detail::SmallTask& task) {
+  const size_t n = queues_.size();
+  for (size_t k = 0; k < n; ++k) {
+    auto& queue = *queues_[(id + k) % n];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.pop();
+      pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void WorkStealingThreadPool::run(
+    size_t id,
+    const std::function<void(size_t)>& initFn) {
+  current() = std::make_pair(this, id);
+  if (initFn) {
+    initFn(id);
+  }
+  detail::SmallTask task;
+  for (;;) {
+    if (tryPop(id, task)) {
+      task();
+      task.reset();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleepers_.fetch_add(1);
+    wakeUp_.wait(lock, [this] { return pending_.load() > 0 || stop_.load(); });
+    sleepers_.fetch_sub(1);
+    if (stop_ && pending_.load() == 0) {
+      return;
+    }
+  }
+}
+
+inline WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  wakeUp_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+} // namespace fl
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/dataset/AsyncFileReader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <linux/aio_abi.h>
+#include <sys/syscall.h>
+#endif
+
+namespace fl {
+
+namespace {
+
+/**
+ * Returns the pool of `numThreads` threads shared by the readers, and starts
+ * it if no reader currently holds it. Each dataset has its own reader: a pool
+ * per reader would start threads for every dataset.
+ */
+std::shared_ptr<WorkStealingThreadPool> getThreadPool(int64_t numThreads) {
+  static std::mutex mutex;
+  static std::map<int64_t, std::weak_ptr<WorkStealingThreadPool>> pools;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& weakPool = pools[numThreads];
+  auto pool = weakPool.lock();
+  if (!pool) {
+    pool = std::make_shared<WorkStealingThreadPool>(numThreads);
+    weakPool = pool;
+  }
+  return pool;
+}
+
+#ifdef __linux__
+// Alignment of offsets, sizes and buffers of O_DIRECT reads
+constexpr int64_t kDirectIoAlignment = 4096;
+
+int64_t alignDown(int64_t offset) {
+  return offset / kDirectIoAlignment * kDirectIoAlignment;
+}
+
+int64_t alignUp(int64_t offset) {
+  return alignDown(offset + kDirectIoAlignment - 1);
+}
+
+/**
+ * A buffer suitable for O_DIRECT reads, which only grows.
+ */
+class AlignedBuffer {
+ public:
+  char* data() {
+    return data_.get();
+  }
+
+  void reserve(int64_t size) {
+    if (size <= size_) {
+      return;
+    }
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, kDirectIoAlignment, size) != 0) {
+      throw std::bad_alloc();
+    }
+    data_.reset(static_cast<char*>(ptr));
+    size_ = size;
+  }
+
+ private:
+  struct Free {
+    void operator()(char* ptr) const {
+      free(ptr);
+    }
+  };
+
+  std::unique_ptr<char, Free> data_;
+  int64_t size_ = 0;
+};
+
+// Maximum number of reads in flight in a single AIO context
+constexpr int64_t kMaxAioQueueDepth = 128;
+
+// glibc does not provide wrappers for the native AIO syscalls
+long ioSetup(unsigned nr, aio_context_t* ctx) {
+  return syscall(__NR_io_setup, nr, ctx);
+}
+
+long ioDestroy(aio_context_t ctx) {
+  return syscall(__NR_io_destroy, ctx);
+}
+
+long ioSubmit(aio_context_t ctx, long nr, struct iocb** iocbpp) {
+  return syscall(__NR_io_submit, ctx, nr, iocbpp);
+}
+
+long ioGetEvents(
+    aio_context_t ctx,
+    long minNr,
+    long nr,
+    struct io_event* events) {
+  return syscall(__NR_io_getevents, ctx, minNr, nr, events, nullptr);
+}
+#endif
+
+} // namespace
+
+char* AsyncFileReader::Extent::target() {
+  if (requests.size() == 1 && requests[0].offset == offset &&
+      requests[0].size == size) {
+    return requests[0].data;
+  }
+  scratch.resize(size);
+  return scratch.data();
+}
+
+void AsyncFileReader::Extent::scatter() const {
+  if (scratch.empty()) {
+    return;
+  }
+  for (const auto& r : requests) {
+    std::memcpy(r.data, scratch.data() + (r.offset - offset), r.size);
+  }
+}
+
+AsyncFileReader::AsyncFileReader(
+    const std::string& name,
+    int64_t maxGap,
+    int64_t maxReadSize,
+    int64_t numThreads,
+    bool useAio)
+    : name_(name),
+      fd_(-1),
+      directFd_(-1),
+      maxGap_(maxGap),
+      maxReadSize_(maxReadSize),
+      useAio_(false),
+      aioContext_(0),
+      numThreads_(numThreads) {
+  if (maxGap_ < 0 || maxReadSize_ <= 0 || numThreads < 0) {
+    throw std::invalid_argument("invalid AsyncFileReader parameters");
+  }
+  fd_ = open(name_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ == -1) {
+    throw std::runtime_error("could not open file " + name_);
+  }
+#ifdef __linux__
+  if (useAio) {
+    // Fails e.g. on file systems which don't support O_DIRECT
+    directFd_ = open(name_.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    aio_context_t ctx = 0;
+    if (directFd_ != -1 && ioSetup(kMaxAioQueueDepth, &ctx) == 0) {
+      aioContext_ = ctx;
+      useAio_ = true;
+    }
+  }
+#endif
+}
+
+void AsyncFileReader::read(const std::vector<FileReadRequest>& requests) const {
+  auto extents = coalesce(requests);
+  if (extents.empty()) {
+    return;
+  }
+  if (extents.size() == 1) {
+    readExtent(extents[0]);
+    return;
+  }
+  if (useAio_) {
+    std::unique_lock<std::mutex> lock(aioMutex_, std::try_to_lock);
+    if (lock.owns_lock() && useAio_) {
+      readAio(extents);
+      return;
+    }
+  }
+  readThreaded(extents);
+}
+
+bool AsyncFileReader::usesAio() const {
+  return useAio_;
+}
+
+std::vector<AsyncFileReader::Extent> AsyncFileReader::coalesce(
+    const std::vector<FileReadRequest>& requests) const {
+  std::vector<FileReadRequest> sorted;
+  sorted.reserve(requests.size());
+  for (const auto& r : requests) {
+    if (r.size < 0 || r.offset < 0) {
+      throw std::invalid_argument("AsyncFileReader: invalid read request");
+    }
+    if (r.size > 0) {
+      sorted.push_back(r);
+    }
+  }
+  std::sort(
+      sorted.begin(),
+      sorted.end(),
+      [](const FileReadRequest& a, const FileReadRequest& b) {
+        return a.offset < b.offset;
+      });
+
+  std::vector<Extent> extents;
+  for (const auto& r : sorted) {
+    if (!extents.empty()) {
+      auto& last = extents.back();
+      int64_t end = last.offset + last.size;
+      int64_t newEnd = std::max(end, r.offset + r.size);
+      if (r.offset <= end + maxGap_ && newEnd - last.offset <= maxReadSize_) {
+        last.size = newEnd - last.offset;
+        last.requests.push_back(r);
+        continue;
+      }
+    }
+    Extent extent;
+    extent.offset = r.offset;
+    extent.size = r.size;
+    extent.requests.push_back(r);
+    extents.push_back(std::move(extent));
+  }
+  return extents;
+}
+
+void AsyncFileReader::readFully(int64_t offset, int64_t size, char* data)
+    const {
+  while (size > 0) {
+    auto res = pread(fd_, data, size, offset);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(
+          "AsyncFileReader: read failed on " + name_ + ": " +
+          std::strerror(errno));
+    }
+    if (res == 0) {
+      throw std::runtime_error(
+          "AsyncFileReader: unexpected end of file " + name_);
+    }
+    offset += res;
+    size -= res;
+    data += res;
+  }
+}
+
+void AsyncFileReader::readExtent(Extent& extent) const {
+  readFully(extent.offset, extent.size, extent.target());
+  extent.scatter();
+}
+
+void AsyncFileReader::readAio(std::vector<Extent>& extents) const {
+#ifdef __linux__
+  const int64_t queueDepth =
+      std::min<int64_t>(extents.size(), kMaxAioQueueDepth);
+  aio_context_t ctx = aioContext_;
+
+  std::vector<struct iocb> cbs(queueDepth);
+  std::vector<struct iocb*> cbPtrs(queueDepth);
+  std::vector<struct io_event> events(queueDepth);
+  // O_DIRECT reads have aligned offsets and sizes, and go to aligned buffers
+  std::vector<AlignedBuffer> buffers(queueDepth);
+  std::string error;
+  const int64_t nExtents = extents.size();
+  for (int64_t start = 0; start < nExtents && error.empty();
+       start += queueDepth) {
+    int64_t n = std::min(queueDepth, nExtents - start);
+    for (int64_t i = 0; i < n; ++i) {
+      const auto& extent = extents[start + i];
+      int64_t begin = alignDown(extent.offset);
+      int64_t size = alignUp(extent.offset + extent.size) - begin;
+      buffers[i].reserve(size);
+      std::memset(&cbs[i], 0, sizeof(struct iocb));
+      cbs[i].aio_fildes = directFd_;
+      cbs[i].aio_lio_opcode = IOCB_CMD_PREAD;
+      cbs[i].aio_buf = reinterpret_cast<uint64_t>(buffers[i].data());
+      cbs[i].aio_nbytes = size;
+      cbs[i].aio_offset = begin;
+      cbs[i].aio_data = i;
+      cbPtrs[i] = &cbs[i];
+    }
+
+    // Submit the whole window; whatever the kernel refuses is read
+    // synchronously.
+    int64_t submitted = 0;
+    while (submitted < n) {
+      auto res = ioSubmit(ctx, n - submitted, cbPtrs.data() + submitted);
+      if (res <= 0) {
+        break;
+      }
+      submitted += res;
+    }
+    for (int64_t i = submitted; i < n; ++i) {
+      try {
+        readExtent(extents[start + i]);
+      } catch (const std::exception& ex) {
+        error = ex.what();
+      }
+    }
+
+    int64_t completed = 0;
+    while (completed < submitted) {
+      auto res = ioGetEvents(
+          ctx, submitted - completed, submitted - completed, events.data());
+      if (res < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // Destroying the context waits for the reads in flight, which still
+        // target the buffers
+        ioDestroy(ctx);
+        useAio_ = false;
+        throw std::runtime_error(
+            "AsyncFileReader: io_getevents failed on " + name_);
+      }
+      for (int64_t e = 0; e < res; ++e) {
+        int64_t i = events[e].data;
+        auto& extent = extents[start + i];
+        int64_t nRead = events[e].res;
+        try {
+          if (nRead < 0) {
+            throw std::runtime_error(
+                "AsyncFileReader: read failed on " + name_ + ": " +
+                std::strerror(-nRead));
+          }
+          int64_t skip = extent.offset - alignDown(extent.offset);
+          int64_t available =
+              std::max<int64_t>(0, std::min(nRead - skip, extent.size));
+          char* target = extent.target();
+          std::memcpy(target, buffers[i].data() + skip, available);
+          // Short reads are completed synchronously
+          if (available < extent.size) {
+            readFully(
+                extent.offset + available,
+                extent.size - available,
+                target + available);
+          }
+          extent.scatter();
+        } catch (const std::exception& ex) {
+          error = ex.what();
+        }
+      }
+      completed += res;
+    }
+  }
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+#else
+  readThreaded(extents);
+#endif
+}
+
+void AsyncFileReader::readThreaded(std::vector<Extent>& extents) const {
+  if (numThreads_ <= 1) {
+    for (auto& extent : extents) {
+      readExtent(extent);
+    }
+    return;
+  }
+  // Also used by concurrent batches when AIO is used
+  std::call_once(threadPoolInit_, [this]() {
+    threadPool_ = getThreadPool(numThreads_);
+  });
+  threadPool_->parallelFor(0, extents.size(), [this, &extents](int64_t i) {
+    readExtent(extents[i]);
+  });
+}
+
+AsyncFileReader::~AsyncFileReader() {
+#ifdef __linux__
+  if (useAio_) {
+    ioDestroy(aioContext_);
+  }
+#endif
+  if (directFd_ != -1) {
+    close(directFd_);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+} // namespace fl
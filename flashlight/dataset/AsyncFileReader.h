@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "flashlight/flashlight/common/threadpool/WorkStealingThreadPool.h"
+
+namespace fl {
+
+/**
+ * A read request on a file: `size` bytes at `offset` go to `data`.
+ */
+struct FileReadRequest {
+  int64_t offset;
+  int64_t size;
+  char* data;
+};
+
+/**
+ * Reads batches of (possibly many small) extents of a file.
+ *
+ * Requests of a batch are sorted by offset, and requests which are adjacent
+ * or separated by at most `maxGap` bytes are coalesced into a single read.
+ * The resulting reads are issued with `pread` from a thread pool, so that the
+ * storage queue is kept deep. The pool is shared by all the readers with the
+ * same number of threads, and is only started by the first batch which needs
+ * it. Batches which coalesce into a single read, such as a sample whose
+ * fields are stored contiguously, are read inline on the calling thread.
+ *
+ * Optionally, reads can instead be all submitted at once using Linux native
+ * AIO on a descriptor opened with `O_DIRECT` (native AIO only runs
+ * asynchronously without the page cache). They then bypass the page cache,
+ * which is only worth it for datasets much larger than memory, read once per
+ * epoch. A single AIO context is used at a time; concurrent batches use the
+ * thread pool.
+ *
+ * Reads go through positioned I/O on a single descriptor: the reader is
+ * thread-safe and does not need any per-thread file handle.
+ */
+class AsyncFileReader {
+ public:
+  /**
+   * Creates an `AsyncFileReader`.
+   * @param[in] name A file name.
+   * @param[in] maxGap Requests separated by at most this number of bytes are
+   * coalesced into a single read.
+   * @param[in] maxReadSize Coalesced reads are not grown beyond this size (in
+   * bytes).
+   * @param[in] numThreads Number of threads issuing reads. The threads are
+   * shared with the other readers using as many threads.
+   * @param[in] useAio If true, use Linux native AIO with `O_DIRECT` when
+   * available.
+   */
+  explicit AsyncFileReader(
+      const std::string& name,
+      int64_t maxGap = 65536,
+      int64_t maxReadSize = 16777216,
+      int64_t numThreads = 4,
+      bool useAio = false);
+
+  /**
+   * Read all requests, and block until they are completed.
+   * @param[in] requests Requests to be served. Overlapping requests are
+   * allowed.
+   */
+  void read(const std::vector<FileReadRequest>& requests) const;
+
+  /**
+   * Return true iff Linux native AIO is used to submit reads.
+   */
+  bool usesAio() const;
+
+  ~AsyncFileReader();
+
+ private:
+  struct Extent {
+    int64_t offset;
+    int64_t size;
+    std::vector<FileReadRequest> requests;
+    // Only used when the extent does not map to a single request
+    std::vector<char> scratch;
+
+    char* target();
+    void scatter() const;
+  };
+
+  std::vector<Extent> coalesce(
+      const std::vector<FileReadRequest>& requests) const;
+  void readExtent(Extent& extent) const;
+  void readAio(std::vector<Extent>& extents) const;
+  void readThreaded(std::vector<Extent>& extents) const;
+  void readFully(int64_t offset, int64_t size, char* data) const;
+
+  std::string name_;
+  int fd_;
+  // Descriptor opened with O_DIRECT, for AIO
+  int directFd_;
+  int64_t maxGap_;
+  int64_t maxReadSize_;
+  mutable std::atomic<bool> useAio_;
+  // aio_context_t, valid if useAio_
+  unsigned long aioContext_;
+  mutable std::mutex aioMutex_;
+  int64_t numThreads_;
+  // Shared with other readers, obtained on the first threaded read
+  mutable std::shared_ptr<WorkStealingThreadPool> threadPool_;
+  mutable std::once_flag threadPoolInit_;
+};
+
+} // namespace fl
@@ -61,20 +61,90 @@ int64_t BlobDataset::size() const {
 }
 
 std::vector<af::array> BlobDataset::get(const int64_t idx) const {
-  std::vector<af::array> sample;
-  for (int64_t i = 0; i < sizes_.at(idx); i++) {
-    auto entry = entries_.get(offsets_.at(idx) + i);
-    sample.push_back(readArray(entry, i));
-  }
-  return sample;
+  return getBatch({idx}).front();
 };
 
+std::vector<std::vector<af::array>> BlobDataset::getBatch(
+    const std::vector<int64_t>& indices) const {
+  // Arrays which cannot be created straight from the blob memory are read
+  // in a single host buffer, with one batched read. Host transforms may
+  // modify their input, so fields with a transform always go through the
+  // buffer.
+  std::vector<std::vector<BlobDatasetEntry>> entries;
+  std::vector<std::vector<const void*>> directPtrs;
+  std::vector<std::vector<int64_t>> bufferOffsets;
+  int64_t bufferSize = 0;
+  for (auto idx : indices) {
+    entries.push_back(getEntries(idx));
+    directPtrs.emplace_back();
+    bufferOffsets.emplace_back();
+    for (int i = 0; i < entries.back().size(); i++) {
+      const auto& e = entries.back()[i];
+      int64_t bytes = af::getSizeOf(e.type) * e.dims.elements();
+      const void* ptr = nullptr;
+      if (bytes > 0 && hostTransforms_.find(i) == hostTransforms_.end()) {
+        ptr = dataPtr(e.offset, bytes);
+      }
+      directPtrs.back().push_back(ptr);
+      bufferOffsets.back().push_back(bufferSize);
+      if (!ptr) {
+        bufferSize += bytes;
+      }
+    }
+  }
+
+  std::vector<uint8_t> buffer(bufferSize);
+  std::vector<BlobDataRequest> requests;
+  for (int64_t s = 0; s < entries.size(); s++) {
+    for (int64_t i = 0; i < entries[s].size(); i++) {
+      const auto& e = entries[s][i];
+      int64_t bytes = af::getSizeOf(e.type) * e.dims.elements();
+      if (!directPtrs[s][i] && bytes > 0) {
+        requests.push_back(
+            {e.offset, bytes, (char*)buffer.data() + bufferOffsets[s][i]});
+      }
+    }
+  }
+  readDataBatch(requests);
+
+  std::vector<std::vector<af::array>> batch(entries.size());
+  for (int64_t s = 0; s < entries.size(); s++) {
+    for (int i = 0; i < entries[s].size(); i++) {
+      const auto& e = entries[s][i];
+      if (e.dims.elements() == 0) {
+        batch[s].push_back(af::array());
+        continue;
+      }
+      if (directPtrs[s][i]) {
+        batch[s].push_back(createArray(e, directPtrs[s][i]));
+        continue;
+      }
+      void* ptr = buffer.data() + bufferOffsets[s][i];
+      auto keyval = hostTransforms_.find(i);
+      if (keyval == hostTransforms_.end()) {
+        batch[s].push_back(createArray(e, ptr));
+      } else {
+        batch[s].push_back(keyval->second(ptr, e.dims, e.type));
+      }
+    }
+  }
+  return batch;
+}
+
 std::vector<std::vector<uint8_t>> BlobDataset::rawGet(const int64_t idx) const {
   std::vector<std::vector<uint8_t>> sample;
-  for (int64_t i = 0; i < sizes_.at(idx); i++) {
-    auto entry = entries_.get(offsets_.at(idx) + i);
-    sample.push_back(readRawArray(entry));
+  std::vector<BlobDataRequest> requests;
+  auto entries = getEntries(idx);
+  sample.resize(entries.size());
+  for (int64_t i = 0; i < entries.size(); i++) {
+    const auto& e = entries[i];
+    if (e.dims.elements() > 0) {
+      sample[i].resize(af::getSizeOf(e.type) * e.dims.elements());
+      requests.push_back(
+          {e.offset, (int64_t)sample[i].size(), (char*)sample[i].data()});
+    }
   }
+  readDataBatch(requests);
   return sample;
 };
 
@@ -150,24 +220,21 @@ std::vector<uint8_t> BlobDataset::readRawArray(
   return buffer;
 }
 
-af::array BlobDataset::readArray(const BlobDatasetEntry& e, int i) const {
-  if (e.dims.elements() > 0) {
-    auto buffer = readRawArray(e);
-    auto keyval = hostTransforms_.find(i);
-    if (keyval == hostTransforms_.end()) {
-      af_array c_array;
-      af_err status = af_create_array(
-          &c_array, buffer.data(), e.dims.ndims(), e.dims.get(), e.type);
-      if (status != AF_SUCCESS) {
-        throw af::exception(
-            "unable to create array", __FILE__, __LINE__, status);
-      }
-      return af::array(c_array);
-    } else {
-      return keyval->second(buffer.data(), e.dims, e.type);
-    }
-  } else {
-    return af::array();
+af::array BlobDataset::createArray(const BlobDatasetEntry& e, const void* ptr)
+    const {
+  af_array c_array;
+  af_err status =
+      af_create_array(&c_array, ptr, e.dims.ndims(), e.dims.get(), e.type);
+  if (status != AF_SUCCESS) {
+    throw af::exception("unable to create array", __FILE__, __LINE__, status);
+  }
+  return af::array(c_array);
+}
+
+void BlobDataset::readDataBatch(
+    const std::vector<BlobDataRequest>& requests) const {
+  for (const auto& r : requests) {
+    readData(r.offset, r.data, r.size);
   }
 }
 
@@ -230,6 +297,11 @@ void BlobDataset::readIndex() {
   readData(offset, entries_.data(), entries_.bytes());
 }
 
+const char* BlobDataset::dataPtr(int64_t /* offset */, int64_t /* size */)
+    const {
+  return nullptr;
+}
+
 void BlobDataset::flush() {
   flushData();
 }
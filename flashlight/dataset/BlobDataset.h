@@ -61,6 +61,16 @@ struct BlobDatasetEntry {
   int64_t offset;
 };
 
+/**
+ * A raw data read request in a blob: `size` bytes at `offset` are read in
+ * `data`.
+ */
+struct BlobDataRequest {
+  int64_t offset;
+  int64_t size;
+  char* data;
+};
+
 class BlobDatasetEntryBuffer {
  private:
   std::vector<int64_t> data_;
@@ -87,7 +97,7 @@ class BlobDataset : public Dataset {
   mutable std::mutex mutex_;
 
   std::vector<uint8_t> readRawArray(const BlobDatasetEntry& e) const;
-  af::array readArray(const BlobDatasetEntry& e, int i) const;
+  af::array createArray(const BlobDatasetEntry& e, const void* ptr) const;
   void writeArray(const BlobDatasetEntry& e, const af::array& array);
 
  protected:
@@ -108,6 +118,14 @@ class BlobDataset : public Dataset {
    * @param[in] size Raw data size in bytes.
    */
   virtual int64_t readData(int64_t offset, char* data, int64_t size) const = 0;
+  /* Read a batch of raw data in the blob. Requests may come in any order.
+   * The default implementation calls readData() for each request;
+   * implementations may override it to coalesce and overlap reads.
+   * Implementation must be thread-safe.
+   * @param[in] requests Read requests.
+   */
+  virtual void readDataBatch(const std::vector<BlobDataRequest>& requests)
+      const;
   /* Make sure all written data is flushed in the blob.
    * Implementation must be thread-safe.
    */
@@ -116,6 +134,15 @@ class BlobDataset : public Dataset {
    * Implementation must be thread-safe.
    */
   virtual bool isEmptyData() const = 0;
+  /* Return a pointer to raw data in the blob, if the implementation can
+   * access it directly (e.g. memory-mapped blobs), or nullptr otherwise.
+   * When available, arrays are created straight from this memory, without
+   * any intermediate host buffer.
+   * Implementation must be thread-safe.
+   * @param[in] offset Offset in the blob in bytes.
+   * @param[in] size Raw data size in bytes.
+   */
+  virtual const char* dataPtr(int64_t offset, int64_t size) const;
 
  public:
   /**
@@ -133,6 +160,15 @@ class BlobDataset : public Dataset {
 
   std::vector<af::array> get(const int64_t idx) const override;
 
+  /**
+   * Return a batch of samples. All the arrays of the batch are read at once,
+   * which allows implementations to coalesce and overlap reads: this is more
+   * efficient than calling get() for each sample.
+   * @param[in] indices Indices in the dataset.
+   */
+  std::vector<std::vector<af::array>> getBatch(
+      const std::vector<int64_t>& indices) const;
+
   /**
    * Return raw data stored in given sample. Dimensions and types of each array
    * can be retrieved with getEntries().
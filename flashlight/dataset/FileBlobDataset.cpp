@@ -7,6 +7,8 @@
 
 #include "flashlight/flashlight/dataset/FileBlobDataset.h"
 
+#include "flashlight/flashlight/common/CppBackports.h"
+
 namespace fl {
 
 FileBlobDataset::FileBlobDataset(
@@ -21,6 +23,7 @@ FileBlobDataset::FileBlobDataset(
       throw std::runtime_error("could not open file " + name);
     }
   }
+  reader_ = cpp::make_unique<AsyncFileReader>(name_);
   readIndex();
 }
 
@@ -83,6 +86,21 @@ int64_t FileBlobDataset::readData(int64_t offset, char* data, int64_t size)
   return fs->tellg() - offset;
 }
 
+void FileBlobDataset::readDataBatch(
+    const std::vector<BlobDataRequest>& requests) const {
+  // The reader has its own file descriptor: samples added by this thread may
+  // still be in the buffer of its stream
+  if (mode_ & std::ios_base::out) {
+    getStream()->flush();
+  }
+  std::vector<FileReadRequest> fileRequests;
+  fileRequests.reserve(requests.size());
+  for (const auto& r : requests) {
+    fileRequests.push_back({r.offset, r.size, r.data});
+  }
+  reader_->read(fileRequests);
+}
+
 void FileBlobDataset::flushData() {
   auto fs = getStream();
   fs->flush();
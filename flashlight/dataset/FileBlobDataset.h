@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "flashlight/flashlight/dataset/AsyncFileReader.h"
 #include "flashlight/flashlight/dataset/BlobDataset.h"
 
 #include <fstream>
@@ -18,7 +19,8 @@ namespace fl {
  * A BlobDataset on file.
  *
  * As the arrays are stored on disk, sequential access will be the most
- * efficient.
+ * efficient. Reads of a sample (or of a batch, with getBatch()) are
+ * coalesced and submitted at once through an `AsyncFileReader`.
  *
  */
 class FileBlobDataset : public BlobDataset {
@@ -43,6 +45,8 @@ class FileBlobDataset : public BlobDataset {
   int64_t writeData(int64_t offset, const char* data, int64_t size)
       const override;
   int64_t readData(int64_t offset, char* data, int64_t size) const override;
+  void readDataBatch(
+      const std::vector<BlobDataRequest>& requests) const override;
   void flushData() override;
   bool isEmptyData() const override;
 
@@ -50,6 +54,7 @@ class FileBlobDataset : public BlobDataset {
   std::string name_;
   std::ios_base::openmode mode_;
   std::shared_ptr<std::fstream> getStream() const;
+  std::unique_ptr<AsyncFileReader> reader_;
 
   mutable std::vector<std::weak_ptr<
       std::unordered_map<uintptr_t, std::shared_ptr<std::fstream>>>>
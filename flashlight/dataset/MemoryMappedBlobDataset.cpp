@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/dataset/MemoryMappedBlobDataset.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace fl {
+
+MemoryMappedBlobDataset::MemoryMappedBlobDataset(const std::string& name)
+    : name_(name), data_(nullptr), size_(0) {
+  int fd = open(name_.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("could not open file " + name_);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("could not stat file " + name_);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("could not mmap file " + name_);
+    }
+    data_ = static_cast<char*>(ptr);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  // The destructor does not run if the constructor throws, e.g. on a
+  // truncated file
+  try {
+    readIndex();
+  } catch (...) {
+    if (data_) {
+      munmap(data_, size_);
+    }
+    throw;
+  }
+}
+
+std::vector<BlobDatasetView> MemoryMappedBlobDataset::rawGetView(
+    const int64_t idx) const {
+  std::vector<BlobDatasetView> sample;
+  for (const auto& e : getEntries(idx)) {
+    BlobDatasetView view;
+    view.entry = e;
+    view.bytes = af::getSizeOf(e.type) * e.dims.elements();
+    view.data = (view.bytes > 0)
+        ? reinterpret_cast<const uint8_t*>(dataPtr(e.offset, view.bytes))
+        : nullptr;
+    sample.push_back(view);
+  }
+  return sample;
+}
+
+int64_t MemoryMappedBlobDataset::writeData(
+    int64_t /* offset */,
+    const char* /* data */,
+    int64_t /* size */) const {
+  throw std::runtime_error(
+      "MemoryMappedBlobDataset is read-only: cannot write to " + name_);
+}
+
+int64_t MemoryMappedBlobDataset::readData(
+    int64_t offset,
+    char* data,
+    int64_t size) const {
+  std::memcpy(data, dataPtr(offset, size), size);
+  return size;
+}
+
+void MemoryMappedBlobDataset::flushData() {}
+
+bool MemoryMappedBlobDataset::isEmptyData() const {
+  return size_ == 0;
+}
+
+const char* MemoryMappedBlobDataset::dataPtr(int64_t offset, int64_t size)
+    const {
+  if (offset < 0 || size < 0 || offset + size > size_) {
+    throw std::out_of_range(
+        "MemoryMappedBlobDataset: read out of bounds in " + name_);
+  }
+  return data_ + offset;
+}
+
+MemoryMappedBlobDataset::~MemoryMappedBlobDataset() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+} // namespace fl
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "flashlight/flashlight/dataset/BlobDataset.h"
+
+#include <string>
+#include <vector>
+
+namespace fl {
+
+/**
+ * A read-only view on the raw data of an array stored in a
+ * `MemoryMappedBlobDataset`. The view remains valid as long as the dataset
+ * is alive.
+ */
+struct BlobDatasetView {
+  BlobDatasetEntry entry;
+  const uint8_t* data;
+  int64_t bytes;
+};
+
+/**
+ * A read-only BlobDataset on a memory-mapped file.
+ *
+ * The whole blob is mapped once at construction. Arrays are created directly
+ * from the mapped pages, with no intermediate host buffer and no per-thread
+ * file handle, and raw data can be accessed without any copy with
+ * rawGetView(). Fields with a host transform still go through a private
+ * copy, as the transform is allowed to modify its input.
+ *
+ * The blob must have been written (e.g. with a `FileBlobDataset`) and its
+ * index stored with writeIndex() before being opened.
+ */
+class MemoryMappedBlobDataset : public BlobDataset {
+ public:
+  /**
+   * Creates a `MemoryMappedBlobDataset`, specifying a blob file name.
+   * @param[in] name A blob file name.
+   */
+  explicit MemoryMappedBlobDataset(const std::string& name);
+
+  // The dataset owns the mapping, which is unmapped at destruction
+  MemoryMappedBlobDataset(const MemoryMappedBlobDataset&) = delete;
+  MemoryMappedBlobDataset& operator=(const MemoryMappedBlobDataset&) = delete;
+
+  /**
+   * Return views on the raw data stored in given sample, without copy.
+   * @param[in] idx An index in the dataset.
+   */
+  std::vector<BlobDatasetView> rawGetView(const int64_t idx) const;
+
+  virtual ~MemoryMappedBlobDataset() override;
+
+ protected:
+  int64_t writeData(int64_t offset, const char* data, int64_t size)
+      const override;
+  int64_t readData(int64_t offset, char* data, int64_t size) const override;
+  void flushData() override;
+  bool isEmptyData() const override;
+  const char* dataPtr(int64_t offset, int64_t size) const override;
+
+ private:
+  std::string name_;
+  char* data_;
+  int64_t size_;
+};
+
+} // namespace fl
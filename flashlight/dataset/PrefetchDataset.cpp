@@ -16,11 +16,20 @@ namespace fl {
 PrefetchDataset::PrefetchDataset(
     std::shared_ptr<const Dataset> dataset,
     int64_t numThreads,
-    int64_t prefetchSize)
+    int64_t prefetchSize,
+    int64_t maxPrefetchBytes /* = 0 */,
+    bool outOfOrder /* = false */)
     : dataset_(dataset),
       numThreads_(numThreads),
       prefetchSize_(prefetchSize),
-      curIdx_(-1) {
+      maxPrefetchBytes_(maxPrefetchBytes),
+      outOfOrder_(outOfOrder),
+      cancelledCount_(0),
+      readyBytes_(0),
+      fetchedBytes_(0),
+      fetchedCount_(0),
+      nextIdx_(-1),
+      submitIdx_(0) {
   if (!dataset_) {
     throw std::invalid_argument("dataset to be prefetched is null");
   }
@@ -28,9 +37,12 @@ PrefetchDataset::PrefetchDataset(
       !(numThreads_ == 0 && prefetchSize_ == 0)) {
     throw std::invalid_argument("invalid numThreads or prefetchSize");
   }
+  if (maxPrefetchBytes_ < 0) {
+    throw std::invalid_argument("invalid maxPrefetchBytes");
+  }
   if (numThreads_ > 0) {
     auto deviceId = af::getDevice();
-    threadPool_ = cpp::make_unique<ThreadPool>(
+    threadPool_ = cpp::make_unique<WorkStealingThreadPool>(
         numThreads_,
         [deviceId](int /* threadId */) { af::setDevice(deviceId); });
   }
@@ -43,30 +55,167 @@ std::vector<af::array> PrefetchDataset::get(int64_t idx) const {
     return dataset_->get(idx);
   }
 
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool sequential = (idx == nextIdx_);
+  nextIdx_ = idx + 1;
+
+  if (outOfOrder_) {
+    // The window holds the next samples to be returned, whatever their
+    // index: on a non-sequential access, start over from idx.
+    if (!sequential) {
+      evictOutside(0, 0);
+      submitIdx_ = idx;
+    }
+    auto topUp = [this]() {
+      while (submitIdx_ < size() &&
+             ((ready_.empty() && inFlight_.empty()) || canPrefetch())) {
+        prefetch(submitIdx_++);
+      }
+    };
+    topUp();
+    if (ready_.empty() && inFlight_.empty()) {
+      // More samples requested than available in this pass
+      ++stats_.misses;
+      prefetch(idx);
+    } else if (ready_.empty()) {
+      ++stats_.stalls;
+    } else {
+      ++stats_.hits;
+    }
+    completed_.wait(lock, [this]() { return !ready_.empty(); });
+    auto sample = take(ready_.begin());
+    topUp();
+    return sample;
+  }
+
   // remove from cache (if necessary)
-  while (!prefetchCache_.empty() && idx != curIdx_) {
-    prefetchCache_.pop();
-    ++curIdx_;
+  int64_t windowEnd = std::min(idx + prefetchSize_, size());
+  evictOutside(idx, windowEnd);
+
+  if (ready_.find(idx) != ready_.end()) {
+    ++stats_.hits;
+  } else if (inFlight_.find(idx) != inFlight_.end()) {
+    ++stats_.stalls;
+  } else {
+    ++stats_.misses;
+    prefetch(idx);
   }
 
   // add to cache (if necessary)
-  while (prefetchCache_.size() < prefetchSize_) {
-    auto fetchIdx = idx + prefetchCache_.size();
-    if (fetchIdx >= size()) {
+  for (int64_t fetchIdx = idx + 1; fetchIdx < windowEnd; ++fetchIdx) {
+    if (ready_.find(fetchIdx) != ready_.end() ||
+        inFlight_.find(fetchIdx) != inFlight_.end()) {
+      continue;
+    }
+    if (!canPrefetch()) {
       break;
     }
-    prefetchCache_.emplace(threadPool_->enqueue(
-        [this, fetchIdx]() { return this->dataset_->get(fetchIdx); }));
+    prefetch(fetchIdx);
   }
 
-  auto curSample = prefetchCache_.front().get();
+  completed_.wait(
+      lock, [this, idx]() { return ready_.find(idx) != ready_.end(); });
+  return take(ready_.find(idx));
+}
+
+bool PrefetchDataset::canPrefetch() const {
+  int64_t running = inFlight_.size() + cancelledCount_;
+  if (ready_.size() + running >= prefetchSize_) {
+    return false;
+  }
+  if (maxPrefetchBytes_ == 0 || fetchedCount_ == 0) {
+    return true;
+  }
+  // Samples in flight are assumed to have the average size of the samples
+  // fetched so far
+  int64_t avgBytes = fetchedBytes_ / fetchedCount_;
+  return readyBytes_ + (running + 1) * avgBytes <= maxPrefetchBytes_;
+}
 
-  prefetchCache_.pop();
-  curIdx_ = idx + 1;
-  return curSample;
+void PrefetchDataset::prefetch(int64_t idx) const {
+  auto cancelled = std::make_shared<bool>(false);
+  inFlight_[idx] = cancelled;
+  threadPool_->execute([this, idx, cancelled]() {
+    {
+      // Samples evicted before their task starts are not fetched
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (*cancelled) {
+        --cancelledCount_;
+        return;
+      }
+    }
+    Result result;
+    result.bytes = 0;
+    try {
+      result.sample = dataset_->get(idx);
+      for (const auto& array : result.sample) {
+        result.bytes += array.bytes();
+      }
+    } catch (...) {
+      result.error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    fetchedBytes_ += result.bytes;
+    ++fetchedCount_;
+    // Results of samples evicted while in flight are dropped
+    if (*cancelled) {
+      --cancelledCount_;
+    } else {
+      inFlight_.erase(idx);
+      readyBytes_ += result.bytes;
+      ready_[idx] = std::move(result);
+    }
+    completed_.notify_all();
+  });
+}
+
+void PrefetchDataset::evictOutside(int64_t begin, int64_t end) const {
+  for (auto it = ready_.begin(); it != ready_.end();) {
+    if (it->first < begin || it->first >= end) {
+      readyBytes_ -= it->second.bytes;
+      it = ready_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = inFlight_.begin(); it != inFlight_.end();) {
+    if (it->first < begin || it->first >= end) {
+      *it->second = true;
+      ++cancelledCount_;
+      it = inFlight_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::vector<af::array> PrefetchDataset::take(
+    std::map<int64_t, Result>::iterator it) const {
+  Result result = std::move(it->second);
+  readyBytes_ -= result.bytes;
+  ready_.erase(it);
+  if (result.error) {
+    std::rethrow_exception(result.error);
+  }
+  return result.sample;
 }
 
 int64_t PrefetchDataset::size() const {
   return dataset_->size();
 }
+
+PrefetchDatasetStats PrefetchDataset::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void PrefetchDataset::resetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_ = PrefetchDatasetStats();
+}
+
+PrefetchDataset::~PrefetchDataset() {
+  // Wait for pending tasks before the state they update is destroyed
+  threadPool_.reset();
+}
 } // namespace fl
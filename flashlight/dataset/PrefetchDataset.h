@@ -7,20 +7,49 @@
 
 #pragma once
 
-#include <future>
-#include <queue>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "flashlight/flashlight/dataset/Dataset.h"
 
-#include "flashlight/flashlight/common/threadpool/ThreadPool.h"
+#include "flashlight/flashlight/common/threadpool/WorkStealingThreadPool.h"
 
 namespace fl {
 
+/**
+ * Counters reported by a `PrefetchDataset`.
+ */
+struct PrefetchDatasetStats {
+  // Requested sample was already available
+  int64_t hits = 0;
+  // Requested sample was not prefetched, and had to be fetched on demand
+  int64_t misses = 0;
+  // Requested sample was prefetched, but not available yet
+  int64_t stalls = 0;
+};
+
 /**
  * A view into a dataset, where a given number of samples are prefetched in
- * advance in a ThreadPool. PrefetchDataset should be used when there is a
- * sequential access to the underlying dataset. Otherwise, there will a lot of
- * cache misses leading to a degraded performance.
+ * advance in a WorkStealingThreadPool. PrefetchDataset should be used when
+ * there is a sequential access to the underlying dataset. Otherwise, there
+ * will a lot of cache misses leading to a degraded performance.
+ *
+ * Prefetched samples are kept in a window keyed by index: on a
+ * non-sequential access, only the samples outside of the new window are
+ * dropped. The window can be bounded in bytes (in addition to the number of
+ * samples), in which case the size of samples still in flight is estimated
+ * from the average size of the samples fetched so far.
+ *
+ * If out-of-order mode is enabled, sequential calls to get() return
+ * prefetched samples as soon as they are completed, instead of waiting for
+ * the sample with the requested index: a slow sample does not stall the
+ * consumer. Every sample is still returned exactly once when iterating
+ * over the whole dataset, which makes this mode suitable e.g. for training
+ * on a shuffled dataset.
  *
  * Example:
   \code{.cpp}
@@ -43,25 +72,73 @@ class PrefetchDataset : public Dataset {
    * @param[in] dataset The underlying dataset.
    * @param[in] numThreads Number of threads used by the threadpool
    * @param[in] prefetchSize Number of samples to be prefetched
+   * @param[in] maxPrefetchBytes Maximum number of bytes held by prefetched
+   * samples (0 for no limit). At least one sample is always prefetched.
+   * @param[in] outOfOrder If true, sequential calls to get() return samples
+   * in completion order.
    */
   explicit PrefetchDataset(
       std::shared_ptr<const Dataset> dataset,
       int64_t numThreads,
-      int64_t prefetchSize);
+      int64_t prefetchSize,
+      int64_t maxPrefetchBytes = 0,
+      bool outOfOrder = false);
 
   int64_t size() const override;
 
   std::vector<af::array> get(const int64_t idx) const override;
 
+  /**
+   * @return Hit, miss and stall counters since construction or the last
+   * call to resetStats().
+   */
+  PrefetchDatasetStats getStats() const;
+
+  /**
+   * Reset hit, miss and stall counters.
+   */
+  void resetStats();
+
+  ~PrefetchDataset() override;
+
  protected:
   std::shared_ptr<const Dataset> dataset_;
   int64_t numThreads_, prefetchSize_;
+  int64_t maxPrefetchBytes_;
+  bool outOfOrder_;
 
  private:
-  std::unique_ptr<ThreadPool> threadPool_;
-  // state variables
-  mutable std::queue<std::future<std::vector<af::array>>> prefetchCache_;
-  mutable int64_t curIdx_;
+  struct Result {
+    std::vector<af::array> sample;
+    std::exception_ptr error;
+    int64_t bytes;
+  };
+
+  // Must be called with mutex_ held
+  bool canPrefetch() const;
+  void prefetch(int64_t idx) const;
+  void evictOutside(int64_t begin, int64_t end) const;
+  std::vector<af::array> take(std::map<int64_t, Result>::iterator it) const;
+
+  // state variables, shared with the threadpool
+  mutable std::mutex mutex_;
+  mutable std::condition_variable completed_;
+  mutable std::map<int64_t, Result> ready_;
+  // In-flight samples, with a flag set when they are evicted
+  mutable std::unordered_map<int64_t, std::shared_ptr<bool>> inFlight_;
+  // Evicted samples whose task is still running. They count towards the
+  // limits until they finish, as they hold a thread and memory.
+  mutable int64_t cancelledCount_;
+  mutable int64_t readyBytes_;
+  mutable int64_t fetchedBytes_;
+  mutable int64_t fetchedCount_;
+  mutable int64_t nextIdx_;
+  // Next index to be prefetched, in out-of-order mode
+  mutable int64_t submitIdx_;
+  mutable PrefetchDatasetStats stats_;
+
+  // Declared last, so workers are joined before the state is destroyed
+  std::unique_ptr<WorkStealingThreadPool> threadPool_;
 };
 
 } // namespace fl
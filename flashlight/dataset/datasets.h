@@ -13,6 +13,7 @@
 #include "flashlight/flashlight/dataset/Dataset.h"
 #include "flashlight/flashlight/dataset/DatasetIterator.h"
 #include "flashlight/flashlight/dataset/FileBlobDataset.h"
+#include "flashlight/flashlight/dataset/MemoryMappedBlobDataset.h"
 #include "flashlight/flashlight/dataset/MergeDataset.h"
 #include "flashlight/flashlight/dataset/PrefetchDataset.h"
 #include "flashlight/flashlight/dataset/ResampleDataset.h"
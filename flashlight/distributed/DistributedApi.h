@@ -123,6 +123,10 @@ void allReduceMultiple(
  * Note that if asynchronous allReduce is not used, this operation will be a
  * no-op, since no operations will be enqueued on the distributed compute
  * stream.
+ *
+ * With the Gloo backend, asynchronous reductions run on a background thread;
+ * this waits for them to complete. Arrays passed to an asynchronous allReduce
+ * must not be used until then.
  */
 void syncDistributed();
 
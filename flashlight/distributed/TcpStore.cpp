@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/distributed/TcpStore.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+enum Command : uint8_t { kSet = 0, kGet = 1 };
+
+void sendAll(int fd, const void* buf, size_t len) {
+  auto* ptr = static_cast<const char*>(buf);
+  while (len > 0) {
+    ssize_t n = ::send(fd, ptr, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(
+          std::string("TcpStore: send failed: ") + std::strerror(errno));
+    }
+    ptr += n;
+    len -= n;
+  }
+}
+
+// Returns false if the connection was closed before any byte was read
+bool recvAll(int fd, void* buf, size_t len) {
+  auto* ptr = static_cast<char*>(buf);
+  size_t read = 0;
+  while (read < len) {
+    ssize_t n = ::recv(fd, ptr + read, len - read, 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(
+          std::string("TcpStore: recv failed: ") + std::strerror(errno));
+    }
+    if (n == 0) {
+      if (read == 0) {
+        return false;
+      }
+      throw std::runtime_error("TcpStore: connection closed mid-message");
+    }
+    read += n;
+  }
+  return true;
+}
+
+void sendBytes(int fd, const char* data, size_t len) {
+  uint32_t netLen = htonl(static_cast<uint32_t>(len));
+  sendAll(fd, &netLen, sizeof(netLen));
+  sendAll(fd, data, len);
+}
+
+std::vector<char> recvBytes(int fd) {
+  uint32_t netLen;
+  if (!recvAll(fd, &netLen, sizeof(netLen))) {
+    throw std::runtime_error("TcpStore: connection closed");
+  }
+  std::vector<char> data(ntohl(netLen));
+  if (!data.empty() && !recvAll(fd, data.data(), data.size())) {
+    throw std::runtime_error("TcpStore: connection closed");
+  }
+  return data;
+}
+
+} // namespace
+
+namespace fl {
+
+namespace detail {
+
+constexpr std::chrono::milliseconds TcpStore::kDefaultTimeout;
+
+TcpStore::TcpStore(const std::string& host, int port, bool isServer)
+    : port_(port), isServer_(isServer) {
+  if (isServer_) {
+    listen(port);
+    acceptThread_ = std::thread([this]() { acceptConnections(); });
+  }
+  try {
+    connect(host, port_);
+  } catch (...) {
+    stopServer();
+    throw;
+  }
+}
+
+TcpStore::~TcpStore() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+  stopServer();
+}
+
+void TcpStore::stopServer() {
+  if (!isServer_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(serverMutex_);
+    stopping_ = true;
+    // Unblock accept() and recv() in server threads
+    ::shutdown(listenFd_, SHUT_RDWR);
+    for (int fd : connectionFds_) {
+      ::shutdown(fd, SHUT_RDWR);
+    }
+  }
+  acceptThread_.join();
+  for (auto& thread : connectionThreads_) {
+    thread.join();
+  }
+  for (int fd : connectionFds_) {
+    ::close(fd);
+  }
+  ::close(listenFd_);
+}
+
+void TcpStore::set(const std::string& key, const std::vector<char>& data) {
+  std::lock_guard<std::mutex> lock(clientMutex_);
+  uint8_t command = kSet;
+  sendAll(fd_, &command, sizeof(command));
+  sendBytes(fd_, key.data(), key.size());
+  sendBytes(fd_, data.data(), data.size());
+  uint8_t status;
+  if (!recvAll(fd_, &status, sizeof(status))) {
+    throw std::runtime_error("TcpStore set: connection closed");
+  }
+  if (status != 0) {
+    throw std::runtime_error("TcpStore set: key already exists: " + key);
+  }
+}
+
+int TcpStore::port() const {
+  return port_;
+}
+
+std::vector<char> TcpStore::get(const std::string& key) {
+  const auto start = std::chrono::steady_clock::now();
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(clientMutex_);
+      uint8_t command = kGet;
+      sendAll(fd_, &command, sizeof(command));
+      sendBytes(fd_, key.data(), key.size());
+      uint8_t found;
+      if (!recvAll(fd_, &found, sizeof(found))) {
+        throw std::runtime_error("TcpStore get: connection closed");
+      }
+      if (found) {
+        return recvBytes(fd_);
+      }
+    }
+    if (std::chrono::steady_clock::now() - start > kDefaultTimeout) {
+      throw std::runtime_error("TcpStore timed out for key: " + key);
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+void TcpStore::listen(int port) {
+  // Prefer a dual-stack IPv6 socket accepting IPv4 connections too, and fall
+  // back to IPv4 where IPv6 is unavailable
+  bool ipv6 = true;
+  listenFd_ = ::socket(AF_INET6, SOCK_STREAM, 0);
+  if (listenFd_ == -1) {
+    ipv6 = false;
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  }
+  if (listenFd_ == -1) {
+    throw std::runtime_error(
+        std::string("TcpStore: socket failed: ") + std::strerror(errno));
+  }
+  int on = 1;
+  ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  int rv;
+  if (ipv6) {
+    int off = 0;
+    ::setsockopt(listenFd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    sockaddr_in6 addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(static_cast<uint16_t>(port));
+    rv = ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  } else {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    rv = ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  }
+  if (rv != 0 || ::listen(listenFd_, SOMAXCONN) != 0) {
+    std::string err = std::strerror(errno);
+    ::close(listenFd_);
+    throw std::runtime_error(
+        "TcpStore: can't listen on port " + std::to_string(port) + ": " +
+        err);
+  }
+
+  // The port picked by the system if port is 0
+  sockaddr_storage addr;
+  socklen_t addrLen = sizeof(addr);
+  if (::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &addrLen) !=
+      0) {
+    std::string err = std::strerror(errno);
+    ::close(listenFd_);
+    throw std::runtime_error("TcpStore: getsockname failed: " + err);
+  }
+  port_ = ntohs(
+      addr.ss_family == AF_INET6
+          ? reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port
+          : reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+}
+
+void TcpStore::connect(const std::string& host, int port) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs = nullptr;
+  int rv = ::getaddrinfo(
+      host.c_str(), std::to_string(port).c_str(), &hints, &addrs);
+  if (rv != 0) {
+    throw std::runtime_error(
+        "TcpStore: can't resolve " + host + ": " + ::gai_strerror(rv));
+  }
+
+  // The server may not be up yet: retry until timeout
+  const auto start = std::chrono::steady_clock::now();
+  while (fd_ == -1) {
+    for (addrinfo* ai = addrs; ai != nullptr; ai = ai->ai_next) {
+      int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd == -1) {
+        continue;
+      }
+      if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+        fd_ = fd;
+        break;
+      }
+      ::close(fd);
+    }
+    if (fd_ == -1) {
+      if (std::chrono::steady_clock::now() - start > kDefaultTimeout) {
+        ::freeaddrinfo(addrs);
+        throw std::runtime_error(
+            "TcpStore: timed out connecting to " + host + ":" +
+            std::to_string(port));
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  ::freeaddrinfo(addrs);
+  int on = 1;
+  ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+void TcpStore::acceptConnections() {
+  while (true) {
+    int fd = ::accept(listenFd_, nullptr, nullptr);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return; // listening socket was shut down
+    }
+    std::lock_guard<std::mutex> lock(serverMutex_);
+    if (stopping_) {
+      ::close(fd);
+      return;
+    }
+    connectionFds_.push_back(fd);
+    connectionThreads_.emplace_back([this, fd]() { serveConnection(fd); });
+  }
+}
+
+void TcpStore::serveConnection(int fd) {
+  try {
+    uint8_t command;
+    while (recvAll(fd, &command, sizeof(command))) {
+      auto keyBytes = recvBytes(fd);
+      std::string key(keyBytes.begin(), keyBytes.end());
+      if (command == kSet) {
+        auto data = recvBytes(fd);
+        bool inserted;
+        {
+          std::lock_guard<std::mutex> lock(serverMutex_);
+          inserted = data_.emplace(key, std::move(data)).second;
+        }
+        uint8_t status = inserted ? 0 : 1;
+        sendAll(fd, &status, sizeof(status));
+      } else if (command == kGet) {
+        std::vector<char> data;
+        uint8_t found = 0;
+        {
+          std::lock_guard<std::mutex> lock(serverMutex_);
+          auto it = data_.find(key);
+          if (it != data_.end()) {
+            data = it->second;
+            found = 1;
+          }
+        }
+        sendAll(fd, &found, sizeof(found));
+        if (found) {
+          sendBytes(fd, data.data(), data.size());
+        }
+      } else {
+        return; // protocol error: drop the connection
+      }
+    }
+  } catch (const std::exception&) {
+    // Connection closed or failed: nothing to clean up here, the socket is
+    // closed by the destructor
+  }
+}
+
+} // namespace detail
+
+} // namespace fl
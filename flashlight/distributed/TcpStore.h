@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fl {
+
+namespace detail {
+
+// A minimal key-value store for rendezvous, with the same interface as
+// FileStore. One process (usually rank 0) serves the store; all processes,
+// including the server, access it as clients. Keys can only be set once.
+class TcpStore {
+ public:
+  static constexpr std::chrono::milliseconds kDefaultTimeout =
+      std::chrono::seconds(60 * 2);
+
+  /**
+   * @param host address of the process serving the store
+   * @param port port on which the store is served. A server given port 0
+   * listens on a free port, see port().
+   * @param isServer whether this process serves the store, listening on
+   * `port` on all interfaces
+   */
+  TcpStore(const std::string& host, int port, bool isServer);
+  ~TcpStore();
+
+  TcpStore(const TcpStore&) = delete;
+  TcpStore& operator=(const TcpStore&) = delete;
+
+  // Blocks until the key is set
+  std::vector<char> get(const std::string& key);
+  void set(const std::string& key, const std::vector<char>& data);
+
+  // Port on which the store is served
+  int port() const;
+
+ private:
+  int port_;
+
+  // Client
+  int fd_{-1};
+  std::mutex clientMutex_;
+
+  // Server
+  bool isServer_;
+  int listenFd_{-1};
+  bool stopping_{false};
+  std::mutex serverMutex_;
+  std::unordered_map<std::string, std::vector<char>> data_;
+  std::vector<int> connectionFds_;
+  std::vector<std::thread> connectionThreads_;
+  std::thread acceptThread_;
+
+  void listen(int port);
+  void connect(const std::string& host, int port);
+  void acceptConnections();
+  void stopServer();
+  void serveConnection(int fd);
+};
+} // namespace detail
+
+} // namespace fl
@@ -7,24 +7,64 @@
 
 #include "flashlight/flashlight/distributed/DistributedApi.h"
 
+#include <cstring>
+#include <exception>
+#include <future>
 #include <iostream>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <utility>
 
 #include <gloo/allreduce_halving_doubling.h>
 #include <gloo/config.h>
-#include <gloo/mpi/context.h>
+#include <gloo/rendezvous/context.h>
+#include <gloo/rendezvous/store.h>
 #include <gloo/transport/tcp/device.h>
+#if GLOO_USE_MPI
+#include <gloo/mpi/context.h>
 #include <mpi.h>
+#endif
 
 #include "flashlight/flashlight/common/CppBackports.h"
 #include "flashlight/flashlight/common/DevicePtr.h"
+#include "flashlight/flashlight/common/threadpool/ThreadPool.h"
+#include "flashlight/flashlight/distributed/FileStore.h"
 #include "flashlight/flashlight/distributed/LRUCache.h"
+#include "flashlight/flashlight/distributed/TcpStore.h"
 
 namespace {
-std::shared_ptr<gloo::mpi::Context> glooContext_;
+std::shared_ptr<gloo::Context> glooContext_;
+
+// Store used for rendezvous without MPI. Kept alive with the context, since
+// other ranks may still be reading from it after this rank has connected.
+std::shared_ptr<gloo::rendezvous::Store> glooStore_;
+
+// Exposes a flashlight rendezvous store (FileStore, TcpStore) to Gloo
+template <typename StoreT>
+class GlooStore : public gloo::rendezvous::Store {
+ public:
+  explicit GlooStore(std::unique_ptr<StoreT> store) : store_(std::move(store)) {}
+
+  void set(const std::string& key, const std::vector<char>& data) override {
+    store_->set(key, data);
+  }
+
+  std::vector<char> get(const std::string& key) override {
+    return store_->get(key);
+  }
+
+  void wait(const std::vector<std::string>& keys) override {
+    // get() blocks until the key is set
+    for (const auto& key : keys) {
+      store_->get(key);
+    }
+  }
+
+ private:
+  std::unique_ptr<StoreT> store_;
+};
 
 // Gloo algorithms are "not meant" to be created an deleted often, for some
 // strange reason. Therefore, we emulate THD by providing a cache of the last
@@ -38,23 +78,84 @@ std::shared_ptr<gloo::mpi::Context> glooContext_;
 const int kGlooCacheSize_ = 10;
 using CacheType = fl::detail::LRUCache<std::string, gloo::Algorithm>;
 CacheType glooCache_(kGlooCacheSize_);
-af::array cacheArr_;
+
+// All reductions run on a single communication thread, in submission order.
+// This lets asynchronous reductions overlap with computation, and guarantees
+// that every rank creates and runs Gloo algorithms in the same order.
+std::unique_ptr<fl::ThreadPool> commThread_;
+
+// Staging buffer into which arrays are coalesced before being reduced. It is
+// only accessed from the communication thread. Reducing from a stable buffer
+// keeps the Gloo algorithm cache effective.
+std::vector<char> coalesceBuffer_;
+
+// An asynchronous reduction which hasn't been synchronized yet. The arrays
+// keep the reduced buffers alive (and locked) until it completes.
+struct PendingReduction {
+  std::future<void> done;
+  std::vector<af::array> arrays;
+};
+// Reductions may be submitted and synchronized from different threads
+std::vector<PendingReduction> pendingReductions_;
+std::mutex pendingReductionsMutex_;
+
+// A buffer to reduce, as a host pointer and a size in bytes
+using ReduceBuffer = std::pair<void*, size_t>;
 } // namespace
 
 namespace fl {
 
 namespace detail {
 
-std::shared_ptr<gloo::mpi::Context> globalContext() {
+std::shared_ptr<gloo::Context> globalContext() {
   return glooContext_;
 }
 
+std::shared_ptr<gloo::rendezvous::Store> createStore(
+    DistributedInit initMethod,
+    int worldRank,
+    const std::unordered_map<std::string, std::string>& params) {
+  if (initMethod == DistributedInit::FILE_SYSTEM) {
+    auto filePath = params.find(DistributedConstants::kFilePath);
+    if (filePath == params.end() || filePath->second.empty()) {
+      throw std::invalid_argument("invalid FilePath for Gloo FILE_SYSTEM init");
+    }
+    return std::make_shared<GlooStore<FileStore>>(
+        cpp::make_unique<FileStore>(filePath->second));
+  }
+  auto host = params.find(DistributedConstants::kTcpHost);
+  auto port = params.find(DistributedConstants::kTcpPort);
+  if (host == params.end() || host->second.empty()) {
+    throw std::invalid_argument("invalid TcpHost for Gloo TCP init");
+  }
+  if (port == params.end() || port->second.empty()) {
+    throw std::invalid_argument("invalid TcpPort for Gloo TCP init");
+  }
+  return std::make_shared<GlooStore<TcpStore>>(cpp::make_unique<TcpStore>(
+      host->second, std::stoi(port->second), /* isServer = */ worldRank == 0));
+}
+
+/**
+ * Reduces `s` elements at `ptr`. If `cached`, the algorithm is kept in the
+ * cache, keyed by `ptr`, which must then be the same on all ranks across
+ * calls: ranks which would disagree on a cache hit would create algorithms in
+ * a different order and hang.
+ */
 template <typename T>
-inline void allreduceGloo(T* ptr, size_t s) {
+inline void allreduceGloo(T* ptr, size_t s, bool cached) {
+  using Allreduce = gloo::AllreduceHalvingDoubling<T>;
+  if (!cached) {
+    Allreduce(
+        globalContext(),
+        std::vector<T*>({ptr}),
+        s,
+        gloo::ReductionFunction<T>::sum)
+        .run();
+    return;
+  }
   auto key = detail::makeHashKey(ptr, s, "allreduceCpu");
   auto algorithm = glooCache_.get(key);
   if (algorithm == nullptr) {
-    using Allreduce = gloo::AllreduceHalvingDoubling<T>;
     algorithm = glooCache_.put(
         key,
         cpp::make_unique<Allreduce>(
@@ -65,35 +166,199 @@ inline void allreduceGloo(T* ptr, size_t s) {
   }
   algorithm->run();
 }
+
+void allreduceGloo(void* data, size_t bytes, af::dtype type, bool cached) {
+  size_t elements = bytes / af::getSizeOf(type);
+  switch (type) {
+    case af::dtype::f32:
+      allreduceGloo(static_cast<float*>(data), elements, cached);
+      break;
+    case af::dtype::f64:
+      allreduceGloo(static_cast<double*>(data), elements, cached);
+      break;
+    case af::dtype::s32:
+      allreduceGloo(static_cast<int*>(data), elements, cached);
+      break;
+    case af::dtype::s64:
+      allreduceGloo(static_cast<int64_t*>(data), elements, cached);
+      break;
+    default:
+      throw std::runtime_error("unsupported data type for allreduce with gloo");
+  }
+}
+
+/**
+ * Reduces buffers with a single allreduce. A single buffer is reduced in
+ * place; several buffers are copied into the coalesce buffer, which is reduced
+ * and copied back. Runs on the communication thread.
+ */
+void coalescedAllreduce(
+    const std::vector<ReduceBuffer>& buffers,
+    af::dtype type) {
+  size_t totalBytes = 0;
+  for (const auto& buffer : buffers) {
+    totalBytes += buffer.second;
+  }
+  if (totalBytes == 0) {
+    return;
+  }
+  if (buffers.size() == 1) {
+    // The address of the array differs across ranks, so its algorithm can't be
+    // cached
+    allreduceGloo(buffers[0].first, totalBytes, type, /* cached = */ false);
+    return;
+  }
+  if (coalesceBuffer_.size() < totalBytes) {
+    coalesceBuffer_.resize(totalBytes);
+  }
+  char* cur = coalesceBuffer_.data();
+  for (const auto& buffer : buffers) {
+    std::memcpy(cur, buffer.first, buffer.second);
+    cur += buffer.second;
+  }
+
+  allreduceGloo(coalesceBuffer_.data(), totalBytes, type, /* cached = */ true);
+
+  cur = coalesceBuffer_.data();
+  for (const auto& buffer : buffers) {
+    std::memcpy(buffer.first, cur, buffer.second);
+    cur += buffer.second;
+  }
+}
+
+/**
+ * Reduces groups of arrays, each group coalesced into a single allreduce, on
+ * the communication thread. If async, returns immediately; the arrays are
+ * locked until `syncDistributed` is called. Otherwise, waits for completion.
+ */
+void allreduceGroups(
+    const std::vector<std::vector<af::array*>>& groups,
+    bool async) {
+  if (!isDistributedInit()) {
+    throw std::runtime_error("distributed environment not initialized");
+  }
+  for (const auto& group : groups) {
+    for (auto* arr : group) {
+      if (arr->type() != group.front()->type()) {
+        throw std::runtime_error(
+            "Cannot perform contiguous set allReduce on a set of tensors "
+            "of different types");
+      }
+      switch (arr->type()) {
+        case af::dtype::f32:
+        case af::dtype::f64:
+        case af::dtype::s32:
+        case af::dtype::s64:
+          break;
+        default:
+          throw std::runtime_error(
+              "unsupported data type for allreduce with gloo");
+      }
+    }
+  }
+
+  std::vector<std::pair<std::vector<ReduceBuffer>, af::dtype>> work;
+  std::vector<af::array> lockedArrays;
+  // Only used if synchronous: unlocks arrays once done
+  std::vector<DevicePtr> devicePtrs;
+  for (const auto& group : groups) {
+    if (group.empty()) {
+      continue;
+    }
+    std::vector<ReduceBuffer> buffers;
+    for (auto* arr : group) {
+      if (arr->isempty()) {
+        continue;
+      }
+      if (async) {
+        // The caller may replace or release the array before the reduction
+        // completes, so keep a reference to it to unlock it later. The
+        // pointer must be taken from the original array: device() on a
+        // shared array would copy it.
+        if (!af::isLinear(*arr)) {
+          throw std::invalid_argument(
+              "can't get device pointer of non-contiguous array");
+        }
+        void* ptr = arr->device<void>();
+        lockedArrays.push_back(*arr);
+        buffers.emplace_back(ptr, arr->bytes());
+      } else {
+        devicePtrs.emplace_back(*arr);
+        buffers.emplace_back(devicePtrs.back().get(), arr->bytes());
+      }
+    }
+    work.emplace_back(std::move(buffers), group.front()->type());
+  }
+  if (work.empty()) {
+    return;
+  }
+
+  auto done = commThread_->enqueue([work]() {
+    for (const auto& entry : work) {
+      coalescedAllreduce(entry.first, entry.second);
+    }
+  });
+  if (async) {
+    std::lock_guard<std::mutex> lock(pendingReductionsMutex_);
+    pendingReductions_.push_back({std::move(done), std::move(lockedArrays)});
+  } else {
+    done.get();
+  }
+}
 } // namespace detail
 
 void distributedInit(
     DistributedInit initMethod,
-    int /* worldRank */,
-    int /* worldSize */,
-    const std::unordered_map<std::string, std::string>& /* params = {} */) {
+    int worldRank,
+    int worldSize,
+    const std::unordered_map<std::string, std::string>& params /* = {} */) {
   if (isDistributedInit()) {
     std::cerr << "warning: fl::distributedInit() called more than once\n";
     return;
   }
-
-  if (initMethod != DistributedInit::MPI) {
-    throw std::runtime_error(
-        "unsupported distributed init method for gloo backend");
-  }
-
-  // using MPI
   if (glooContext_ != nullptr) {
     return;
   }
+
   // TODO: ibverbs support.
   auto glooDev = gloo::transport::tcp::CreateDevice("");
 
-  // Create Gloo context from MPI communicator
-  glooContext_ = gloo::mpi::Context::createManaged();
-  glooContext_->setTimeout(gloo::kNoTimeout);
-  glooContext_->connectFullMesh(glooDev);
+  if (initMethod == DistributedInit::MPI) {
+#if GLOO_USE_MPI
+    // Create Gloo context from MPI communicator
+    auto context = gloo::mpi::Context::createManaged();
+    context->setTimeout(gloo::kNoTimeout);
+    context->connectFullMesh(glooDev);
+    glooContext_ = context;
+#else
+    throw std::runtime_error(
+        "Gloo was built without MPI: use DistributedInit::FILE_SYSTEM "
+        "or DistributedInit::TCP");
+#endif
+  } else if (
+      initMethod == DistributedInit::FILE_SYSTEM ||
+      initMethod == DistributedInit::TCP) {
+    if (worldSize < 1 || worldRank < 0 || worldRank >= worldSize) {
+      throw std::invalid_argument(
+          "invalid worldRank " + std::to_string(worldRank) +
+          " or worldSize " + std::to_string(worldSize) + " for Gloo init");
+    }
+    // Rendezvous through the store: each rank publishes its address, then
+    // connects to all others
+    auto store = detail::createStore(initMethod, worldRank, params);
+    auto context =
+        std::make_shared<gloo::rendezvous::Context>(worldRank, worldSize);
+    context->setTimeout(gloo::kNoTimeout);
+    context->connectFullMesh(*store, glooDev);
+    glooStore_ = store;
+    glooContext_ = context;
+  } else {
+    throw std::runtime_error(
+        "unsupported distributed init method for gloo backend");
+  }
+  commThread_ = cpp::make_unique<ThreadPool>(1);
 
+  detail::DistributedInfo::getInstance().initMethod_ = initMethod;
   detail::DistributedInfo::getInstance().backend_ = DistributedBackend::GLOO;
   detail::DistributedInfo::getInstance().isInitialized_ = true;
   if (glooContext_->rank == 0) {
@@ -102,55 +367,58 @@ void distributedInit(
 }
 
 void allReduce(af::array& arr, bool async /* = false */) {
-  if (!isDistributedInit()) {
-    throw std::runtime_error("distributed environment not initialized");
-  }
-  if (async) {
-    throw std::runtime_error(
-        "Asynchronous allReduce not yet supported for Gloo backend");
-  }
-  size_t arrSize = arr.elements() * af::getSizeOf(arr.type());
-  if (arrSize > cacheArr_.elements()) {
-    cacheArr_ = af::array(arrSize, af::dtype::b8);
-  }
-  DevicePtr arrPtr(arr);
-  DevicePtr cacheArrPtr(cacheArr_);
-  memcpy(cacheArrPtr.get(), arrPtr.get(), arrSize);
-  switch (arr.type()) {
-    case af::dtype::f32:
-      detail::allreduceGloo(
-          static_cast<float*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::f64:
-      detail::allreduceGloo(
-          static_cast<double*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::s32:
-      detail::allreduceGloo(
-          static_cast<int*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::s64:
-      detail::allreduceGloo(
-          static_cast<int64_t*>(cacheArrPtr.get()), arr.elements());
-      break;
-    default:
-      throw std::runtime_error("unsupported data type for allreduce with gloo");
-  }
-  memcpy(arrPtr.get(), cacheArrPtr.get(), arrSize);
+  detail::allreduceGroups({{&arr}}, async);
 }
 
-// Not yet supported
 void allReduceMultiple(
     std::vector<af::array*> arrs,
     bool async /* = false */,
     bool contiguous /* = false */) {
-  throw std::runtime_error(
-      "allReduceMultiple not yet supported for Gloo backend");
+  std::vector<std::vector<af::array*>> groups;
+  if (contiguous) {
+    // Same limit as other backends, which use a fixed size coalesce buffer
+    size_t totalBytes = 0;
+    for (auto* arr : arrs) {
+      totalBytes += arr->bytes();
+    }
+    if (totalBytes > DistributedConstants::kCoalesceCacheSize) {
+      throw std::runtime_error(
+          "Total coalesce buffer size is larger than existing buffer size");
+    }
+    groups.push_back(std::move(arrs));
+  } else {
+    for (auto* arr : arrs) {
+      groups.push_back({arr});
+    }
+  }
+  detail::allreduceGroups(groups, async);
 }
 
+/**
+ * Waits for all asynchronous reductions and releases the arrays they hold.
+ */
 void syncDistributed() {
-  throw std::runtime_error(
-      "Asynchronous allReduce not yet supported for Gloo backend");
+  std::vector<PendingReduction> pending;
+  {
+    std::lock_guard<std::mutex> lock(pendingReductionsMutex_);
+    pending.swap(pendingReductions_);
+  }
+  std::exception_ptr error;
+  for (auto& reduction : pending) {
+    try {
+      reduction.done.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+    for (auto& arr : reduction.arrays) {
+      arr.unlock();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
 }
 
 int getWorldRank() {
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/distributed/reducers/BucketedReducer.h"
+
+#include <stdexcept>
+
+#include "flashlight/flashlight/autograd/Variable.h"
+#include "flashlight/flashlight/distributed/DistributedApi.h"
+
+namespace fl {
+
+BucketedReducer::BucketedReducer(
+    double scale,
+    bool async /* = true */,
+    std::size_t bucketBytes /* = DistributedConstants::kCoalesceCacheSize */)
+    : scale_(scale), async_(async), bucketBytes_(bucketBytes) {
+  if (bucketBytes_ == 0) {
+    throw std::invalid_argument("BucketedReducer: bucket size must be > 0");
+  }
+}
+
+BucketedReducer::~BucketedReducer() {
+  finalize();
+}
+
+void BucketedReducer::registerParams(const std::vector<Variable>& params) {
+  if (stepStarted_) {
+    throw std::logic_error(
+        "BucketedReducer::registerParams - can't register parameters "
+        "during a step");
+  }
+  // The params must not own the Reducer: it would never be destroyed, e.g.
+  // when it is replaced between training phases
+  std::weak_ptr<BucketedReducer> weakSelf = shared_from_this();
+  for (auto param : params) {
+    size_t paramIdx = params_.size();
+    params_.push_back({0, 0, param.type(), param.elements()});
+    param.registerGradHook([weakSelf, paramIdx](Variable& grad) {
+      if (auto self = weakSelf.lock()) {
+        self->addParamGrad(paramIdx, grad);
+      }
+    });
+  }
+}
+
+void BucketedReducer::add(Variable& var) {
+  if (getWorldSize() > 1) {
+    allReduce(var.array());
+  }
+  var.array() *= scale_;
+}
+
+void BucketedReducer::finalize() {
+  if (!stepStarted_) {
+    return;
+  }
+  // Parameters which didn't get a gradient this step are reduced as zeros, so
+  // that every process runs the same reductions
+  launchReadyBuckets(/* force = */ true);
+  if (async_) {
+    syncDistributed();
+  }
+
+  for (auto& bucket : buckets_) {
+    for (size_t slot = 0; slot < bucket.params.size(); ++slot) {
+      auto& grad = bucket.grads[slot];
+      dim_t elements = params_[bucket.params[slot]].elements;
+      if (bucket.ready[slot] && elements > 0) {
+        dim_t offset = bucket.offsets[slot];
+        // Copy the slice out: a gradient indexing the bucket would share its
+        // buffer, which would then be copied whole when the bucket is written
+        // at the next step
+        af::array slice = bucket.buffer(af::seq(offset, offset + elements - 1));
+        auto reduced = scale_ == 1.0 ? slice.copy() : slice * scale_;
+        reduced.eval();
+        grad.array() = af::moddims(reduced, grad.dims());
+      }
+      grad = Variable();
+    }
+  }
+  stepStarted_ = false;
+}
+
+void BucketedReducer::assignBuckets() {
+  // Backward roughly visits parameters in reverse registration order: fill
+  // buckets from the last parameter so that the first bucket is ready first
+  const size_t firstNewBucket = buckets_.size();
+  for (size_t i = params_.size(); i-- > numAssigned_;) {
+    auto& param = params_[i];
+    size_t bytes = param.elements * af::getSizeOf(param.type);
+    if (buckets_.size() == firstNewBucket ||
+        buckets_.back().type != param.type ||
+        (buckets_.back().elements > 0 &&
+         buckets_.back().elements * af::getSizeOf(param.type) + bytes >
+             bucketBytes_)) {
+      buckets_.emplace_back();
+      buckets_.back().type = param.type;
+    }
+    auto& bucket = buckets_.back();
+    param.bucket = buckets_.size() - 1;
+    param.slot = bucket.params.size();
+    bucket.params.push_back(i);
+    bucket.offsets.push_back(bucket.elements);
+    bucket.elements += param.elements;
+  }
+  numAssigned_ = params_.size();
+}
+
+void BucketedReducer::startStep() {
+  if (numAssigned_ != params_.size()) {
+    assignBuckets();
+  }
+  for (auto& bucket : buckets_) {
+    bucket.grads.assign(bucket.params.size(), Variable());
+    bucket.ready.assign(bucket.params.size(), false);
+    bucket.numPending = bucket.params.size();
+  }
+  nextBucket_ = 0;
+  stepStarted_ = true;
+}
+
+void BucketedReducer::addParamGrad(std::size_t paramIdx, Variable& grad) {
+  if (!stepStarted_) {
+    startStep();
+  }
+  const auto& param = params_[paramIdx];
+  auto& bucket = buckets_[param.bucket];
+  if (bucket.ready[param.slot]) {
+    throw std::logic_error(
+        "BucketedReducer: gradient added twice in a step; "
+        "finalize() must be called after each backward pass");
+  }
+
+  if (param.elements > 0) {
+    if (bucket.buffer.isempty()) {
+      bucket.buffer = af::array(bucket.elements, bucket.type);
+    }
+    dim_t offset = bucket.offsets[param.slot];
+    bucket.buffer(af::seq(offset, offset + param.elements - 1)) =
+        af::flat(grad.array());
+  }
+  bucket.grads[param.slot] = grad;
+  bucket.ready[param.slot] = true;
+  if (--bucket.numPending == 0) {
+    launchReadyBuckets(/* force = */ false);
+  }
+}
+
+void BucketedReducer::launchReadyBuckets(bool force) {
+  // Reductions must be issued in the same order on all processes: a bucket
+  // only launches once all buckets before it have
+  while (nextBucket_ < buckets_.size() &&
+         (force || buckets_[nextBucket_].numPending == 0)) {
+    launch(buckets_[nextBucket_]);
+    ++nextBucket_;
+  }
+}
+
+void BucketedReducer::launch(Bucket& bucket) {
+  if (bucket.elements == 0) {
+    return;
+  }
+  if (bucket.buffer.isempty()) {
+    bucket.buffer = af::array(bucket.elements, bucket.type);
+  }
+  if (bucket.numPending > 0) {
+    for (size_t slot = 0; slot < bucket.params.size(); ++slot) {
+      dim_t elements = params_[bucket.params[slot]].elements;
+      if (!bucket.ready[slot] && elements > 0) {
+        dim_t offset = bucket.offsets[slot];
+        bucket.buffer(af::seq(offset, offset + elements - 1)) = 0;
+      }
+    }
+  }
+  if (getWorldSize() > 1) {
+    allReduce(bucket.buffer, async_);
+  }
+}
+
+} // namespace fl
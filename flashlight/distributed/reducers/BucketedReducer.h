@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <arrayfire.h>
+
+#include "flashlight/flashlight/common/Defines.h"
+#include "flashlight/flashlight/distributed/reducers/Reducer.h"
+
+namespace fl {
+
+class Variable;
+
+/**
+ * A Reducer which overlaps gradient synchronization with the backward pass.
+ *
+ * Parameters are assigned ahead of time to fixed-size buckets, in reverse
+ * registration order (roughly the order in which backward produces their
+ * gradients). Each bucket owns a persistent flat buffer: gradients are copied
+ * into it as they become available, and the bucket is all-reduced as soon as
+ * its last gradient is ready, while backward keeps running. Buckets are always
+ * launched in the same order on every process.
+ *
+ * Parameters must be registered with ``registerParams``, which installs the
+ * gradient hooks; ``distributeModuleGrads`` must not be used with this
+ * Reducer. ``finalize`` must be called after backward and before using the
+ * gradients: it reduces buckets whose gradients weren't all computed, waits
+ * for all reductions and copies the scaled results back into the gradients.
+ *
+ * Example:
+ * \code
+ * auto reducer = std::make_shared<BucketedReducer>(1.0 / getWorldSize());
+ * reducer->registerParams(model->params());
+ * for (auto& sample : dataset) {
+ *   ...
+ *   loss.backward();
+ *   reducer->finalize();
+ *   optimizer.step();
+ * }
+ * \endcode
+ */
+class BucketedReducer : public Reducer,
+                        public std::enable_shared_from_this<BucketedReducer> {
+ public:
+  /**
+   * Creates a new bucketed reducer.
+   *
+   * @param[in] scale a factor by which to scale reduced gradients
+   * @param[in] async whether or not buckets are reduced in a separate compute
+   * stream, asynchronously to the ArrayFire stream
+   * @param[in] bucketBytes the maximum size of a bucket, in bytes. Parameters
+   * larger than this get a bucket of their own.
+   */
+  explicit BucketedReducer(
+      double scale,
+      bool async = true,
+      std::size_t bucketBytes = DistributedConstants::kCoalesceCacheSize);
+
+  /**
+   * Destroy the Reducer. Calls `finalize()` before returning.
+   */
+  ~BucketedReducer() override;
+
+  /**
+   * Assigns parameters to buckets and registers gradient hooks which add
+   * their gradients to their bucket. May be called several times (for
+   * instance for a network and a criterion) before the first backward pass;
+   * every process must register the same parameters in the same order.
+   *
+   * The Reducer must be owned by a ``std::shared_ptr``. The hooks don't keep
+   * it alive: once it is destroyed, they leave gradients untouched, until
+   * they are replaced e.g. by those of a new Reducer.
+   *
+   * @param[in] params parameters whose gradients will be synchronized
+   */
+  void registerParams(const std::vector<Variable>& params);
+
+  /**
+   * Add a ``Variable`` which was not registered with ``registerParams``: it is
+   * reduced immediately with ``allReduce``.
+   */
+  void add(Variable& var) override;
+
+  /**
+   * Reduce all buckets which weren't launched during backward, wait for all
+   * reductions, and write the scaled results back into the gradients.
+   */
+  void finalize() override;
+
+ private:
+  struct Bucket {
+    af::dtype type;
+    /// Parameter indices, in bucket order
+    std::vector<std::size_t> params;
+    /// Offsets of the parameters in the flat buffer, in elements
+    std::vector<dim_t> offsets;
+    dim_t elements{0};
+    /// Persistent flat buffer, allocated on first use
+    af::array buffer;
+    /// Gradients added during the current step, indexed like `params`
+    std::vector<Variable> grads;
+    std::vector<bool> ready;
+    std::size_t numPending{0};
+  };
+
+  struct ParamInfo {
+    std::size_t bucket;
+    std::size_t slot;
+    af::dtype type;
+    dim_t elements;
+  };
+
+  /// A scale by which to scale reduced gradients
+  double scale_;
+  bool async_;
+  std::size_t bucketBytes_;
+  std::vector<ParamInfo> params_;
+  std::vector<Bucket> buckets_;
+  /// Number of parameters which have been assigned to buckets
+  std::size_t numAssigned_{0};
+  /// Buckets are launched in order: all buckets before this one are launched
+  std::size_t nextBucket_{0};
+  bool stepStarted_{false};
+
+  /// Assigns parameters registered since the last call to buckets
+  void assignBuckets();
+  void addParamGrad(std::size_t paramIdx, Variable& grad);
+  void startStep();
+  /// Launches ready buckets, in order, starting from `nextBucket_`
+  void launchReadyBuckets(bool force);
+  void launch(Bucket& bucket);
+};
+
+} // namespace fl
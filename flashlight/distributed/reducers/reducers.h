@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "flashlight/flashlight/distributed/reducers/BucketedReducer.h"
 #include "flashlight/flashlight/distributed/reducers/CoalescingReducer.h"
 #include "flashlight/flashlight/distributed/reducers/InlineReducer.h"
 #include "flashlight/flashlight/distributed/reducers/Reducer.h"
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Measures the bookkeeping overhead of the backward pass, that is the
+ * traversal of the computation graph, versus the size of the graph. The graphs
+ * are chains of additions of a 1-element array mixed with a residual
+ * connection every 4 ops, so that the numerical work is negligible.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "flashlight/flashlight/autograd/autograd.h"
+
+using namespace fl;
+
+namespace {
+
+Variable buildGraph(const Variable& input, int size) {
+  auto output = input;
+  auto residual = input;
+  for (int i = 0; i < size; ++i) {
+    output = output + input;
+    if (i % 4 == 3) {
+      output = output + residual;
+      residual = output;
+    }
+  }
+  return output;
+}
+
+double timeit(std::function<void()> fn, int numIters) {
+  af::sync();
+  auto start = af::timer::start();
+  for (int i = 0; i < numIters; ++i) {
+    fn();
+  }
+  af::sync();
+  return af::timer::stop(start) / numIters;
+}
+
+} // namespace
+
+int main() {
+  af::info();
+  auto input = Variable(af::constant(1.0, 1), true);
+  // Larger graphs which are not consumed by a backward pass overflow the call
+  // stack when they are destroyed
+  for (int size : {100, 1000, 10000}) {
+    auto output = buildGraph(input, size);
+    int numIters = std::max(100000 / size, 10);
+
+    // Graph traversal only, on a retained graph
+    BackwardTape tape;
+    tape.record(output);
+    double recordSec = timeit([&]() { tape.record(output); }, numIters);
+    double newTapeSec = timeit(
+        [&]() {
+          BackwardTape newTape;
+          newTape.record(output);
+        },
+        numIters);
+
+    // Full backward passes
+    double backwardSec = timeit(
+        [&]() {
+          input.zeroGrad();
+          buildGraph(input, size).backward();
+        },
+        10);
+    double forwardSec = timeit([&]() { buildGraph(input, size); }, 10);
+
+    std::cout << std::setw(7) << tape.size() << " nodes: record "
+              << recordSec * 1e9 / tape.size() << " ns/node (new tape "
+              << newTapeSec * 1e9 / tape.size() << " ns/node), backward "
+              << (backwardSec - forwardSec) * 1e9 / tape.size()
+              << " ns/node" << std::endl;
+  }
+  return 0;
+}
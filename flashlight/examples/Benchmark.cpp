@@ -7,6 +7,8 @@
 
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "flashlight/flashlight/nn/nn.h"
 
@@ -138,6 +140,36 @@ double layerNorm() {
   return timeit(ln_fn);
 }
 
+double residual() {
+  // Each block feeds its input to a Linear layer and to a residual
+  // connection, and adds the input of the network, so most Variables
+  // accumulate several gradients during the backward pass
+  int C = 256;
+  int T = 64;
+  int B = 8;
+  int numBlocks = 24;
+  Variable input(af::randu(C, T, B, f32), true);
+  Variable dout(af::randu(C, T, B, f32), false);
+  std::vector<std::shared_ptr<Linear>> blocks;
+  for (int i = 0; i < numBlocks; ++i) {
+    blocks.push_back(std::make_shared<Linear>(C, C));
+  }
+
+  auto residual_fn = [&]() {
+    input.zeroGrad();
+    for (auto& block : blocks) {
+      block->zeroGrad();
+    }
+    auto output = input;
+    for (auto& block : blocks) {
+      output = output + relu(block->forward(output)) + input;
+    }
+    output.backward(dout);
+  };
+
+  return timeit(residual_fn);
+}
+
 int main() {
   af::info();
   TIME(alexnet);
@@ -145,5 +177,6 @@ int main() {
   TIME(linear);
   TIME(batchNorm);
   TIME(layerNorm);
+  TIME(residual);
   return 0;
 }
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Replays an allocation trace against memory manager implementations and
+ * reports reserved memory, fragmentation, native calls and call latencies.
+ *
+ * Record a trace from a training job with:
+ *   std::ofstream traceFile("trace.bin", std::ios::binary);
+ *   fl::MemoryManagerInstaller::currentlyInstalledMemoryManager()
+ *       ->setTraceStream(&traceFile);
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flashlight/flashlight/memory/memory.h"
+
+using namespace fl;
+
+namespace {
+
+const unsigned kDefaultMaxBuffers = 64;
+
+std::shared_ptr<MemoryManagerAdapter> createManager(
+    const std::string& name,
+    int numDevices,
+    std::shared_ptr<MemoryManagerDeviceInterface> deviceInterface) {
+  if (name == "default") {
+    return std::make_shared<DefaultMemoryManager>(
+        numDevices, kDefaultMaxBuffers, false, deviceInterface);
+  } else if (name == "caching") {
+    return std::make_shared<CachingMemoryManager>(numDevices, deviceInterface);
+  }
+  return nullptr;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " <trace file> [default | caching ...]\n";
+    return 1;
+  }
+  std::vector<std::string> managers(argv + 2, argv + argc);
+  if (managers.empty()) {
+    managers = {"default", "caching"};
+  }
+
+  auto trace = loadAllocationTrace(argv[1]);
+  int numDevices = 1;
+  for (const auto& event : trace) {
+    numDevices = std::max(numDevices, event.device + 1);
+  }
+  std::cout << "Loaded " << trace.size() << " events from " << argv[1]
+            << std::endl;
+
+  for (const auto& name : managers) {
+    AllocationTraceReplayer replayer;
+    auto manager =
+        createManager(name, numDevices, replayer.getDeviceInterface());
+    if (!manager) {
+      std::cerr << "Unknown memory manager '" << name << "'\n";
+      return 1;
+    }
+    auto stats = replayer.replay(trace, *manager);
+    std::cout << "\n[" << name << "]\n" << stats.prettyString() << std::endl;
+  }
+  return 0;
+}
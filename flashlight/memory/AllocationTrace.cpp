@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/memory/AllocationTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace fl {
+
+namespace {
+
+const char kTraceMagic[] = {'F', 'L', 'M', 'T'};
+constexpr uint8_t kTraceVersion = 1;
+constexpr uint8_t kMaxEventType =
+    static_cast<uint8_t>(AllocationEventType::SignalMemoryCleanup);
+constexpr uint8_t kUserLockFlag = 0x80;
+
+void writeVarint(std::ostream& stream, uint64_t value) {
+  char buf[10];
+  int len = 0;
+  while (value >= 0x80) {
+    buf[len++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = static_cast<char>(value);
+  stream.write(buf, len);
+}
+
+uint64_t readVarint(std::istream& stream) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = stream.get();
+    if (byte == std::char_traits<char>::eof()) {
+      throw std::runtime_error("AllocationTraceReader: truncated record");
+    }
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("AllocationTraceReader: malformed varint");
+}
+
+} // namespace
+
+AllocationTraceWriter::AllocationTraceWriter(std::ostream& stream)
+    : stream_(stream), start_(std::chrono::steady_clock::now()) {
+  stream_.write(kTraceMagic, sizeof(kTraceMagic));
+  stream_.put(static_cast<char>(kTraceVersion));
+}
+
+void AllocationTraceWriter::record(
+    AllocationEventType type,
+    int device,
+    const void* ptr,
+    size_t bytes /* = 0 */,
+    bool userLock /* = false */) {
+  AllocationEvent event;
+  event.type = type;
+  event.userLock = userLock;
+  event.device = device;
+  event.ptr = reinterpret_cast<uintptr_t>(ptr);
+  event.bytes = bytes;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Timestamp under the lock so that timestamps are monotonic in the trace
+  event.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start_)
+                          .count();
+  writeLocked(event);
+}
+
+void AllocationTraceWriter::write(const AllocationEvent& event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (event.timestampNs < lastTimestampNs_) {
+    throw std::invalid_argument(
+        "AllocationTraceWriter::write - events must be written "
+        "in timestamp order");
+  }
+  writeLocked(event);
+}
+
+void AllocationTraceWriter::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stream_.flush();
+}
+
+void AllocationTraceWriter::writeLocked(const AllocationEvent& event) {
+  uint8_t tag = static_cast<uint8_t>(event.type);
+  if (event.userLock) {
+    tag |= kUserLockFlag;
+  }
+  stream_.put(static_cast<char>(tag));
+  writeVarint(stream_, event.timestampNs - lastTimestampNs_);
+  writeVarint(stream_, event.device);
+  writeVarint(stream_, event.ptr);
+  if (event.type == AllocationEventType::Alloc) {
+    writeVarint(stream_, event.bytes);
+  }
+  lastTimestampNs_ = event.timestampNs;
+}
+
+AllocationTraceReader::AllocationTraceReader(std::istream& stream)
+    : stream_(stream) {
+  char header[sizeof(kTraceMagic) + 1];
+  if (!stream_.read(header, sizeof(header)) ||
+      !std::equal(kTraceMagic, kTraceMagic + sizeof(kTraceMagic), header)) {
+    throw std::runtime_error(
+        "AllocationTraceReader: stream is not an allocation trace");
+  }
+  if (static_cast<uint8_t>(header[sizeof(kTraceMagic)]) != kTraceVersion) {
+    throw std::runtime_error(
+        "AllocationTraceReader: unsupported trace version " +
+        std::to_string(static_cast<uint8_t>(header[sizeof(kTraceMagic)])));
+  }
+}
+
+bool AllocationTraceReader::next(AllocationEvent& event) {
+  int tag = stream_.get();
+  if (tag == std::char_traits<char>::eof()) {
+    return false;
+  }
+  uint8_t type = static_cast<uint8_t>(tag) & ~kUserLockFlag;
+  if (type > kMaxEventType) {
+    throw std::runtime_error(
+        "AllocationTraceReader: invalid event type " + std::to_string(type));
+  }
+  AllocationEvent result;
+  result.type = static_cast<AllocationEventType>(type);
+  result.userLock = tag & kUserLockFlag;
+  result.timestampNs = lastTimestampNs_ + readVarint(stream_);
+  result.device = static_cast<int>(readVarint(stream_));
+  result.ptr = readVarint(stream_);
+  if (result.type == AllocationEventType::Alloc) {
+    result.bytes = readVarint(stream_);
+  }
+  lastTimestampNs_ = result.timestampNs;
+  event = result;
+  return true;
+}
+
+std::vector<AllocationEvent> loadAllocationTrace(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(
+        "loadAllocationTrace: can't open trace file " + path);
+  }
+  AllocationTraceReader reader(file);
+  std::vector<AllocationEvent> events;
+  AllocationEvent event;
+  while (reader.next(event)) {
+    events.push_back(event);
+  }
+  return events;
+}
+
+} // namespace fl
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fl {
+
+/**
+ * The memory manager call recorded by an `AllocationEvent`.
+ */
+enum class AllocationEventType : uint8_t {
+  Alloc = 0,
+  Unlock = 1,
+  UserLock = 2,
+  UserUnlock = 3,
+  SignalMemoryCleanup = 4,
+};
+
+/**
+ * A single memory manager call in an allocation trace.
+ */
+struct AllocationEvent {
+  AllocationEventType type{AllocationEventType::Alloc};
+  // Whether the memory is user locked (`Alloc` and `Unlock` only)
+  bool userLock{false};
+  // Active device when the call was made
+  int device{0};
+  // Nanoseconds since the start of the trace
+  uint64_t timestampNs{0};
+  // Device pointer returned by (`Alloc`) or passed to the call
+  uint64_t ptr{0};
+  // Number of bytes requested (`Alloc` only)
+  uint64_t bytes{0};
+};
+
+/**
+ * Writes memory manager calls to a stream in a compact binary format: a
+ * header followed by one variable-length record per call. Fields are
+ * varint-encoded and timestamps are stored as deltas from the previous record,
+ * so a typical record takes around 10 bytes.
+ *
+ * Recording is thread-safe; records are written in the order `write` or
+ * `record` is called.
+ */
+class AllocationTraceWriter {
+ public:
+  /**
+   * Constructs a writer and writes the trace header to the stream.
+   *
+   * @param[in] stream the output stream, which must outlive the writer. It
+   * should be opened in binary mode.
+   */
+  explicit AllocationTraceWriter(std::ostream& stream);
+
+  /**
+   * Records a call, timestamped with the time elapsed since the writer was
+   * constructed.
+   */
+  void record(
+      AllocationEventType type,
+      int device,
+      const void* ptr,
+      size_t bytes = 0,
+      bool userLock = false);
+
+  /**
+   * Writes an event with its own timestamp, which must not be earlier than
+   * the previously written one.
+   */
+  void write(const AllocationEvent& event);
+
+  void flush();
+
+ private:
+  void writeLocked(const AllocationEvent& event);
+
+  std::mutex mutex_;
+  std::ostream& stream_;
+  const std::chrono::steady_clock::time_point start_;
+  uint64_t lastTimestampNs_{0};
+};
+
+/**
+ * Reads a trace written by an `AllocationTraceWriter`.
+ */
+class AllocationTraceReader {
+ public:
+  /**
+   * Constructs a reader and validates the trace header.
+   *
+   * @param[in] stream the input stream, which must outlive the reader.
+   */
+  explicit AllocationTraceReader(std::istream& stream);
+
+  /**
+   * Reads the next event.
+   *
+   * @returns false if the end of the trace was reached, in which case `event`
+   * is left unchanged.
+   */
+  bool next(AllocationEvent& event);
+
+ private:
+  std::istream& stream_;
+  uint64_t lastTimestampNs_{0};
+};
+
+/**
+ * Reads all events of the trace file at `path`.
+ */
+std::vector<AllocationEvent> loadAllocationTrace(const std::string& path);
+
+} // namespace fl
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/memory/AllocationTraceReplayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace fl {
+
+namespace {
+
+// Simulated device addresses start here and are aligned to kAddressAlignment
+constexpr uintptr_t kBaseAddress = 0x100000000;
+constexpr size_t kAddressAlignment = 4096;
+
+CallLatencyStats computeLatencyStats(std::vector<double>& latenciesNs) {
+  CallLatencyStats stats;
+  stats.count = latenciesNs.size();
+  if (latenciesNs.empty()) {
+    return stats;
+  }
+  std::sort(latenciesNs.begin(), latenciesNs.end());
+  auto percentile = [&latenciesNs](double p) {
+    size_t idx = std::min(
+        latenciesNs.size() - 1, static_cast<size_t>(p * latenciesNs.size()));
+    return latenciesNs[idx] / 1000.0;
+  };
+  stats.p50Us = percentile(0.5);
+  stats.p90Us = percentile(0.9);
+  stats.p99Us = percentile(0.99);
+  stats.maxUs = latenciesNs.back() / 1000.0;
+  return stats;
+}
+
+std::string formatLatency(const std::string& name, const CallLatencyStats& s) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2) << name << ": " << s.count
+     << " calls, p50 " << s.p50Us << " us, p90 " << s.p90Us << " us, p99 "
+     << s.p99Us << " us, max " << s.maxUs << " us";
+  return ss.str();
+}
+
+double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+struct AllocationTraceReplayer::SimulatedDevice {
+  size_t memoryBytes;
+  int activeDevice{0};
+  uintptr_t nextAddress{kBaseAddress};
+  // address -> (device, bytes)
+  std::unordered_map<uintptr_t, std::pair<int, size_t>> allocations;
+  std::unordered_map<int, size_t> reservedBytes;
+  size_t totalReservedBytes{0};
+  size_t peakReservedBytes{0};
+  size_t mallocs{0};
+  size_t frees{0};
+  float memoryPressureThreshold{1.0};
+
+  explicit SimulatedDevice(size_t bytes) : memoryBytes(bytes) {}
+
+  void* alloc(size_t bytes) {
+    size_t& reserved = reservedBytes[activeDevice];
+    if (reserved + bytes > memoryBytes) {
+      throw std::runtime_error(
+          "AllocationTraceReplayer: simulated device out of memory");
+    }
+    uintptr_t address = nextAddress;
+    size_t span = std::max(bytes, kAddressAlignment);
+    nextAddress += (span + kAddressAlignment - 1) / kAddressAlignment *
+        kAddressAlignment;
+    allocations[address] = std::make_pair(activeDevice, bytes);
+    reserved += bytes;
+    totalReservedBytes += bytes;
+    peakReservedBytes = std::max(peakReservedBytes, totalReservedBytes);
+    ++mallocs;
+    return reinterpret_cast<void*>(address);
+  }
+
+  void free(void* ptr) {
+    auto it = allocations.find(reinterpret_cast<uintptr_t>(ptr));
+    if (it == allocations.end()) {
+      throw std::invalid_argument(
+          "AllocationTraceReplayer: native free of a pointer "
+          "which was not natively allocated");
+    }
+    reservedBytes[it->second.first] -= it->second.second;
+    totalReservedBytes -= it->second.second;
+    allocations.erase(it);
+    ++frees;
+  }
+};
+
+AllocationTraceReplayer::AllocationTraceReplayer(
+    size_t deviceMemoryBytes /* = size_t(1) << 34 */)
+    : device_(std::make_shared<SimulatedDevice>(deviceMemoryBytes)),
+      deviceInterface_(std::make_shared<MemoryManagerDeviceInterface>()) {
+  // Capture the device by value so the interface stays valid if it outlives
+  // the replayer
+  auto device = device_;
+  deviceInterface_->getActiveDeviceId = [device]() {
+    return device->activeDevice;
+  };
+  deviceInterface_->getMaxMemorySize = [device](int /* id */) {
+    return device->memoryBytes;
+  };
+  deviceInterface_->nativeAlloc = [device](size_t bytes) {
+    return device->alloc(bytes);
+  };
+  deviceInterface_->nativeFree = [device](void* ptr) { device->free(ptr); };
+  deviceInterface_->getMemoryPressureThreshold = [device]() {
+    return device->memoryPressureThreshold;
+  };
+  deviceInterface_->setMemoryPressureThreshold = [device](float pressure) {
+    device->memoryPressureThreshold = pressure;
+  };
+}
+
+std::shared_ptr<MemoryManagerDeviceInterface>
+AllocationTraceReplayer::getDeviceInterface() const {
+  return deviceInterface_;
+}
+
+AllocationReplayStats AllocationTraceReplayer::replay(
+    const std::vector<AllocationEvent>& trace,
+    MemoryManagerAdapter& manager) {
+  if (manager.deviceInterface != deviceInterface_) {
+    throw std::invalid_argument(
+        "AllocationTraceReplayer::replay - memory manager must be constructed "
+        "with the replayer's device interface");
+  }
+
+  struct LiveBlock {
+    void* ptr;
+    size_t bytes;
+    bool managerLock;
+    bool userLock;
+  };
+  // traced pointer -> block allocated during the replay
+  std::unordered_map<uint64_t, LiveBlock> liveBlocks;
+  size_t liveBytes = 0;
+
+  AllocationReplayStats stats;
+  stats.numEvents = trace.size();
+  const size_t mallocsBefore = device_->mallocs;
+  const size_t freesBefore = device_->frees;
+  device_->peakReservedBytes = device_->totalReservedBytes;
+
+  std::vector<double> allocNs, unlockNs;
+  size_t peakReserved = 0;
+  double fragmentationSum = 0;
+  size_t fragmentationSamples = 0;
+
+  // Updates lock flags from an unlock and drops the block once fully unlocked
+  auto release = [&](const AllocationEvent& event, bool userUnlock) {
+    auto it = liveBlocks.find(event.ptr);
+    if (it == liveBlocks.end()) {
+      ++stats.unmatchedEvents;
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    manager.unlock(it->second.ptr, userUnlock);
+    unlockNs.push_back(elapsedNs(start));
+    if (userUnlock) {
+      it->second.userLock = false;
+    } else {
+      it->second.managerLock = false;
+    }
+    if (!it->second.managerLock && !it->second.userLock) {
+      liveBytes -= it->second.bytes;
+      liveBlocks.erase(it);
+    }
+  };
+
+  manager.initialize();
+  for (const auto& event : trace) {
+    device_->activeDevice = event.device;
+    switch (event.type) {
+      case AllocationEventType::Alloc: {
+        dim_t bytes = event.bytes;
+        void* ptr = nullptr;
+        auto start = std::chrono::steady_clock::now();
+        try {
+          ptr = manager.alloc(event.userLock, 1, &bytes, 1);
+        } catch (const std::exception&) {
+          ++stats.failedAllocs;
+          continue;
+        }
+        allocNs.push_back(elapsedNs(start));
+        if (event.ptr && ptr) {
+          liveBlocks[event.ptr] = {
+              ptr, event.bytes, !event.userLock, event.userLock};
+          liveBytes += event.bytes;
+          stats.peakLiveBytes = std::max(stats.peakLiveBytes, liveBytes);
+        }
+        size_t reserved = device_->totalReservedBytes;
+        if (reserved > 0) {
+          double fragmentation =
+              1.0 - static_cast<double>(liveBytes) / reserved;
+          fragmentationSum += fragmentation;
+          ++fragmentationSamples;
+          if (reserved > peakReserved) {
+            peakReserved = reserved;
+            stats.fragmentationAtPeak = fragmentation;
+          }
+        }
+        break;
+      }
+      case AllocationEventType::Unlock:
+        release(event, event.userLock);
+        break;
+      case AllocationEventType::UserUnlock:
+        release(event, true);
+        break;
+      case AllocationEventType::UserLock: {
+        auto it = liveBlocks.find(event.ptr);
+        if (it == liveBlocks.end()) {
+          ++stats.unmatchedEvents;
+          break;
+        }
+        manager.userLock(it->second.ptr);
+        it->second.userLock = true;
+        break;
+      }
+      case AllocationEventType::SignalMemoryCleanup:
+        manager.signalMemoryCleanup();
+        break;
+    }
+  }
+
+  stats.peakReservedBytes = device_->peakReservedBytes;
+  stats.meanFragmentation = fragmentationSamples > 0
+      ? fragmentationSum / fragmentationSamples
+      : 0.0;
+  stats.nativeMallocs = device_->mallocs - mallocsBefore;
+  stats.nativeFrees = device_->frees - freesBefore;
+  stats.allocLatency = computeLatencyStats(allocNs);
+  stats.unlockLatency = computeLatencyStats(unlockNs);
+  return stats;
+}
+
+std::string AllocationReplayStats::prettyString() const {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  ss << "Events: " << numEvents << " (failed allocs: " << failedAllocs
+     << ", unmatched: " << unmatchedEvents << ")\n";
+  ss << "Peak reserved: " << peakReservedBytes / (1024.0 * 1024.0)
+     << " MiB, peak live: " << peakLiveBytes / (1024.0 * 1024.0) << " MiB\n";
+  ss << "Fragmentation: " << 100.0 * fragmentationAtPeak << "% at peak, "
+     << 100.0 * meanFragmentation << "% mean\n";
+  ss << "Native calls: " << nativeMallocs << " (mallocs), " << nativeFrees
+     << " (frees)\n";
+  ss << formatLatency("alloc", allocLatency) << "\n";
+  ss << formatLatency("unlock", unlockLatency);
+  return ss.str();
+}
+
+} // namespace fl
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flashlight/flashlight/memory/AllocationTrace.h"
+#include "flashlight/flashlight/memory/MemoryManagerAdapter.h"
+#include "flashlight/flashlight/memory/MemoryManagerDeviceInterface.h"
+
+namespace fl {
+
+/**
+ * Latency percentiles of a memory manager call, in microseconds.
+ */
+struct CallLatencyStats {
+  size_t count{0};
+  double p50Us{0};
+  double p90Us{0};
+  double p99Us{0};
+  double maxUs{0};
+};
+
+/**
+ * Statistics collected while replaying an allocation trace.
+ */
+struct AllocationReplayStats {
+  size_t numEvents{0};
+  // Allocations for which the memory manager threw
+  size_t failedAllocs{0};
+  // Unlock or user lock calls on pointers not allocated in the trace
+  size_t unmatchedEvents{0};
+  // Peak bytes obtained from the (simulated) device
+  size_t peakReservedBytes{0};
+  // Peak bytes requested by allocations which were not released yet
+  size_t peakLiveBytes{0};
+  // 1 - live / reserved bytes when reserved bytes peaked
+  double fragmentationAtPeak{0};
+  // 1 - live / reserved bytes averaged over all allocations
+  double meanFragmentation{0};
+  size_t nativeMallocs{0};
+  size_t nativeFrees{0};
+  CallLatencyStats allocLatency;
+  CallLatencyStats unlockLatency;
+
+  std::string prettyString() const;
+};
+
+/**
+ * Replays an allocation trace recorded by a `MemoryManagerAdapter` (see
+ * `MemoryManagerAdapter::setTraceStream`) against any memory manager
+ * implementation, without ArrayFire or a device.
+ *
+ * The replayer simulates the device: native allocations return distinct,
+ * never dereferenced addresses, and fail once the simulated device memory is
+ * exhausted. The memory manager to replay must be constructed with the
+ * replayer's device interface:
+ *
+ * \code
+   AllocationTraceReplayer replayer;
+   CachingMemoryManager manager(1, replayer.getDeviceInterface());
+   auto stats = replayer.replay(loadAllocationTrace(path), manager);
+   std::cout << stats.prettyString() << std::endl;
+ * \endcode
+ *
+ * Calls are replayed sequentially in trace order, as fast as possible.
+ */
+class AllocationTraceReplayer {
+ public:
+  /**
+   * @param[in] deviceMemoryBytes memory available on each simulated device
+   */
+  explicit AllocationTraceReplayer(
+      size_t deviceMemoryBytes = size_t(1) << 34);
+
+  std::shared_ptr<MemoryManagerDeviceInterface> getDeviceInterface() const;
+
+  /**
+   * Initializes the memory manager and replays the trace on it. Blocks left
+   * allocated by the trace are not released, so the manager can be inspected
+   * afterwards.
+   */
+  AllocationReplayStats replay(
+      const std::vector<AllocationEvent>& trace,
+      MemoryManagerAdapter& manager);
+
+ private:
+  struct SimulatedDevice;
+
+  std::shared_ptr<SimulatedDevice> device_;
+  std::shared_ptr<MemoryManagerDeviceInterface> deviceInterface_;
+};
+
+} // namespace fl
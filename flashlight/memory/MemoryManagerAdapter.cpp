@@ -10,6 +10,7 @@
 #include <stdexcept>
 #include <utility>
 
+#include "flashlight/flashlight/common/CppBackports.h"
 #include "flashlight/flashlight/common/Utils.h"
 
 namespace fl {
@@ -38,6 +39,9 @@ MemoryManagerAdapter::~MemoryManagerAdapter() {
     *logStream_ << logStreamBuffer_.str();
     logStream_->flush();
   }
+  if (traceWriter_) {
+    traceWriter_->flush();
+  }
 
   if (interface_) {
     af_release_memory_manager(interface_); // nothrow
@@ -61,6 +65,28 @@ void MemoryManagerAdapter::setLogFlushInterval(size_t interval) {
   logFlushInterval_ = interval;
 }
 
+void MemoryManagerAdapter::setTraceStream(std::ostream* traceStream) {
+  if (traceWriter_) {
+    traceWriter_->flush();
+  }
+  traceWriter_ = traceStream
+      ? fl::cpp::make_unique<AllocationTraceWriter>(*traceStream)
+      : nullptr;
+}
+
+void MemoryManagerAdapter::trace(
+    AllocationEventType type,
+    const void* ptr /* = nullptr */,
+    size_t bytes /* = 0 */,
+    bool userLock /* = false */) {
+  if (traceWriter_) {
+    int device = deviceInterface->getActiveDeviceId
+        ? deviceInterface->getActiveDeviceId()
+        : 0;
+    traceWriter_->record(type, device, ptr, bytes, userLock);
+  }
+}
+
 af_memory_manager MemoryManagerAdapter::getHandle() const {
   return interface_;
 }
@@ -16,6 +16,7 @@
 #include <stdexcept>
 #include <string>
 
+#include "flashlight/flashlight/memory/AllocationTrace.h"
 #include "flashlight/flashlight/memory/MemoryManagerDeviceInterface.h"
 
 namespace fl {
@@ -39,6 +40,8 @@ const size_t kDefaultLogFlushInterval = 50;
  * - Provides logging functions and a logging mode which logs all function calls
  *   from ArrayFire and all relevant arguments. Only virtual base class methods
  *   that have derived implementations are eligible for logging.
+ * - Optionally records allocation calls to a compact binary trace which can be
+ *   replayed against any implementation with an `AllocationTraceReplayer`.
  * - The `MemoryManagerInstaller` provides an interface for setting implemented
  *   memory managers as the active ArrayFire memory managers by setting relevant
  *   callbacks on construction.
@@ -127,6 +130,31 @@ class MemoryManagerAdapter {
    */
   void setLogFlushInterval(size_t interval);
 
+  /**
+   * Sets a stream to which alloc, unlock, userLock, userUnlock and
+   * signalMemoryCleanup calls from ArrayFire are recorded in the binary format
+   * of `AllocationTraceWriter`. Passing a null stream stops recording.
+   *
+   * @param[in] traceStream the output stream to record to, opened in binary
+   * mode. It must remain valid until recording is stopped or the adapter is
+   * destroyed.
+   */
+  void setTraceStream(std::ostream* traceStream);
+
+  /**
+   * Records a call to the trace stream, if one is set.
+   *
+   * @param[in] type the recorded call
+   * @param[in] ptr the pointer returned by or passed to the call
+   * @param[in] bytes the number of bytes requested for an allocation
+   * @param[in] userLock whether the memory is user locked
+   */
+  void trace(
+      AllocationEventType type,
+      const void* ptr = nullptr,
+      size_t bytes = 0,
+      bool userLock = false);
+
   /**
    * Returns the ArrayFire handle for this memory manager.
    *
@@ -148,6 +176,9 @@ class MemoryManagerAdapter {
   std::stringstream logStreamBuffer_;
   size_t logStreamBufferSize_{0}; // in number of lines
   size_t logFlushInterval_{kDefaultLogFlushInterval};
+
+  // Allocation trace recording
+  std::unique_ptr<AllocationTraceWriter> traceWriter_;
 };
 
 template <typename... Values>
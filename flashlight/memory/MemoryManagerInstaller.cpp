@@ -94,6 +94,11 @@ MemoryManagerInstaller::MemoryManagerInstaller(
         /* size */ dims[0], // HACK: dims[0] until af::memAlloc is size-aware
         userLock,
         (std::uintptr_t)ptr);
+    size_t bytes = elSize;
+    for (unsigned i = 0; i < ndims; ++i) {
+      bytes *= dims[i];
+    }
+    m->trace(AllocationEventType::Alloc, *ptr, bytes, userLock);
     return AF_SUCCESS;
   };
   AF_CHECK(af_memory_manager_set_alloc_fn(itf, allocFn));
@@ -107,6 +112,7 @@ MemoryManagerInstaller::MemoryManagerInstaller(
   auto unlockFn = [](af_memory_manager manager, void* ptr, int userLock) {
     MemoryManagerAdapter* m = MemoryManagerInstaller::getImpl(manager);
     m->log("unlock", (std::uintptr_t)ptr, userLock);
+    m->trace(AllocationEventType::Unlock, ptr, 0, userLock);
     m->unlock(ptr, (bool)userLock);
     return AF_SUCCESS;
   };
@@ -114,6 +120,7 @@ MemoryManagerInstaller::MemoryManagerInstaller(
   auto signalMemoryCleanupFn = [](af_memory_manager manager) {
     MemoryManagerAdapter* m = MemoryManagerInstaller::getImpl(manager);
     m->log("signalMemoryCleanup");
+    m->trace(AllocationEventType::SignalMemoryCleanup);
     m->signalMemoryCleanup();
     return AF_SUCCESS;
   };
@@ -128,6 +135,7 @@ MemoryManagerInstaller::MemoryManagerInstaller(
   auto userLockFn = [](af_memory_manager manager, void* ptr) {
     MemoryManagerAdapter* m = MemoryManagerInstaller::getImpl(manager);
     m->log("userLock", (std::uintptr_t)ptr);
+    m->trace(AllocationEventType::UserLock, ptr);
     m->userLock(ptr);
     return AF_SUCCESS;
   };
@@ -135,6 +143,7 @@ MemoryManagerInstaller::MemoryManagerInstaller(
   auto userUnlockFn = [](af_memory_manager manager, void* ptr) {
     MemoryManagerAdapter* m = MemoryManagerInstaller::getImpl(manager);
     m->log("userUnlock", (std::uintptr_t)ptr);
+    m->trace(AllocationEventType::UserUnlock, ptr);
     MemoryManagerInstaller::getImpl(manager)->userUnlock(ptr);
     return AF_SUCCESS;
   };
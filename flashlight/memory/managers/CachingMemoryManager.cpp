@@ -9,10 +9,13 @@
 #include <arrayfire.h> // Needed for af exception
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "flashlight/flashlight/common/CppBackports.h"
@@ -30,6 +33,13 @@ constexpr size_t kLargeBuffer =
 constexpr size_t kMinLargeAlloc =
     10485760; // allocations between 1 and 10 MiB may use kLargeBuffer
 constexpr size_t kRoundLarge = 2097152; // round up large allocs to 2 MiB
+constexpr size_t kMaxThreadCachedSize =
+    65536; // blocks up to 64 KiB may be cached per thread
+constexpr size_t kMaxThreadCacheBytes =
+    4194304; // a thread caches at most 4 MiB per device
+constexpr size_t kBlockSlabSize = 256; // Block metadata allocated by 256
+
+std::atomic<uint64_t> nextDeviceMemoryInfoUid(0);
 
 size_t roundSize(size_t size) {
   if (size < kMinBlockSize) {
@@ -58,6 +68,19 @@ static bool BlockComparator(
   return (uintptr_t)a->ptr_ < (uintptr_t)b->ptr_;
 }
 
+size_t lowestSetBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  size_t i = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    ++i;
+  }
+  return i;
+#endif
+}
+
 std::string formatMemory(size_t bytes) {
   const std::vector<std::string> units = {"B", "KiB", "MiB", "GiB", "TiB"};
   size_t unitId =
@@ -70,10 +93,101 @@ std::string formatMemory(size_t bytes) {
 
 } // namespace
 
+constexpr size_t CachingMemoryManager::kNumBlockMapShards;
+
+CachingMemoryManager::BlockBins::BlockBins(size_t maxSize)
+    : bins_(maxSize / kMinBlockSize + 1, nullptr),
+      nonEmpty_((bins_.size() + 63) / 64, 0) {}
+
+void CachingMemoryManager::BlockBins::insert(Block* block) {
+  size_t bin = block->size_ / kMinBlockSize;
+  if (bin >= bins_.size()) {
+    throw std::runtime_error("block too large for BlockBins");
+  }
+  block->binPrev_ = nullptr;
+  block->binNext_ = bins_[bin];
+  if (bins_[bin]) {
+    bins_[bin]->binPrev_ = block;
+  }
+  bins_[bin] = block;
+  nonEmpty_[bin / 64] |= (uint64_t(1) << (bin % 64));
+}
+
+void CachingMemoryManager::BlockBins::erase(Block* block) {
+  size_t bin = block->size_ / kMinBlockSize;
+  if (block->binPrev_) {
+    block->binPrev_->binNext_ = block->binNext_;
+  } else {
+    bins_[bin] = block->binNext_;
+  }
+  if (block->binNext_) {
+    block->binNext_->binPrev_ = block->binPrev_;
+  }
+  block->binPrev_ = nullptr;
+  block->binNext_ = nullptr;
+  if (!bins_[bin]) {
+    nonEmpty_[bin / 64] &= ~(uint64_t(1) << (bin % 64));
+  }
+}
+
+CachingMemoryManager::Block* CachingMemoryManager::BlockBins::extract(
+    size_t size) {
+  size_t bin = size / kMinBlockSize;
+  size_t word = bin / 64;
+  if (word >= nonEmpty_.size()) {
+    return nullptr;
+  }
+  uint64_t bits = nonEmpty_[word] & (~uint64_t(0) << (bin % 64));
+  while (bits == 0) {
+    if (++word == nonEmpty_.size()) {
+      return nullptr;
+    }
+    bits = nonEmpty_[word];
+  }
+  Block* block = bins_[word * 64 + lowestSetBit(bits)];
+  erase(block);
+  return block;
+}
+
+std::vector<CachingMemoryManager::Block*>
+CachingMemoryManager::BlockBins::blocks() const {
+  std::vector<Block*> result;
+  for (auto* block : bins_) {
+    for (; block; block = block->binNext_) {
+      result.push_back(block);
+    }
+  }
+  return result;
+}
+
+CachingMemoryManager::Block* CachingMemoryManager::BlockPool::acquire(
+    size_t size,
+    void* ptr) {
+  if (free_.empty()) {
+    slabs_.emplace_back(new Block[kBlockSlabSize]);
+    for (size_t i = 0; i < kBlockSlabSize; ++i) {
+      free_.push_back(&slabs_.back()[i]);
+    }
+  }
+  Block* block = free_.back();
+  free_.pop_back();
+  *block = Block(size, ptr);
+  return block;
+}
+
+void CachingMemoryManager::BlockPool::release(Block* block) {
+  free_.push_back(block);
+}
+
+CachingMemoryManager::ThreadCache::ThreadCache()
+    : bins_(kMaxThreadCachedSize / kMinBlockSize + 1), bytes_(0) {}
+
 CachingMemoryManager::DeviceMemoryInfo::DeviceMemoryInfo(int id)
     : deviceId_(id),
+      uid_(nextDeviceMemoryInfoUid++),
       largeBlocks_(BlockComparator),
-      smallBlocks_(BlockComparator) {}
+      smallBlocks_(kSmallBuffer),
+      threadCachedBytes_(0) {}
 
 CachingMemoryManager::CachingMemoryManager(
     int numDevices,
@@ -113,56 +227,68 @@ void* CachingMemoryManager::alloc(
     dim_t* dims,
     const unsigned elementSize) {
   auto& memoryInfo = getDeviceMemoryInfo();
-  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
   size_t size = elementSize;
   for (unsigned i = 0; i < ndims; ++i) {
     size *= dims[i];
   }
   size = roundSize(size);
-  const bool isSmallAlloc = (size <= kSmallSize);
-  CachingMemoryManager::Block searchKey(size);
-  CachingMemoryManager::BlockSet& pool =
-      isSmallAlloc ? memoryInfo.smallBlocks_ : memoryInfo.largeBlocks_;
 
   CachingMemoryManager::Block* block = nullptr;
-  auto it = pool.lower_bound(&searchKey);
-  if (it != pool.end()) {
-    block = *it;
-    pool.erase(it);
-    memoryInfo.stats_.cachedBytes_ -= block->size_;
-  } else {
-    void* ptr = nullptr;
-    size_t allocSize = getAllocationSize(size);
-    mallocWithRetry(allocSize, &ptr); // could throw
-    block = new Block(allocSize, ptr);
-    memoryInfo.stats_.allocatedBytes_ += allocSize;
-  }
-
-  // If the block is larger than the requested size to handle another
-  // allocation in the same large or small BlockSet, it will be split into two.
-  // Note that we don't split a small stepsize out of a large one to keep the
-  // implementation simple.
-  CachingMemoryManager::Block* remaining = nullptr;
-  size_t diff = block->size_ - size;
-  if (diff >= (isSmallAlloc ? kMinBlockSize : kSmallSize)) {
-    remaining = block;
-    block = new Block(size, block->ptr_);
-    block->prev_ = remaining->prev_;
-    if (block->prev_) {
-      block->prev_->next_ = block;
+  if (size <= kMaxThreadCachedSize) {
+    block = popThreadCache(memoryInfo, size);
+  }
+
+  if (!block) {
+    std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
+    const bool isSmallAlloc = (size <= kSmallSize);
+    if (isSmallAlloc) {
+      block = memoryInfo.smallBlocks_.extract(size);
+      if (block) {
+        block->free_ = false;
+        memoryInfo.stats_.cachedBytes_ -= block->size_;
+      }
+    } else {
+      CachingMemoryManager::Block searchKey(size);
+      auto it = memoryInfo.largeBlocks_.lower_bound(&searchKey);
+      if (it != memoryInfo.largeBlocks_.end()) {
+        block = *it;
+        eraseFreeBlock(block, isSmallAlloc);
+      }
+    }
+    if (!block) {
+      void* ptr = nullptr;
+      size_t allocSize = getAllocationSize(size);
+      mallocWithRetry(allocSize, &ptr); // could throw
+      block = memoryInfo.blockPool_.acquire(allocSize, ptr);
+      memoryInfo.stats_.allocatedBytes_ += allocSize;
     }
-    block->next_ = remaining;
 
-    remaining->prev_ = block;
-    remaining->ptr_ = static_cast<char*>(remaining->ptr_) + size;
-    remaining->size_ -= size;
-    pool.insert(remaining);
-    memoryInfo.stats_.cachedBytes_ += remaining->size_;
+    // If the block is larger than the requested size to handle another
+    // allocation in the same large or small pool, it will be split into two.
+    // Note that we don't split a small stepsize out of a large one to keep
+    // the implementation simple.
+    size_t diff = block->size_ - size;
+    if (diff >= (isSmallAlloc ? kMinBlockSize : kSmallSize)) {
+      CachingMemoryManager::Block* remaining = block;
+      block = memoryInfo.blockPool_.acquire(size, block->ptr_);
+      block->prev_ = remaining->prev_;
+      if (block->prev_) {
+        block->prev_->next_ = block;
+      }
+      block->next_ = remaining;
+
+      remaining->prev_ = block;
+      remaining->ptr_ = static_cast<char*>(remaining->ptr_) + size;
+      remaining->size_ -= size;
+      insertFreeBlock(remaining, isSmallAlloc);
+    }
   }
 
   block->managerLock_ = !userLock;
   block->userLock_ = userLock;
-  memoryInfo.allocatedBlocks_[block->ptr_] = block;
+  auto& shard = getShard(memoryInfo, block->ptr_);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  shard.blocks_[block->ptr_] = block;
   return static_cast<void*>(block->ptr_);
 }
 
@@ -171,41 +297,51 @@ size_t CachingMemoryManager::allocated(void* ptr) {
     return 0;
   }
   auto& memoryInfo = getDeviceMemoryInfo();
-  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
-  auto it = memoryInfo.allocatedBlocks_.find(ptr);
-  if (it == memoryInfo.allocatedBlocks_.end()) {
+  auto& shard = getShard(memoryInfo, ptr);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  auto it = shard.blocks_.find(ptr);
+  if (it == shard.blocks_.end()) {
     return 0;
   }
   return (it->second)->size_;
 }
 
 void CachingMemoryManager::unlock(void* ptr, bool userUnlock) {
-  auto& memoryInfo = getDeviceMemoryInfo();
-  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
   if (!ptr) {
     return;
   }
-  auto it = memoryInfo.allocatedBlocks_.find(ptr);
-  if (it == memoryInfo.allocatedBlocks_.end()) {
+  auto& memoryInfo = getDeviceMemoryInfo();
+  CachingMemoryManager::Block* block = nullptr;
+  {
+    auto& shard = getShard(memoryInfo, ptr);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto it = shard.blocks_.find(ptr);
+    if (it != shard.blocks_.end()) {
+      block = it->second;
+      if (userUnlock) {
+        block->userLock_ = false;
+      } else {
+        block->managerLock_ = false;
+      }
+
+      // Return early if either one is locked
+      if (block->inUse()) {
+        return;
+      }
+      shard.blocks_.erase(it);
+    }
+  }
+
+  if (!block) {
     // Probably came from user, just free it
+    std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
     this->deviceInterface->nativeFree(ptr);
     ++memoryInfo.stats_.totalNativeFrees_;
     return;
   }
-
-  CachingMemoryManager::Block* block = it->second;
-  if (userUnlock) {
-    block->userLock_ = false;
-  } else {
-    block->managerLock_ = false;
-  }
-
-  // Return early if either one is locked
-  if (block->inUse()) {
-    return;
+  if (!pushThreadCache(memoryInfo, block)) {
+    freeBlock(block);
   }
-  memoryInfo.allocatedBlocks_.erase(it);
-  freeBlock(block);
 }
 
 void CachingMemoryManager::freeBlock(CachingMemoryManager::Block* block) {
@@ -216,23 +352,47 @@ void CachingMemoryManager::freeBlock(CachingMemoryManager::Block* block) {
   std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
 
   const bool isSmallAlloc = (block->size_ <= kSmallSize);
-  CachingMemoryManager::BlockSet& pool =
-      isSmallAlloc ? memoryInfo.smallBlocks_ : memoryInfo.largeBlocks_;
-  tryMergeBlocks(block, block->prev_, pool);
-  tryMergeBlocks(block, block->next_, pool);
+  tryMergeBlocks(block, block->prev_, isSmallAlloc);
+  tryMergeBlocks(block, block->next_, isSmallAlloc);
+  insertFreeBlock(block, isSmallAlloc);
+}
 
-  pool.insert(block);
+void CachingMemoryManager::insertFreeBlock(
+    CachingMemoryManager::Block* block,
+    bool isSmall) {
+  auto& memoryInfo = getDeviceMemoryInfo();
+  if (isSmall) {
+    memoryInfo.smallBlocks_.insert(block);
+  } else {
+    memoryInfo.largeBlocks_.insert(block);
+  }
+  block->free_ = true;
   memoryInfo.stats_.cachedBytes_ += block->size_;
 }
 
+void CachingMemoryManager::eraseFreeBlock(
+    CachingMemoryManager::Block* block,
+    bool isSmall) {
+  auto& memoryInfo = getDeviceMemoryInfo();
+  if (isSmall) {
+    memoryInfo.smallBlocks_.erase(block);
+  } else {
+    memoryInfo.largeBlocks_.erase(block);
+  }
+  block->free_ = false;
+  memoryInfo.stats_.cachedBytes_ -= block->size_;
+}
+
 /** combine previously split blocks */
 void CachingMemoryManager::tryMergeBlocks(
     CachingMemoryManager::Block* dst,
     CachingMemoryManager::Block* src,
-    BlockSet& pool) {
-  if (!src || src->inUse()) {
+    bool isSmall) {
+  // Blocks in use or held in a thread cache are not free
+  if (!src || !src->free_) {
     return;
   }
+  eraseFreeBlock(src, isSmall);
   if (dst->prev_ == src) {
     dst->ptr_ = src->ptr_;
     dst->prev_ = src->prev_;
@@ -246,9 +406,100 @@ void CachingMemoryManager::tryMergeBlocks(
     }
   }
   dst->size_ += src->size_;
-  pool.erase(src);
-  getDeviceMemoryInfo().stats_.cachedBytes_ -= src->size_;
-  delete src;
+  getDeviceMemoryInfo().blockPool_.release(src);
+}
+
+CachingMemoryManager::BlockMapShard& CachingMemoryManager::getShard(
+    DeviceMemoryInfo& memoryInfo,
+    const void* ptr) {
+  auto key = reinterpret_cast<uintptr_t>(ptr) / kMinBlockSize;
+  return memoryInfo.allocatedBlocks_[key % kNumBlockMapShards];
+}
+
+CachingMemoryManager::ThreadCache& CachingMemoryManager::getThreadCache(
+    DeviceMemoryInfo& memoryInfo) {
+  // Keyed by uid rather than address, as a DeviceMemoryInfo may be re-created
+  // at the same address. Caches are shared with the DeviceMemoryInfo, which
+  // reclaims their blocks on cleanup, including after the thread exits.
+  static thread_local std::
+      unordered_map<uint64_t, std::shared_ptr<ThreadCache>>
+          caches;
+  static thread_local uint64_t lastUid = ~uint64_t(0);
+  static thread_local ThreadCache* lastCache = nullptr;
+  if (lastCache && lastUid == memoryInfo.uid_) {
+    return *lastCache;
+  }
+  auto& cache = caches[memoryInfo.uid_];
+  if (!cache) {
+    cache = std::make_shared<ThreadCache>();
+    std::lock_guard<std::mutex> lock(memoryInfo.threadCachesMutex_);
+    memoryInfo.threadCaches_.push_back(cache);
+  }
+  lastUid = memoryInfo.uid_;
+  lastCache = cache.get();
+  return *cache;
+}
+
+CachingMemoryManager::Block* CachingMemoryManager::popThreadCache(
+    DeviceMemoryInfo& memoryInfo,
+    size_t size) {
+  auto& cache = getThreadCache(memoryInfo);
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  auto& bin = cache.bins_[size / kMinBlockSize];
+  if (bin.empty()) {
+    return nullptr;
+  }
+  Block* block = bin.back();
+  bin.pop_back();
+  cache.bytes_ -= block->size_;
+  memoryInfo.threadCachedBytes_ -= block->size_;
+  return block;
+}
+
+bool CachingMemoryManager::pushThreadCache(
+    DeviceMemoryInfo& memoryInfo,
+    CachingMemoryManager::Block* block) {
+  if (block->size_ > kMaxThreadCachedSize) {
+    return false;
+  }
+  auto& cache = getThreadCache(memoryInfo);
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  if (cache.bytes_ + block->size_ > kMaxThreadCacheBytes) {
+    return false;
+  }
+  cache.bins_[block->size_ / kMinBlockSize].push_back(block);
+  cache.bytes_ += block->size_;
+  memoryInfo.threadCachedBytes_ += block->size_;
+  return true;
+}
+
+void CachingMemoryManager::drainThreadCaches(DeviceMemoryInfo& memoryInfo) {
+  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
+  std::vector<Block*> blocks;
+  {
+    std::lock_guard<std::mutex> cachesLock(memoryInfo.threadCachesMutex_);
+    for (auto& cache : memoryInfo.threadCaches_) {
+      std::lock_guard<std::mutex> cacheLock(cache->mutex_);
+      for (auto& bin : cache->bins_) {
+        blocks.insert(blocks.end(), bin.begin(), bin.end());
+        bin.clear();
+      }
+      memoryInfo.threadCachedBytes_ -= cache->bytes_;
+      cache->bytes_ = 0;
+    }
+    // Caches of exited threads are only referenced here
+    memoryInfo.threadCaches_.erase(
+        std::remove_if(
+            memoryInfo.threadCaches_.begin(),
+            memoryInfo.threadCaches_.end(),
+            [](const std::shared_ptr<ThreadCache>& cache) {
+              return cache.use_count() == 1;
+            }),
+        memoryInfo.threadCaches_.end());
+  }
+  for (auto* block : blocks) {
+    freeBlock(block);
+  }
 }
 
 void CachingMemoryManager::mallocWithRetry(size_t size, void** ptr) {
@@ -271,7 +522,10 @@ void CachingMemoryManager::mallocWithRetry(size_t size, void** ptr) {
                        memInfo.deviceId_))
                 << ", Allocated: "
                 << formatMemory(memInfo.stats_.allocatedBytes_)
-                << ", Cached: " << formatMemory(memInfo.stats_.cachedBytes_)
+                << ", Cached: "
+                << formatMemory(
+                       memInfo.stats_.cachedBytes_ +
+                       memInfo.threadCachedBytes_)
                 << ") with error '" << ex.what() << "'" << std::endl;
       // note: converting here an af exception to std exception prevents to
       // catch the af error code at the user level. Rethrowing.
@@ -281,24 +535,17 @@ void CachingMemoryManager::mallocWithRetry(size_t size, void** ptr) {
 }
 
 void CachingMemoryManager::freeBlocks(
-    BlockSet& blocks,
-    BlockSet::iterator it,
-    BlockSet::iterator end) {
-  // Frees all non-split blocks between `it` and `end`
+    const std::vector<Block*>& blocks,
+    bool isSmall) {
+  // Frees all non-split blocks
   auto& memoryInfo = getDeviceMemoryInfo();
-  while (it != end) {
-    Block* block = *it;
+  for (auto* block : blocks) {
     if (!block->isSplit()) {
       this->deviceInterface->nativeFree(static_cast<void*>(block->ptr_));
       ++memoryInfo.stats_.totalNativeFrees_;
       memoryInfo.stats_.allocatedBytes_ -= block->size_;
-      memoryInfo.stats_.cachedBytes_ -= block->size_;
-      auto cur = it;
-      ++it;
-      blocks.erase(cur);
-      delete block;
-    } else {
-      ++it;
+      eraseFreeBlock(block, isSmall);
+      memoryInfo.blockPool_.release(block);
     }
   }
 }
@@ -308,15 +555,14 @@ void CachingMemoryManager::signalMemoryCleanup() {
   auto& memoryInfo = getDeviceMemoryInfo();
   std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
 
-  freeBlocks(
-      memoryInfo.largeBlocks_,
-      memoryInfo.largeBlocks_.begin(),
-      memoryInfo.largeBlocks_.end());
+  drainThreadCaches(memoryInfo);
 
   freeBlocks(
-      memoryInfo.smallBlocks_,
-      memoryInfo.smallBlocks_.begin(),
-      memoryInfo.smallBlocks_.end());
+      std::vector<Block*>(
+          memoryInfo.largeBlocks_.begin(), memoryInfo.largeBlocks_.end()),
+      false);
+
+  freeBlocks(memoryInfo.smallBlocks_.blocks(), true);
 }
 
 float CachingMemoryManager::getMemoryPressure() {
@@ -337,7 +583,9 @@ void CachingMemoryManager::printInfo(const char* msg, const int /* unused */) {
             << formatMemory(
                    this->deviceInterface->getMaxMemorySize(memInfo.deviceId_))
             << ", Allocated: " << formatMemory(memInfo.stats_.allocatedBytes_)
-            << ", Cached: " << formatMemory(memInfo.stats_.cachedBytes_);
+            << ", Cached: "
+            << formatMemory(
+                   memInfo.stats_.cachedBytes_ + memInfo.threadCachedBytes_);
   std::cout << "\nTotal native calls: " << memInfo.stats_.totalNativeMallocs_
             << "(mallocs), " << memInfo.stats_.totalNativeFrees_ << "(frees)"
             << std::endl;
@@ -348,15 +596,21 @@ void CachingMemoryManager::userLock(const void* ptr) {
     return;
   }
   auto& memoryInfo = getDeviceMemoryInfo();
-  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
+  auto& shard = getShard(memoryInfo, ptr);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
 
-  auto it = memoryInfo.allocatedBlocks_.find(const_cast<void*>(ptr));
-  if (it == memoryInfo.allocatedBlocks_.end()) {
+  auto it = shard.blocks_.find(const_cast<void*>(ptr));
+  if (it == shard.blocks_.end()) {
     // Follows the behavior of DefaultMemoryManager
-    auto block = new Block(kSmallBuffer, const_cast<void*>(ptr));
+    CachingMemoryManager::Block* block = nullptr;
+    {
+      std::lock_guard<std::recursive_mutex> poolLock(memoryInfo.mutexAll_);
+      block =
+          memoryInfo.blockPool_.acquire(kSmallBuffer, const_cast<void*>(ptr));
+    }
     block->managerLock_ = false;
     block->userLock_ = true;
-    memoryInfo.allocatedBlocks_[block->ptr_] = block;
+    shard.blocks_[block->ptr_] = block;
   } else {
     it->second->userLock_ = true;
   }
@@ -371,9 +625,10 @@ bool CachingMemoryManager::isUserLocked(const void* ptr) {
     return false;
   }
   auto& memoryInfo = getDeviceMemoryInfo();
-  std::lock_guard<std::recursive_mutex> lock(memoryInfo.mutexAll_);
-  auto it = memoryInfo.allocatedBlocks_.find(const_cast<void*>(ptr));
-  if (it == memoryInfo.allocatedBlocks_.end()) {
+  auto& shard = getShard(memoryInfo, ptr);
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  auto it = shard.blocks_.find(const_cast<void*>(ptr));
+  if (it == shard.blocks_.end()) {
     return false;
   }
   return it->second->userLock_;
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -23,6 +25,12 @@ namespace fl {
  * Sources :
  * https://github.com/torch/cutorch/blob/master/lib/THC/THCCachingAllocator.h
  * https://github.com/pytorch/pytorch/blob/master/c10/cuda/CUDACachingAllocator.cpp
+ *
+ * Locking: allocated blocks are tracked in maps sharded by pointer, each with
+ * its own lock. Small blocks freed by a thread are kept in a per-thread cache
+ * (up to a size limit), from which the same thread allocates without taking
+ * any shared lock. Only cache misses go to the free pools, guarded by the
+ * per-device lock.
  */
 class CachingMemoryManager : public MemoryManagerAdapter {
  public:
@@ -55,8 +63,11 @@ class CachingMemoryManager : public MemoryManagerAdapter {
     void* ptr_; // memory address
     bool managerLock_; //  whether the memory is locked by the memory manager
     bool userLock_; // whether the memory is locked by the user
+    bool free_; // whether the block is in a free pool (guarded by mutexAll_)
     Block* prev_; // prev block if split from a larger allocation
     Block* next_; // next block if split from a larger allocation
+    Block* binPrev_; // prev block in the same free bin
+    Block* binNext_; // next block in the same free bin
 
     bool isSplit() const {
       return (prev_ != nullptr) || (next_ != nullptr);
@@ -66,18 +77,66 @@ class CachingMemoryManager : public MemoryManagerAdapter {
       return managerLock_ || userLock_;
     }
 
-    explicit Block(size_t size, void* ptr = nullptr)
+    explicit Block(size_t size = 0, void* ptr = nullptr)
         : size_(size),
           ptr_(ptr),
           managerLock_(false),
           userLock_(false),
+          free_(false),
           prev_(nullptr),
-          next_(nullptr) {}
+          next_(nullptr),
+          binPrev_(nullptr),
+          binNext_(nullptr) {}
   };
 
   typedef bool (*Comparison)(const Block*, const Block*);
   typedef std::set<Block*, Comparison> BlockSet;
 
+  // Free blocks binned by exact size class (sizes are multiples of the
+  // minimum block size), with a bitmap of non-empty bins. Used instead of a
+  // BlockSet for small blocks: insertion and removal are O(1), and lookup is
+  // a scan of the bitmap.
+  class BlockBins {
+   public:
+    explicit BlockBins(size_t maxSize);
+    void insert(Block* block);
+    void erase(Block* block);
+    // Removes and returns a block of the smallest size >= size, if any
+    Block* extract(size_t size);
+    std::vector<Block*> blocks() const;
+
+   private:
+    std::vector<Block*> bins_;
+    std::vector<uint64_t> nonEmpty_;
+  };
+
+  // Recycles Block metadata instead of allocating one per block.
+  class BlockPool {
+   public:
+    Block* acquire(size_t size, void* ptr);
+    void release(Block* block);
+
+   private:
+    std::vector<std::unique_ptr<Block[]>> slabs_;
+    std::vector<Block*> free_;
+  };
+
+  // A shard of the map of allocated blocks by device pointer.
+  struct BlockMapShard {
+    std::mutex mutex_;
+    std::unordered_map<void*, Block*> blocks_;
+  };
+
+  // Small free blocks cached by a thread, which it can reuse without taking
+  // the device lock.
+  struct ThreadCache {
+    std::mutex mutex_; // only contended when the cache is drained
+    std::vector<std::vector<Block*>> bins_;
+    size_t bytes_;
+
+    ThreadCache();
+  };
+
   // A structure to store allocation stats per device.
   struct MemoryAllocationStats {
     size_t totalNativeMallocs_;
@@ -92,22 +151,34 @@ class CachingMemoryManager : public MemoryManagerAdapter {
           cachedBytes_(0) {}
   };
 
+  static constexpr size_t kNumBlockMapShards = 16;
+
   // Stores the mutex and misc variables per device so that we operate in a
   // thredsafe manner.
   struct DeviceMemoryInfo {
     int deviceId_;
 
-    // lock around all operations
-    std::recursive_mutex mutexAll_; // TODO:: improve perf using R/W locks
+    // unique id, identifying the thread caches of this device
+    const uint64_t uid_;
+
+    // lock around free pools, block metadata and stats
+    std::recursive_mutex mutexAll_;
 
     // cached blocks larger than 1 MB
     BlockSet largeBlocks_;
 
     // cached blocks 1 MB or smaller
-    BlockSet smallBlocks_;
+    BlockBins smallBlocks_;
+
+    BlockPool blockPool_;
 
-    // allocated blocks by device pointer
-    std::unordered_map<void*, Block*> allocatedBlocks_;
+    // allocated blocks by device pointer, each shard with its own lock
+    std::array<BlockMapShard, kNumBlockMapShards> allocatedBlocks_;
+
+    // caches of all threads using this device
+    std::mutex threadCachesMutex_;
+    std::vector<std::shared_ptr<ThreadCache>> threadCaches_;
+    std::atomic<size_t> threadCachedBytes_;
 
     MemoryAllocationStats stats_;
 
@@ -126,12 +197,19 @@ class CachingMemoryManager : public MemoryManagerAdapter {
   // Using "-1" will return info for the current active device.
   DeviceMemoryInfo& getDeviceMemoryInfo(int device = -1);
 
-  void
-  freeBlocks(BlockSet& blocks, BlockSet::iterator it, BlockSet::iterator end);
+  BlockMapShard& getShard(DeviceMemoryInfo& memoryInfo, const void* ptr);
+  ThreadCache& getThreadCache(DeviceMemoryInfo& memoryInfo);
+  Block* popThreadCache(DeviceMemoryInfo& memoryInfo, size_t size);
+  bool pushThreadCache(DeviceMemoryInfo& memoryInfo, Block* block);
+  void drainThreadCaches(DeviceMemoryInfo& memoryInfo);
+
+  void freeBlocks(const std::vector<Block*>& blocks, bool isSmall);
 
   void mallocWithRetry(size_t size, void** ptr);
 
-  void tryMergeBlocks(Block* dst, Block* src, BlockSet& freeBlocks);
+  void insertFreeBlock(Block* block, bool isSmall);
+  void eraseFreeBlock(Block* block, bool isSmall);
+  void tryMergeBlocks(Block* dst, Block* src, bool isSmall);
   void freeBlock(Block* block);
 };
 
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "flashlight/flashlight/memory/AllocationTrace.h"
+#include "flashlight/flashlight/memory/AllocationTraceReplayer.h"
 #include "flashlight/flashlight/memory/MemoryManagerAdapter.h"
 #include "flashlight/flashlight/memory/MemoryManagerDeviceInterface.h"
 #include "flashlight/flashlight/memory/MemoryManagerInstaller.h"
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/flashlight/nn/modules/Checkpoint.h"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace fl {
+
+namespace {
+
+/**
+ * Draws seeds on the host: drawing them from the ArrayFire engine would wait
+ * for the device. The host engine starts from the seed of the ArrayFire
+ * engine, so that runs seeded with af::setSeed() are reproducible.
+ */
+unsigned long long drawSeed() {
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  static std::mt19937_64 engine(af::getSeed());
+  return engine();
+}
+
+/**
+ * Seeds the ArrayFire engine while in scope. ArrayFire doesn't expose the
+ * position of its engine in the stream, so its previous state can't be
+ * restored: it is reseeded from the host instead, so that the random numbers
+ * drawn after the scope don't repeat those drawn in it.
+ */
+class SeedGuard {
+ public:
+  explicit SeedGuard(unsigned long long seed) {
+    af::setSeed(seed);
+  }
+
+  ~SeedGuard() {
+    af::setSeed(drawSeed());
+  }
+};
+
+} // namespace
+
+std::vector<Variable> checkpoint(
+    const std::function<std::vector<Variable>(const std::vector<Variable>&)>&
+        func,
+    const std::vector<Variable>& inputs) {
+  auto seed = drawSeed();
+
+  // Runs func on copies of the inputs which are not part of the graph, so
+  // that the graph of func is released with its outputs below
+  std::vector<Variable> detachedInputs;
+  for (const auto& input : inputs) {
+    detachedInputs.emplace_back(input.array(), false);
+  }
+  std::vector<Variable> funcOutputs;
+  {
+    SeedGuard seedGuard(seed);
+    funcOutputs = func(detachedInputs);
+  }
+
+  bool inputsCalcGrad =
+      std::any_of(inputs.begin(), inputs.end(), [](const Variable& input) {
+        return input.isCalcGrad();
+      });
+  std::vector<Variable> outputs;
+  for (int i = 0; i < funcOutputs.size(); ++i) {
+    if (!inputsCalcGrad && !funcOutputs[i].isCalcGrad()) {
+      outputs.emplace_back(funcOutputs[i].array(), false);
+      continue;
+    }
+
+    int numInputs = inputs.size();
+    auto gradFunc = [func, seed, i, numInputs](
+                        std::vector<Variable>& gradInputs,
+                        const Variable& gradOutput) {
+      // Recompute the graph of func, with the same random numbers
+      std::vector<Variable> recomputeInputs;
+      for (int j = 0; j < numInputs; ++j) {
+        recomputeInputs.emplace_back(
+            gradInputs[j].array(), gradInputs[j].isCalcGrad());
+      }
+      std::vector<Variable> recomputeOutputs;
+      {
+        SeedGuard seedGuard(seed);
+        recomputeOutputs = func(recomputeInputs);
+      }
+      if (i >= recomputeOutputs.size()) {
+        throw std::logic_error(
+            "checkpoint: func returned fewer outputs when recomputed");
+      }
+
+      // The parameters used by func get their gradients here
+      recomputeOutputs[i].backward(gradOutput);
+      for (int j = 0; j < numInputs; ++j) {
+        if (recomputeInputs[j].isGradAvailable()) {
+          gradInputs[j].addGrad(recomputeInputs[j].grad());
+        }
+      }
+    };
+
+    auto gradInputs = inputs;
+    if (!inputsCalcGrad) {
+      // Only parameters of func require a gradient. Variable records a
+      // gradFunc only if an input requires a gradient, which this empty one
+      // does.
+      gradInputs.emplace_back(af::array(), true);
+    }
+    outputs.emplace_back(funcOutputs[i].array(), gradInputs, gradFunc);
+  }
+  return outputs;
+}
+
+std::vector<Variable> Checkpoint::forward(
+    const std::vector<Variable>& inputs) {
+  auto modules = modules_;
+  auto func = [modules](const std::vector<Variable>& funcInputs) {
+    auto output = funcInputs;
+    for (auto& module : modules) {
+      output = module->forward(output);
+    }
+    return output;
+  };
+  if (!train_) {
+    return func(inputs);
+  }
+  return checkpoint(func, inputs);
+}
+
+std::string Checkpoint::prettyString() const {
+  std::ostringstream ss;
+  ss << "Checkpoint";
+  for (const auto& module : modules_) {
+    ss << " (" << module->prettyString() << ")";
+  }
+  return ss.str();
+}
+
+} // namespace fl
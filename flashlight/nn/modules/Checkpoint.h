@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "flashlight/flashlight/nn/modules/Container.h"
+
+namespace fl {
+
+/**
+ * Computes `func(inputs)` without keeping the intermediate Variables of the
+ * computation alive: only `inputs` are kept for the backward pass, which runs
+ * `func` again to compute the gradients. This trades one more forward pass for
+ * the memory of the activations (gradient checkpointing).
+ *
+ * The random engine is reseeded before `func` runs, and again with the same
+ * seed before it is recomputed, so that layers like Dropout draw the same
+ * random numbers twice. It is reseeded again after each run, with a seed
+ * drawn on the host. Other side effects of `func`, like the update of running
+ * statistics in BatchNorm, happen twice.
+ *
+ * Each output of `func` which requires a gradient runs its own recomputation,
+ * so `func` should preferably have a single output.
+ *
+ * @param func the function to checkpoint. It must compute the same outputs
+ * when called twice with the same inputs.
+ * @param inputs the inputs of `func`
+ * @return the outputs of `func`
+ */
+std::vector<Variable> checkpoint(
+    const std::function<std::vector<Variable>(const std::vector<Variable>&)>&
+        func,
+    const std::vector<Variable>& inputs);
+
+/**
+ * Wraps a module so that its activations are not stored for the backward pass
+ * in train mode, but recomputed from its inputs by running its forward again.
+ * See `fl::checkpoint()`. In eval mode, the module runs as usual.
+ *
+ * Checkpointing a block of a deep model keeps only the input of the block
+ * alive until the backward pass:
+ * \code
+   Sequential model;
+   for (int i = 0; i < 36; ++i) {
+     model.add(Checkpoint(Transformer(512, 64, 2048, 8, 100, 0.1, 0.1)));
+   }
+   \endcode
+ * If modules are added with `add()`, they are run in order like in a
+ * `Sequential`, and checkpointed together.
+ */
+class Checkpoint : public Container {
+ public:
+  /**
+   * Constructs a Checkpoint wrapping a copy of a module. Parameters are
+   * shared, due to Variable's copy semantics.
+   *
+   * @param module the module to checkpoint
+   */
+  template <typename T>
+  explicit Checkpoint(const T& module)
+      : Checkpoint(std::make_shared<T>(module)) {}
+
+  /**
+   * Constructs a Checkpoint wrapping a module.
+   *
+   * @param module the module to checkpoint
+   */
+  template <typename T>
+  explicit Checkpoint(std::shared_ptr<T> module) {
+    add(module);
+  }
+
+  std::vector<Variable> forward(const std::vector<Variable>& inputs) override;
+
+  std::string prettyString() const override;
+
+ private:
+  Checkpoint() = default; // Intentionally private
+
+  FL_SAVE_LOAD_WITH_BASE(Container)
+};
+
+} // namespace fl
+
+CEREAL_REGISTER_TYPE(fl::Checkpoint)
@@ -15,7 +15,10 @@
 
 #include "flashlight/flashlight/nn/modules/Container.h"
 
+#include <algorithm>
+
 #include "flashlight/flashlight/autograd/Variable.h"
+#include "flashlight/flashlight/nn/modules/Checkpoint.h"
 
 namespace fl {
 
@@ -71,17 +74,31 @@ Sequential::Sequential() = default;
 
 std::vector<Variable> Sequential::forward(const std::vector<Variable>& input) {
   auto output = input;
-  for (auto& module : modules_) {
-    output = module->forward(output);
+  if (!train_ || checkpointEvery_ <= 0) {
+    for (auto& module : modules_) {
+      output = module->forward(output);
+    }
+    return output;
+  }
+
+  for (int start = 0; start < modules_.size(); start += checkpointEvery_) {
+    int end = std::min<int>(start + checkpointEvery_, modules_.size());
+    std::vector<ModulePtr> modules(
+        modules_.begin() + start, modules_.begin() + end);
+    auto func = [modules](const std::vector<Variable>& funcInputs) {
+      auto funcOutput = funcInputs;
+      for (auto& module : modules) {
+        funcOutput = module->forward(funcOutput);
+      }
+      return funcOutput;
+    };
+    output = checkpoint(func, output);
   }
   return output;
 }
 
 Variable Sequential::forward(const Variable& input) {
-  std::vector<Variable> output = {input};
-  for (auto& module : modules_) {
-    output = module->forward(output);
-  }
+  auto output = Sequential::forward(std::vector<Variable>{input});
   if (output.size() != 1) {
     throw std::invalid_argument("Module output size is not 1");
   }
@@ -92,6 +109,14 @@ Variable Sequential::operator()(const Variable& input) {
   return this->forward(input);
 }
 
+void Sequential::setCheckpointEvery(int numModules) {
+  if (numModules < 0) {
+    throw std::invalid_argument(
+        "Sequential::setCheckpointEvery: numModules must be >= 0");
+  }
+  checkpointEvery_ = numModules;
+}
+
 std::string Sequential::prettyString() const {
   std::ostringstream ss;
   ss << "Sequential";
@@ -159,6 +159,17 @@ class Sequential : public Container {
 
   Variable operator()(const Variable& input);
 
+  /**
+   * Enables gradient checkpointing in train mode: every `numModules`
+   * consecutive modules are run as a `Checkpoint`, so that only their input is
+   * stored for the backward pass, and their activations are recomputed. See
+   * `fl::checkpoint()`.
+   *
+   * @param numModules the number of modules per checkpoint, or 0 to disable
+   * checkpointing
+   */
+  void setCheckpointEvery(int numModules);
+
   /**
    * Generates a stringified representation of the `Sequential` by concatenating
    * string representations for each contained `Module`
@@ -168,10 +179,13 @@ class Sequential : public Container {
   std::string prettyString() const override;
 
  private:
-  FL_SAVE_LOAD_WITH_BASE(Container)
+  int checkpointEvery_{0};
+
+  FL_SAVE_LOAD_WITH_BASE(Container, fl::versioned(checkpointEvery_, 1))
 };
 
 } // namespace fl
 
 CEREAL_REGISTER_TYPE(fl::Container)
 CEREAL_REGISTER_TYPE(fl::Sequential)
+CEREAL_CLASS_VERSION(fl::Sequential, 1)
@@ -11,6 +11,7 @@
 #include "flashlight/flashlight/nn/modules/Activations.h"
 #include "flashlight/flashlight/nn/modules/AdaptiveSoftMax.h"
 #include "flashlight/flashlight/nn/modules/BatchNorm.h"
+#include "flashlight/flashlight/nn/modules/Checkpoint.h"
 #include "flashlight/flashlight/nn/modules/Container.h"
 #include "flashlight/flashlight/nn/modules/Conv2D.h"
 #include "flashlight/flashlight/nn/modules/Dropout.h"
@@ -13,9 +13,12 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "flashlight/flashlight/autograd/autograd.h"
@@ -241,6 +244,191 @@ TEST(AutogradTest, NoCalcGrad) {
   ASSERT_THROW(x.grad(), std::logic_error);
 }
 
+TEST(AutogradTest, DeepGraph) {
+  // Deep enough to overflow the call stack with a recursive traversal
+  const int depth = 100000;
+  auto x = Variable(af::constant(1.0, 1), true);
+  auto y = x;
+  for (int i = 0; i < depth; ++i) {
+    y = y + x;
+  }
+  y.backward();
+  ASSERT_FLOAT_EQ(x.grad().scalar<float>(), depth + 1);
+}
+
+TEST(AutogradTest, BackwardTape) {
+  auto x = Variable(af::randu(5), true);
+  auto y = Variable(af::randu(5), true);
+  auto dz = Variable(af::constant(1.0, 5), false);
+  BackwardTape tape;
+  ASSERT_THROW(tape.backward(), std::logic_error);
+  for (int step = 0; step < 3; ++step) {
+    x.zeroGrad();
+    y.zeroGrad();
+    auto xy = x * y;
+    auto z = xy + xy * x;
+    tape.record(z);
+    ASSERT_EQ(tape.size(), 5);
+    tape.backward(dz);
+    ASSERT_EQ(tape.size(), 0);
+    ASSERT_TRUE(allClose(
+        x.grad().array(), y.array() + 2 * x.array() * y.array()));
+    ASSERT_TRUE(allClose(y.grad().array(), x.array() + x.array() * x.array()));
+  }
+
+  // A retained graph can be replayed
+  x.zeroGrad();
+  auto z = x * x;
+  tape.record(z);
+  tape.backward(dz, true);
+  z.zeroGrad();
+  tape.backward(dz);
+  ASSERT_TRUE(allClose(x.grad().array(), 4 * x.array()));
+}
+
+TEST(AutogradTest, ConcurrentRecord) {
+  // Graphs recorded by different threads share x and its sums, which every
+  // thread must visit exactly once
+  auto x = Variable(af::constant(1.0, 1), true);
+  auto shared = x;
+  for (int i = 0; i < 100; ++i) {
+    shared = shared + x;
+  }
+  const int nThreads = 8;
+  std::vector<Variable> outputs;
+  for (int t = 0; t < nThreads; ++t) {
+    outputs.push_back(shared * x + shared);
+  }
+
+  std::vector<size_t> maxSizes(nThreads, 0), minSizes(nThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      BackwardTape tape;
+      tape.record(outputs[t]);
+      maxSizes[t] = minSizes[t] = tape.size();
+      for (int trial = 0; trial < 200; ++trial) {
+        tape.record(outputs[t]);
+        maxSizes[t] = std::max(maxSizes[t], tape.size());
+        minSizes[t] = std::min(minSizes[t], tape.size());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < nThreads; ++t) {
+    ASSERT_EQ(minSizes[t], 103);
+    ASSERT_EQ(maxSizes[t], 103);
+  }
+}
+
+TEST(AutogradTest, PendingGradsBounded) {
+  // A weight used at every step of a sequence, like tied weights
+  auto w = Variable(af::constant(1.0, 5), true);
+  auto x = Variable(af::randu(5), false);
+  auto y = x;
+  const int nSteps = 100;
+  for (int i = 0; i < nSteps; ++i) {
+    y = y * w;
+  }
+  y.backward();
+  ASSERT_LT(w.numPendingGrads(), Variable::kMaxPendingGrads);
+
+  for (int i = 0; i < nSteps; ++i) {
+    w.addGrad(Variable(af::constant(1.0, 5), false));
+    ASSERT_LT(w.numPendingGrads(), Variable::kMaxPendingGrads);
+  }
+  ASSERT_TRUE(
+      allClose(w.grad().array(), nSteps * x.array() + nSteps, 1E-3));
+  ASSERT_EQ(w.numPendingGrads(), 0);
+}
+
+TEST(AutogradTest, NoGradGuard) {
+  auto x = Variable(af::randu(5), true);
+  Variable y;
+  {
+    NoGradGuard noGrad;
+    ASSERT_FALSE(isGradEnabled());
+    { NoGradGuard nested; }
+    ASSERT_FALSE(isGradEnabled());
+    y = x * x + x;
+    ASSERT_FALSE(y.isCalcGrad());
+    ASSERT_TRUE(Variable(af::randu(5), true).isCalcGrad());
+  }
+  ASSERT_TRUE(isGradEnabled());
+
+  // y is a constant for the graph recorded after the guard
+  auto z = y * x;
+  z.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), y.array()));
+
+  y.setCalcGrad(true);
+  ASSERT_TRUE(y.isCalcGrad());
+}
+
+TEST(AutogradTest, NoGradGuardResult) {
+  auto x = Variable(af::randu(5), true);
+  Variable y;
+  {
+    NoGradGuard noGrad;
+    y = x * x;
+  }
+  ASSERT_FALSE(y.isCalcGrad());
+  ASSERT_FALSE(y.isGradAvailable());
+  ASSERT_TRUE(y.getInputs().empty());
+  ASSERT_THROW(y.grad(), std::logic_error);
+  y.zeroGrad();
+  ASSERT_TRUE(y.withoutData().getInputs().empty());
+
+  // Hooks can be registered, but don't make the Variable need a gradient
+  bool hookCalled = false;
+  y.registerGradHook([&hookCalled](Variable& /* unused */) {
+    hookCalled = true;
+  });
+  ASSERT_FALSE(y.isCalcGrad());
+
+  // Nor does a constant leaf
+  auto c = Variable(af::randu(5), false);
+  ASSERT_FALSE(c.isCalcGrad());
+  ASSERT_TRUE(c.getInputs().empty());
+  ASSERT_THROW(c.grad(), std::logic_error);
+  c.zeroGrad();
+
+  // Both are constants of graphs recorded later
+  auto z = y * x + c;
+  z.backward();
+  ASSERT_FALSE(hookCalled);
+  ASSERT_EQ(z.getInputs().size(), 2);
+  ASSERT_TRUE(allClose(x.grad().array(), y.array()));
+}
+
+TEST(AutogradTest, FanOutGrad) {
+  auto x = Variable(af::randu(5), true);
+  auto y = x * 2;
+  // y has many consumers, whose gradients are summed once
+  auto z = y;
+  for (int i = 0; i < 10; ++i) {
+    z = z + y * x;
+  }
+  z.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), 2 + 40 * x.array()));
+
+  // Gradients added after the gradient was read are accumulated too
+  x.addGrad(Variable(af::constant(1.0, 5), false));
+  x.addGrad(Variable(af::constant(2.0, 5), false));
+  ASSERT_TRUE(allClose(x.grad().array(), 5 + 40 * x.array()));
+  x.zeroGrad();
+  ASSERT_FALSE(x.isGradAvailable());
+
+  // In place updates of the gradient see all the contributions
+  auto w = Variable(af::constant(0.0, 4), true);
+  auto v = w + w;
+  v(af::seq(0, 1)).backward();
+  auto expected = af::join(0, af::constant(2.0, 2), af::constant(0.0, 2));
+  ASSERT_TRUE(allClose(w.grad().array(), expected));
+}
+
 TEST(AutogradTest, MultiplySub) {
   auto x = Variable(af::randu(5), true);
   auto y = Variable(af::randu(5), true);
@@ -632,6 +820,35 @@ TEST(AutogradTest, ConvolveDilation) {
   ASSERT_TRUE(jacobianTestImpl(func_conv_bs, bs, 0.02));
 }
 
+TEST(AutogradTest, ConvolveUpdatedWeights) {
+  // Repeated inference calls must see the updates of the weights
+  auto in = Variable(af::randu(10, 9, 8, 7, af::dtype::f32), false);
+  auto wt = Variable(af::randu(4, 3, 8, 6, af::dtype::f32), false);
+  auto expected = [&]() {
+    return conv2d(in, Variable(wt.array().copy(), false), 1, 1, 1, 1).array();
+  };
+  ASSERT_TRUE(allClose(conv2d(in, wt, 1, 1, 1, 1).array(), expected()));
+  ASSERT_TRUE(allClose(conv2d(in, wt, 1, 1, 1, 1).array(), expected()));
+
+  wt.array() = wt.array() * 2;
+  ASSERT_TRUE(allClose(conv2d(in, wt, 1, 1, 1, 1).array(), expected()));
+
+  wt.array()(af::span, af::span, af::span, 0) = 0;
+  ASSERT_TRUE(allClose(conv2d(in, wt, 1, 1, 1, 1).array(), expected()));
+}
+
+TEST(AutogradTest, ConvolveTemporaryWeights) {
+  // Weights computed on every call, e.g. by WeightNorm, are destroyed after
+  // the call and the next ones may get the same memory
+  auto in = Variable(af::randu(10, 9, 8, 7, af::dtype::f32), false);
+  auto base = Variable(af::randu(4, 3, 8, 6, af::dtype::f32), false);
+  auto expected = conv2d(in, base, 1, 1, 1, 1).array();
+  for (int i = 1; i <= 3; ++i) {
+    auto out = conv2d(in, Variable(base.array() * i, false), 1, 1, 1, 1);
+    ASSERT_TRUE(allClose(out.array(), expected * i, 1E-4));
+  }
+}
+
 TEST(AutogradTest, Padding) {
   auto in = Variable(af::randu(3, 3, af::dtype::f32), true);
   auto func_pad = [&](Variable& input) {
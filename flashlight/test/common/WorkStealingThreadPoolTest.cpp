@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/flashlight/common/threadpool/WorkStealingThreadPool.h"
+
+using namespace fl;
+
+namespace {
+
+TEST(WorkStealingThreadPool, Enqueue) {
+  std::atomic<int> nInit(0);
+  WorkStealingThreadPool pool(4, [&nInit](size_t /* id */) { ++nInit; });
+  ASSERT_EQ(pool.size(), 4);
+
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 10000; ++i) {
+    results.push_back(pool.enqueue([](int answer) { return 2 * answer; }, i));
+  }
+  for (int i = 0; i < results.size(); ++i) {
+    ASSERT_EQ(results[i].get(), 2 * i);
+  }
+  ASSERT_EQ(nInit, 4);
+
+  // Captures too large to be stored inline
+  std::array<char, 256> large;
+  large.fill(7);
+  auto largeResult = pool.enqueue([large]() { return large[100]; });
+  ASSERT_EQ(largeResult.get(), 7);
+
+  auto error = pool.enqueue([]() { throw std::runtime_error("task error"); });
+  ASSERT_THROW(error.get(), std::runtime_error);
+}
+
+TEST(WorkStealingThreadPool, Execute) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingThreadPool pool(3);
+    for (int i = 0; i < 1000; ++i) {
+      pool.execute([&count]() { ++count; });
+    }
+    // pending tasks are run before the pool is destroyed
+  }
+  ASSERT_EQ(count, 1000);
+}
+
+TEST(WorkStealingThreadPool, ParallelFor) {
+  WorkStealingThreadPool pool(4);
+
+  std::vector<int64_t> values(100003, 0);
+  pool.parallelFor(
+      0, values.size(), [&values](int64_t i) { values[i] += i; }, 64);
+  for (int64_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(values[i], i);
+  }
+
+  // Nested in a task of the same pool
+  auto nested = pool.enqueue([&pool]() {
+    std::atomic<int64_t> sum(0);
+    pool.parallelFor(10, 1010, [&sum](int64_t i) { sum += i; });
+    return sum.load();
+  });
+  ASSERT_EQ(nested.get(), 1009 * 1010 / 2 - 9 * 10 / 2);
+
+  ASSERT_THROW(
+      pool.parallelFor(
+          0,
+          100,
+          [](int64_t i) {
+            if (i == 42) {
+              throw std::invalid_argument("iteration error");
+            }
+          }),
+      std::invalid_argument);
+
+  // Empty range
+  pool.parallelFor(5, 5, [](int64_t /* i */) { FAIL(); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
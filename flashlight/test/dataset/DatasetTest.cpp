@@ -5,8 +5,13 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <fstream>
+#include <iterator>
 #include <thread>
+#include <type_traits>
 
 #include <arrayfire.h>
 #include <gtest/gtest.h>
@@ -335,6 +340,127 @@ TEST(DatasetTest, FileBlobDataset) {
   }
 }
 
+TEST(DatasetTest, BlobDatasetGetBatch) {
+  {
+    FileBlobDataset blob("/tmp/data-batch.blob", true, true);
+    for (int64_t i = 0; i < 50; i++) {
+      std::vector<af::array> sample;
+      for (int64_t j = 0; j < i % 3; j++) {
+        sample.push_back(af::randu(10 + i, 5 + j));
+      }
+      sample.push_back(af::constant(i, 1, s32));
+      blob.add(sample);
+    }
+    blob.writeIndex();
+  }
+
+  std::vector<int64_t> indices = {7, 3, 4, 5, 49, 0, 3, 12, 11, 10};
+  FileBlobDataset fileBlob("/tmp/data-batch.blob");
+  MemoryMappedBlobDataset mmapBlob("/tmp/data-batch.blob");
+  for (const BlobDataset* blob :
+       std::vector<const BlobDataset*>{&fileBlob, &mmapBlob}) {
+    auto batch = blob->getBatch(indices);
+    ASSERT_EQ(batch.size(), indices.size());
+    for (int64_t i = 0; i < indices.size(); i++) {
+      auto sample = blob->get(indices[i]);
+      ASSERT_EQ(sample.size(), batch[i].size());
+      ASSERT_EQ(batch[i].back().scalar<int>(), indices[i]);
+      for (int64_t j = 0; j < sample.size(); j++) {
+        ASSERT_TRUE(allClose(sample[j], batch[i][j]));
+      }
+    }
+  }
+  ASSERT_THROW(fileBlob.getBatch({0, 50}), std::out_of_range);
+}
+
+TEST(DatasetTest, FileBlobDatasetGetWithoutFlush) {
+  FileBlobDataset blob("/tmp/data-noflush.blob", true, true);
+  std::vector<af::array> data;
+  for (int64_t i = 0; i < 10; i++) {
+    data.push_back(af::randu(5 + i, 3));
+    blob.add({data.back()});
+    ASSERT_TRUE(allClose(blob.get(i)[0], data.back()));
+  }
+  auto batch = blob.getBatch({9, 0, 4});
+  ASSERT_TRUE(allClose(batch[0][0], data[9]));
+  ASSERT_TRUE(allClose(batch[1][0], data[0]));
+  ASSERT_TRUE(allClose(batch[2][0], data[4]));
+}
+
+TEST(DatasetTest, MemoryMappedBlobDataset) {
+  // A copy would unmap the blob a second time
+  static_assert(
+      !std::is_copy_constructible<MemoryMappedBlobDataset>::value &&
+          !std::is_copy_assignable<MemoryMappedBlobDataset>::value,
+      "MemoryMappedBlobDataset must not be copyable");
+
+  std::vector<std::vector<af::array>> data;
+  {
+    FileBlobDataset blob("/tmp/data-mmap.blob", true, true);
+    for (int64_t i = 0; i < 20; i++) {
+      std::vector<af::array> sample;
+      for (int64_t j = 0; j < i % 4; j++) {
+        if (j % 2 == 0) {
+          sample.push_back(af::randu(100, 3, 10));
+        } else {
+          sample.push_back(af::range(af::dim4(10, 20), 0, s32));
+        }
+      }
+      data.push_back(sample);
+      blob.add(sample);
+    }
+    blob.writeIndex();
+  }
+
+  MemoryMappedBlobDataset blob("/tmp/data-mmap.blob");
+  FileBlobDataset fileBlob("/tmp/data-mmap.blob");
+  ASSERT_EQ(data.size(), blob.size());
+  for (int64_t i = 0; i < blob.size(); i++) {
+    auto sample = blob.get(i);
+    ASSERT_EQ(data[i].size(), sample.size());
+    for (int64_t j = 0; j < sample.size(); j++) {
+      ASSERT_TRUE(data[i][j].dims() == sample[j].dims());
+      ASSERT_EQ(data[i][j].type(), sample[j].type());
+      ASSERT_TRUE(allClose(data[i][j], sample[j]));
+    }
+    auto raw = fileBlob.rawGet(i);
+    auto views = blob.rawGetView(i);
+    ASSERT_EQ(raw.size(), views.size());
+    for (int64_t j = 0; j < views.size(); j++) {
+      ASSERT_EQ(raw[j].size(), views[j].bytes);
+      ASSERT_TRUE(std::equal(raw[j].begin(), raw[j].end(), views[j].data));
+    }
+  }
+
+  // host transforms work on a private copy of the mapped data
+  blob.setHostTransform(
+      0, [](void* ptr, af::dim4 size, af::dtype /* type */) {
+        float* ptr_f = (float*)ptr;
+        for (int64_t i = 0; i < size.elements(); i++) {
+          ptr_f[i] += 1;
+        }
+        return af::array(size, ptr_f);
+      });
+  for (int64_t i = 0; i < blob.size(); i++) {
+    if (data[i].size() > 0) {
+      ASSERT_TRUE(allClose(data[i][0] + 1, blob.get(i)[0]));
+    }
+  }
+  ASSERT_TRUE(allClose(data[1][0], fileBlob.get(1)[0]));
+
+  // the index of a truncated blob is out of the mapped region
+  {
+    std::ifstream in("/tmp/data-mmap.blob", std::ios::binary);
+    std::vector<char> bytes(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream out("/tmp/data-mmap-truncated.blob", std::ios::binary);
+    out.write(bytes.data(), bytes.size() / 2);
+  }
+  ASSERT_THROW(
+      MemoryMappedBlobDataset("/tmp/data-mmap-truncated.blob"),
+      std::out_of_range);
+}
+
 TEST(DatasetTest, PrefetchDatasetCorrectness) {
   std::vector<af::array> tensormap = {af::randu(100, 200, 300)};
   auto tensords = std::make_shared<TensorDataset>(tensormap);
@@ -357,6 +483,88 @@ TEST(DatasetTest, PrefetchDatasetCorrectness) {
   }
 }
 
+TEST(DatasetTest, PrefetchDatasetNonSequential) {
+  std::vector<af::array> tensormap = {af::randu(10, 20, 50)};
+  auto tensords = std::make_shared<TensorDataset>(tensormap);
+  auto prefetchDs = std::make_shared<PrefetchDataset>(tensords, 2, 4);
+
+  std::vector<int64_t> indices = {0, 1, 2, 10, 11, 3, 4, 49, 48, 12, 13};
+  for (auto idx : indices) {
+    ASSERT_TRUE(allClose(tensords->get(idx)[0], prefetchDs->get(idx)[0]));
+  }
+  auto stats = prefetchDs->getStats();
+  ASSERT_EQ(stats.hits + stats.misses + stats.stalls, indices.size());
+  // 0, 10, 3, 49, 48 and 12 are not in the window of the previous access
+  ASSERT_EQ(stats.misses, 6);
+
+  prefetchDs->resetStats();
+  stats = prefetchDs->getStats();
+  ASSERT_EQ(stats.hits + stats.misses + stats.stalls, 0);
+}
+
+TEST(DatasetTest, PrefetchDatasetEvictedInFlight) {
+  const int64_t n = 100;
+  std::vector<af::array> tensormap = {af::range(af::dim4(1, n), 1)};
+  auto tensords = std::make_shared<TensorDataset>(tensormap);
+
+  std::atomic<int64_t> numFetched(0);
+  Dataset::TransformFunction slowDown = [&numFetched](const af::array& a) {
+    ++numFetched;
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return a;
+  };
+  auto transformDs = std::make_shared<TransformDataset>(
+      tensords, std::vector<Dataset::TransformFunction>{slowDown});
+
+  // Every access is out of the window of the previous one: the samples
+  // prefetched in between are evicted, and those not started are skipped
+  const int64_t prefetchSize = 4;
+  auto prefetchDs =
+      std::make_shared<PrefetchDataset>(transformDs, 1, prefetchSize);
+  int64_t numGets = 0;
+  for (int64_t idx = 0; idx < n; idx += 10, ++numGets) {
+    ASSERT_EQ(prefetchDs->get(idx)[0].scalar<float>(), idx);
+  }
+  // Each access fetches its sample, and at most one evicted sample is
+  // being fetched when it is requested
+  ASSERT_LE(numFetched.load(), 2 * numGets + prefetchSize);
+}
+
+TEST(DatasetTest, PrefetchDatasetOutOfOrder) {
+  const int64_t n = 40;
+  std::vector<af::array> tensormap = {af::range(af::dim4(1, n), 1)};
+  auto tensords = std::make_shared<TensorDataset>(tensormap);
+
+  Dataset::TransformFunction slowDown = [](const af::array& a) {
+    if (a.scalar<float>() == 3) {
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return a;
+  };
+  auto transformDs = std::make_shared<TransformDataset>(
+      tensords, std::vector<Dataset::TransformFunction>{slowDown});
+
+  // A byte budget of 4 samples, out-of-order
+  auto prefetchDs = std::make_shared<PrefetchDataset>(
+      transformDs, 4, 8, 4 * sizeof(float), true);
+  std::vector<int> seen(n, 0);
+  int64_t pos3 = -1;
+  for (int64_t i = 0; i < n; ++i) {
+    auto idx = static_cast<int64_t>(prefetchDs->get(i)[0].scalar<float>());
+    ++seen[idx];
+    if (idx == 3) {
+      pos3 = i;
+    }
+  }
+  // Each sample is returned exactly once, and the slow one came later
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(seen[i], 1);
+  }
+  ASSERT_GT(pos3, 3);
+}
+
 TEST(DatasetTest, DISABLED_PrefetchDatasetPerformance) {
   // Flaky test. Disabled for now.
   std::vector<af::array> tensormap = {af::randu(100, 200, 300)};
@@ -10,6 +10,7 @@
 
 #include <gtest/gtest.h>
 
+#include "flashlight/flashlight/autograd/autograd.h"
 #include "flashlight/flashlight/distributed/distributed.h"
 
 using namespace fl;
@@ -133,6 +134,52 @@ TEST(Distributed, CoalescingReducer) {
   }
 }
 
+TEST(Distributed, BucketedReducer) {
+  if (!isDistributedInit()) {
+    GTEST_SKIP() << "Distributed initialization failed or not enabled.";
+  }
+
+  auto rank = getWorldRank();
+  auto size = getWorldSize();
+
+  // Small buckets, so that parameters are spread across several of them
+  auto reducer = std::make_shared<fl::BucketedReducer>(
+      /* scale = */ 1.0 / size, /* async = */ true, /* bucketBytes = */ 4096);
+
+  std::vector<Variable> params;
+  for (int i = 0; i < 20; ++i) {
+    params.push_back(Variable(af::constant(1, 100 + 37 * i), true));
+  }
+  Variable unused(af::constant(1, 10), true);
+  reducer->registerParams(params);
+  reducer->registerParams({unused});
+
+  for (int step = 0; step < 3; ++step) {
+    Variable loss(af::constant(0, 1), false);
+    for (size_t i = 0; i < params.size(); ++i) {
+      loss = loss + fl::sum(params[i] * (rank + i + step), {0});
+    }
+    for (auto& param : params) {
+      param.zeroGrad();
+    }
+    loss.backward();
+    reducer->finalize();
+
+    for (size_t i = 0; i < params.size(); ++i) {
+      // Mean of (rank + i + step) over all ranks
+      float expected = (size - 1) / 2.0 + i + step;
+      ASSERT_TRUE(af::allTrue<bool>(
+          af::abs(params[i].grad().array() - expected) < 1e-5));
+    }
+    ASSERT_FALSE(unused.isGradAvailable());
+  }
+
+  // The parameters' hooks don't keep the reducer alive
+  std::weak_ptr<fl::BucketedReducer> weakReducer = reducer;
+  reducer.reset();
+  ASSERT_TRUE(weakReducer.expired());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/flashlight/autograd/autograd.h"
+#include "flashlight/flashlight/distributed/distributed.h"
+
+using namespace fl;
+
+namespace {
+
+const int kWorldSize = 2;
+
+// Runs `fn(rank)` for each rank in its own forked process, as the Gloo
+// context is global to a process. Returns true if all ranks succeeded.
+bool runRanks(const std::function<bool(int)>& fn) {
+  std::vector<pid_t> pids;
+  for (int rank = 0; rank < kWorldSize; ++rank) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // A rank waits forever for the others if one of them fails
+      alarm(120);
+      bool success = false;
+      try {
+        success = fn(rank);
+      } catch (const std::exception& ex) {
+        std::cerr << "rank " << rank << " failed: " << ex.what() << std::endl;
+      }
+      _exit(success ? 0 : 1);
+    }
+    if (pid == -1) {
+      break;
+    }
+    pids.push_back(pid);
+  }
+  bool success = pids.size() == kWorldSize;
+  for (auto pid : pids) {
+    int status;
+    success &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+        WEXITSTATUS(status) == 0;
+  }
+  return success;
+}
+
+bool initAndAllReduce(
+    DistributedInit initMethod,
+    int rank,
+    const std::unordered_map<std::string, std::string>& params) {
+  distributedInit(initMethod, rank, kWorldSize, params);
+  if (getWorldRank() != rank || getWorldSize() != kWorldSize) {
+    return false;
+  }
+  Variable var(af::constant(rank, 10), false);
+  allReduce(var, 2.0);
+  float expected = kWorldSize * (kWorldSize - 1.0);
+  return af::allTrue<bool>(var.array() == expected);
+}
+
+// A port which was free when this function was called
+int freePort() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrLen = sizeof(addr);
+  int port = -1;
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+      getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  close(fd);
+  return port;
+}
+
+} // namespace
+
+TEST(GlooRendezvousTest, FileSystem) {
+  char dir[] = "/tmp/fl_gloo_rendezvous_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  std::string path(dir);
+  ASSERT_TRUE(runRanks([&path](int rank) {
+    return initAndAllReduce(
+        DistributedInit::FILE_SYSTEM,
+        rank,
+        {{DistributedConstants::kFilePath, path}});
+  }));
+}
+
+TEST(GlooRendezvousTest, Tcp) {
+  // The port may be taken by another process before rank 0 listens on it
+  bool success = false;
+  for (int attempt = 0; attempt < 3 && !success; ++attempt) {
+    int port = freePort();
+    ASSERT_GT(port, 0);
+    success = runRanks([port](int rank) {
+      return initAndAllReduce(
+          DistributedInit::TCP,
+          rank,
+          {{DistributedConstants::kTcpHost, "localhost"},
+           {DistributedConstants::kTcpPort, std::to_string(port)}});
+    });
+  }
+  ASSERT_TRUE(success);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
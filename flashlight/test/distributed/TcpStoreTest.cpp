@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/flashlight/distributed/TcpStore.h"
+
+using namespace fl::detail;
+
+TEST(TcpStoreTest, SetGet) {
+  // Listen on a free port
+  TcpStore server("localhost", 0, /* isServer = */ true);
+  ASSERT_GT(server.port(), 0);
+  TcpStore client("localhost", server.port(), /* isServer = */ false);
+
+  std::vector<char> data = {'a', 'b', 'c'};
+  server.set("key0", data);
+  ASSERT_EQ(client.get("key0"), data);
+
+  client.set("key1", {});
+  ASSERT_TRUE(server.get("key1").empty());
+
+  // Keys can only be set once
+  ASSERT_THROW(client.set("key0", data), std::runtime_error);
+  ASSERT_EQ(server.get("key0"), data);
+}
+
+TEST(TcpStoreTest, GetWaitsForSet) {
+  TcpStore server("localhost", 0, /* isServer = */ true);
+
+  int port = server.port();
+  auto value = std::async(std::launch::async, [port]() {
+    TcpStore client("localhost", port, /* isServer = */ false);
+    return client.get("rank1");
+  });
+
+  std::vector<char> data(1 << 16, 'x');
+  server.set("rank1", data);
+  ASSERT_EQ(value.get(), data);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/flashlight/memory/memory.h"
+
+using namespace fl;
+
+namespace {
+
+AllocationEvent makeEvent(
+    AllocationEventType type,
+    uint64_t timestampNs,
+    uint64_t ptr,
+    uint64_t bytes = 0,
+    bool userLock = false) {
+  AllocationEvent event;
+  event.type = type;
+  event.timestampNs = timestampNs;
+  event.ptr = ptr;
+  event.bytes = bytes;
+  event.userLock = userLock;
+  return event;
+}
+
+// Allocates increasingly large buffers, keeping every other one alive
+std::vector<AllocationEvent> makeSyntheticTrace() {
+  std::vector<AllocationEvent> trace;
+  uint64_t t = 0;
+  for (uint64_t i = 1; i <= 200; ++i) {
+    trace.push_back(
+        makeEvent(AllocationEventType::Alloc, t++, i * 0x1000, i * 3000));
+    if (i % 2 == 0) {
+      trace.push_back(makeEvent(AllocationEventType::Unlock, t++, i * 0x1000));
+    }
+  }
+  trace.push_back(makeEvent(AllocationEventType::SignalMemoryCleanup, t++, 0));
+  return trace;
+}
+
+} // namespace
+
+TEST(AllocationTraceTest, WriteRead) {
+  std::vector<AllocationEvent> events = {
+      makeEvent(AllocationEventType::Alloc, 10, 0x7f0000001000, 4096, true),
+      makeEvent(AllocationEventType::UserLock, 15, 0x7f0000001000),
+      makeEvent(AllocationEventType::Unlock, 1000000, 0x7f0000001000, 0, true),
+      makeEvent(AllocationEventType::UserUnlock, 1000000, 0x7f0000001000),
+      makeEvent(AllocationEventType::SignalMemoryCleanup, 1 << 30, 0)};
+  events[1].device = 3;
+
+  std::stringstream stream;
+  AllocationTraceWriter writer(stream);
+  for (const auto& event : events) {
+    writer.write(event);
+  }
+  ASSERT_THROW(writer.write(events.front()), std::invalid_argument);
+
+  AllocationTraceReader reader(stream);
+  AllocationEvent event;
+  for (const auto& expected : events) {
+    ASSERT_TRUE(reader.next(event));
+    ASSERT_EQ(event.type, expected.type);
+    ASSERT_EQ(event.userLock, expected.userLock);
+    ASSERT_EQ(event.device, expected.device);
+    ASSERT_EQ(event.timestampNs, expected.timestampNs);
+    ASSERT_EQ(event.ptr, expected.ptr);
+    ASSERT_EQ(event.bytes, expected.bytes);
+  }
+  ASSERT_FALSE(reader.next(event));
+
+  std::stringstream invalid("not a trace");
+  ASSERT_THROW(AllocationTraceReader{invalid}, std::runtime_error);
+}
+
+TEST(AllocationTraceTest, Record) {
+  std::stringstream stream;
+  AllocationTraceWriter writer(stream);
+  int x;
+  writer.record(AllocationEventType::Alloc, 1, &x, 12, true);
+  writer.record(AllocationEventType::Unlock, 1, &x, 0, true);
+
+  AllocationTraceReader reader(stream);
+  AllocationEvent alloc, unlock;
+  ASSERT_TRUE(reader.next(alloc));
+  ASSERT_TRUE(reader.next(unlock));
+  ASSERT_EQ(alloc.ptr, reinterpret_cast<uintptr_t>(&x));
+  ASSERT_EQ(alloc.bytes, 12);
+  ASSERT_EQ(alloc.device, 1);
+  ASSERT_TRUE(unlock.userLock);
+  ASSERT_LE(alloc.timestampNs, unlock.timestampNs);
+}
+
+TEST(AllocationTraceTest, ReplayCachingMemoryManager) {
+  auto trace = makeSyntheticTrace();
+  AllocationTraceReplayer replayer;
+  CachingMemoryManager manager(1, replayer.getDeviceInterface());
+  auto stats = replayer.replay(trace, manager);
+
+  ASSERT_EQ(stats.numEvents, trace.size());
+  ASSERT_EQ(stats.failedAllocs, 0);
+  ASSERT_EQ(stats.unmatchedEvents, 0);
+  ASSERT_EQ(stats.allocLatency.count, 200);
+  ASSERT_EQ(stats.unlockLatency.count, 100);
+  ASSERT_GT(stats.nativeMallocs, 0);
+  ASSERT_GE(stats.peakReservedBytes, stats.peakLiveBytes);
+  ASSERT_GE(stats.fragmentationAtPeak, 0.0);
+  ASSERT_LT(stats.fragmentationAtPeak, 1.0);
+}
+
+TEST(AllocationTraceTest, ReplayOutOfMemory) {
+  std::vector<AllocationEvent> trace = {
+      makeEvent(AllocationEventType::Alloc, 0, 0x1000, 1 << 20),
+      makeEvent(AllocationEventType::Alloc, 1, 0x2000, 1 << 30),
+      makeEvent(AllocationEventType::Unlock, 2, 0x2000)};
+  AllocationTraceReplayer replayer(1 << 24);
+  DefaultMemoryManager manager(1, 64, false, replayer.getDeviceInterface());
+  auto stats = replayer.replay(trace, manager);
+  ASSERT_EQ(stats.failedAllocs, 1);
+  ASSERT_EQ(stats.unmatchedEvents, 1);
+  ASSERT_LE(stats.peakReservedBytes, 1 << 24);
+
+  AllocationTraceReplayer otherReplayer;
+  ASSERT_THROW(otherReplayer.replay(trace, manager), std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -5,8 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include <af/device.h>
@@ -137,6 +140,58 @@ TEST_F(CachingMemoryManagerTest, OOM) {
   }
 }
 
+TEST(CachingMemoryManager, MultithreadedAllocs) {
+  // This test allocates and frees blocks from several threads directly
+  // through the manager, backed by host memory, and checks that blocks
+  // handed out concurrently never overlap
+  auto deviceInterface = std::make_shared<fl::MemoryManagerDeviceInterface>();
+  deviceInterface->getActiveDeviceId = []() { return 0; };
+  deviceInterface->getMaxMemorySize = [](int) { return size_t(1) << 32; };
+  deviceInterface->nativeAlloc = [](size_t size) { return std::malloc(size); };
+  deviceInterface->nativeFree = [](void* ptr) { std::free(ptr); };
+  fl::CachingMemoryManager manager(1, deviceInterface);
+
+  const int nThreads = 4;
+  std::vector<std::thread> threads;
+  std::vector<int> failures(nThreads, 0);
+  for (int t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&manager, &failures, t]() {
+      std::mt19937 rng(t);
+      std::vector<std::pair<void*, size_t>> held;
+      for (int i = 0; i < 2000; ++i) {
+        if (held.size() < 32 && (held.empty() || rng() % 2)) {
+          dim_t size =
+              rng() % 8 == 0 ? rng() % (2 << 20) + 1 : rng() % 65536 + 1;
+          void* ptr = manager.alloc(false, 1, &size, 1);
+          std::memset(ptr, t + 1, size);
+          held.emplace_back(ptr, size);
+        } else {
+          auto idx = rng() % held.size();
+          auto* bytes = static_cast<unsigned char*>(held[idx].first);
+          for (size_t j = 0; j < held[idx].second; j += 61) {
+            failures[t] += (bytes[j] != t + 1);
+          }
+          manager.unlock(held[idx].first, false);
+          held.erase(held.begin() + idx);
+        }
+        if (t == 0 && i % 500 == 0) {
+          manager.signalMemoryCleanup();
+        }
+      }
+      for (auto& block : held) {
+        manager.unlock(block.first, false);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < nThreads; ++t) {
+    ASSERT_EQ(failures[t], 0);
+  }
+  manager.signalMemoryCleanup();
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
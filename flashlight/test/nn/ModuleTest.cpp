@@ -479,6 +479,71 @@ TEST(ModuleTest, IdentityFwd) {
   ASSERT_TRUE(allClose(out.at(1), in.at(1), 1e-20));
 }
 
+TEST(ModuleTest, CheckpointGrad) {
+  auto makeModel = []() {
+    Sequential model;
+    model.add(Linear(6, 8));
+    model.add(ReLU());
+    model.add(Linear(8, 4));
+    model.add(Tanh());
+    model.add(Linear(4, 3));
+    return model;
+  };
+  auto model = makeModel();
+  auto checkpointed = makeModel();
+  for (int i = 0; i < model.params().size(); ++i) {
+    checkpointed.setParams(model.param(i), i);
+  }
+  checkpointed.setCheckpointEvery(2);
+
+  auto runBackward = [](Sequential& seq, Variable in) {
+    seq.zeroGrad();
+    in.zeroGrad();
+    auto out = seq(in);
+    out.backward();
+    std::vector<af::array> grads = {out.array(), in.grad().array()};
+    for (const auto& p : seq.params()) {
+      grads.push_back(p.grad().array().copy());
+    }
+    return grads;
+  };
+  auto in = Variable(af::randu(6, 5), true);
+  auto expected = runBackward(model, in);
+  auto grads = runBackward(checkpointed, in);
+  ASSERT_EQ(grads.size(), expected.size());
+  for (int i = 0; i < grads.size(); ++i) {
+    ASSERT_TRUE(allClose(grads[i], expected[i], 1E-5));
+  }
+
+  // Parameters still get gradients when the input doesn't require any
+  auto constIn = Variable(in.array(), false);
+  checkpointed.zeroGrad();
+  checkpointed(constIn).backward();
+  model.zeroGrad();
+  model(constIn).backward();
+  for (int i = 0; i < model.params().size(); ++i) {
+    ASSERT_TRUE(allClose(
+        checkpointed.param(i).grad().array(),
+        model.param(i).grad().array(),
+        1E-5));
+  }
+}
+
+TEST(ModuleTest, CheckpointDropout) {
+  auto module = Checkpoint(Dropout(0.5));
+  module.train();
+  auto in = Variable(af::randu(100, 10) + 1, true);
+  auto out = module.forward({in}).front();
+  out.backward();
+  // The recomputation must drop the same elements
+  auto kept = (out.array() != 0).as(f32);
+  ASSERT_TRUE(allClose(in.grad().array(), 2 * kept, 1E-5));
+
+  // Eval mode runs the module as is
+  module.eval();
+  ASSERT_TRUE(allClose(module.forward({in}).front().array(), in.array()));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
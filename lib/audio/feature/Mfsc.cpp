@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <numeric>
+#include <stdexcept>
 
 #include "flashlight/lib/audio/feature/SpeechUtils.h"
 
@@ -77,6 +78,74 @@ std::vector<float> Mfsc::apply(const std::vector<float>& input) {
   return derivatives_.apply(mfscFeat, numFeat);
 }
 
+void Mfsc::applyFrames(const float* signal, int nFrames, float* output)
+    const {
+  if (this->featParams_.ditherVal != 0.0 ||
+      this->featParams_.deltaWindow > 0 || this->featParams_.accWindow > 0) {
+    throw std::invalid_argument(
+        "Mfsc::applyFrames: dithering and derivatives are not supported");
+  }
+  if (nFrames <= 0) {
+    return;
+  }
+
+  int nSamples = this->featParams_.numFrameSizeSamples();
+  int frameStride = this->featParams_.numFrameStrideSamples();
+  int K = this->featParams_.filterFreqResponseLen();
+  bool useEnergy = this->featParams_.useEnergy;
+  int numFeat = this->featParams_.numFilterbankChans + (useEnergy ? 1 : 0);
+
+  auto energy = [nSamples](const float* frame) {
+    return std::log(std::max(
+        std::inner_product(
+            frame, frame + nSamples, frame, static_cast<float>(0.0)),
+        std::numeric_limits<float>::lowest()));
+  };
+
+  std::vector<float> frames(nFrames * nSamples);
+  for (size_t f = 0; f < nFrames; ++f) {
+    // Same scaling as frameSignal()
+    const float* begin = signal + f * frameStride;
+    float* frame = frames.data() + f * nSamples;
+    std::transform(
+        begin, begin + nSamples, frame, [](float x) { return 32768.0f * x; });
+    if (useEnergy && this->featParams_.rawEnergy) {
+      output[f * numFeat] = energy(frame);
+    }
+  }
+  std::vector<float> powspectrum(nFrames * K);
+  this->framesSpectrum(frames.data(), nFrames, powspectrum.data());
+  if (useEnergy && !this->featParams_.rawEnergy) {
+    for (size_t f = 0; f < nFrames; ++f) {
+      output[f * numFeat] = energy(frames.data() + f * nSamples);
+    }
+  }
+  if (this->featParams_.usePower) {
+    std::transform(
+        powspectrum.begin(),
+        powspectrum.end(),
+        powspectrum.begin(),
+        [](float x) { return x * x; });
+  }
+
+  // Energy, if any, comes first in each output frame
+  float* filterbankOutput = output + (useEnergy ? 1 : 0);
+  triFltBank_.apply(
+      powspectrum.data(),
+      nFrames,
+      this->featParams_.melFloor,
+      filterbankOutput,
+      numFeat);
+  for (size_t f = 0; f < nFrames; ++f) {
+    float* begin = filterbankOutput + f * numFeat;
+    std::transform(
+        begin,
+        begin + this->featParams_.numFilterbankChans,
+        begin,
+        [](float x) { return std::log(x); });
+  }
+}
+
 std::vector<float> Mfsc::mfscImpl(std::vector<float>& frames) {
   auto powspectrum = this->powSpectrumImpl(frames);
   if (this->featParams_.usePower) {
@@ -29,6 +29,13 @@ class Mfsc : public PowerSpectrum {
   // Returns - MFSC feature (Col Major : FEAT X FRAMESZ)
   std::vector<float> apply(const std::vector<float>& input) override;
 
+  // Streaming version of apply() that reads the frames in place and writes
+  // directly to output. Frame f starts at signal + f * numFrameStrideSamples().
+  // Writes nFrames x mfscFeatSz() features (Col Major : FEAT X FRAMESZ).
+  // Can be called concurrently from many threads. Dithering and derivatives
+  // are not supported.
+  void applyFrames(const float* signal, int nFrames, float* output) const;
+
   int outputSize(int inputSz) override;
 
  protected:
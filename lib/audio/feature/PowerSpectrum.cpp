@@ -9,6 +9,10 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <thread>
 #include <unordered_map>
 
 #include "flashlight/lib/audio/feature/SpeechUtils.h"
@@ -17,17 +21,64 @@ namespace fl {
 namespace lib {
 namespace audio {
 
+namespace {
+// The FFTW planner is not thread-safe, unlike plan execution.
+std::mutex fftwPlannerMutex;
+} // namespace
+
+constexpr int PowerSpectrum::kFftBatchSize;
+
+PowerSpectrum::FftBuffers::FftBuffers(int nFft)
+    : in(static_cast<double*>(
+          fftw_malloc(sizeof(double) * nFft * kFftBatchSize))),
+      out(static_cast<fftw_complex*>(fftw_malloc(
+          sizeof(fftw_complex) * outStride(nFft) * kFftBatchSize))) {}
+
+PowerSpectrum::FftBuffers::~FftBuffers() {
+  fftw_free(in);
+  fftw_free(out);
+}
+
+int PowerSpectrum::FftBuffers::outStride(int nFft) {
+  // nFft / 2 + 1 rounded up to an even number keeps every frame 32 bytes
+  // aligned, like the start of the buffer
+  return (nFft / 2 + 2) & ~1;
+}
+
+PowerSpectrum::FftBuffers& PowerSpectrum::threadFftBuffers(int nFft) {
+  thread_local std::unordered_map<int, std::unique_ptr<FftBuffers>> buffers;
+  auto& fftBuffers = buffers[nFft];
+  if (!fftBuffers) {
+    fftBuffers.reset(new FftBuffers(nFft));
+  }
+  return *fftBuffers;
+}
+
 PowerSpectrum::PowerSpectrum(const FeatureParams& params)
     : featParams_(params),
       dither_(params.ditherVal),
       preEmphasis_(params.preemCoef, params.numFrameSizeSamples()),
       windowing_(params.numFrameSizeSamples(), params.windowType) {
   validatePowSpecParams();
-  auto nFFt = featParams_.nFft();
-  inFftBuf_.resize(nFFt, 0.0);
-  outFftBuf_.resize(2 * nFFt);
+  int nFFt = featParams_.nFft();
+  int outStride = FftBuffers::outStride(nFFt);
+  FftBuffers fftBuffers(nFFt);
+  std::lock_guard<std::mutex> lock(fftwPlannerMutex);
   fftPlan_ = fftw_plan_dft_r2c_1d(
-      nFFt, inFftBuf_.data(), (fftw_complex*)outFftBuf_.data(), FFTW_MEASURE);
+      nFFt, fftBuffers.in, fftBuffers.out, FFTW_MEASURE);
+  fftBatchPlan_ = fftw_plan_many_dft_r2c(
+      1, // rank
+      &nFFt,
+      kFftBatchSize, // howmany
+      fftBuffers.in,
+      nullptr, // inembed
+      1, // istride
+      nFFt, // idist
+      fftBuffers.out,
+      nullptr, // onembed
+      1, // ostride
+      outStride, // odist
+      FFTW_MEASURE);
 }
 
 std::vector<float> PowerSpectrum::apply(const std::vector<float>& input) {
@@ -41,48 +92,66 @@ std::vector<float> PowerSpectrum::apply(const std::vector<float>& input) {
 std::vector<float> PowerSpectrum::powSpectrumImpl(std::vector<float>& frames) {
   int nSamples = featParams_.numFrameSizeSamples();
   int nFrames = frames.size() / nSamples;
-  int nFft = featParams_.nFft();
   int K = featParams_.filterFreqResponseLen();
 
   if (featParams_.ditherVal != 0.0) {
-    frames = dither_.apply(frames);
-  }
-  if (featParams_.zeroMeanFrame) {
-    for (size_t f = 0; f < nFrames; ++f) {
-      auto begin = frames.data() + f * nSamples;
-      float mean = std::accumulate(begin, begin + nSamples, 0.0);
-      mean /= nSamples;
-      std::transform(
-          begin, begin + nSamples, begin, [mean](float x) { return x - mean; });
-    }
-  }
-  if (featParams_.preemCoef != 0) {
-    preEmphasis_.applyInPlace(frames);
+    std::lock_guard<std::mutex> lock(ditherMutex_);
+    dither_.applyInPlace(frames);
   }
-  windowing_.applyInPlace(frames);
   std::vector<float> dft(K * nFrames);
-  for (size_t f = 0; f < nFrames; ++f) {
-    auto begin = frames.data() + f * nSamples;
-    {
-      std::lock_guard<std::mutex> lock(fftMutex_);
-      std::copy(begin, begin + nSamples, inFftBuf_.data());
-      std::fill(outFftBuf_.begin(), outFftBuf_.end(), 0.0);
-      fftw_execute(fftPlan_);
-
-      // Copy stuff to the redundant part
-      for (size_t i = K; i < nFft; ++i) {
-        outFftBuf_[2 * i] = outFftBuf_[2 * nFft - 2 * i];
-        outFftBuf_[2 * i + 1] = -outFftBuf_[2 * nFft - 2 * i + 1];
+  framesSpectrum(frames.data(), nFrames, dft.data());
+  return dft;
+}
+
+void PowerSpectrum::framesSpectrum(float* frames, int nFrames, float* output)
+    const {
+  int nSamples = featParams_.numFrameSizeSamples();
+  int nFft = featParams_.nFft();
+  int K = featParams_.filterFreqResponseLen();
+  int outStride = FftBuffers::outStride(nFft);
+  FftBuffers& fftBuffers = threadFftBuffers(nFft);
+
+  for (int start = 0; start < nFrames; start += kFftBatchSize) {
+    int batchSize = std::min(kFftBatchSize, nFrames - start);
+    for (int i = 0; i < batchSize; ++i) {
+      float* frame = frames + (start + i) * nSamples;
+      if (featParams_.zeroMeanFrame) {
+        float mean = std::accumulate(frame, frame + nSamples, 0.0);
+        mean /= nSamples;
+        std::transform(frame, frame + nSamples, frame, [mean](float x) {
+          return x - mean;
+        });
+      }
+      if (featParams_.preemCoef != 0) {
+        preEmphasis_.applyInPlace(frame, nSamples);
+      }
+      windowing_.applyInPlace(frame, nSamples);
+      // The buffers are shared with instances of other frame sizes, so the
+      // zero padding is written for every frame
+      double* fftIn = fftBuffers.in + i * nFft;
+      std::copy(frame, frame + nSamples, fftIn);
+      std::fill(fftIn + nSamples, fftIn + nFft, 0.0);
+    }
+
+    if (batchSize == kFftBatchSize) {
+      fftw_execute_dft_r2c(fftBatchPlan_, fftBuffers.in, fftBuffers.out);
+    } else {
+      for (int i = 0; i < batchSize; ++i) {
+        fftw_execute_dft_r2c(
+            fftPlan_,
+            fftBuffers.in + i * nFft,
+            fftBuffers.out + i * outStride);
       }
+    }
 
-      for (size_t i = 0; i < K; ++i) {
-        dft[f * K + i] = std::sqrt(
-            outFftBuf_[2 * i] * outFftBuf_[2 * i] +
-            outFftBuf_[2 * i + 1] * outFftBuf_[2 * i + 1]);
+    for (int i = 0; i < batchSize; ++i) {
+      const fftw_complex* dft = fftBuffers.out + i * outStride;
+      float* dftAbs = output + (start + i) * K;
+      for (int k = 0; k < K; ++k) {
+        dftAbs[k] = std::sqrt(dft[k][0] * dft[k][0] + dft[k][1] * dft[k][1]);
       }
     }
   }
-  return dft;
 }
 
 std::vector<float> PowerSpectrum::batchApply(
@@ -98,16 +167,44 @@ std::vector<float> PowerSpectrum::batchApply(
   int outputSz = outputSize(N);
   std::vector<float> feat(outputSz * batchSz);
 
-#pragma omp parallel for num_threads(batchSz)
-  for (int b = 0; b < batchSz; ++b) {
-    auto start = input.begin() + b * N;
-    std::vector<float> inputBuf(start, start + N);
-    auto curFeat = apply(inputBuf);
-    if (outputSz != curFeat.size()) {
-      throw std::logic_error("PowerSpectrum: apply() returned wrong size");
+  auto applyRange = [&](int threadIdx, int nThreads) {
+    for (int b = threadIdx; b < batchSz; b += nThreads) {
+      auto start = input.begin() + b * N;
+      std::vector<float> inputBuf(start, start + N);
+      auto curFeat = apply(inputBuf);
+      if (outputSz != curFeat.size()) {
+        throw std::logic_error("PowerSpectrum: apply() returned wrong size");
+      }
+      std::copy(
+          curFeat.begin(), curFeat.end(), feat.begin() + b * curFeat.size());
+    }
+  };
+
+  int nThreads = std::min<int>(
+      batchSz, std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(nThreads);
+  for (int t = 1; t < nThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      try {
+        applyRange(t, nThreads);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  try {
+    applyRange(0, nThreads);
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
     }
-    std::copy(
-        curFeat.begin(), curFeat.end(), feat.begin() + b * curFeat.size());
   }
   return feat;
 }
@@ -135,7 +232,9 @@ void PowerSpectrum::validatePowSpecParams() const {
 }
 
 PowerSpectrum::~PowerSpectrum() {
+  std::lock_guard<std::mutex> lock(fftwPlannerMutex);
   fftw_destroy_plan(fftPlan_);
+  fftw_destroy_plan(fftBatchPlan_);
 }
 } // namespace audio
 } // namespace lib
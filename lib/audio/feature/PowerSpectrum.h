@@ -21,6 +21,10 @@ namespace lib {
 namespace audio {
 
 // Computes Power Spectrum features for a speech signal.
+//
+// apply() and batchApply() can be called concurrently from many threads. The
+// FFT plans are created once and executed on FFT buffers owned by the calling
+// thread, so threads never wait on each other except for dithering.
 
 class PowerSpectrum {
  public:
@@ -34,6 +38,8 @@ class PowerSpectrum {
 
   // input - input speech signal (Col Major : T X BATCHSZ)
   // Returns - Output features (Col Major : FEAT X FRAMESZ X BATCHSZ)
+  // The batch is split across up to std::thread::hardware_concurrency()
+  // threads.
   std::vector<float> batchApply(const std::vector<float>& input, int batchSz);
 
   virtual int outputSize(int inputSz);
@@ -47,17 +53,49 @@ class PowerSpectrum {
   // frames. Main purpose of this function is to reuse it in MFSC, MFCC code
   std::vector<float> powSpectrumImpl(std::vector<float>& frames);
 
+  // Computes the spectrum of nFrames frames of numFrameSizeSamples() samples,
+  // stored one after the other, into nFrames x filterFreqResponseLen() values
+  // of output. The frames are zero-meaned, pre-emphasized and windowed in
+  // place. Dithering is left to the caller.
+  void framesSpectrum(float* frames, int nFrames, float* output) const;
+
   void validatePowSpecParams() const;
 
  private:
+  // Number of frames transformed by a single execution of fftBatchPlan_
+  static constexpr int kFftBatchSize = 32;
+
+  // FFT input and output buffers of kFftBatchSize frames. fftw_malloc() gives
+  // them the alignment the plans were created with, and the frame strides
+  // keep it, as fftw_execute_dft_r2c() requires.
+  class FftBuffers {
+   public:
+    explicit FftBuffers(int nFft);
+    ~FftBuffers();
+    FftBuffers(const FftBuffers&) = delete;
+    FftBuffers& operator=(const FftBuffers&) = delete;
+
+    // Distance between two frames of out, in complex numbers
+    static int outStride(int nFft);
+
+    double* in;
+    fftw_complex* out;
+  };
+
+  // Returns the FFT buffers of the calling thread for frames of nFft samples.
+  // They are shared by all the instances with the same nFft, whatever their
+  // numFrameSizeSamples(), so they hold no state between calls.
+  static FftBuffers& threadFftBuffers(int nFft);
+
   // The following classes are defined in the order they are applied
   Dither dither_;
+  std::mutex ditherMutex_;
   PreEmphasis preEmphasis_;
   Windowing windowing_;
 
+  // Plans for a single frame, and for kFftBatchSize frames at once
   fftw_plan fftPlan_;
-  std::vector<double> inFftBuf_, outFftBuf_;
-  std::mutex fftMutex_;
+  fftw_plan fftBatchPlan_;
 };
 } // namespace audio
 } // namespace lib
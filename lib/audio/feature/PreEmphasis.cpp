@@ -31,11 +31,15 @@ std::vector<float> PreEmphasis::apply(const std::vector<float>& input) const {
 }
 
 void PreEmphasis::applyInPlace(std::vector<float>& input) const {
-  if (input.size() % windowLength_ != 0) {
+  applyInPlace(input.data(), input.size());
+}
+
+void PreEmphasis::applyInPlace(float* input, int size) const {
+  if (size % windowLength_ != 0) {
     throw std::invalid_argument(
         "PreEmphasis: input.size() not divisible by windowLength");
   }
-  size_t nframes = input.size() / windowLength_;
+  size_t nframes = size / windowLength_;
   for (size_t n = nframes; n > 0; --n) {
     size_t e = n * windowLength_ - 1; // end of current frame
     size_t s = (n - 1) * windowLength_; // start of current frame
@@ -25,6 +25,9 @@ class PreEmphasis {
 
   void applyInPlace(std::vector<float>& input) const;
 
+  // Same as above on the size elements starting at input.
+  void applyInPlace(float* input, int size) const;
+
  private:
   float preemCoef_;
   int windowLength_;
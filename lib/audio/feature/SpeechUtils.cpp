@@ -55,6 +55,19 @@ std::vector<float> cblasGemm(
 
   std::vector<float> matC(m * n);
 
+  cblasGemm(matA.data(), matB.data(), matC.data(), m, n, k, n);
+
+  return matC;
+};
+
+void cblasGemm(
+    const float* matA,
+    const float* matB,
+    float* matC,
+    int m,
+    int n,
+    int k,
+    int ldc) {
 #if FL_LIBRARIES_USE_MKL
   auto prevMaxThreads = mkl_get_max_threads();
   mkl_set_num_threads_local(1);
@@ -70,22 +83,20 @@ std::vector<float> cblasGemm(
       n,
       k,
       1.0, // alpha
-      matA.data(),
+      matA,
       k,
-      matB.data(),
+      matB,
       n,
       0.0, // beta
-      matC.data(),
-      n);
+      matC,
+      ldc);
 
 #if FL_LIBRARIES_USE_MKL
   mkl_set_num_threads_local(prevMaxThreads);
 #else
 // TODO: to be tested
 #endif
-
-  return matC;
-};
+}
 } // namespace audio
 } // namespace lib
 } // namespace fl
@@ -28,6 +28,17 @@ std::vector<float> cblasGemm(
     const std::vector<float>& matB,
     int n,
     int k);
+
+// row major;  matA - m x k , matB - k x n, matC - m x n with row stride ldc
+
+void cblasGemm(
+    const float* matA,
+    const float* matB,
+    float* matC,
+    int m,
+    int n,
+    int k,
+    int ldc);
 } // namespace audio
 } // namespace lib
 } // namespace fl
@@ -65,6 +65,28 @@ std::vector<float> TriFilterbank::apply(
   return output;
 }
 
+void TriFilterbank::apply(
+    const float* input,
+    int nFrames,
+    float melfloor,
+    float* output,
+    int outputStride) const {
+  cblasGemm(
+      input,
+      H_.data(),
+      output,
+      nFrames,
+      numFilters_,
+      filterLen_,
+      outputStride);
+  for (int f = 0; f < nFrames; ++f) {
+    float* row = output + f * outputStride;
+    std::transform(row, row + numFilters_, row, [melfloor](float n) -> float {
+      return std::max(n, melfloor);
+    });
+  }
+}
+
 std::vector<float> TriFilterbank::filterbank() const {
   return H_;
 }
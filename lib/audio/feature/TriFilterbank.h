@@ -30,6 +30,15 @@ class TriFilterbank {
       const std::vector<float>& input,
       float melfloor = 0.0) const;
 
+  // Same as above on nFrames rows of filterlen values starting at input.
+  // Row f of the result is written at output + f * outputStride.
+  void apply(
+      const float* input,
+      int nFrames,
+      float melfloor,
+      float* output,
+      int outputStride) const;
+
   // Returns triangular filterbank matrix
   std::vector<float> filterbank() const;
 
@@ -45,13 +45,17 @@ std::vector<float> Windowing::apply(const std::vector<float>& input) const {
 }
 
 void Windowing::applyInPlace(std::vector<float>& input) const {
-  if (input.size() % windowLength_ != 0) {
+  applyInPlace(input.data(), input.size());
+}
+
+void Windowing::applyInPlace(float* input, int size) const {
+  if (size % windowLength_ != 0) {
     throw std::invalid_argument(
         "Windowing: input size is not divisible by windowLength");
   }
   size_t n = 0;
-  for (auto& in : input) {
-    in *= coefs_[n++];
+  for (int i = 0; i < size; ++i) {
+    input[i] *= coefs_[n++];
     if (n == windowLength_) {
       n = 0;
     }
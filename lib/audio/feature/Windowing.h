@@ -27,6 +27,9 @@ class Windowing {
 
   void applyInPlace(std::vector<float>& input) const;
 
+  // Same as above on the size elements starting at input.
+  void applyInPlace(float* input, int size) const;
+
  private:
   int windowLength_;
   WindowType windowType_;
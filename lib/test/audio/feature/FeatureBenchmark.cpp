@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Measures the throughput of a single Mfcc featurizer shared by an increasing
+// number of threads, in frames of features per second.
+//
+// FeatureBenchmark [seconds of audio per call] [calls per thread]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "flashlight/lib/audio/feature/Mfcc.h"
+#include "flashlight/lib/test/audio/feature/TestUtils.h"
+
+using namespace fl::lib::audio;
+
+int main(int argc, char** argv) {
+  int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+  int nCalls = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  FeatureParams params;
+  params.samplingFreq = 16000;
+  params.numCepstralCoeffs = 13;
+  params.numFilterbankChans = 40;
+  params.lifterParam = 22;
+  params.deltaWindow = 2;
+  params.accWindow = 2;
+  Mfcc mfcc(params);
+
+  auto input = randVec<float>(params.samplingFreq * seconds);
+  int framesPerCall = params.numFrames(input.size());
+
+  int maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+  for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+      threads.emplace_back([&]() {
+        for (int i = 0; i < nCalls; ++i) {
+          mfcc.apply(input);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsedSec = std::chrono::duration<double>(end - start).count();
+    std::cout << nThreads << " threads: "
+              << framesPerCall * nCalls * nThreads / elapsedSec
+              << " frames/sec" << std::endl;
+  }
+  return 0;
+}
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <iterator>
 #include <sstream>
+#include <thread>
 
 #include "flashlight/lib/audio/feature/FeatureParams.h"
 #include "flashlight/lib/audio/feature/Mfcc.h"
@@ -200,6 +201,97 @@ TEST(MfccTest, ZeroInputTest) {
   }
 }
 
+TEST(MfccTest, ApplyFramesTest) {
+  int Tmax = 10000;
+  auto input = randVec<float>(Tmax);
+  FeatureParams featparams;
+  featparams.deltaWindow = 0;
+  featparams.accWindow = 0;
+  std::vector<bool> energies = {true, false};
+  std::vector<bool> rawEnergies = {true, false};
+  std::vector<bool> zMeans = {true, false};
+  std::vector<bool> usePow = {true, false};
+
+  for (auto e : energies) {
+    for (auto r : rawEnergies) {
+      for (auto z : zMeans) {
+        for (auto p : usePow) {
+          featparams.useEnergy = e;
+          featparams.rawEnergy = r;
+          featparams.zeroMeanFrame = z;
+          featparams.usePower = p;
+
+          Mfsc mfsc(featparams);
+          auto expected = mfsc.apply(input);
+
+          // Featurize in two calls, the second one reading the frames that
+          // overlap the first call from the same input.
+          int nFrames = featparams.numFrames(Tmax);
+          int nFirstFrames = nFrames / 3;
+          std::vector<float> output(mfsc.outputSize(Tmax));
+          mfsc.applyFrames(input.data(), nFirstFrames, output.data());
+          mfsc.applyFrames(
+              input.data() + nFirstFrames * featparams.numFrameStrideSamples(),
+              nFrames - nFirstFrames,
+              output.data() + nFirstFrames * featparams.mfscFeatSz());
+          ASSERT_EQ(output.size(), expected.size());
+          for (int j = 0; j < output.size(); ++j) {
+            ASSERT_NEAR(output[j], expected[j], 1E-4);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(MfccTest, ConcurrentApplyTest) {
+  int nThreads = 8;
+  FeatureParams featparams;
+  Mfcc mfcc(featparams);
+  std::vector<std::vector<float>> inputs, expected;
+  for (int i = 0; i < nThreads; ++i) {
+    inputs.push_back(randVec<float>(5000 + 100 * i));
+    expected.push_back(mfcc.apply(inputs.back()));
+  }
+
+  std::vector<std::vector<float>> outputs(nThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int trial = 0; trial < 5; ++trial) {
+        outputs[i] = mfcc.apply(inputs[i]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < nThreads; ++i) {
+    ASSERT_TRUE(compareVec(outputs[i], expected[i], 1E-4));
+  }
+}
+
+TEST(MfccTest, SharedFftBuffersTest) {
+  // Frames of 400 and 320 samples are both padded to 512 for the FFT, and
+  // use the same FFT buffers of the calling thread
+  FeatureParams longFrameParams, shortFrameParams;
+  longFrameParams.frameSizeMs = 25;
+  shortFrameParams.frameSizeMs = 20;
+  ASSERT_EQ(longFrameParams.nFft(), shortFrameParams.nFft());
+  ASSERT_NE(
+      longFrameParams.numFrameSizeSamples(),
+      shortFrameParams.numFrameSizeSamples());
+  Mfcc longFrameMfcc(longFrameParams), shortFrameMfcc(shortFrameParams);
+  auto input = randVec<float>(10000);
+
+  // Featurize on a thread which never used the buffers
+  std::vector<float> expected;
+  std::thread([&]() { expected = shortFrameMfcc.apply(input); }).join();
+
+  longFrameMfcc.apply(input);
+  ASSERT_TRUE(compareVec(shortFrameMfcc.apply(input), expected, 1E-4));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
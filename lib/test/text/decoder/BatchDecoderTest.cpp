@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/text/decoder/BatchDecoder.h"
+#include "flashlight/lib/text/decoder/LexiconDecoder.h"
+#include "flashlight/lib/text/decoder/LexiconFreeDecoder.h"
+
+using namespace fl::lib::text;
+
+namespace {
+
+const int kNTokens = 8;
+const int kBlank = kNTokens - 1;
+const int kSil = 0;
+
+// A deterministic LM with states made of the hash of their history, which
+// counts how many times it is called
+struct HashLMState : LMState {
+  int hash{0};
+};
+
+class HashLM : public LM {
+ public:
+  int nScoreBatchCalls{0};
+
+  LMStatePtr start(bool /* startWithNothing */) override {
+    return std::make_shared<HashLMState>();
+  }
+
+  std::pair<LMStatePtr, float> score(const LMStatePtr& state, const int token)
+      override {
+    auto outState = state->child<HashLMState>(token);
+    outState->hash =
+        (std::static_pointer_cast<HashLMState>(state)->hash * 31 + token) % 101;
+    return std::make_pair(outState, -(outState->hash % 7) / 3.0f);
+  }
+
+  std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override {
+    auto hash = std::static_pointer_cast<HashLMState>(state)->hash;
+    return std::make_pair(state, -(hash % 5) / 2.0f);
+  }
+
+  void scoreBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices,
+      std::vector<LMStatePtr>& outStates,
+      std::vector<float>& outScores) override {
+    ++nScoreBatchCalls;
+    LM::scoreBatch(states, usrTokenIndices, outStates, outScores);
+  }
+};
+
+void checkSameResults(
+    const std::vector<DecodeResult>& expected,
+    const std::vector<DecodeResult>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(expected[i].score, actual[i].score);
+    ASSERT_EQ(expected[i].words, actual[i].words);
+    ASSERT_EQ(expected[i].tokens, actual[i].tokens);
+  }
+}
+
+} // namespace
+
+TEST(BatchDecoderTest, MatchesSequentialDecoding) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> emission(-5, 0);
+  const std::vector<int> nFrames = {12, 0, 30, 5, 21, 1};
+  std::vector<std::vector<float>> emissions;
+  std::vector<const float*> emissionPtrs;
+  for (int T : nFrames) {
+    std::vector<float> e(T * kNTokens);
+    for (auto& x : e) {
+      x = emission(rng);
+    }
+    emissions.push_back(std::move(e));
+    emissionPtrs.push_back(emissions.back().data());
+  }
+
+  auto trie = std::make_shared<Trie>(kNTokens, kSil);
+  trie->insert({1, 2}, 0, -1);
+  trie->insert({1, 3, 4}, 1, -2);
+  trie->insert({5}, 2, -0.5);
+  trie->insert({2, 6, 6}, 3, -1.5);
+  trie->smear(SmearingMode::MAX);
+  auto flatTrie = std::make_shared<FlatTrie>(*trie);
+
+  DecoderOptions opt(
+      20, kNTokens, 50, 0.5, 0.2, -10, 0, 0, false, CriterionType::CTC);
+  auto lm = std::make_shared<HashLM>();
+  auto lexiconDecoder = [&]() {
+    return std::make_shared<LexiconDecoder>(
+        opt, flatTrie, lm, kSil, kBlank, 4, std::vector<float>(), false);
+  };
+  auto lexiconFreeDecoder = [&]() {
+    return std::make_shared<LexiconFreeDecoder>(
+        opt, lm, kSil, kBlank, std::vector<float>());
+  };
+
+  for (bool lexiconFree : {false, true}) {
+    std::vector<std::vector<DecodeResult>> expected;
+    for (int i = 0; i < nFrames.size(); i++) {
+      std::shared_ptr<Decoder> decoder = lexiconFree
+          ? std::shared_ptr<Decoder>(lexiconFreeDecoder())
+          : std::shared_ptr<Decoder>(lexiconDecoder());
+      expected.push_back(
+          decoder->decode(emissionPtrs[i], nFrames[i], kNTokens));
+    }
+
+    std::vector<std::shared_ptr<Decoder>> decoders;
+    for (int i = 0; i < 3; i++) {
+      if (lexiconFree) {
+        decoders.push_back(lexiconFreeDecoder());
+      } else {
+        decoders.push_back(lexiconDecoder());
+      }
+    }
+    BatchDecoder batchDecoder(lm, decoders);
+    lm->nScoreBatchCalls = 0;
+    auto results = batchDecoder.decode(emissionPtrs, nFrames, kNTokens);
+    ASSERT_EQ(results.size(), nFrames.size());
+    for (int i = 0; i < nFrames.size(); i++) {
+      checkSameResults(expected[i], results[i]);
+    }
+    // Frames of different utterances are scored together
+    ASSERT_LT(lm->nScoreBatchCalls, 30 + 12);
+  }
+}
+
+TEST(BatchDecoderTest, InvalidArguments) {
+  auto lm = std::make_shared<HashLM>();
+  ASSERT_THROW(BatchDecoder(lm, {}), std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
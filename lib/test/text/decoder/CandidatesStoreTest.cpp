@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/text/decoder/Utils.h"
+
+using namespace fl::lib::text;
+
+namespace {
+
+struct TestState {
+  double score;
+  int key;
+  int id;
+
+  TestState(double score, int key, int id) : score(score), key(key), id(id) {}
+
+  int compareNoScoreStates(const TestState* node) const {
+    if (key != node->key) {
+      return key > node->key ? 1 : -1;
+    }
+    return 0;
+  }
+
+  size_t hashNoScoreStates() const {
+    // Collide on purpose to exercise probing
+    return key % 7;
+  }
+};
+
+std::vector<TestState> store(
+    const std::vector<TestState>& input,
+    int beamSize,
+    bool logAdd,
+    MergeMode mergeMode) {
+  std::vector<TestState> candidates = input;
+  std::vector<TestState*> candidatePtrs;
+  std::vector<TestState> outputs;
+  CandidateHashTable hashTable;
+  candidatesStore(
+      candidates,
+      candidatePtrs,
+      outputs,
+      beamSize,
+      -5.0,
+      logAdd,
+      true,
+      mergeMode,
+      &hashTable);
+  return outputs;
+}
+
+} // namespace
+
+TEST(CandidatesStoreTest, HashMatchesSort) {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> key(0, 40);
+  std::uniform_real_distribution<double> score(-6, 0);
+  std::vector<TestState> input;
+  for (int i = 0; i < 200; ++i) {
+    input.emplace_back(score(rng), key(rng), i);
+  }
+
+  for (bool logAdd : {false, true}) {
+    for (int beamSize : {10, 1000}) {
+      auto sorted = store(input, beamSize, logAdd, MergeMode::SORT);
+      auto hashed = store(input, beamSize, logAdd, MergeMode::HASH);
+      ASSERT_EQ(sorted.size(), hashed.size());
+      for (int i = 0; i < sorted.size(); ++i) {
+        // Bit-exact scores, and the same best candidate kept for each state
+        ASSERT_EQ(sorted[i].score, hashed[i].score);
+        ASSERT_EQ(sorted[i].key, hashed[i].key);
+        ASSERT_EQ(sorted[i].id, hashed[i].id);
+      }
+    }
+  }
+}
+
+TEST(CandidatesStoreTest, HashMerge) {
+  std::vector<TestState> input = {
+      {-1.0, 3, 0}, {-0.5, 10, 1}, {-2.0, 3, 2}, {-0.2, 3, 3}, {-9.0, 4, 4}};
+  auto outputs = store(input, 10, false, MergeMode::HASH);
+  // The candidate below the threshold is dropped, key 3 is merged
+  ASSERT_EQ(outputs.size(), 2);
+  ASSERT_EQ(outputs[0].id, 3);
+  ASSERT_EQ(outputs[0].score, -0.2);
+  ASSERT_EQ(outputs[1].id, 1);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
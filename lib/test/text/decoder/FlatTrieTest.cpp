@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+
+using namespace fl::lib::text;
+
+namespace {
+
+const std::vector<std::vector<int>> kWords = {
+    {1, 2, 3},
+    {1, 2},
+    {1, 4},
+    {5},
+    {5, 2, 2, 3},
+};
+
+std::shared_ptr<Trie> buildTrie() {
+  auto trie = std::make_shared<Trie>(/* maxChildren = */ 6, /* rootIdx = */ 0);
+  for (int i = 0; i < kWords.size(); ++i) {
+    trie->insert(kWords[i], i, -1.0f * (i + 1));
+  }
+  // Homophone: two labels on the same node
+  trie->insert(kWords[0], 10, -0.5f);
+  trie->smear(SmearingMode::MAX);
+  return trie;
+}
+
+// Checks that the flat trie has the same structure and values as the trie
+void checkSameTrie(
+    const TrieNode* node,
+    const FlatTrie& flat,
+    const FlatTrieNode* flatNode) {
+  ASSERT_EQ(node->idx, flatNode->idx);
+  ASSERT_EQ(node->maxScore, flatNode->maxScore);
+  ASSERT_EQ(node->children.size(), flatNode->nChildren);
+  ASSERT_EQ(node->labels.size(), flatNode->nLabels);
+  for (int i = 0; i < flatNode->nLabels; ++i) {
+    ASSERT_EQ(node->labels[i], flat.labels(flatNode)[i]);
+    ASSERT_EQ(node->scores[i], flat.scores(flatNode)[i]);
+  }
+  for (const auto& child : node->children) {
+    const FlatTrieNode* flatChild = flat.getChild(flatNode, child.first);
+    ASSERT_NE(flatChild, nullptr);
+    checkSameTrie(child.second.get(), flat, flatChild);
+  }
+}
+
+} // namespace
+
+TEST(FlatTrieTest, Build) {
+  auto trie = buildTrie();
+  FlatTrie flat(*trie);
+
+  // root + 1, 1-2, 1-2-3, 1-4, 5, 5-2, 5-2-2, 5-2-2-3
+  ASSERT_EQ(flat.nNodes(), 9);
+  checkSameTrie(trie->getRoot(), flat, flat.getRoot());
+
+  ASSERT_EQ(flat.getChild(flat.getRoot(), 2), nullptr);
+  ASSERT_EQ(flat.search({1, 3}), nullptr);
+  const FlatTrieNode* node = flat.search({1, 2, 3});
+  ASSERT_NE(node, nullptr);
+  ASSERT_EQ(node->nLabels, 2);
+  ASSERT_EQ(flat.labels(node)[1], 10);
+  ASSERT_EQ(flat.search({}), flat.getRoot());
+  ASSERT_THROW(flat.search({7}), std::out_of_range);
+}
+
+TEST(FlatTrieTest, SaveLoad) {
+  auto trie = buildTrie();
+  FlatTrie flat(*trie);
+  char* user = getenv("USER");
+  std::string userstr = user != nullptr ? std::string(user) : "unknown";
+  std::string path = "/tmp/test_" + userstr + "_FlatTrie.bin";
+  flat.save(path);
+
+  auto loaded = FlatTrie::load(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(loaded->nNodes(), flat.nNodes());
+  checkSameTrie(trie->getRoot(), *loaded, loaded->getRoot());
+  ASSERT_THROW(loaded->search({6}), std::out_of_range);
+
+  ASSERT_THROW(FlatTrie::load(path), std::runtime_error);
+}
+
+TEST(FlatTrieTest, LoadCorrupted) {
+  auto trie = buildTrie();
+  FlatTrie flat(*trie);
+  char* user = getenv("USER");
+  std::string userstr = user != nullptr ? std::string(user) : "unknown";
+  std::string path = "/tmp/test_" + userstr + "_FlatTrieCorrupted.bin";
+
+  // Nodes follow the 32-byte file header, starting with the root
+  auto saveWithRootField = [&](size_t fieldOffset, uint32_t value) {
+    flat.save(path);
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(32 + fieldOffset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  saveWithRootField(offsetof(FlatTrieNode, firstChild), flat.nNodes() - 1);
+  ASSERT_THROW(FlatTrie::load(path), std::runtime_error);
+  saveWithRootField(offsetof(FlatTrieNode, firstLabel), 1000);
+  ASSERT_THROW(FlatTrie::load(path), std::runtime_error);
+  saveWithRootField(offsetof(FlatTrieNode, firstLabel), 0);
+  ASSERT_NO_THROW(FlatTrie::load(path));
+  std::remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+
+namespace {
+std::atomic<size_t> numAllocations{0};
+} // namespace
+
+// Count the allocations going through the system allocator
+void* operator new(size_t bytes) {
+  ++numAllocations;
+  if (void* ptr = std::malloc(bytes ? bytes : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /* unused */) noexcept {
+  std::free(ptr);
+}
+
+TEST(LMStatePoolTest, AllocateAndReuse) {
+  auto pool = std::make_shared<LMStatePool>(1024);
+  void* a = pool->allocate(40);
+  void* b = pool->allocate(40);
+  ASSERT_NE(a, b);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t), 0);
+  ASSERT_EQ(pool->liveBlocks(), 2);
+  ASSERT_EQ(pool->reservedBytes(), 1024);
+
+  pool->deallocate(a, 40);
+  ASSERT_EQ(pool->allocate(40), a);
+
+  // Another block size doesn't reuse blocks of a different size
+  pool->deallocate(b, 40);
+  ASSERT_NE(pool->allocate(100), b);
+
+  // Large blocks don't go to slabs
+  void* large = pool->allocate(1000);
+  ASSERT_EQ(pool->reservedBytes(), 1024);
+  pool->deallocate(large, 1000);
+}
+
+TEST(LMStatePoolTest, StateTree) {
+  ZeroLM lm;
+  auto root = lm.start(false);
+  ASSERT_NE(root->pool, nullptr);
+  auto pool = root->pool->shared_from_this();
+
+  auto child = lm.score(root, 3).first;
+  ASSERT_EQ(child->pool, root->pool);
+  ASSERT_EQ(lm.score(root, 3).first, child);
+  auto grandChild = lm.score(child, 4).first;
+  ASSERT_EQ(grandChild->pool, root->pool);
+  // Three states, plus a node and a bucket array in two maps of children
+  ASSERT_EQ(pool->liveBlocks(), 7);
+
+  // Children outlive their parents
+  root.reset();
+  child.reset();
+  ASSERT_EQ(pool->liveBlocks(), 1);
+  grandChild.reset();
+  ASSERT_EQ(pool->liveBlocks(), 0);
+
+  // States not created by a LM are allocated as before
+  auto state = std::make_shared<LMState>();
+  ASSERT_EQ(state->child<LMState>(1)->pool, nullptr);
+}
+
+TEST(LMStatePoolTest, NoAllocationPerState) {
+  ZeroLM lm;
+  auto root = lm.start(false);
+  std::vector<LMStatePtr> states;
+  states.reserve(1000);
+
+  // States, their reference counts and the nodes and buckets of the maps of
+  // children all come from the slabs of the pool
+  size_t before = numAllocations;
+  for (int i = 0; i < 10; ++i) {
+    states.push_back(lm.score(root, i).first);
+  }
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 99; ++j) {
+      states.push_back(lm.score(states[i], j).first);
+    }
+  }
+  ASSERT_EQ(states.size(), 1000);
+  ASSERT_LT(numAllocations - before, 100);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
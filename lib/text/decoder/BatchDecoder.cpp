@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/BatchDecoder.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+BatchDecoder::BatchDecoder(
+    LMPtr lm,
+    std::vector<std::shared_ptr<Decoder>> decoders)
+    : lm_(std::move(lm)), decoders_(std::move(decoders)) {
+  if (!lm_) {
+    throw std::invalid_argument("[BatchDecoder] LM is null");
+  }
+  if (decoders_.empty()) {
+    throw std::invalid_argument("[BatchDecoder] no decoders given");
+  }
+}
+
+std::vector<std::vector<DecodeResult>> BatchDecoder::decode(
+    const std::vector<const float*>& emissions,
+    const std::vector<int>& T,
+    int N) {
+  if (emissions.size() != T.size()) {
+    throw std::invalid_argument(
+        "[BatchDecoder] emissions and lengths have different sizes");
+  }
+  const int nUtterances = emissions.size();
+  std::vector<std::vector<DecodeResult>> results(nUtterances);
+
+  // Utterance decoded by each decoder (-1 if none) and its next frame
+  std::vector<int> utterance(decoders_.size(), -1);
+  std::vector<int> frame(decoders_.size(), 0);
+  std::vector<LMQueries*> decoderQueries(decoders_.size(), nullptr);
+  std::vector<size_t> queryOffset(decoders_.size() + 1, 0);
+  int nextUtterance = 0;
+
+  // Start the next utterance with decoder `d`, finishing empty ones at once
+  auto startNext = [&](int d) {
+    utterance[d] = -1;
+    while (nextUtterance < nUtterances) {
+      int u = nextUtterance++;
+      decoders_[d]->decodeBegin();
+      if (T[u] > 0) {
+        utterance[d] = u;
+        frame[d] = 0;
+        return;
+      }
+      decoders_[d]->decodeEnd();
+      results[u] = decoders_[d]->getAllFinalHypothesis();
+    }
+  };
+
+  int nActive = 0;
+  for (int d = 0; d < decoders_.size(); d++) {
+    startNext(d);
+    nActive += utterance[d] >= 0;
+  }
+
+  while (nActive > 0) {
+    /* 1. Expand all the utterances and gather their LM queries */
+    queries_.clear();
+    for (int d = 0; d < decoders_.size(); d++) {
+      queryOffset[d] = queries_.states.size();
+      if (utterance[d] < 0) {
+        continue;
+      }
+      auto& queries = decoders_[d]->expandFrame(
+          emissions[utterance[d]] + static_cast<size_t>(frame[d]) * N, N);
+      queries_.states.insert(
+          queries_.states.end(), queries.states.begin(), queries.states.end());
+      queries_.tokens.insert(
+          queries_.tokens.end(), queries.tokens.begin(), queries.tokens.end());
+      decoderQueries[d] = &queries;
+    }
+    queryOffset[decoders_.size()] = queries_.states.size();
+
+    /* 2. Score them at once */
+    queries_.score(*lm_);
+
+    /* 3. Hand the results back and prune the beams */
+    for (int d = 0; d < decoders_.size(); d++) {
+      if (utterance[d] < 0) {
+        continue;
+      }
+      auto& queries = *decoderQueries[d];
+      queries.outStates.assign(
+          std::make_move_iterator(
+              queries_.outStates.begin() + queryOffset[d]),
+          std::make_move_iterator(
+              queries_.outStates.begin() + queryOffset[d + 1]));
+      queries.outScores.assign(
+          queries_.outScores.begin() + queryOffset[d],
+          queries_.outScores.begin() + queryOffset[d + 1]);
+      decoders_[d]->pruneFrame();
+
+      if (++frame[d] == T[utterance[d]]) {
+        decoders_[d]->decodeEnd();
+        results[utterance[d]] = decoders_[d]->getAllFinalHypothesis();
+        startNext(d);
+        nActive -= utterance[d] < 0;
+      }
+    }
+  }
+  return results;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/Decoder.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * BatchDecoder decodes several utterances in lockstep, frame by frame, with
+ * decoders sharing one LM and usually one trie. The LM queries of all the
+ * utterances for a frame are scored with a single `LM::scoreBatch()` call,
+ * so that for instance ConvLM runs one large forward instead of one per
+ * utterance, and a single copy of the LM serves all of them.
+ *
+ * Each decoder (LexiconDecoder or LexiconFreeDecoder, which support
+ * frame-level decoding) decodes one utterance at a time: as soon as an
+ * utterance is finished, its decoder starts the next one.
+ *
+ * Example:
+ * \code
+ * std::vector<std::shared_ptr<Decoder>> decoders;
+ * for (int i = 0; i < 16; i++) {
+ *   decoders.push_back(std::make_shared<LexiconDecoder>(opt, trie, lm, ...));
+ * }
+ * BatchDecoder batchDecoder(lm, decoders);
+ * auto results = batchDecoder.decode(emissions, nFrames, nTokens);
+ * \endcode
+ */
+class BatchDecoder {
+ public:
+  /**
+   * @param lm the LM shared by all the decoders
+   * @param decoders decoders using `lm`, one per utterance decoded at a time
+   */
+  BatchDecoder(LMPtr lm, std::vector<std::shared_ptr<Decoder>> decoders);
+
+  /**
+   * Decode utterances with emissions of size T[i] x N. Returns the final
+   * hypotheses of each utterance, in order.
+   */
+  std::vector<std::vector<DecodeResult>> decode(
+      const std::vector<const float*>& emissions,
+      const std::vector<int>& T,
+      int N);
+
+  int nDecoders() const {
+    return decoders_.size();
+  }
+
+ private:
+  LMPtr lm_;
+  std::vector<std::shared_ptr<Decoder>> decoders_;
+
+  // LM queries of all the utterances for the current frame
+  LMQueries queries_;
+};
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stdexcept>
+
 #include "flashlight/lib/text/decoder/Utils.h"
 
 namespace fl {
@@ -26,6 +28,7 @@ struct DecoderOptions {
   double eosScore; // Score for inserting an EOS
   bool logAdd; // If or not use logadd when merging hypothesis
   CriterionType criterionType; // CTC or ASG
+  MergeMode mergeMode; // How to find hypotheses with the same state
 
   DecoderOptions(
       const int beamSize,
@@ -37,7 +40,8 @@ struct DecoderOptions {
       const double silScore,
       const double eosScore,
       const bool logAdd,
-      const CriterionType criterionType)
+      const CriterionType criterionType,
+      const MergeMode mergeMode = MergeMode::SORT)
       : beamSize(beamSize),
         beamSizeToken(beamSizeToken),
         beamThreshold(beamThreshold),
@@ -47,9 +51,10 @@ struct DecoderOptions {
         silScore(silScore),
         eosScore(eosScore),
         logAdd(logAdd),
-        criterionType(criterionType) {}
+        criterionType(criterionType),
+        mergeMode(mergeMode) {}
 
-  DecoderOptions() {}
+  DecoderOptions() : mergeMode(MergeMode::SORT) {}
 };
 
 /**
@@ -84,6 +89,22 @@ class Decoder {
   /* Finish up decoding after consuming all emissions */
   virtual void decodeEnd() {}
 
+  /**
+   * Consume a single frame in two steps, so that the LM queries of several
+   * decoders sharing a LM can be scored together (see BatchDecoder):
+   * `expandFrame()` proposes the candidates for the next frame, given its N
+   * emissions, and returns their LM queries. The queries must be scored with
+   * `LMQueries::score()` before calling `pruneFrame()`, which selects the
+   * hypotheses of the frame. Decoders which don't support it throw.
+   */
+  virtual LMQueries& expandFrame(const float* /* emissions */, int /* N */) {
+    throw std::logic_error("[Decoder] frame-level decoding is not supported");
+  }
+
+  virtual void pruneFrame() {
+    throw std::logic_error("[Decoder] frame-level decoding is not supported");
+  }
+
   /* Offline decode function, which consume all emissions at once */
   virtual std::vector<DecodeResult>
   decode(const float* emissions, int T, int N) {
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <stdexcept>
+#include <utility>
+
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'L', 'T', 'R'};
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  int32_t maxChildren;
+  uint32_t reserved;
+  uint64_t nNodes;
+  uint64_t nLabels;
+};
+
+static_assert(sizeof(FileHeader) == 32, "unexpected FileHeader padding");
+
+// Children and labels are filled in once the node is dequeued
+FlatTrieNode makeNode(const TrieNode* node) {
+  FlatTrieNode flatNode{};
+  flatNode.idx = node->idx;
+  flatNode.maxScore = node->maxScore;
+  return flatNode;
+}
+
+} // namespace
+
+FlatTrie::FlatTrie(const Trie& trie) : maxChildren_(trie.getMaxChildren()) {
+  // Breadth-first traversal, so that the children of each node are numbered
+  // contiguously
+  std::queue<const TrieNode*> queue;
+  queue.push(trie.getRoot());
+  nodeStorage_.push_back(makeNode(trie.getRoot()));
+  for (size_t i = 0; !queue.empty(); ++i) {
+    const TrieNode* node = queue.front();
+    queue.pop();
+
+    if (node->children.size() > std::numeric_limits<uint16_t>::max() ||
+        node->labels.size() > std::numeric_limits<uint16_t>::max()) {
+      throw std::invalid_argument("[FlatTrie] Too many children or labels");
+    }
+    std::vector<std::pair<int, const TrieNode*>> children;
+    children.reserve(node->children.size());
+    for (const auto& child : node->children) {
+      children.emplace_back(child.first, child.second.get());
+    }
+    std::sort(children.begin(), children.end());
+
+    nodeStorage_[i].firstChild = nodeStorage_.size();
+    nodeStorage_[i].nChildren = children.size();
+    nodeStorage_[i].firstLabel = labelStorage_.size();
+    nodeStorage_[i].nLabels = node->labels.size();
+    labelStorage_.insert(
+        labelStorage_.end(), node->labels.begin(), node->labels.end());
+    scoreStorage_.insert(
+        scoreStorage_.end(), node->scores.begin(), node->scores.end());
+    for (const auto& child : children) {
+      nodeStorage_.push_back(makeNode(child.second));
+      queue.push(child.second);
+    }
+    if (nodeStorage_.size() > std::numeric_limits<uint32_t>::max() ||
+        labelStorage_.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::invalid_argument("[FlatTrie] Too many nodes or labels");
+    }
+  }
+  setStorage();
+}
+
+FlatTrie::~FlatTrie() {
+  if (mapped_) {
+    munmap(mapped_, mappedSize_);
+  }
+}
+
+void FlatTrie::setStorage() {
+  nNodes_ = nodeStorage_.size();
+  nLabels_ = labelStorage_.size();
+  nodes_ = nodeStorage_.data();
+  labels_ = labelStorage_.data();
+  scores_ = scoreStorage_.data();
+}
+
+const FlatTrieNode* FlatTrie::search(const std::vector<int>& indices) const {
+  const FlatTrieNode* node = getRoot();
+  for (auto idx : indices) {
+    if (idx < 0 || idx >= maxChildren_) {
+      throw std::out_of_range(
+          "[FlatTrie] Invalid letter index: " + std::to_string(idx));
+    }
+    node = getChild(node, idx);
+    if (!node) {
+      return nullptr;
+    }
+  }
+  return node;
+}
+
+void FlatTrie::save(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("[FlatTrie] Can't open file for writing: " + path);
+  }
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.maxChildren = maxChildren_;
+  header.reserved = 0;
+  header.nNodes = nNodes_;
+  header.nLabels = nLabels_;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(
+      reinterpret_cast<const char*>(nodes_), nNodes_ * sizeof(FlatTrieNode));
+  file.write(
+      reinterpret_cast<const char*>(labels_), nLabels_ * sizeof(int32_t));
+  file.write(reinterpret_cast<const char*>(scores_), nLabels_ * sizeof(float));
+  if (!file) {
+    throw std::runtime_error("[FlatTrie] Failed to write file: " + path);
+  }
+}
+
+std::shared_ptr<FlatTrie> FlatTrie::load(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("[FlatTrie] Can't open file: " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+    close(fd);
+    throw std::runtime_error("[FlatTrie] Invalid trie file: " + path);
+  }
+  size_t size = st.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("[FlatTrie] Can't map file: " + path);
+  }
+
+  std::shared_ptr<FlatTrie> trie(new FlatTrie());
+  trie->mapped_ = mapped;
+  trie->mappedSize_ = size;
+
+  const auto* header = static_cast<const FileHeader*>(mapped);
+  // The counts are bounded by the file size first, so that the expected size
+  // can't overflow
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion || header->maxChildren <= 0 ||
+      header->nNodes == 0 || header->nNodes > size / sizeof(FlatTrieNode) ||
+      header->nLabels > size / (sizeof(int32_t) + sizeof(float)) ||
+      size !=
+          sizeof(FileHeader) + header->nNodes * sizeof(FlatTrieNode) +
+              header->nLabels * (sizeof(int32_t) + sizeof(float))) {
+    throw std::runtime_error("[FlatTrie] Invalid trie file: " + path);
+  }
+  trie->maxChildren_ = header->maxChildren;
+  trie->nNodes_ = header->nNodes;
+  trie->nLabels_ = header->nLabels;
+  const char* data = static_cast<const char*>(mapped) + sizeof(FileHeader);
+  trie->nodes_ = reinterpret_cast<const FlatTrieNode*>(data);
+  data += trie->nNodes_ * sizeof(FlatTrieNode);
+  trie->labels_ = reinterpret_cast<const int32_t*>(data);
+  data += trie->nLabels_ * sizeof(int32_t);
+  trie->scores_ = reinterpret_cast<const float*>(data);
+
+  // Lookups don't check bounds, so a corrupted node must not be accepted
+  for (size_t i = 0; i < trie->nNodes_; ++i) {
+    const auto& node = trie->nodes_[i];
+    if (uint64_t(node.firstChild) + node.nChildren > trie->nNodes_ ||
+        uint64_t(node.firstLabel) + node.nLabels > trie->nLabels_) {
+      throw std::runtime_error(
+          "[FlatTrie] Invalid node " + std::to_string(i) +
+          " in trie file: " + path);
+    }
+  }
+  return trie;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
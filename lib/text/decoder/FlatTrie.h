@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/Trie.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * FlatTrieNode is the node structure in FlatTrie. Nodes only store offsets
+ * into the arrays of their FlatTrie, so the whole trie can be written to and
+ * mapped from disk as is.
+ */
+struct FlatTrieNode {
+  // Node index
+  int32_t idx;
+
+  // Maximum score of all the labels if this node is a leaf,
+  // otherwise it will be the value after trie smearing.
+  float maxScore;
+
+  // Children are stored contiguously starting at `firstChild`, sorted by idx
+  uint32_t firstChild;
+
+  // Labels and scores of the node start at `firstLabel`
+  uint32_t firstLabel;
+
+  uint16_t nChildren;
+  uint16_t nLabels;
+};
+
+static_assert(
+    sizeof(FlatTrieNode) == 20,
+    "FlatTrieNode layout is part of the FlatTrie file format");
+
+/**
+ * FlatTrie is a read-only, compact version of Trie used by lexicon decoders.
+ * Nodes are stored in breadth-first order in a single array, with the children
+ * of each node in a contiguous range sorted by index, and labels and scores in
+ * two separate arrays. Looking up a child is a binary search in a few cache
+ * lines, instead of a hash map lookup and pointer chasing.
+ *
+ * A FlatTrie is built once from a smeared Trie. It can be saved to disk and
+ * loaded back with a memory mapping, which avoids planting and smearing the
+ * trie at startup for large lexicons. The file format uses the native byte
+ * order.
+ */
+class FlatTrie {
+ public:
+  /* Build from a Trie: it should be smeared beforehand */
+  explicit FlatTrie(const Trie& trie);
+
+  ~FlatTrie();
+
+  FlatTrie(const FlatTrie&) = delete;
+  FlatTrie& operator=(const FlatTrie&) = delete;
+
+  /* Save the trie to a file which can be loaded with `load()` */
+  void save(const std::string& path) const;
+
+  /* Load a trie saved with `save()`, mapping the file in memory */
+  static std::shared_ptr<FlatTrie> load(const std::string& path);
+
+  /* Return the root node pointer */
+  const FlatTrieNode* getRoot() const {
+    return nodes_;
+  }
+
+  /* Return the child of `node` with index `idx`, or nullptr */
+  const FlatTrieNode* getChild(const FlatTrieNode* node, int idx) const {
+    const FlatTrieNode* first = nodes_ + node->firstChild;
+    const FlatTrieNode* last = first + node->nChildren;
+    auto child = std::lower_bound(
+        first, last, idx, [](const FlatTrieNode& child, int idx) {
+          return child.idx < idx;
+        });
+    return child != last && child->idx == idx ? child : nullptr;
+  }
+
+  /* Labels of the words ending at `node` (`node->nLabels` of them) */
+  const int32_t* labels(const FlatTrieNode* node) const {
+    return labels_ + node->firstLabel;
+  }
+
+  /* Scores of the words ending at `node` (`node->nLabels` of them) */
+  const float* scores(const FlatTrieNode* node) const {
+    return scores_ + node->firstLabel;
+  }
+
+  /* Get the node for a given token, or nullptr if it isn't in the trie */
+  const FlatTrieNode* search(const std::vector<int>& indices) const;
+
+  size_t nNodes() const {
+    return nNodes_;
+  }
+
+  /* Return the number of tokens the trie was built for */
+  int getMaxChildren() const {
+    return maxChildren_;
+  }
+
+ private:
+  FlatTrie() = default;
+
+  void setStorage();
+
+  int maxChildren_{0};
+  size_t nNodes_{0};
+  size_t nLabels_{0};
+
+  const FlatTrieNode* nodes_{nullptr};
+  const int32_t* labels_{nullptr};
+  const float* scores_{nullptr};
+
+  // Storage of a trie built in memory
+  std::vector<FlatTrieNode> nodeStorage_;
+  std::vector<int32_t> labelStorage_;
+  std::vector<float> scoreStorage_;
+
+  // Memory mapping of a loaded trie
+  void* mapped_{nullptr};
+  size_t mappedSize_{0};
+};
+
+using FlatTriePtr = std::shared_ptr<FlatTrie>;
+} // namespace text
+} // namespace lib
+} // namespace fl
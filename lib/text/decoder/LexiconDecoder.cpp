@@ -30,194 +30,242 @@ void LexiconDecoder::decodeBegin() {
 }
 
 void LexiconDecoder::decodeStep(const float* emissions, int T, int N) {
-  int startFrame = nDecodedFrames_ - nPrunedFrames_;
-  // Extend hyp_ buffer
-  if (hyp_.size() < startFrame + T + 2) {
-    for (int i = hyp_.size(); i < startFrame + T + 2; i++) {
-      hyp_.emplace(i, std::vector<LexiconDecoderState>());
-    }
+  for (int t = 0; t < T; t++) {
+    expandFrame(emissions + t * N, N).score(*lm_);
+    pruneFrame();
   }
+}
 
-  std::vector<size_t> idx(N);
-  for (int t = 0; t < T; t++) {
-    std::iota(idx.begin(), idx.end(), 0);
-    if (N > opt_.beamSizeToken) {
-      std::partial_sort(
-          idx.begin(),
-          idx.begin() + opt_.beamSizeToken,
-          idx.end(),
-          [&t, &N, &emissions](const size_t& l, const size_t& r) {
-            return emissions[t * N + l] > emissions[t * N + r];
-          });
-    }
+LMQueries& LexiconDecoder::expandFrame(const float* emissions, int N) {
+  int frame = nDecodedFrames_ - nPrunedFrames_;
+  // Extend hyp_ buffer
+  for (int i = hyp_.size(); i < frame + 2; i++) {
+    hyp_.emplace(i, std::vector<LexiconDecoderState>());
+  }
 
-    candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
-    for (const LexiconDecoderState& prevHyp : hyp_[startFrame + t]) {
-      const TrieNode* prevLex = prevHyp.lex;
-      const int prevIdx = prevHyp.token;
-      const float lexMaxScore =
-          prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
-
-      /* (1) Try children */
-      for (int r = 0; r < std::min(opt_.beamSizeToken, N); ++r) {
-        int n = idx[r];
-        auto iter = prevLex->children.find(n);
-        if (iter == prevLex->children.end()) {
-          continue;
-        }
-        const TrieNodePtr& lex = iter->second;
-        double amScore = emissions[t * N + n];
-        if (nDecodedFrames_ + t > 0 &&
-            opt_.criterionType == CriterionType::ASG) {
-          amScore += transitions_[n * N + prevIdx];
-        }
-        double score = prevHyp.score + amScore;
-        if (n == sil_) {
-          score += opt_.silScore;
-        }
+  tokenIdx_.resize(N);
+  std::iota(tokenIdx_.begin(), tokenIdx_.end(), 0);
+  if (N > opt_.beamSizeToken) {
+    std::partial_sort(
+        tokenIdx_.begin(),
+        tokenIdx_.begin() + opt_.beamSizeToken,
+        tokenIdx_.end(),
+        [emissions](const size_t& l, const size_t& r) {
+          return emissions[l] > emissions[r];
+        });
+  }
 
-        LMStatePtr lmState;
-        double lmScore = 0.;
+  candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
+  pendingCandidates_.clear();
+  lmQueries_.clear();
+  for (const LexiconDecoderState& prevHyp : hyp_[frame]) {
+    const FlatTrieNode* prevLex = prevHyp.lex;
+    const int prevIdx = prevHyp.token;
+    const float lexMaxScore =
+        prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
+
+    /* (1) Try children */
+    for (int r = 0; r < std::min(opt_.beamSizeToken, N); ++r) {
+      int n = tokenIdx_[r];
+      const FlatTrieNode* lex = lexicon_->getChild(prevLex, n);
+      if (!lex) {
+        continue;
+      }
+      double amScore = emissions[n];
+      if (nDecodedFrames_ > 0 && opt_.criterionType == CriterionType::ASG) {
+        amScore += transitions_[n * N + prevIdx];
+      }
+      double score = prevHyp.score + amScore;
+      if (n == sil_) {
+        score += opt_.silScore;
+      }
 
-        if (isLmToken_) {
-          auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
-          lmState = lmStateScorePair.first;
-          lmScore = lmStateScorePair.second;
-        }
+      int tokenLmQuery = -1;
+      if (isLmToken_) {
+        tokenLmQuery = lmQueries_.add(prevHyp.lmState, n);
+      }
 
-        // We eat-up a new token
-        if (opt_.criterionType != CriterionType::CTC || prevHyp.prevBlank ||
-            n != prevIdx) {
-          if (!lex->children.empty()) {
-            if (!isLmToken_) {
-              lmState = prevHyp.lmState;
-              lmScore = lex->maxScore - lexMaxScore;
-            }
-            candidatesAdd(
-                candidates_,
-                candidatesBestScore_,
-                opt_.beamThreshold,
-                score + opt_.lmWeight * lmScore,
-                lmState,
-                lex.get(),
+      // We eat-up a new token
+      if (opt_.criterionType != CriterionType::CTC || prevHyp.prevBlank ||
+          n != prevIdx) {
+        if (lex->nChildren > 0) {
+          if (isLmToken_) {
+            addPendingCandidate(
+                score,
+                0,
+                tokenLmQuery,
+                0,
+                lex,
                 &prevHyp,
                 n,
                 -1,
-                false, // prevBlank
-                prevHyp.amScore + amScore,
-                prevHyp.lmScore + lmScore);
-          }
-        }
-
-        // If we got a true word
-        for (auto label : lex->labels) {
-          if (!isLmToken_) {
-            auto lmStateScorePair = lm_->score(prevHyp.lmState, label);
-            lmState = lmStateScorePair.first;
-            lmScore = lmStateScorePair.second - lexMaxScore;
-          }
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score + opt_.lmWeight * lmScore + opt_.wordScore,
-              lmState,
-              lexicon_->getRoot(),
-              &prevHyp,
-              n,
-              label,
-              false, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
-        }
-
-        // If we got an unknown word
-        if (lex->labels.empty() && (opt_.unkScore > kNegativeInfinity)) {
-          if (!isLmToken_) {
-            auto lmStateScorePair = lm_->score(prevHyp.lmState, unk_);
-            lmState = lmStateScorePair.first;
-            lmScore = lmStateScorePair.second - lexMaxScore;
+                false,
+                amScore);
+          } else {
+            addPendingCandidate(
+                score,
+                0,
+                -1,
+                lex->maxScore - lexMaxScore,
+                lex,
+                &prevHyp,
+                n,
+                -1,
+                false,
+                amScore);
           }
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score + opt_.lmWeight * lmScore + opt_.unkScore,
-              lmState,
-              lexicon_->getRoot(),
-              &prevHyp,
-              n,
-              unk_,
-              false, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
         }
       }
 
-      /* (2) Try same lexicon node */
-      if (opt_.criterionType != CriterionType::CTC || !prevHyp.prevBlank) {
-        int n = prevIdx;
-        double amScore = emissions[t * N + n];
-        if (nDecodedFrames_ + t > 0 &&
-            opt_.criterionType == CriterionType::ASG) {
-          amScore += transitions_[n * N + prevIdx];
-        }
-        double score = prevHyp.score + amScore;
-        if (n == sil_) {
-          score += opt_.silScore;
-        }
-
-        candidatesAdd(
-            candidates_,
-            candidatesBestScore_,
-            opt_.beamThreshold,
+      // If we got a true word
+      const int32_t* labels = lexicon_->labels(lex);
+      for (int i = 0; i < lex->nLabels; ++i) {
+        int label = labels[i];
+        int lmQuery =
+            isLmToken_ ? tokenLmQuery : lmQueries_.add(prevHyp.lmState, label);
+        addPendingCandidate(
             score,
-            prevHyp.lmState,
-            prevLex,
+            opt_.wordScore,
+            lmQuery,
+            isLmToken_ ? 0 : lexMaxScore,
+            lexicon_->getRoot(),
             &prevHyp,
             n,
-            -1,
-            false, // prevBlank
-            prevHyp.amScore + amScore,
-            prevHyp.lmScore);
+            label,
+            false,
+            amScore);
       }
 
-      /* (3) CTC only, try blank */
-      if (opt_.criterionType == CriterionType::CTC) {
-        int n = blank_;
-        double amScore = emissions[t * N + n];
-        candidatesAdd(
-            candidates_,
-            candidatesBestScore_,
-            opt_.beamThreshold,
-            prevHyp.score + amScore,
-            prevHyp.lmState,
-            prevLex,
+      // If we got an unknown word
+      if (lex->nLabels == 0 && (opt_.unkScore > kNegativeInfinity)) {
+        int lmQuery =
+            isLmToken_ ? tokenLmQuery : lmQueries_.add(prevHyp.lmState, unk_);
+        addPendingCandidate(
+            score,
+            opt_.unkScore,
+            lmQuery,
+            isLmToken_ ? 0 : lexMaxScore,
+            lexicon_->getRoot(),
             &prevHyp,
             n,
-            -1,
-            true, // prevBlank
-            prevHyp.amScore + amScore,
-            prevHyp.lmScore);
+            unk_,
+            false,
+            amScore);
+      }
+    }
+
+    /* (2) Try same lexicon node */
+    if (opt_.criterionType != CriterionType::CTC || !prevHyp.prevBlank) {
+      int n = prevIdx;
+      double amScore = emissions[n];
+      if (nDecodedFrames_ > 0 && opt_.criterionType == CriterionType::ASG) {
+        amScore += transitions_[n * N + prevIdx];
+      }
+      double score = prevHyp.score + amScore;
+      if (n == sil_) {
+        score += opt_.silScore;
       }
-      // finish proposing
+
+      addPendingCandidate(
+          score, 0, -1, 0, prevLex, &prevHyp, n, -1, false, amScore);
+    }
+
+    /* (3) CTC only, try blank */
+    if (opt_.criterionType == CriterionType::CTC) {
+      int n = blank_;
+      double amScore = emissions[n];
+      addPendingCandidate(
+          prevHyp.score + amScore,
+          0,
+          -1,
+          0,
+          prevLex,
+          &prevHyp,
+          n,
+          -1,
+          true, // prevBlank
+          amScore);
     }
+    // finish proposing
+  }
+
+  return lmQueries_;
+}
 
-    candidatesStore(
+void LexiconDecoder::pruneFrame() {
+  int frame = nDecodedFrames_ - nPrunedFrames_;
+  /* Add the candidates with their LM scores */
+  for (const auto& candidate : pendingCandidates_) {
+    const LexiconDecoderState* prevHyp = candidate.parent;
+    double lmScore = candidate.lmScore;
+    if (candidate.lmQuery >= 0) {
+      // Subtract in single precision, as smeared scores are floats
+      lmScore =
+          lmQueries_.outScores[candidate.lmQuery] - candidate.lmScoreOffset;
+    }
+    candidatesAdd(
         candidates_,
-        candidatePtrs_,
-        hyp_[startFrame + t + 1],
-        opt_.beamSize,
-        candidatesBestScore_ - opt_.beamThreshold,
-        opt_.logAdd,
-        false);
-    updateLMCache(lm_, hyp_[startFrame + t + 1]);
+        candidatesBestScore_,
+        opt_.beamThreshold,
+        candidate.score + opt_.lmWeight * lmScore + candidate.bonus,
+        candidate.lmQuery >= 0 ? lmQueries_.outStates[candidate.lmQuery]
+                               : prevHyp->lmState,
+        candidate.lex,
+        prevHyp,
+        candidate.token,
+        candidate.word,
+        candidate.prevBlank,
+        prevHyp->amScore + candidate.amScore,
+        prevHyp->lmScore + lmScore);
   }
 
-  nDecodedFrames_ += T;
+  candidatesStore(
+      candidates_,
+      candidatePtrs_,
+      hyp_[frame + 1],
+      opt_.beamSize,
+      candidatesBestScore_ - opt_.beamThreshold,
+      opt_.logAdd,
+      false,
+      opt_.mergeMode,
+      &candidateHashTable_);
+  ++nDecodedFrames_;
+}
+
+void LexiconDecoder::addPendingCandidate(
+    double score,
+    double bonus,
+    int lmQuery,
+    float lmScore,
+    const FlatTrieNode* lex,
+    const LexiconDecoderState* parent,
+    int token,
+    int word,
+    bool prevBlank,
+    double amScore) {
+  PendingCandidate candidate;
+  candidate.score = score;
+  candidate.bonus = bonus;
+  candidate.lmQuery = lmQuery;
+  if (lmQuery >= 0) {
+    candidate.lmScoreOffset = lmScore;
+    candidate.lmScore = 0;
+  } else {
+    candidate.lmScoreOffset = 0;
+    candidate.lmScore = lmScore;
+  }
+  candidate.lex = lex;
+  candidate.parent = parent;
+  candidate.token = token;
+  candidate.word = word;
+  candidate.prevBlank = prevBlank;
+  candidate.amScore = amScore;
+  pendingCandidates_.push_back(candidate);
 }
 
 void LexiconDecoder::decodeEnd() {
+  // Prepare the LM (e.g. ConvLM caches) for the final queries at once
+  updateLMCache(lm_, hyp_[nDecodedFrames_ - nPrunedFrames_]);
   candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
   bool hasNiceEnding = false;
   for (const LexiconDecoderState& prevHyp :
@@ -229,7 +277,7 @@ void LexiconDecoder::decodeEnd() {
   }
   for (const LexiconDecoderState& prevHyp :
        hyp_[nDecodedFrames_ - nPrunedFrames_]) {
-    const TrieNode* prevLex = prevHyp.lex;
+    const FlatTrieNode* prevLex = prevHyp.lex;
     const LMStatePtr& prevLmState = prevHyp.lmState;
 
     if (!hasNiceEnding || prevHyp.lex == lexicon_->getRoot()) {
@@ -258,7 +306,9 @@ void LexiconDecoder::decodeEnd() {
       opt_.beamSize,
       candidatesBestScore_ - opt_.beamThreshold,
       opt_.logAdd,
-      true);
+      true,
+      opt_.mergeMode,
+      &candidateHashTable_);
   ++nDecodedFrames_;
 }
 
@@ -10,7 +10,7 @@
 #include <unordered_map>
 
 #include "flashlight/lib/text/decoder/Decoder.h"
-#include "flashlight/lib/text/decoder/Trie.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 
 namespace fl {
@@ -23,7 +23,7 @@ namespace text {
 struct LexiconDecoderState {
   double score; // Accumulated total score so far
   LMStatePtr lmState; // Language model state
-  const TrieNode* lex; // Trie node in the lexicon
+  const FlatTrieNode* lex; // Trie node in the lexicon
   const LexiconDecoderState* parent; // Parent hypothesis
   int token; // Label of token
   int word; // Label of word (-1 if incomplete)
@@ -35,7 +35,7 @@ struct LexiconDecoderState {
   LexiconDecoderState(
       const double score,
       const LMStatePtr& lmState,
-      const TrieNode* lex,
+      const FlatTrieNode* lex,
       const LexiconDecoderState* parent,
       const int token,
       const int word,
@@ -77,6 +77,13 @@ struct LexiconDecoderState {
     return 0;
   }
 
+  size_t hashNoScoreStates() const {
+    size_t hash = std::hash<LMState*>()(lmState.get());
+    hash = hashCombine(hash, std::hash<const FlatTrieNode*>()(lex));
+    hash = hashCombine(hash, token);
+    return hashCombine(hash, prevBlank);
+  }
+
   int getWord() const {
     return word;
   }
@@ -103,7 +110,7 @@ class LexiconDecoder : public Decoder {
  public:
   LexiconDecoder(
       const DecoderOptions& opt,
-      const TriePtr& lexicon,
+      const FlatTriePtr& lexicon,
       const LMPtr& lm,
       const int sil,
       const int blank,
@@ -119,10 +126,33 @@ class LexiconDecoder : public Decoder {
         transitions_(transitions),
         isLmToken_(isLmToken) {}
 
+  /* Flattens the trie: prefer sharing a FlatTrie between decoders */
+  LexiconDecoder(
+      const DecoderOptions& opt,
+      const TriePtr& lexicon,
+      const LMPtr& lm,
+      const int sil,
+      const int blank,
+      const int unk,
+      const std::vector<float>& transitions,
+      const bool isLmToken)
+      : Decoder(opt),
+        lexicon_(std::make_shared<FlatTrie>(*lexicon)),
+        lm_(lm),
+        sil_(sil),
+        blank_(blank),
+        unk_(unk),
+        transitions_(transitions),
+        isLmToken_(isLmToken) {}
+
   void decodeBegin() override;
 
   void decodeStep(const float* emissions, int T, int N) override;
 
+  LMQueries& expandFrame(const float* emissions, int N) override;
+
+  void pruneFrame() override;
+
   void decodeEnd() override;
 
   int nHypothesis() const;
@@ -137,7 +167,7 @@ class LexiconDecoder : public Decoder {
 
  protected:
   // Lexicon trie to restrict beam-search decoder
-  TriePtr lexicon_;
+  FlatTriePtr lexicon_;
   LMPtr lm_;
   // Index of silence label
   int sil_;
@@ -159,6 +189,9 @@ class LexiconDecoder : public Decoder {
   // so instead of moving around objects, we only need to sort pointers
   std::vector<LexiconDecoderState*> candidatePtrs_;
 
+  // Scratch space to merge candidates with MergeMode::HASH
+  CandidateHashTable candidateHashTable_;
+
   // Best candidate score of current frame
   double candidatesBestScore_;
 
@@ -168,6 +201,41 @@ class LexiconDecoder : public Decoder {
   // These 2 variables are used for online decoding, for hypothesis pruning
   int nDecodedFrames_; // Total number of decoded frames.
   int nPrunedFrames_; // Total number of pruned frames from hyp_.
+
+  // A candidate proposed in the current frame, waiting for its LM score: all
+  // the LM queries of a frame are issued at once with LM::scoreBatch
+  struct PendingCandidate {
+    double score; // Score without LM score and word bonus
+    double bonus; // Word or unknown word score
+    int lmQuery; // Index of the LM query, or -1 to keep the parent LM state
+    float lmScoreOffset; // Subtracted from the LM query score
+    double lmScore; // LM score, if there is no LM query
+    const FlatTrieNode* lex;
+    const LexiconDecoderState* parent;
+    int token;
+    int word;
+    bool prevBlank;
+    double amScore; // AM score of the frame
+  };
+
+  std::vector<PendingCandidate> pendingCandidates_;
+  LMQueries lmQueries_;
+
+  // Tokens of the current frame, best first for the `beamSizeToken` first
+  std::vector<size_t> tokenIdx_;
+
+  // `lmScore` is the LM score offset if `lmQuery` >= 0, the LM score otherwise
+  void addPendingCandidate(
+      double score,
+      double bonus,
+      int lmQuery,
+      float lmScore,
+      const FlatTrieNode* lex,
+      const LexiconDecoderState* parent,
+      int token,
+      int word,
+      bool prevBlank,
+      double amScore);
 };
 } // namespace text
 } // namespace lib
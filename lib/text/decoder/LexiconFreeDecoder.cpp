@@ -28,103 +28,129 @@ void LexiconFreeDecoder::decodeBegin() {
 }
 
 void LexiconFreeDecoder::decodeStep(const float* emissions, int T, int N) {
-  int startFrame = nDecodedFrames_ - nPrunedFrames_;
+  for (int t = 0; t < T; t++) {
+    expandFrame(emissions + t * N, N).score(*lm_);
+    pruneFrame();
+  }
+}
+
+LMQueries& LexiconFreeDecoder::expandFrame(const float* emissions, int N) {
+  int frame = nDecodedFrames_ - nPrunedFrames_;
   // Extend hyp_ buffer
-  if (hyp_.size() < startFrame + T + 2) {
-    for (int i = hyp_.size(); i < startFrame + T + 2; i++) {
-      hyp_.emplace(i, std::vector<LexiconFreeDecoderState>());
-    }
+  for (int i = hyp_.size(); i < frame + 2; i++) {
+    hyp_.emplace(i, std::vector<LexiconFreeDecoderState>());
   }
 
-  std::vector<size_t> idx(N);
-  // Looping over all the frames
-  for (int t = 0; t < T; t++) {
-    std::iota(idx.begin(), idx.end(), 0);
-    if (N > opt_.beamSizeToken) {
-      std::partial_sort(
-          idx.begin(),
-          idx.begin() + opt_.beamSizeToken,
-          idx.end(),
-          [&t, &N, &emissions](const size_t& l, const size_t& r) {
-            return emissions[t * N + l] > emissions[t * N + r];
-          });
-    }
+  tokenIdx_.resize(N);
+  std::iota(tokenIdx_.begin(), tokenIdx_.end(), 0);
+  if (N > opt_.beamSizeToken) {
+    std::partial_sort(
+        tokenIdx_.begin(),
+        tokenIdx_.begin() + opt_.beamSizeToken,
+        tokenIdx_.end(),
+        [emissions](const size_t& l, const size_t& r) {
+          return emissions[l] > emissions[r];
+        });
+  }
+
+  candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
+  pendingCandidates_.clear();
+  lmQueries_.clear();
+  for (const LexiconFreeDecoderState& prevHyp : hyp_[frame]) {
+    const int prevIdx = prevHyp.token;
+
+    for (int r = 0; r < std::min(opt_.beamSizeToken, N); ++r) {
+      int n = tokenIdx_[r];
+      double amScore = emissions[n];
+      if (nDecodedFrames_ > 0 && opt_.criterionType == CriterionType::ASG) {
+        amScore += transitions_[n * N + prevIdx];
+      }
+      double score = prevHyp.score + emissions[n];
+      if (n == sil_) {
+        score += opt_.silScore;
+      }
 
-    candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
-    for (const LexiconFreeDecoderState& prevHyp : hyp_[startFrame + t]) {
-      const int prevIdx = prevHyp.token;
-
-      for (int r = 0; r < std::min(opt_.beamSizeToken, N); ++r) {
-        int n = idx[r];
-        double amScore = emissions[t * N + n];
-        if (nDecodedFrames_ + t > 0 &&
-            opt_.criterionType == CriterionType::ASG) {
-          amScore += transitions_[n * N + prevIdx];
-        }
-        double score = prevHyp.score + emissions[t * N + n];
-        if (n == sil_) {
-          score += opt_.silScore;
-        }
-
-        if ((opt_.criterionType == CriterionType::ASG && n != prevIdx) ||
-            (opt_.criterionType == CriterionType::CTC && n != blank_ &&
-             (n != prevIdx || prevHyp.prevBlank))) {
-          auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
-          auto lmScore = lmStateScorePair.second;
-
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score + opt_.lmWeight * lmScore,
-              lmStateScorePair.first,
-              &prevHyp,
-              n,
-              false, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
-        } else if (opt_.criterionType == CriterionType::CTC && n == blank_) {
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score,
-              prevHyp.lmState,
-              &prevHyp,
-              n,
-              true, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore);
-        } else {
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score,
-              prevHyp.lmState,
-              &prevHyp,
-              n,
-              false, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore);
-        }
+      if ((opt_.criterionType == CriterionType::ASG && n != prevIdx) ||
+          (opt_.criterionType == CriterionType::CTC && n != blank_ &&
+           (n != prevIdx || prevHyp.prevBlank))) {
+        pendingCandidates_.push_back(
+            {score,
+             lmQueries_.add(prevHyp.lmState, n),
+             &prevHyp,
+             n,
+             false, // prevBlank
+             amScore});
+      } else if (opt_.criterionType == CriterionType::CTC && n == blank_) {
+        pendingCandidates_.push_back(
+            {score,
+             -1,
+             &prevHyp,
+             n,
+             true, // prevBlank
+             amScore});
+      } else {
+        pendingCandidates_.push_back(
+            {score,
+             -1,
+             &prevHyp,
+             n,
+             false, // prevBlank
+             amScore});
       }
     }
+  }
+  return lmQueries_;
+}
 
-    candidatesStore(
-        candidates_,
-        candidatePtrs_,
-        hyp_[startFrame + t + 1],
-        opt_.beamSize,
-        candidatesBestScore_ - opt_.beamThreshold,
-        opt_.logAdd,
-        false);
-    updateLMCache(lm_, hyp_[startFrame + t + 1]);
+void LexiconFreeDecoder::pruneFrame() {
+  int frame = nDecodedFrames_ - nPrunedFrames_;
+  /* Add the candidates with their LM scores */
+  for (const auto& candidate : pendingCandidates_) {
+    const LexiconFreeDecoderState* prevHyp = candidate.parent;
+    if (candidate.lmQuery >= 0) {
+      auto lmScore = lmQueries_.outScores[candidate.lmQuery];
+      candidatesAdd(
+          candidates_,
+          candidatesBestScore_,
+          opt_.beamThreshold,
+          candidate.score + opt_.lmWeight * lmScore,
+          lmQueries_.outStates[candidate.lmQuery],
+          prevHyp,
+          candidate.token,
+          candidate.prevBlank,
+          prevHyp->amScore + candidate.amScore,
+          prevHyp->lmScore + lmScore);
+    } else {
+      candidatesAdd(
+          candidates_,
+          candidatesBestScore_,
+          opt_.beamThreshold,
+          candidate.score,
+          prevHyp->lmState,
+          prevHyp,
+          candidate.token,
+          candidate.prevBlank,
+          prevHyp->amScore + candidate.amScore,
+          prevHyp->lmScore);
+    }
   }
-  nDecodedFrames_ += T;
+
+  candidatesStore(
+      candidates_,
+      candidatePtrs_,
+      hyp_[frame + 1],
+      opt_.beamSize,
+      candidatesBestScore_ - opt_.beamThreshold,
+      opt_.logAdd,
+      false,
+      opt_.mergeMode,
+      &candidateHashTable_);
+  ++nDecodedFrames_;
 }
 
 void LexiconFreeDecoder::decodeEnd() {
+  // Prepare the LM (e.g. ConvLM caches) for the final queries at once
+  updateLMCache(lm_, hyp_[nDecodedFrames_ - nPrunedFrames_]);
   candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
   for (const LexiconFreeDecoderState& prevHyp :
        hyp_[nDecodedFrames_ - nPrunedFrames_]) {
@@ -153,7 +179,9 @@ void LexiconFreeDecoder::decodeEnd() {
       opt_.beamSize,
       candidatesBestScore_ - opt_.beamThreshold,
       opt_.logAdd,
-      true);
+      true,
+      opt_.mergeMode,
+      &candidateHashTable_);
   ++nDecodedFrames_;
 }
 
@@ -66,6 +66,12 @@ struct LexiconFreeDecoderState {
     return 0;
   }
 
+  size_t hashNoScoreStates() const {
+    size_t hash = std::hash<LMState*>()(lmState.get());
+    hash = hashCombine(hash, token);
+    return hashCombine(hash, prevBlank);
+  }
+
   int getWord() const {
     return -1;
   }
@@ -104,6 +110,10 @@ class LexiconFreeDecoder : public Decoder {
 
   void decodeStep(const float* emissions, int T, int N) override;
 
+  LMQueries& expandFrame(const float* emissions, int N) override;
+
+  void pruneFrame() override;
+
   void decodeEnd() override;
 
   int nHypothesis() const;
@@ -128,6 +138,9 @@ class LexiconFreeDecoder : public Decoder {
   // so instead of moving around objects, we only need to sort pointers
   std::vector<LexiconFreeDecoderState*> candidatePtrs_;
 
+  // Scratch space to merge candidates with MergeMode::HASH
+  CandidateHashTable candidateHashTable_;
+
   // Best candidate score of current frame
   double candidatesBestScore_;
 
@@ -143,6 +156,23 @@ class LexiconFreeDecoder : public Decoder {
   // These 2 variables are used for online decoding, for hypothesis pruning
   int nDecodedFrames_; // Total number of decoded frames.
   int nPrunedFrames_; // Total number of pruned frames from hyp_.
+
+  // A candidate proposed in the current frame, waiting for its LM score: all
+  // the LM queries of a frame are issued at once with LM::scoreBatch
+  struct PendingCandidate {
+    double score; // Score without LM score
+    int lmQuery; // Index of the LM query, or -1 to keep the parent LM state
+    const LexiconFreeDecoderState* parent;
+    int token;
+    bool prevBlank;
+    double amScore; // AM score of the frame
+  };
+
+  std::vector<PendingCandidate> pendingCandidates_;
+  LMQueries lmQueries_;
+
+  // Tokens of the current frame, best first for the `beamSizeToken` first
+  std::vector<size_t> tokenIdx_;
 };
 } // namespace text
 } // namespace lib
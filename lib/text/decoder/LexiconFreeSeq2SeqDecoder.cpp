@@ -142,7 +142,9 @@ void LexiconFreeSeq2SeqDecoder::decodeStep(
         opt_.beamSize,
         candidatesBestScore_ - opt_.beamThreshold,
         opt_.logAdd,
-        true);
+        true,
+        opt_.mergeMode,
+        &candidateHashTable_);
     updateLMCache(lm_, hyp_[t + 1]);
   } // End of decoding
 
@@ -70,6 +70,10 @@ struct LexiconFreeSeq2SeqDecoderState {
     return lmState->compare(node->lmState);
   }
 
+  size_t hashNoScoreStates() const {
+    return std::hash<LMState*>()(lmState.get());
+  }
+
   int getWord() const {
     return -1;
   }
@@ -122,6 +126,7 @@ class LexiconFreeSeq2SeqDecoder : public Decoder {
 
   std::vector<LexiconFreeSeq2SeqDecoderState> candidates_;
   std::vector<LexiconFreeSeq2SeqDecoderState*> candidatePtrs_;
+  CandidateHashTable candidateHashTable_;
   double candidatesBestScore_;
 
   std::unordered_map<int, std::vector<LexiconFreeSeq2SeqDecoderState>> hyp_;
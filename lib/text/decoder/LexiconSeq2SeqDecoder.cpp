@@ -92,7 +92,7 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
         continue;
       }
 
-      const TrieNode* prevLex = prevHyp.lex;
+      const FlatTrieNode* prevLex = prevHyp.lex;
       const float lexMaxScore =
           prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
 
@@ -141,9 +141,8 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
 
         /* (2) Try normal token */
         if (n != eos_) {
-          auto searchLex = prevLex->children.find(n);
-          if (searchLex != prevLex->children.end()) {
-            auto lex = searchLex->second;
+          const FlatTrieNode* lex = lexicon_->getChild(prevLex, n);
+          if (lex) {
             LMStatePtr lmState;
             double lmScore;
             if (isLmToken_) {
@@ -161,7 +160,7 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
                 opt_.beamThreshold,
                 prevHyp.score + amScore + opt_.lmWeight * lmScore,
                 lmState,
-                lex.get(),
+                lex,
                 &prevHyp,
                 n,
                 -1,
@@ -170,8 +169,10 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
                 prevHyp.lmScore + lmScore);
 
             // If we got a true word
-            if (lex->labels.size() > 0) {
-              for (auto word : lex->labels) {
+            if (lex->nLabels > 0) {
+              const int32_t* labels = lexicon_->labels(lex);
+              for (int i = 0; i < lex->nLabels; ++i) {
+                int word = labels[i];
                 if (!isLmToken_) {
                   auto lmStateScorePair = lm_->score(prevHyp.lmState, word);
                   lmState = lmStateScorePair.first;
@@ -208,7 +209,9 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
         opt_.beamSize,
         candidatesBestScore_ - opt_.beamThreshold,
         opt_.logAdd,
-        true);
+        true,
+        opt_.mergeMode,
+        &candidateHashTable_);
     updateLMCache(lm_, hyp_[t + 1]);
   } // End of decoding
 
@@ -11,7 +11,7 @@
 #include <unordered_map>
 
 #include "flashlight/lib/text/decoder/Decoder.h"
-#include "flashlight/lib/text/decoder/Trie.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 
 namespace fl {
@@ -35,7 +35,7 @@ using AMUpdateFunc = std::function<
 struct LexiconSeq2SeqDecoderState {
   double score; // Accumulated total score so far
   LMStatePtr lmState; // Language model state
-  const TrieNode* lex;
+  const FlatTrieNode* lex;
   const LexiconSeq2SeqDecoderState* parent; // Parent hypothesis
   int token; // Label of token
   int word;
@@ -47,7 +47,7 @@ struct LexiconSeq2SeqDecoderState {
   LexiconSeq2SeqDecoderState(
       const double score,
       const LMStatePtr& lmState,
-      const TrieNode* lex,
+      const FlatTrieNode* lex,
       const LexiconSeq2SeqDecoderState* parent,
       const int token,
       const int word,
@@ -87,6 +87,12 @@ struct LexiconSeq2SeqDecoderState {
     return 0;
   }
 
+  size_t hashNoScoreStates() const {
+    size_t hash = std::hash<LMState*>()(lmState.get());
+    hash = hashCombine(hash, std::hash<const FlatTrieNode*>()(lex));
+    return hashCombine(hash, token);
+  }
+
   int getWord() const {
     return word;
   }
@@ -109,7 +115,7 @@ class LexiconSeq2SeqDecoder : public Decoder {
  public:
   LexiconSeq2SeqDecoder(
       const DecoderOptions& opt,
-      const TriePtr& lexicon,
+      const FlatTriePtr& lexicon,
       const LMPtr& lm,
       const int eos,
       AMUpdateFunc amUpdateFunc,
@@ -123,6 +129,23 @@ class LexiconSeq2SeqDecoder : public Decoder {
         maxOutputLength_(maxOutputLength),
         isLmToken_(isLmToken) {}
 
+  /* Flattens the trie: prefer sharing a FlatTrie between decoders */
+  LexiconSeq2SeqDecoder(
+      const DecoderOptions& opt,
+      const TriePtr& lexicon,
+      const LMPtr& lm,
+      const int eos,
+      AMUpdateFunc amUpdateFunc,
+      const int maxOutputLength,
+      const bool isLmToken)
+      : Decoder(opt),
+        lm_(lm),
+        lexicon_(std::make_shared<FlatTrie>(*lexicon)),
+        eos_(eos),
+        amUpdateFunc_(amUpdateFunc),
+        maxOutputLength_(maxOutputLength),
+        isLmToken_(isLmToken) {}
+
   void decodeStep(const float* emissions, int T, int N) override;
 
   void prune(int lookBack = 0) override;
@@ -135,7 +158,7 @@ class LexiconSeq2SeqDecoder : public Decoder {
 
  protected:
   LMPtr lm_;
-  TriePtr lexicon_;
+  FlatTriePtr lexicon_;
   int eos_;
   AMUpdateFunc amUpdateFunc_;
   std::vector<int> rawY_;
@@ -145,6 +168,7 @@ class LexiconSeq2SeqDecoder : public Decoder {
 
   std::vector<LexiconSeq2SeqDecoderState> candidates_;
   std::vector<LexiconSeq2SeqDecoderState*> candidatePtrs_;
+  CandidateHashTable candidateHashTable_;
   double candidatesBestScore_;
 
   std::unordered_map<int, std::vector<LexiconSeq2SeqDecoderState>> hyp_;
@@ -67,6 +67,11 @@ class Trie {
   /* Return the root node pointer */
   const TrieNode* getRoot() const;
 
+  /* Return the maximum number of children of a node */
+  int getMaxChildren() const {
+    return maxChildren_;
+  }
+
   /* Insert a token into trie with label */
   TrieNodePtr insert(const std::vector<int>& indices, int label, float score);
 
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -34,6 +35,27 @@ struct DecodeResult {
       : score(0), words(length, -1), tokens(length, -1) {}
 };
 
+/**
+ * How candidatesStore() merges the candidates with the same state. SORT sorts
+ * the candidates by state, HASH groups them with a hash table, which is faster
+ * for large beams. Both keep the same hypotheses with the same scores, except
+ * for the order of the hypotheses and ties between equal scores.
+ */
+enum class MergeMode { SORT = 0, HASH = 1 };
+
+/* Scratch space of candidatesStore() for MergeMode::HASH */
+struct CandidateHashTable {
+  std::vector<int> buckets; // First candidate of a group of equal states
+  std::vector<int> next; // Next candidate of the same group
+  std::vector<int> tail; // Last candidate of the group, for group heads
+  std::vector<int> heads; // First candidate of each group, in order
+  std::vector<int> group;
+};
+
+inline size_t hashCombine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
 /* ===================== Candidate-related operations ===================== */
 
 template <class DecoderState>
@@ -61,28 +83,25 @@ void candidatesAdd(
   }
 }
 
+/* Merge the score of `node` into `merged`, a candidate with the same state */
 template <class DecoderState>
-void candidatesStore(
-    std::vector<DecoderState>& candidates,
-    std::vector<DecoderState*>& candidatePtrs,
-    std::vector<DecoderState>& outputs,
-    const int beamSize,
-    const double threshold,
-    const bool logAdd,
-    const bool returnSorted) {
-  outputs.clear();
-  if (candidates.empty()) {
-    return;
-  }
-
-  /* 1. Select valid candidates */
-  for (auto& candidate : candidates) {
-    if (candidate.score >= threshold) {
-      candidatePtrs.emplace_back(&candidate);
-    }
+void candidatesMergeScore(
+    DecoderState* merged,
+    const DecoderState* node,
+    const bool logAdd) {
+  double maxScore = std::max(merged->score, node->score);
+  if (logAdd) {
+    double minScore = std::min(merged->score, node->score);
+    merged->score = maxScore + std::log1p(std::exp(minScore - maxScore));
+  } else {
+    merged->score = maxScore;
   }
+}
 
-  /* 2. Merge candidates */
+template <class DecoderState>
+void candidatesMergeSorted(
+    std::vector<DecoderState*>& candidatePtrs,
+    const bool logAdd) {
   std::sort(
       candidatePtrs.begin(),
       candidatePtrs.end(),
@@ -100,20 +119,123 @@ void candidatesStore(
       nHypAfterMerging++;
     } else {
       // Same candidate
-      double maxScore = std::max(
-          candidatePtrs[nHypAfterMerging - 1]->score, candidatePtrs[i]->score);
-      if (logAdd) {
-        double minScore = std::min(
-            candidatePtrs[nHypAfterMerging - 1]->score,
-            candidatePtrs[i]->score);
-        candidatePtrs[nHypAfterMerging - 1]->score =
-            maxScore + std::log1p(std::exp(minScore - maxScore));
-      } else {
-        candidatePtrs[nHypAfterMerging - 1]->score = maxScore;
+      candidatesMergeScore(
+          candidatePtrs[nHypAfterMerging - 1], candidatePtrs[i], logAdd);
+    }
+  }
+  candidatePtrs.resize(nHypAfterMerging);
+}
+
+/**
+ * Same as candidatesMergeSorted(), but groups candidates with a hash table on
+ * the states and keeps them in their original order. Within a group, scores
+ * are merged in decreasing order, like after sorting, so that log-adds give
+ * the same results.
+ */
+template <class DecoderState>
+void candidatesMergeHashed(
+    std::vector<DecoderState*>& candidatePtrs,
+    const bool logAdd,
+    CandidateHashTable& table) {
+  const int nCandidates = candidatePtrs.size();
+  int nBits = 1;
+  while ((1 << nBits) < 2 * nCandidates) {
+    nBits++;
+  }
+  const size_t mask = (size_t(1) << nBits) - 1;
+  table.buckets.assign(mask + 1, -1);
+  table.next.assign(nCandidates, -1);
+  table.tail.resize(nCandidates);
+  table.heads.clear();
+
+  /* 1. Group candidates with the same state */
+  for (int i = 0; i < nCandidates; i++) {
+    // Multiplicative hashing: the high bits mix all the bits of the hash
+    uint64_t hash = candidatePtrs[i]->hashNoScoreStates();
+    size_t bucket = (hash * 0x9E3779B97F4A7C15ULL) >> (64 - nBits);
+    while (true) {
+      int head = table.buckets[bucket];
+      if (head < 0) {
+        table.buckets[bucket] = i;
+        table.tail[i] = i;
+        table.heads.push_back(i);
+        break;
+      }
+      if (candidatePtrs[head]->compareNoScoreStates(candidatePtrs[i]) == 0) {
+        table.next[table.tail[head]] = i;
+        table.tail[head] = i;
+        break;
+      }
+      bucket = (bucket + 1) & mask;
+    }
+  }
+
+  /* 2. Merge groups. Candidates of a group come after its head, so the
+   * merged candidates can be written in place. */
+  int nHypAfterMerging = 0;
+  for (int head : table.heads) {
+    DecoderState* merged = candidatePtrs[head];
+    if (table.next[head] >= 0) {
+      // Sort the group by decreasing score (insertion sort: groups are small)
+      table.group.clear();
+      for (int i = head; i >= 0; i = table.next[i]) {
+        int j = table.group.size();
+        table.group.push_back(i);
+        while (j > 0 &&
+               candidatePtrs[table.group[j - 1]]->score <
+                   candidatePtrs[i]->score) {
+          table.group[j] = table.group[j - 1];
+          j--;
+        }
+        table.group[j] = i;
+      }
+      merged = candidatePtrs[table.group[0]];
+      for (int j = 1; j < table.group.size(); j++) {
+        candidatesMergeScore(merged, candidatePtrs[table.group[j]], logAdd);
       }
     }
+    candidatePtrs[nHypAfterMerging] = merged;
+    nHypAfterMerging++;
   }
   candidatePtrs.resize(nHypAfterMerging);
+}
+
+/**
+ * Merge the candidates with the same state, and move the `beamSize` best ones
+ * with a score above `threshold` to `outputs`. `hashTable` is the scratch
+ * space used for MergeMode::HASH, if it should be reused across calls.
+ */
+template <class DecoderState>
+void candidatesStore(
+    std::vector<DecoderState>& candidates,
+    std::vector<DecoderState*>& candidatePtrs,
+    std::vector<DecoderState>& outputs,
+    const int beamSize,
+    const double threshold,
+    const bool logAdd,
+    const bool returnSorted,
+    const MergeMode mergeMode = MergeMode::SORT,
+    CandidateHashTable* hashTable = nullptr) {
+  outputs.clear();
+  if (candidates.empty()) {
+    return;
+  }
+
+  /* 1. Select valid candidates */
+  for (auto& candidate : candidates) {
+    if (candidate.score >= threshold) {
+      candidatePtrs.emplace_back(&candidate);
+    }
+  }
+
+  /* 2. Merge candidates */
+  if (mergeMode == MergeMode::HASH) {
+    CandidateHashTable localTable;
+    candidatesMergeHashed(
+        candidatePtrs, logAdd, hashTable ? *hashTable : localTable);
+  } else {
+    candidatesMergeSorted(candidatePtrs, logAdd);
+  }
 
   /* 3. Sort and prune */
   auto compareNodeScore = [](const DecoderState* node1,
@@ -261,6 +383,33 @@ void pruneAndNormalize(
 
 /* ===================== LM-related operations ===================== */
 
+/**
+ * The LM queries of a decoding frame, which are scored at once with
+ * `LM::scoreBatch()`.
+ */
+struct LMQueries {
+  std::vector<LMStatePtr> states;
+  std::vector<int> tokens;
+  std::vector<LMStatePtr> outStates;
+  std::vector<float> outScores;
+
+  void clear() {
+    states.clear();
+    tokens.clear();
+  }
+
+  /* Returns the index of the query */
+  int add(const LMStatePtr& state, int usrTokenIdx) {
+    states.push_back(state);
+    tokens.push_back(usrTokenIdx);
+    return states.size() - 1;
+  }
+
+  void score(LM& lm) {
+    lm.scoreBatch(states, tokens, outStates, outScores);
+  }
+};
+
 template <class DecoderState>
 void updateLMCache(const LMPtr& lm, std::vector<DecoderState>& hypothesis) {
   // For ConvLM update cache
@@ -7,8 +7,10 @@
  */
 
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <unordered_set>
 
 #include "flashlight/lib/text/decoder/lm/ConvLM.h"
 
@@ -49,6 +51,11 @@ ConvLM::ConvLM(
   }
 
   /* Refresh cache */
+  // The cache holds the scores of the whole vocabulary for each state
+  int64_t cacheBytes =
+      static_cast<int64_t>(beamSize_) * vocabSize_ * sizeof(float);
+  std::cerr << "[ConvLM]: cache of " << beamSize_ << " states takes "
+            << (cacheBytes >> 20) << " MB\n";
   cacheIndices_.reserve(beamSize_);
   cache_.resize(beamSize_, std::vector<float>(vocabSize_));
   slot_.reserve(beamSize_);
@@ -141,6 +148,34 @@ std::pair<LMStatePtr, float> ConvLM::finish(const LMStatePtr& state) {
   return scoreWithLmIdx(state, vocab_.getIndex(kEosToken));
 }
 
+void ConvLM::scoreBatch(
+    const std::vector<LMStatePtr>& states,
+    const std::vector<int>& usrTokenIndices,
+    std::vector<LMStatePtr>& outStates,
+    std::vector<float>& outScores) {
+  checkBatch(states, usrTokenIndices);
+  outStates.resize(states.size());
+  outScores.resize(states.size());
+  if (states.empty()) {
+    return;
+  }
+
+  std::vector<LMStatePtr> uniqueStates;
+  std::unordered_set<const LMState*> seen;
+  for (const auto& state : states) {
+    if (seen.insert(state.get()).second) {
+      uniqueStates.push_back(state);
+    }
+  }
+  updateCache(uniqueStates);
+
+  for (size_t i = 0; i < states.size(); ++i) {
+    auto stateScorePair = score(states[i], usrTokenIndices[i]);
+    outStates[i] = std::move(stateScorePair.first);
+    outScores[i] = stateScorePair.second;
+  }
+}
+
 void ConvLM::updateCache(std::vector<LMStatePtr> states) {
   int longestHistory = -1, nStates = states.size();
   if (nStates > beamSize_) {
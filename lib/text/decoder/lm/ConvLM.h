@@ -47,6 +47,13 @@ class ConvLM : public LM {
 
   std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override;
 
+  /* Runs one batched forward for all the states missing from the cache */
+  void scoreBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices,
+      std::vector<LMStatePtr>& outStates,
+      std::vector<float>& outScores) override;
+
   void updateCache(std::vector<LMStatePtr> states) override;
 
  private:
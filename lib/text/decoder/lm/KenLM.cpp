@@ -15,6 +15,12 @@ namespace fl {
 namespace lib {
 namespace text {
 
+KenLMState::~KenLMState() {
+  if (indexed) {
+    static_cast<KenLMStatePool*>(pool)->contexts.erase(ken_);
+  }
+}
+
 KenLM::KenLM(const std::string& path, const Dictionary& usrTknDict) {
   // Load LM
   model_.reset(lm::ngram::LoadVirtual(path.c_str()));
@@ -36,7 +42,8 @@ KenLM::KenLM(const std::string& path, const Dictionary& usrTknDict) {
 }
 
 LMStatePtr KenLM::start(bool startWithNothing) {
-  auto outState = std::make_shared<KenLMState>();
+  auto outState =
+      makePooledState<KenLMState>(*std::make_shared<KenLMStatePool>());
   if (startWithNothing) {
     model_->NullContextWrite(outState->ken());
   } else {
@@ -46,26 +53,82 @@ LMStatePtr KenLM::start(bool startWithNothing) {
   return outState;
 }
 
-std::pair<LMStatePtr, float> KenLM::score(
-    const LMStatePtr& state,
-    const int usrTokenIdx) {
+LMStatePtr KenLM::canonical(const std::shared_ptr<KenLMState>& state) {
+  if (state->indexed || !state->pool) {
+    return state;
+  }
+  auto& indexed =
+      static_cast<KenLMStatePool*>(state->pool)->contexts[state->ken_];
+  if (!indexed) {
+    indexed = state.get();
+    state->indexed = true;
+    return state;
+  }
+  return indexed->shared_from_this();
+}
+
+void KenLM::checkUsrTokenIdx(int usrTokenIdx) const {
   if (usrTokenIdx < 0 || usrTokenIdx >= usrToLmIdxMap_.size()) {
     throw std::runtime_error(
         "[KenLM] Invalid user token index: " + std::to_string(usrTokenIdx));
   }
+}
+
+std::pair<LMStatePtr, float> KenLM::score(
+    const LMStatePtr& state,
+    const int usrTokenIdx) {
+  checkUsrTokenIdx(usrTokenIdx);
   auto inState = std::static_pointer_cast<KenLMState>(state);
   auto outState = inState->child<KenLMState>(usrTokenIdx);
-  float score = model_->BaseScore(
-      inState->ken(), usrToLmIdxMap_[usrTokenIdx], outState->ken());
-  return std::make_pair(std::move(outState), score);
+  if (!outState->hasScore) {
+    outState->score = model_->BaseScore(
+        inState->ken(), usrToLmIdxMap_[usrTokenIdx], outState->ken());
+    outState->hasScore = true;
+  }
+  return std::make_pair(canonical(outState), outState->score);
+}
+
+void KenLM::scoreBatch(
+    const std::vector<LMStatePtr>& states,
+    const std::vector<int>& usrTokenIndices,
+    std::vector<LMStatePtr>& outStates,
+    std::vector<float>& outScores) {
+  checkBatch(states, usrTokenIndices);
+  outStates.resize(states.size());
+  outScores.resize(states.size());
+
+  // Resolve all the output states first: most queries of a frame were
+  // already answered in previous frames, and only the remaining ones go
+  // through n-gram lookups, back to back
+  for (size_t i = 0; i < states.size(); ++i) {
+    checkUsrTokenIdx(usrTokenIndices[i]);
+    outStates[i] = static_cast<KenLMState*>(states[i].get())
+                       ->child<KenLMState>(usrTokenIndices[i]);
+  }
+  for (size_t i = 0; i < states.size(); ++i) {
+    auto* outState = static_cast<KenLMState*>(outStates[i].get());
+    if (!outState->hasScore) {
+      outState->score = model_->BaseScore(
+          static_cast<KenLMState*>(states[i].get())->ken(),
+          usrToLmIdxMap_[usrTokenIndices[i]],
+          outState->ken());
+      outState->hasScore = true;
+    }
+    outScores[i] = outState->score;
+    outStates[i] =
+        canonical(std::static_pointer_cast<KenLMState>(outStates[i]));
+  }
 }
 
 std::pair<LMStatePtr, float> KenLM::finish(const LMStatePtr& state) {
   auto inState = std::static_pointer_cast<KenLMState>(state);
   auto outState = inState->child<KenLMState>(-1);
-  float score =
-      model_->BaseScore(inState->ken(), vocab_->EndSentence(), outState->ken());
-  return std::make_pair(std::move(outState), score);
+  if (!outState->hasScore) {
+    outState->score = model_->BaseScore(
+        inState->ken(), vocab_->EndSentence(), outState->ken());
+    outState->hasScore = true;
+  }
+  return std::make_pair(canonical(outState), outState->score);
 }
 } // namespace text
 } // namespace lib
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <functional>
+#include <unordered_map>
+
 #include "flashlight/lib/text/decoder/lm/LM.h"
 #include "flashlight/lib/text/dictionary/Dictionary.h"
 
@@ -22,11 +25,47 @@ namespace text {
  * https://github.com/kpu/kenlm/blob/master/lm/state.hh.
  */
 
-struct KenLMState : LMState {
+struct KenLMState : LMState, std::enable_shared_from_this<KenLMState> {
   lm::ngram::State ken_;
   lm::ngram::State* ken() {
     return &ken_;
   }
+
+  // Score of the transition from the parent state to this state. A state is
+  // reached again and again from the same parent while decoding, so the
+  // n-gram lookup is only done once.
+  float score{0};
+  bool hasScore{false};
+
+  // Whether this state is the one indexed by its n-gram context in its pool
+  bool indexed{false};
+
+  ~KenLMState();
+};
+
+struct KenLMStateHash {
+  size_t operator()(const lm::ngram::State& state) const {
+    return hash_value(state);
+  }
+};
+
+/**
+ * The pool of the states of one KenLM state tree, which also indexes them by
+ * n-gram context. Scoring returns the first state reached with a given
+ * context, so hypotheses which only differ by history beyond the model order
+ * share a state and get merged by decoders. Other states reached with the
+ * same context are only kept by their parent to cache their score.
+ */
+struct KenLMStatePool : LMStatePool {
+  using ContextMap = std::unordered_map<
+      lm::ngram::State,
+      KenLMState*,
+      KenLMStateHash,
+      std::equal_to<lm::ngram::State>,
+      LMStatePoolAllocator<std::pair<const lm::ngram::State, KenLMState*>>>;
+
+  // Nodes are allocated from the pool itself
+  ContextMap contexts{ContextMap::allocator_type(this)};
 };
 
 /**
@@ -44,9 +83,20 @@ class KenLM : public LM {
 
   std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override;
 
+  void scoreBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices,
+      std::vector<LMStatePtr>& outStates,
+      std::vector<float>& outScores) override;
+
  private:
   std::shared_ptr<lm::base::Model> model_;
   const lm::base::Vocabulary* vocab_;
+
+  void checkUsrTokenIdx(int usrTokenIdx) const;
+
+  /* Return the state indexed with the context of `state` in its pool */
+  static LMStatePtr canonical(const std::shared_ptr<KenLMState>& state);
 };
 
 using KenLMPtr = std::shared_ptr<KenLM>;
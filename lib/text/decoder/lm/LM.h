@@ -8,24 +8,38 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "flashlight/lib/text/decoder/lm/LMStatePool.h"
+
 namespace fl {
 namespace lib {
 namespace text {
 
 struct LMState {
-  std::unordered_map<int, std::shared_ptr<LMState>> children;
+  using ChildMap = std::unordered_map<
+      int,
+      std::shared_ptr<LMState>,
+      std::hash<int>,
+      std::equal_to<int>,
+      LMStatePoolAllocator<std::pair<const int, std::shared_ptr<LMState>>>>;
+
+  ChildMap children;
+
+  // Pool the state was allocated from, if any. Children are allocated from
+  // the same pool.
+  LMStatePool* pool{nullptr};
 
   template <typename T>
   std::shared_ptr<T> child(int usrIdx) {
     auto s = children.find(usrIdx);
     if (s == children.end()) {
-      auto state = std::make_shared<T>();
+      auto state = pool ? makePooledState<T>(*pool) : std::make_shared<T>();
       children[usrIdx] = state;
       return state;
     } else {
@@ -74,6 +88,28 @@ class LM {
   /* Query the language model and finish decoding. */
   virtual std::pair<LMStatePtr, float> finish(const LMStatePtr& state) = 0;
 
+  /**
+   * Query the language model for a batch of (state, token) pairs. This is
+   * equivalent to calling `score` on each pair in order, but lets language
+   * models share work between queries: decoders issue all the queries of a
+   * frame at once. `outStates` and `outScores` are resized to the number of
+   * queries.
+   */
+  virtual void scoreBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices,
+      std::vector<LMStatePtr>& outStates,
+      std::vector<float>& outScores) {
+    checkBatch(states, usrTokenIndices);
+    outStates.resize(states.size());
+    outScores.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+      auto stateScorePair = score(states[i], usrTokenIndices[i]);
+      outStates[i] = std::move(stateScorePair.first);
+      outScores[i] = stateScorePair.second;
+    }
+  }
+
   /* Update LM caches (optional) given a bunch of new states generated */
   virtual void updateCache(std::vector<LMStatePtr> stateIdices) {}
 
@@ -82,6 +118,15 @@ class LM {
  protected:
   /* Map indices from acoustic model to LM for each valid token. */
   std::vector<int> usrToLmIdxMap_;
+
+  void checkBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices) const {
+    if (states.size() != usrTokenIndices.size()) {
+      throw std::invalid_argument(
+          "[LM] scoreBatch: states and tokens have different sizes");
+    }
+  }
 };
 
 using LMPtr = std::shared_ptr<LM>;
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/lm/LMStatePool.h"
+
+#include <new>
+#include <stdexcept>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+namespace {
+// Blocks are aligned like memory returned by operator new
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+size_t roundUp(size_t bytes) {
+  return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+} // namespace
+
+constexpr size_t LMStatePool::kDefaultSlabBytes;
+
+LMStatePool::LMStatePool(size_t slabBytes) : slabBytes_(roundUp(slabBytes)) {
+  if (slabBytes_ == 0) {
+    throw std::invalid_argument("[LMStatePool] slab size must be positive");
+  }
+}
+
+LMStatePool::~LMStatePool() = default;
+
+LMStatePool::FreeBlock*& LMStatePool::freeList(size_t bytes) {
+  for (auto& list : freeLists_) {
+    if (list.first == bytes) {
+      return list.second;
+    }
+  }
+  freeLists_.emplace_back(bytes, nullptr);
+  return freeLists_.back().second;
+}
+
+void* LMStatePool::allocate(size_t bytes) {
+  bytes = roundUp(bytes);
+  // Large blocks would waste most of a slab
+  if (bytes > slabBytes_ / 8) {
+    return ::operator new(bytes);
+  }
+  ++liveBlocks_;
+  auto& head = freeList(bytes);
+  if (head) {
+    void* ptr = head;
+    head = head->next;
+    return ptr;
+  }
+  if (slabEnd_ - slabCur_ < static_cast<std::ptrdiff_t>(bytes)) {
+    slabs_.emplace_back(new char[slabBytes_]);
+    slabCur_ = slabs_.back().get();
+    slabEnd_ = slabCur_ + slabBytes_;
+  }
+  void* ptr = slabCur_;
+  slabCur_ += bytes;
+  return ptr;
+}
+
+void LMStatePool::deallocate(void* ptr, size_t bytes) {
+  bytes = roundUp(bytes);
+  if (bytes > slabBytes_ / 8) {
+    ::operator delete(ptr);
+    return;
+  }
+  --liveBlocks_;
+  auto& head = freeList(bytes);
+  auto* block = static_cast<FreeBlock*>(ptr);
+  block->next = head;
+  head = block;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * LMStatePool is a slab allocator for the language model states of one
+ * decoding pass. A language model creates a pool in `start()`, and every state
+ * of the tree rooted at the returned state is allocated from it, together with
+ * its reference counts. Freed blocks are kept in per-size free lists and
+ * reused, and the slabs are released at once when the last state of the tree
+ * is destroyed, so decoding an utterance does not go through the system
+ * allocator for each new state.
+ *
+ * Like the state tree itself, a pool is not thread-safe: states of a tree must
+ * not be created or destroyed concurrently.
+ */
+class LMStatePool : public std::enable_shared_from_this<LMStatePool> {
+ public:
+  static constexpr size_t kDefaultSlabBytes = 64 * 1024;
+
+  explicit LMStatePool(size_t slabBytes = kDefaultSlabBytes);
+  ~LMStatePool();
+
+  LMStatePool(const LMStatePool&) = delete;
+  LMStatePool& operator=(const LMStatePool&) = delete;
+
+  void* allocate(size_t bytes);
+  void deallocate(void* ptr, size_t bytes);
+
+  /* Number of bytes reserved in slabs */
+  size_t reservedBytes() const {
+    return slabs_.size() * slabBytes_;
+  }
+
+  /* Number of blocks currently allocated */
+  size_t liveBlocks() const {
+    return liveBlocks_;
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  size_t slabBytes_;
+  std::vector<std::unique_ptr<char[]>> slabs_;
+  char* slabCur_{nullptr};
+  char* slabEnd_{nullptr};
+  // Free lists, one per block size. Only a few sizes are in use at a time
+  // (one per state type), so a linear search is the fastest lookup.
+  std::vector<std::pair<size_t, FreeBlock*>> freeLists_;
+  size_t liveBlocks_{0};
+
+  FreeBlock*& freeList(size_t bytes);
+};
+
+/**
+ * A standard allocator drawing from a LMStatePool. It either keeps the pool
+ * alive, for the state blocks themselves, or only refers to it, for the
+ * containers of a pooled state or of the pool. Without a pool it falls back to
+ * operator new, so that containers of states created outside of a pool work
+ * as usual.
+ */
+template <typename T>
+class LMStatePoolAllocator {
+ public:
+  using value_type = T;
+  // Containers take the allocator of the container they are assigned from
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit LMStatePoolAllocator(std::shared_ptr<LMStatePool> pool)
+      : pool_(pool.get()), owner_(std::move(pool)) {}
+
+  explicit LMStatePoolAllocator(LMStatePool* pool = nullptr) : pool_(pool) {}
+
+  template <typename U>
+  LMStatePoolAllocator(const LMStatePoolAllocator<U>& other)
+      : pool_(other.pool_), owner_(other.owner_) {}
+
+  T* allocate(size_t n) {
+    if (!pool_) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (!pool_) {
+      ::operator delete(ptr);
+      return;
+    }
+    pool_->deallocate(ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const LMStatePoolAllocator<U>& other) const {
+    return pool_ == other.pool_;
+  }
+
+  template <typename U>
+  bool operator!=(const LMStatePoolAllocator<U>& other) const {
+    return pool_ != other.pool_;
+  }
+
+ private:
+  template <typename U>
+  friend class LMStatePoolAllocator;
+
+  LMStatePool* pool_;
+  std::shared_ptr<LMStatePool> owner_;
+};
+
+/**
+ * Create a `T` in `pool`, with its reference counts in the same block. The
+ * state records the pool so that its children, and the nodes of its map of
+ * children, are allocated from it too.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooledState(LMStatePool& pool, Args&&... args) {
+  using ChildMap = typename T::ChildMap;
+  auto state = std::allocate_shared<T>(
+      LMStatePoolAllocator<T>(pool.shared_from_this()),
+      std::forward<Args>(args)...);
+  state->pool = &pool;
+  state->children = ChildMap(typename ChildMap::allocator_type(&pool));
+  return state;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
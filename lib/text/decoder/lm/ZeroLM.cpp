@@ -14,7 +14,7 @@ namespace lib {
 namespace text {
 
 LMStatePtr ZeroLM::start(bool /* unused */) {
-  return std::make_shared<LMState>();
+  return makePooledState<LMState>(*std::make_shared<LMStatePool>());
 }
 
 std::pair<LMStatePtr, float> ZeroLM::score(
@@ -26,6 +26,19 @@ std::pair<LMStatePtr, float> ZeroLM::score(
 std::pair<LMStatePtr, float> ZeroLM::finish(const LMStatePtr& state) {
   return std::make_pair(state, 0.0);
 }
+
+void ZeroLM::scoreBatch(
+    const std::vector<LMStatePtr>& states,
+    const std::vector<int>& usrTokenIndices,
+    std::vector<LMStatePtr>& outStates,
+    std::vector<float>& outScores) {
+  checkBatch(states, usrTokenIndices);
+  outStates.resize(states.size());
+  outScores.assign(states.size(), 0.0);
+  for (size_t i = 0; i < states.size(); ++i) {
+    outStates[i] = states[i]->child<LMState>(usrTokenIndices[i]);
+  }
+}
 } // namespace text
 } // namespace lib
 } // namespace fl
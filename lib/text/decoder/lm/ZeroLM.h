@@ -26,6 +26,12 @@ class ZeroLM : public LM {
       const int usrTokenIdx) override;
 
   std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override;
+
+  void scoreBatch(
+      const std::vector<LMStatePtr>& states,
+      const std::vector<int>& usrTokenIndices,
+      std::vector<LMStatePtr>& outStates,
+      std::vector<float>& outScores) override;
 };
 } // namespace text
 } // namespace lib